@@ -23,6 +23,7 @@
 #include "network/EntityRemoveHandler.h"
 #include "network/EntitySpawnHandler.h"
 #include "network/EntityUpdateHandler.h"
+#include "network/EntityUpdatesHandler.h"
 #include "network/UserSpawnHandler.h"
 #include "voxel/MaterialColor.h"
 #include "core/Rest.h"
@@ -120,6 +121,7 @@ core::AppState Client::onInit() {
 	regHandler(network::ServerMsgType::EntitySpawn, EntitySpawnHandler);
 	regHandler(network::ServerMsgType::EntityRemove, EntityRemoveHandler);
 	regHandler(network::ServerMsgType::EntityUpdate, EntityUpdateHandler);
+	regHandler(network::ServerMsgType::EntityUpdates, EntityUpdatesHandler, _messageSender);
 	regHandler(network::ServerMsgType::UserSpawn, UserSpawnHandler);
 	regHandler(network::ServerMsgType::AuthFailed, AuthFailedHandler);
 	regHandler(network::ServerMsgType::Seed, SeedHandler, _world);
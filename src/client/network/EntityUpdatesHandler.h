@@ -0,0 +1,36 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "IClientProtocolHandler.h"
+#include "network/EntityUpdates.h"
+#include "network/ClientMessageSender.h"
+
+/**
+ * Restores the delta compressed states of the batched entity updates, updates the
+ * @c frontend::ClientEntity instances and acks the received updates
+ */
+class EntityUpdatesHandler: public IClientProtocolHandler<EntityUpdates> {
+private:
+	network::ClientMessageSenderPtr _messageSender;
+	network::EntityUpdatesDecoder _decoder;
+	flatbuffers::FlatBufferBuilder _ackFbb;
+public:
+	EntityUpdatesHandler(const network::ClientMessageSenderPtr& messageSender) :
+			_messageSender(messageSender) {
+	}
+
+	void execute(Client* client, const EntityUpdates* message) override {
+		const bool decoded = _decoder.decode(message, [client] (int64_t id, const glm::vec3& pos, float orientation) {
+			client->entityUpdate(id, pos, orientation);
+		});
+		if (!decoded) {
+			// the server will send the full states again if we don't ack
+			return;
+		}
+		_messageSender->sendClientMessage(_ackFbb, ClientMsgType::EntityUpdatesAck,
+				CreateEntityUpdatesAck(_ackFbb, message->sequence()).Union(), 0u);
+	}
+};
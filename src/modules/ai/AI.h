@@ -46,15 +46,64 @@ class AI : public NonCopyable, public std::enable_shared_from_this<AI> {
 	friend class Server;
 protected:
 	/**
-	 * This map is only filled if we are in debugging mode for this entity
+	 * @brief The per node states of the behaviour tree. Every node has a dense index in its tree
+	 * (see @ai{TreeNode::compileStateIndices()}) that is used to address the entries.
 	 */
-	typedef std::unordered_map<int, TreeNodeStatus> NodeStates;
-	NodeStates _lastStatus;
+	struct TreeStates {
+		/**
+		 * Only filled if we are in debugging mode for this entity
+		 */
+		std::vector<TreeNodeStatus> lastStatus;
+		/**
+		 * Only filled if we are in debugging mode for this entity
+		 */
+		std::vector<int64_t> lastExecMillis;
+		/**
+		 * Often @ai{Selector} states must be stored to continue in the next step at a particular
+		 * position in the behaviour tree.
+		 */
+		std::vector<int> selectorStates;
+		/**
+		 * The amount of executions for the @ai{Limit} node
+		 */
+		std::vector<int> limitStates;
+
+		inline size_t size() const {
+			return selectorStates.size();
+		}
+
+		inline void resize(size_t size) {
+			lastStatus.resize(size, UNKNOWN);
+			lastExecMillis.resize(size, -1L);
+			selectorStates.resize(size, AI_NOTHING_SELECTED);
+			limitStates.resize(size, 0);
+		}
+
+		/**
+		 * @param[in] limits Whether the limit states are reset, too
+		 */
+		inline void reset(bool limits) {
+			std::fill(lastStatus.begin(), lastStatus.end(), UNKNOWN);
+			std::fill(lastExecMillis.begin(), lastExecMillis.end(), -1L);
+			std::fill(selectorStates.begin(), selectorStates.end(), AI_NOTHING_SELECTED);
+			if (limits) {
+				std::fill(limitStates.begin(), limitStates.end(), 0);
+			}
+		}
+	};
+	TreeStates _treeStates;
+	// the behaviour tree the states belong to
+	const TreeNode* _treeStatesBehaviour = nullptr;
+	// the amount of state entries of the compiled behaviour tree - the entries of nodes that are not
+	// part of it are stored behind them
+	int _treeStatesSize = 0;
+	std::unordered_map<const TreeNode*, int> _localStateIndices;
+
 	/**
-	 * This map is only filled if we are in debugging mode for this entity
+	 * @brief Makes sure that the state block contains an entry for the given node
+	 * @return The state index of the given node
 	 */
-	typedef std::unordered_map<int, uint64_t> LastExecMap;
-	LastExecMap _lastExecMillis;
+	int prepareTreeStates(const TreeNode* node);
 
 	/**
 	 * @note The filtered entities are kept even over several ticks. The caller should decide
@@ -67,19 +116,6 @@ protected:
 
 	void addFilteredEntity(CharacterId id);
 
-	/**
-	 * Often @ai{Selector} states must be stored to continue in the next step at a particular
-	 * position in the behaviour tree. This map is doing exactly this.
-	 */
-	typedef std::unordered_map<int, int> SelectorStates;
-	SelectorStates _selectorStates;
-
-	/**
-	 * This map stores the amount of execution for the @ai{Limit} node. The key is the node id
-	 */
-	typedef std::unordered_map<int, int> LimitStates;
-	LimitStates _limitStates;
-
 	TreeNodePtr _behaviour;
 	AggroMgr _aggroMgr;
 
@@ -99,6 +135,10 @@ public:
 	 */
 	explicit AI(const TreeNodePtr& behaviour) :
 			_behaviour(behaviour), _pause(false), _debuggingActive(false), _time(0L), _zone(nullptr), _reset(false) {
+		if (_behaviour && _behaviour->getStateSize() <= 0) {
+			// trees that were not created by a loader
+			TreeNode::compileStateIndices(_behaviour.get());
+		}
 	}
 	virtual ~AI() {
 	}
@@ -202,6 +242,10 @@ inline TreeNodePtr AI::getBehaviour() const {
 }
 
 inline TreeNodePtr AI::setBehaviour(const TreeNodePtr& newBehaviour) {
+	if (newBehaviour && newBehaviour->getStateSize() <= 0) {
+		// trees that were not created by a loader
+		TreeNode::compileStateIndices(newBehaviour.get());
+	}
 	TreeNodePtr current = _behaviour;
 	_behaviour = newBehaviour;
 	_reset = true;
@@ -284,10 +328,10 @@ inline void AI::update(int64_t dt, bool debuggingActive) {
 	if (_reset) {
 		// safe to do it like this, because update is not called from multiple threads
 		_reset = false;
-		_lastStatus.clear();
-		_lastExecMillis.clear();
+		// the limits are only kept as long as the behaviour tree is the same
+		// if the tree was replaced, the state block is rebuilt by prepareTreeStates()
+		_treeStates.reset(_treeStatesBehaviour != _behaviour.get());
 		_filteredEntities.clear();
-		_selectorStates.clear();
 	}
 
 	_debuggingActive = debuggingActive;
@@ -295,6 +339,39 @@ inline void AI::update(int64_t dt, bool debuggingActive) {
 	_aggroMgr.update(dt);
 }
 
+inline int AI::prepareTreeStates(const TreeNode* node) {
+	if (_treeStatesBehaviour != _behaviour.get()) {
+		// the states of another behaviour tree are not valid for this one
+		_treeStates.resize(0);
+		_treeStatesSize = 0;
+		_localStateIndices.clear();
+		_treeStatesBehaviour = _behaviour.get();
+	}
+	// the shared tree is compiled when it is loaded or modified - never from here, other entities
+	// might execute it at the same time
+	const int size = _behaviour ? _behaviour->getStateSize() : 0;
+	if (size > _treeStatesSize) {
+		// the tree grew - the entries of the nodes that were not part of it are given up
+		_treeStates.resize(_treeStatesSize);
+		_treeStates.resize(size);
+		_treeStatesSize = size;
+		_localStateIndices.clear();
+	}
+	const int index = node->getStateIndex();
+	if (index >= 0 && index < _treeStatesSize) {
+		return index;
+	}
+	// the node is not part of the compiled behaviour tree of this entity - it gets its own entry
+	auto i = _localStateIndices.find(node);
+	if (i != _localStateIndices.end()) {
+		return i->second;
+	}
+	const int localIndex = (int)_treeStates.size();
+	_treeStates.resize(localIndex + 1);
+	_localStateIndices.emplace(node, localIndex);
+	return localIndex;
+}
+
 typedef std::shared_ptr<AI> AIPtr;
 
 }
@@ -35,6 +35,9 @@
 #include "filter/SelectGroupLeader.h"
 #include "filter/SelectGroupMembers.h"
 #include "filter/SelectZone.h"
+#include "filter/SelectInRadius.h"
+#include "filter/SelectKNearest.h"
+#include "filter/SelectInFieldOfView.h"
 #include "filter/Union.h"
 #include "filter/Intersection.h"
 #include "filter/Last.h"
@@ -113,6 +116,9 @@ protected:
 			R_GET(SelectGroupMembers);
 			R_GET(SelectHighestAggro);
 			R_GET(SelectZone);
+			R_GET(SelectInRadius);
+			R_GET(SelectKNearest);
+			R_GET(SelectInFieldOfView);
 			R_GET(Union);
 			R_GET(Intersection);
 			R_GET(Last);
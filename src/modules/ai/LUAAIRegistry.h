@@ -6,6 +6,7 @@
 
 #include "AIRegistry.h"
 #include "LUAFunctions.h"
+#include "LUAStatePool.h"
 #include "tree/LUATreeNode.h"
 #include "conditions/LUACondition.h"
 #include "filter/LUAFilter.h"
@@ -65,10 +66,16 @@ namespace ai {
  * @par AI metatable
  * There is a metatable that you can modify by calling @ai{LUAAIRegistry::pushAIMetatable()}.
  * This metatable is applied to all @ai{AI} pointers that are forwarded to the lua functions.
+ *
+ * @par Threads
+ * Every thread that executes lua nodes, conditions, filters or steerings gets its own lua state
+ * (see @ai{LUAStatePool}) - so lua behaviour can be executed by the parallel zone updates. All states
+ * load the scripts that were given to @ai{LUAAIRegistry::evaluate()}. The metatable modifications
+ * via @ai{LUAAIRegistry::pushAIMetatable()} only apply to the state of the calling thread.
  */
 class LUAAIRegistry : public AIRegistry {
 protected:
-	lua_State* _s = nullptr;
+	LUAStatePool _statePool;
 
 	using LuaNodeFactory = LUATreeNode::LUATreeNodeFactory;
 	typedef std::shared_ptr<LuaNodeFactory> LUATreeNodeFactoryPtr;
@@ -92,6 +99,30 @@ protected:
 	FilterFactoryMap _filterFactories;
 	SteeringFactoryMap _steeringFactories;
 
+	/**
+	 * @brief The main state registers the factory for the given type - the other states of the pool
+	 * only replay the scripts of the main state and get the already registered factory.
+	 * @return @c nullptr if the type is already registered (main state) or unknown (other states)
+	 */
+	template<class Factory, class FactoryMap, class RegisterFunc>
+	Factory* getOrRegisterFactory(lua_State* s, const std::string& type, FactoryMap& factories, RegisterFunc registerFactory) {
+		if (!LUAStatePool::isMainState(s)) {
+			ScopedReadLock scopedLock(_lock);
+			auto i = factories.find(type);
+			if (i == factories.end()) {
+				return nullptr;
+			}
+			return i->second.get();
+		}
+		const std::shared_ptr<Factory>& factory = std::make_shared<Factory>(&_statePool, type);
+		if (!registerFactory(type, *factory)) {
+			return nullptr;
+		}
+		ScopedWriteLock scopedLock(_lock);
+		factories.emplace(type, factory);
+		return factory.get();
+	}
+
 	/***
 	 * Gives you access the the light userdata for the LUAAIRegistry.
 	 * @return the registry userdata
@@ -164,13 +195,13 @@ protected:
 	static int luaAI_createnode(lua_State* s) {
 		LUAAIRegistry* r = luaAI_toregistry(s);
 		const std::string type = luaL_checkstring(s, -1);
-		const LUATreeNodeFactoryPtr& factory = std::make_shared<LuaNodeFactory>(s, type);
-		const bool inserted = r->registerNodeFactory(type, *factory);
-		if (!inserted) {
-			return luaL_error(s, "tree node %s is already registered", type.c_str());
+		LuaNodeFactory* factory = r->getOrRegisterFactory<LuaNodeFactory>(s, type, r->_treeNodeFactories,
+				[r] (const std::string& t, const LuaNodeFactory& f) { return r->registerNodeFactory(t, f); });
+		if (factory == nullptr) {
+			return luaL_error(s, "tree node %s is already registered or unknown", type.c_str());
 		}
 
-		luaAI_newuserdata<LuaNodeFactory*>(s, factory.get());
+		luaAI_newuserdata<LuaNodeFactory*>(s, factory);
 		const luaL_Reg nodes[] = {
 			{"execute", luaAI_nodeemptyexecute},
 			{"__tostring", luaAI_nodetostring},
@@ -178,8 +209,6 @@ protected:
 			{nullptr, nullptr}
 		};
 		luaAI_setupmetatable(s, type, nodes, "node");
-		ScopedWriteLock scopedLock(r->_lock);
-		r->_treeNodeFactories.emplace(type, factory);
 		return 1;
 	}
 
@@ -206,13 +235,13 @@ protected:
 	static int luaAI_createcondition(lua_State* s) {
 		LUAAIRegistry* r = luaAI_toregistry(s);
 		const std::string type = luaL_checkstring(s, -1);
-		const LUAConditionFactoryPtr& factory = std::make_shared<LuaConditionFactory>(s, type);
-		const bool inserted = r->registerConditionFactory(type, *factory);
-		if (!inserted) {
-			return luaL_error(s, "condition %s is already registered", type.c_str());
+		LuaConditionFactory* factory = r->getOrRegisterFactory<LuaConditionFactory>(s, type, r->_conditionFactories,
+				[r] (const std::string& t, const LuaConditionFactory& f) { return r->registerConditionFactory(t, f); });
+		if (factory == nullptr) {
+			return luaL_error(s, "condition %s is already registered or unknown", type.c_str());
 		}
 
-		luaAI_newuserdata<LuaConditionFactory*>(s, factory.get());
+		luaAI_newuserdata<LuaConditionFactory*>(s, factory);
 		const luaL_Reg nodes[] = {
 			{"evaluate", luaAI_conditionemptyevaluate},
 			{"__tostring", luaAI_conditiontostring},
@@ -220,8 +249,6 @@ protected:
 			{nullptr, nullptr}
 		};
 		luaAI_setupmetatable(s, type, nodes, "condition");
-		ScopedWriteLock scopedLock(r->_lock);
-		r->_conditionFactories.emplace(type, factory);
 		return 1;
 	}
 
@@ -244,13 +271,13 @@ protected:
 	static int luaAI_createfilter(lua_State* s) {
 		LUAAIRegistry* r = luaAI_toregistry(s);
 		const std::string type = luaL_checkstring(s, -1);
-		const LUAFilterFactoryPtr& factory = std::make_shared<LuaFilterFactory>(s, type);
-		const bool inserted = r->registerFilterFactory(type, *factory);
-		if (!inserted) {
-			return luaL_error(s, "filter %s is already registered", type.c_str());
+		LuaFilterFactory* factory = r->getOrRegisterFactory<LuaFilterFactory>(s, type, r->_filterFactories,
+				[r] (const std::string& t, const LuaFilterFactory& f) { return r->registerFilterFactory(t, f); });
+		if (factory == nullptr) {
+			return luaL_error(s, "filter %s is already registered or unknown", type.c_str());
 		}
 
-		luaAI_newuserdata<LuaFilterFactory*>(s, factory.get());
+		luaAI_newuserdata<LuaFilterFactory*>(s, factory);
 		const luaL_Reg nodes[] = {
 			{"filter", luaAI_filteremptyfilter},
 			{"__tostring", luaAI_filtertostring},
@@ -258,9 +285,6 @@ protected:
 			{nullptr, nullptr}
 		};
 		luaAI_setupmetatable(s, type, nodes, "filter");
-
-		ScopedWriteLock scopedLock(r->_lock);
-		r->_filterFactories.emplace(type, factory);
 		return 1;
 	}
 
@@ -278,13 +302,13 @@ protected:
 	static int luaAI_createsteering(lua_State* s) {
 		LUAAIRegistry* r = luaAI_toregistry(s);
 		const std::string type = luaL_checkstring(s, -1);
-		const LUASteeringFactoryPtr& factory = std::make_shared<LuaSteeringFactory>(s, type);
-		const bool inserted = r->registerSteeringFactory(type, *factory);
-		if (!inserted) {
-			return luaL_error(s, "steering %s is already registered", type.c_str());
+		LuaSteeringFactory* factory = r->getOrRegisterFactory<LuaSteeringFactory>(s, type, r->_steeringFactories,
+				[r] (const std::string& t, const LuaSteeringFactory& f) { return r->registerSteeringFactory(t, f); });
+		if (factory == nullptr) {
+			return luaL_error(s, "steering %s is already registered or unknown", type.c_str());
 		}
 
-		luaAI_newuserdata<LuaSteeringFactory*>(s, factory.get());
+		luaAI_newuserdata<LuaSteeringFactory*>(s, factory);
 		const luaL_Reg nodes[] = {
 			{"filter", luaAI_steeringemptyexecute},
 			{"__tostring", luaAI_steeringtostring},
@@ -292,9 +316,6 @@ protected:
 			{nullptr, nullptr}
 		};
 		luaAI_setupmetatable(s, type, nodes, "steering");
-
-		ScopedWriteLock scopedLock(r->_lock);
-		r->_steeringFactories.emplace(type, factory);
 		return 1;
 	}
 
@@ -338,6 +359,8 @@ public:
 		{"ai", luaAI_zoneai},
 		{"execute", luaAI_zoneexecute},
 		{"groupMgr", luaAI_zonegroupmgr},
+		{"inRadius", luaAI_zoneinradius},
+		{"nearest", luaAI_zonenearest},
 		{"__tostring", luaAI_zonetostring},
 		{nullptr, nullptr}
 	};
@@ -411,11 +434,18 @@ public:
 	}
 
 	/**
-	 * @brief Access to the lua state.
+	 * @brief Access to the lua state of the calling thread.
 	 * @see pushAIMetatable()
 	 */
 	lua_State* getLuaState() {
-		return _s;
+		return _statePool.state();
+	}
+
+	/**
+	 * @return The amount of lua states - one for each thread that executed lua code
+	 */
+	size_t getLuaStateCount() const {
+		return _statePool.size();
 	}
 
 	/**
@@ -424,62 +454,64 @@ public:
 	 * lua functions.
 	 * @note lua_ctxai() can be used in your lua c callbacks to get access to the
 	 * @ai{AI} pointer: @code const AI* ai = lua_ctxai(s, 1); @endcode
+	 * @note This is the metatable of the lua state of the calling thread
 	 */
 	int pushAIMetatable() {
-		ai_assert(_s != nullptr, "LUA state is not yet initialized");
-		return luaL_getmetatable(_s, luaAI_metaai());
+		lua_State* s = getLuaState();
+		ai_assert(s != nullptr, "LUA state is not yet initialized");
+		return luaL_getmetatable(s, luaAI_metaai());
 	}
 
 	/**
 	 * @brief Pushes the character metatable onto the stack. This allows anyone to modify it
 	 * to provide own functions and data that is applied to the @c ai:character() value
+	 * @note This is the metatable of the lua state of the calling thread
 	 */
 	int pushCharacterMetatable() {
-		ai_assert(_s != nullptr, "LUA state is not yet initialized");
-		return luaL_getmetatable(_s, luaAI_metacharacter());
+		lua_State* s = getLuaState();
+		ai_assert(s != nullptr, "LUA state is not yet initialized");
+		return luaL_getmetatable(s, luaAI_metacharacter());
 	}
 
 	/**
-	 * @see shutdown()
+	 * @brief Sets up a new lua state of the pool - the scripts are loaded afterwards
 	 */
-	bool init() {
-		if (_s != nullptr) {
-			return true;
-		}
-		_s = luaL_newstate();
-
-		lua_atpanic(_s, [] (lua_State* L) {
-			ai_log_error("Lua panic. Error message: %s", (lua_isnil(L, -1) ? "" : lua_tostring(L, -1)));
-			return 0;
-		});
-		lua_gc(_s, LUA_GCSTOP, 0);
-		luaL_openlibs(_s);
-
-		luaAI_registerfuncs(_s, &registryFuncs.front(), "META_REGISTRY");
-		lua_setglobal(_s, "REGISTRY");
+	bool initState(lua_State* s) {
+		luaAI_registerfuncs(s, &registryFuncs.front(), "META_REGISTRY");
+		lua_setglobal(s, "REGISTRY");
 
 		// TODO: random
 
-		luaAI_globalpointer(_s, this, luaAI_metaregistry());
+		luaAI_globalpointer(s, this, luaAI_metaregistry());
 
-		luaAI_registerfuncs(_s, &aiFuncs.front(), luaAI_metaai());
-		luaAI_registerfuncs(_s, &vecFuncs.front(), luaAI_metavec());
-		luaAI_registerfuncs(_s, &zoneFuncs.front(), luaAI_metazone());
-		luaAI_registerfuncs(_s, &characterFuncs.front(), luaAI_metacharacter());
-		luaAI_registerfuncs(_s, &aggroMgrFuncs.front(), luaAI_metaaggromgr());
-		luaAI_registerfuncs(_s, &groupMgrFuncs.front(), luaAI_metagroupmgr());
+		luaAI_registerfuncs(s, &aiFuncs.front(), luaAI_metaai());
+		luaAI_registerfuncs(s, &vecFuncs.front(), luaAI_metavec());
+		luaAI_registerfuncs(s, &zoneFuncs.front(), luaAI_metazone());
+		luaAI_registerfuncs(s, &characterFuncs.front(), luaAI_metacharacter());
+		luaAI_registerfuncs(s, &aggroMgrFuncs.front(), luaAI_metaaggromgr());
+		luaAI_registerfuncs(s, &groupMgrFuncs.front(), luaAI_metagroupmgr());
 
 		const char* script = ""
 			"UNKNOWN, CANNOTEXECUTE, RUNNING, FINISHED, FAILED, EXCEPTION = 0, 1, 2, 3, 4, 5\n";
 
-		if (luaL_loadbufferx(_s, script, strlen(script), "", nullptr) || lua_pcall(_s, 0, 0, 0)) {
-			ai_log_error("%s", lua_tostring(_s, -1));
-			lua_pop(_s, 1);
+		if (luaL_loadbufferx(s, script, strlen(script), "", nullptr) || lua_pcall(s, 0, 0, 0)) {
+			ai_log_error("%s", lua_tostring(s, -1));
+			lua_pop(s, 1);
 			return false;
 		}
 		return true;
 	}
 
+	/**
+	 * @brief Creates the main lua state for the calling thread
+	 * @see shutdown()
+	 */
+	bool init() {
+		return _statePool.init([this] (lua_State* s) {
+			return initState(s);
+		});
+	}
+
 	/**
 	 * @see init()
 	 */
@@ -491,10 +523,7 @@ public:
 			_filterFactories.clear();
 			_steeringFactories.clear();
 		}
-		if (_s != nullptr) {
-			lua_close(_s);
-			_s = nullptr;
-		}
+		_statePool.shutdown();
 	}
 
 	~LUAAIRegistry() {
@@ -506,22 +535,14 @@ public:
 	}
 
 	/**
-	 * @brief Load your lua scripts into the lua state of the registry.
+	 * @brief Load your lua scripts into the lua states of the registry.
 	 * This can be called multiple times to e.g. load multiple files.
 	 * @return @c true if the lua script was loaded, @c false otherwise
 	 * @note you have to call init() before
+	 * @note Must not be called while other threads execute lua code
 	 */
 	bool evaluate(const char* luaBuffer, size_t size) {
-		if (_s == nullptr) {
-			ai_log_debug("LUA state is not yet initialized");
-			return false;
-		}
-		if (luaL_loadbufferx(_s, luaBuffer, size, "", nullptr) || lua_pcall(_s, 0, 0, 0)) {
-			ai_log_error("%s", lua_tostring(_s, -1));
-			lua_pop(_s, 1);
-			return false;
-		}
-		return true;
+		return _statePool.evaluate(luaBuffer, size);
 	}
 };
 
@@ -410,6 +410,53 @@ static int luaAI_zonesize(lua_State* s) {
 	return 1;
 }
 
+static int luaAI_pushids(lua_State* s, const std::vector<CharacterId>& ids) {
+	lua_createtable(s, (int)ids.size(), 0);
+	const int top = lua_gettop(s);
+	int i = 1;
+	for (CharacterId id : ids) {
+		lua_pushinteger(s, id);
+		lua_rawseti(s, top, i++);
+	}
+	return 1;
+}
+
+/***
+ * Get the character ids of the entities that are not further away than the given radius
+ * @tparam vec position The center of the search
+ * @tparam number radius The max distance
+ * @treturn {integer,...} The character ids
+ * @function zone:inRadius
+ */
+static int luaAI_zoneinradius(lua_State* s) {
+	const Zone* zone = luaAI_tozone(s, 1);
+	const glm::vec3* pos = luaAI_tovec(s, 2);
+	const lua_Number radius = luaL_checknumber(s, 3);
+	std::vector<CharacterId> ids;
+	zone->queryRadius(*pos, (float)radius, ids);
+	return luaAI_pushids(s, ids);
+}
+
+/***
+ * Get the character ids of the entities that are closest to the given position - the closest first
+ * @tparam vec position The center of the search
+ * @tparam integer k The max amount of entities
+ * @tparam[opt] number maxRadius The max distance
+ * @treturn {integer,...} The character ids
+ * @function zone:nearest
+ */
+static int luaAI_zonenearest(lua_State* s) {
+	const Zone* zone = luaAI_tozone(s, 1);
+	const glm::vec3* pos = luaAI_tovec(s, 2);
+	const lua_Integer k = luaL_checkinteger(s, 3);
+	const lua_Number maxRadius = luaL_optnumber(s, 4, -1.0);
+	std::vector<CharacterId> ids;
+	if (k > 0) {
+		zone->queryNearest(*pos, (size_t)k, ids, (float)maxRadius);
+	}
+	return luaAI_pushids(s, ids);
+}
+
 /***
  * Get the highest aggro entry
  * @treturn integer The current highest aggro entry character id or nil
@@ -0,0 +1,319 @@
+/***
+ * @file LUAStatePool.h
+ * @ingroup LUA
+ */
+#pragma once
+
+#include "LUAFunctions.h"
+#include "common/Thread.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ai {
+
+/**
+ * @brief One lua state per thread that executes lua code - a lua state must not be used by
+ * several threads at the same time.
+ *
+ * The main state is created in @c init() and belongs to the thread that called it. The states for
+ * all other threads are created on their first call to @c state(). Every state is set up by the
+ * same initializer and gets all the scripts that were loaded with @c evaluate() - so all states
+ * know the same functions, nodes, conditions and so on.
+ *
+ * The calling thread caches its state in a thread local - looking the state up doesn't lock the
+ * pool. The state of a thread is closed when the thread exits, all states are closed when the
+ * pool is shut down.
+ *
+ * @note Loading scripts and shutting the pool down must not happen while other threads execute
+ * lua code.
+ */
+class LUAStatePool {
+public:
+	/**
+	 * @brief Sets up a new lua state - e.g. registers the c functions. Called before the scripts
+	 * are loaded into the state.
+	 */
+	typedef std::function<bool(lua_State*)> Initializer;
+
+private:
+	/**
+	 * @brief All states of one initialized pool - shared with the threads, they close their own
+	 * state on exit. Might outlive the pool.
+	 */
+	struct States {
+		std::mutex mutex;
+		std::unordered_set<lua_State*> states;
+	};
+	typedef std::shared_ptr<States> StatesPtr;
+
+	/**
+	 * @brief The states of the calling thread - keyed by the id of the pool
+	 */
+	class ThreadStates {
+	private:
+		struct Entry {
+			std::weak_ptr<States> states;
+			lua_State* state;
+			// the main state is not closed when the thread that created the pool exits
+			bool owned;
+		};
+		std::unordered_map<uint64_t, Entry> _entries;
+
+		static void release(const Entry& entry) {
+			if (!entry.owned) {
+				return;
+			}
+			const StatesPtr& states = entry.states.lock();
+			if (!states) {
+				return;
+			}
+			std::lock_guard<std::mutex> lock(states->mutex);
+			// not part of the pool anymore if the pool was shut down in the meantime
+			if (states->states.erase(entry.state) > 0u) {
+				lua_close(entry.state);
+			}
+		}
+	public:
+		uint64_t lastId = 0u;
+		lua_State* last = nullptr;
+
+		~ThreadStates() {
+			for (const auto& e : _entries) {
+				release(e.second);
+			}
+		}
+
+		lua_State* get(uint64_t id) {
+			auto i = _entries.find(id);
+			if (i == _entries.end()) {
+				return nullptr;
+			}
+			if (i->second.states.expired()) {
+				_entries.erase(i);
+				return nullptr;
+			}
+			lastId = id;
+			last = i->second.state;
+			return last;
+		}
+
+		void put(uint64_t id, const StatesPtr& states, lua_State* state, bool owned) {
+			// forget the states of the pools that were shut down
+			for (auto i = _entries.begin(); i != _entries.end();) {
+				if (i->second.states.expired()) {
+					i = _entries.erase(i);
+				} else {
+					++i;
+				}
+			}
+			_entries[id] = Entry{states, state, owned};
+			lastId = id;
+			last = state;
+		}
+	};
+
+	static ThreadStates& threadStates() {
+		thread_local ThreadStates states;
+		return states;
+	}
+
+	static uint64_t nextId() {
+		static std::atomic<uint64_t> id(0u);
+		return ++id;
+	}
+
+	Initializer _initializer;
+	lua_State* _main = nullptr;
+	StatesPtr _states;
+	// a new id for every init() - the thread local states of an older initialization are not reused
+	std::atomic<uint64_t> _id{0u};
+	// the scripts that were successfully loaded into the main state
+	std::vector<std::string> _scripts;
+	mutable ReadWriteLock _lock{"luastatepool"};
+
+	static bool run(lua_State* s, const char* luaBuffer, size_t size) {
+		if (luaL_loadbufferx(s, luaBuffer, size, "", nullptr) || lua_pcall(s, 0, 0, 0)) {
+			ai_log_error("%s", lua_tostring(s, -1));
+			lua_pop(s, 1);
+			return false;
+		}
+		return true;
+	}
+
+	static inline const char* mainStateKey() {
+		return "__main_state";
+	}
+
+	lua_State* createState(bool main) {
+		lua_State* s = luaL_newstate();
+		lua_atpanic(s, [] (lua_State* L) {
+			ai_log_error("Lua panic. Error message: %s", (lua_isnil(L, -1) ? "" : lua_tostring(L, -1)));
+			return 0;
+		});
+		lua_gc(s, LUA_GCSTOP, 0);
+		luaL_openlibs(s);
+		lua_pushboolean(s, main ? 1 : 0);
+		lua_setfield(s, LUA_REGISTRYINDEX, mainStateKey());
+		if (!_initializer(s)) {
+			lua_close(s);
+			return nullptr;
+		}
+		for (const std::string& script : _scripts) {
+			if (!run(s, script.c_str(), script.size())) {
+				lua_close(s);
+				return nullptr;
+			}
+		}
+		return s;
+	}
+
+public:
+	~LUAStatePool() {
+		shutdown();
+	}
+
+	/**
+	 * @brief Creates the main state for the calling thread
+	 * @return @c false if the initializer failed
+	 */
+	bool init(const Initializer& initializer) {
+		ScopedWriteLock scopedLock(_lock);
+		if (_main != nullptr) {
+			return true;
+		}
+		_initializer = initializer;
+		_main = createState(true);
+		if (_main == nullptr) {
+			return false;
+		}
+		_states = std::make_shared<States>();
+		_states->states.insert(_main);
+		const uint64_t id = nextId();
+		threadStates().put(id, _states, _main, false);
+		_id.store(id, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Closes all states and forgets the loaded scripts
+	 */
+	void shutdown() {
+		ScopedWriteLock scopedLock(_lock);
+		_id.store(0u, std::memory_order_release);
+		if (_states) {
+			std::lock_guard<std::mutex> lock(_states->mutex);
+			for (lua_State* s : _states->states) {
+				lua_close(s);
+			}
+			_states->states.clear();
+		}
+		_states.reset();
+		_scripts.clear();
+		_main = nullptr;
+	}
+
+	inline bool initialized() const {
+		ScopedReadLock scopedLock(_lock);
+		return _main != nullptr;
+	}
+
+	/**
+	 * @return The state that was created in @c init() or @c nullptr if the pool isn't initialized
+	 */
+	inline lua_State* mainState() const {
+		ScopedReadLock scopedLock(_lock);
+		return _main;
+	}
+
+	/**
+	 * @return @c true if the given state is the main state of its pool. The other states only replay
+	 * the scripts of the main state.
+	 * @note Doesn't lock the pool - so it can be called while a state is initialized
+	 */
+	static bool isMainState(lua_State* s) {
+		lua_getfield(s, LUA_REGISTRYINDEX, mainStateKey());
+		const bool main = lua_toboolean(s, -1) != 0;
+		lua_pop(s, 1);
+		return main;
+	}
+
+	/**
+	 * @return The amount of states - one for each living thread that executed lua code
+	 */
+	inline size_t size() const {
+		ScopedReadLock scopedLock(_lock);
+		if (!_states) {
+			return 0u;
+		}
+		std::lock_guard<std::mutex> lock(_states->mutex);
+		return _states->states.size();
+	}
+
+	/**
+	 * @return The lua state of the calling thread - or @c nullptr if the pool isn't initialized
+	 * or the state could not get created.
+	 */
+	lua_State* state() {
+		const uint64_t id = _id.load(std::memory_order_acquire);
+		if (id == 0u) {
+			return nullptr;
+		}
+		ThreadStates& threadState = threadStates();
+		if (threadState.lastId == id) {
+			return threadState.last;
+		}
+		lua_State* s = threadState.get(id);
+		if (s != nullptr) {
+			return s;
+		}
+		ScopedWriteLock scopedLock(_lock);
+		if (_main == nullptr) {
+			return nullptr;
+		}
+		s = createState(false);
+		if (s == nullptr) {
+			ai_log_error("Failed to create the lua state for a new thread");
+			return nullptr;
+		}
+		{
+			std::lock_guard<std::mutex> lock(_states->mutex);
+			_states->states.insert(s);
+		}
+		threadState.put(id, _states, s, true);
+		return s;
+	}
+
+	/**
+	 * @brief Loads the lua script into all states - new states will also load it.
+	 * @return @c false if the script could not get loaded into the main state. The other states
+	 * don't get the script in this case.
+	 */
+	bool evaluate(const char* luaBuffer, size_t size) {
+		ScopedWriteLock scopedLock(_lock);
+		if (_main == nullptr) {
+			ai_log_debug("LUA state is not yet initialized");
+			return false;
+		}
+		if (!run(_main, luaBuffer, size)) {
+			return false;
+		}
+		_scripts.emplace_back(luaBuffer, size);
+		bool success = true;
+		std::lock_guard<std::mutex> lock(_states->mutex);
+		for (lua_State* s : _states->states) {
+			if (s != _main && !run(s, luaBuffer, size)) {
+				success = false;
+			}
+		}
+		return success;
+	}
+};
+
+}
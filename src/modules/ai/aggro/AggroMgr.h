@@ -9,6 +9,8 @@
 
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <functional>
 #include "ICharacter.h"
 #include <algorithm>
 #include "aggro/Entry.h"
@@ -22,11 +24,18 @@ class AggroMgr {
 public:
 	typedef std::vector<Entry> Entries;
 	typedef Entries::iterator EntriesIter;
+	/**
+	 * @brief Schedules a call to @c reduce() - e.g. in a timer wheel.
+	 */
+	typedef std::function<void()> ReductionScheduler;
 protected:
 	mutable Entries _entries;
 
 	mutable bool _dirty;
 
+	ReductionScheduler _reductionScheduler;
+	std::atomic_bool _reductionScheduled { false };
+
 	float _minAggro = 0.0f;
 	float _reduceRatioSecond = 0.0f;
 	float _reduceValueSecond = 0.0f;
@@ -124,11 +133,38 @@ public:
 		_minAggro = 0.0f;
 	}
 
+	/**
+	 * @brief Reduce the aggro values on demand instead of with every @c update() call.
+	 *
+	 * The scheduler is called once the manager has entries to reduce. The owner is then responsible to call
+	 * @c reduce() at some point in time - and to schedule the next call as long as @c reduce() returns @c true.
+	 * So an entity without aggro doesn't cost anything.
+	 *
+	 * @param[in] scheduler An empty function restores the reduction with every @c update() call.
+	 */
+	inline void setReductionScheduler(const ReductionScheduler& scheduler) {
+		_reductionScheduler = scheduler;
+		_reductionScheduled = false;
+	}
+
 	/**
 	 * @brief this will update the aggro list according to the reduction type of an entry.
 	 * @param[in] deltaMillis The current milliseconds to use to update the aggro value of the entries.
+	 * @note Doesn't do anything if a @c ReductionScheduler is set.
 	 */
 	void update(int64_t deltaMillis) {
+		if (_reductionScheduler) {
+			return;
+		}
+		reduce(deltaMillis);
+	}
+
+	/**
+	 * @brief Reduces the aggro values of the entries and removes the entries that have no aggro left.
+	 * @param[in] deltaMillis The milliseconds that passed since the last reduction.
+	 * @return @c true if there are entries left - so the next reduction should be scheduled.
+	 */
+	bool reduce(int64_t deltaMillis) {
 		for (EntriesIter i = _entries.begin(); i != _entries.end(); ++i) {
 			_dirty |= i->reduceByTime(deltaMillis);
 		}
@@ -137,6 +173,9 @@ public:
 			sort();
 			cleanupList();
 		}
+		const bool remaining = !_entries.empty();
+		_reductionScheduled = remaining;
+		return remaining;
 	}
 
 	/**
@@ -146,6 +185,9 @@ public:
 	 * @return The aggro @c Entry that was added or updated. Useful for changing the reduce type or amount.
 	 */
 	EntryPtr addAggro(CharacterId id, float amount) {
+		if (_reductionScheduler && !_reductionScheduled.exchange(true)) {
+			_reductionScheduler();
+		}
 		const CharacterIdPredicate p(id);
 		EntriesIter i = std::find_if(_entries.begin(), _entries.end(), p);
 		if (i == _entries.end()) {
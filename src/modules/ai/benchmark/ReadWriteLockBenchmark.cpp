@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+#include "common/Thread.h"
+
+namespace {
+
+ai::ReadWriteLock benchmarkLock("benchmark");
+// protected by benchmarkLock
+int benchmarkValue = 0;
+
+}
+
+/**
+ * Every thread mostly reads - one out of range(0) operations is a write (0 means no writes at all)
+ */
+static void readWriteLockContention(benchmark::State& state) {
+	const int writeEvery = state.range(0);
+	int operation = 0;
+	while (state.KeepRunning()) {
+		if (writeEvery > 0 && ++operation % writeEvery == 0) {
+			ai::ScopedWriteLock scopedLock(benchmarkLock);
+			++benchmarkValue;
+		} else {
+			ai::ScopedReadLock scopedLock(benchmarkLock);
+			benchmark::DoNotOptimize(benchmarkValue);
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(readWriteLockContention)->Arg(0)->Arg(1000)->Arg(100)->Arg(10)->ThreadRange(1, 16)->UseRealTime();
@@ -0,0 +1,103 @@
+#include "core/benchmark/AbstractBenchmark.h"
+#include "SimpleAI.h"
+#include <thread>
+
+class ZoneBenchmark: public core::AbstractBenchmark {
+protected:
+	ai::TreeNodePtr _root;
+
+	void fill(ai::Zone& zone, int amount, float extent = 0.0f) {
+		std::vector<ai::AIPtr> ais;
+		ais.reserve(amount);
+		for (int i = 0; i < amount; ++i) {
+			const ai::ICharacterPtr& character = std::make_shared<ai::ICharacter>(i);
+			if (extent > 0.0f) {
+				character->setPosition(glm::vec3(ai::randomf(extent), 0.0f, ai::randomf(extent)));
+			}
+			const ai::AIPtr& ai = std::make_shared<ai::AI>(_root);
+			ai->setCharacter(character);
+			ais.push_back(ai);
+		}
+		zone.addAIs(ais);
+		// adds the scheduled ai instances
+		zone.update(0);
+	}
+
+public:
+	bool onInitApp() override {
+		// a selector that always executes a sequence of two idle nodes
+		_root = std::make_shared<ai::PrioritySelector>("root", "", ai::True::get());
+		const ai::TreeNodePtr& sequence = std::make_shared<ai::Sequence>("sequence", "", ai::True::get());
+		sequence->addChild(std::make_shared<ai::Idle>("idle1", "10", ai::True::get()));
+		sequence->addChild(std::make_shared<ai::Idle>("idle2", "10", ai::True::get()));
+		_root->addChild(sequence);
+		return true;
+	}
+
+	void onCleanupApp() override {
+		_root = ai::TreeNodePtr();
+	}
+};
+
+BENCHMARK_DEFINE_F(ZoneBenchmark, update) (benchmark::State& state) {
+	const int amount = state.range(0);
+	const int threads = state.range(1);
+	ai::Zone zone("benchmark", threads);
+	fill(zone, amount);
+	while (state.KeepRunning()) {
+		zone.update(1);
+	}
+	state.SetItemsProcessed(state.iterations() * amount);
+}
+
+static void updateArguments(benchmark::internal::Benchmark* b) {
+	const int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	for (int amount = 10000; amount <= 100000; amount *= 10) {
+		for (int threads = 1; threads <= hardwareThreads; threads *= 2) {
+			b->Args({amount, threads});
+		}
+		if ((hardwareThreads & (hardwareThreads - 1)) != 0) {
+			b->Args({amount, hardwareThreads});
+		}
+	}
+}
+
+/**
+ * @brief Every ai selects the entities around it - once with the complete zone and a distance check
+ * and once with the spatial index of the zone
+ */
+BENCHMARK_DEFINE_F(ZoneBenchmark, selectInRadius) (benchmark::State& state) {
+	const int amount = state.range(0);
+	const bool spatialIndex = state.range(1) != 0;
+	const float radius = 10.0f;
+	ai::Zone zone("benchmark", 1);
+	// roughly 10 other entities in the radius of each entity
+	fill(zone, amount, glm::sqrt((float)amount * glm::pi<float>() * radius * radius / 10.0f));
+	ai::SelectInRadius filter(std::to_string(radius));
+	ai::SelectZone zoneFilter;
+	ai::FilteredEntities entities;
+	while (state.KeepRunning()) {
+		zone.executeParallel([&] (const ai::AIPtr& ai) {
+			if (spatialIndex) {
+				filter.filter(ai);
+			} else {
+				zoneFilter.filter(ai);
+				const glm::vec3& pos = ai->getCharacter()->getPosition();
+				entities.clear();
+				for (ai::CharacterId id : ai->getFilteredEntities()) {
+					const ai::AIPtr& other = zone.getAI(id);
+					if (id != ai->getId() && glm::distance(other->getCharacter()->getPosition(), pos) <= radius) {
+						entities.push_back(id);
+					}
+				}
+			}
+			ai::SelectEmpty::get()->filter(ai);
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * amount);
+}
+
+BENCHMARK_REGISTER_F(ZoneBenchmark, update)->Apply(updateArguments)->UseRealTime();
+BENCHMARK_REGISTER_F(ZoneBenchmark, selectInRadius)->Args({1000, 0})->Args({1000, 1})->Args({5000, 0})->Args({5000, 1});
+
+BENCHMARK_MAIN()
@@ -0,0 +1,280 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "NonCopyable.h"
+#include "Thread.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ai {
+
+/**
+ * @brief Executes a functor for all indices of a range in parallel.
+ *
+ * The range is split into chunks and every participating thread (the workers and the calling thread)
+ * gets a contiguous part of the chunks. If a thread is done with its own chunks, it steals the remaining
+ * chunks of the other threads. There are no allocations for running a job - the worker threads are
+ * created once and the functor is not copied.
+ *
+ * The workers also execute the single tasks that are queued with @c enqueue() while there is no job
+ * to run - so there is no need for a second pool of threads next to the executor.
+ *
+ * @note @c run() calls from different threads are serialized. If the functor itself calls @c run() on
+ * the same instance, the nested call is executed on the calling thread.
+ */
+class ParallelExecutor : public NonCopyable {
+private:
+	/**
+	 * @brief The chunks of one participant. The front index is stored in the lower 32 bits, the (exclusive)
+	 * back index in the upper 32 bits. The owner takes chunks from the front, thieves take them from the back.
+	 */
+	struct ChunkRange {
+		std::atomic<uint64_t> range;
+		// every range gets its own cache line
+		char padding[64 - sizeof(std::atomic<uint64_t>)];
+	};
+
+	typedef void (*Invoker)(const void* func, size_t begin, size_t end);
+
+	std::vector<std::thread> _workers;
+	std::unique_ptr<ChunkRange[]> _ranges;
+	// the workers and the calling thread
+	const size_t _participants;
+
+	std::mutex _runMutex;
+	std::mutex _mutex;
+	std::condition_variable _startCondition;
+	std::condition_variable _doneCondition;
+	// incremented for each job - protected by _mutex
+	uint64_t _generation = 0u;
+	bool _stop = false;
+	std::atomic_int _busyWorkers { 0 };
+	// the queued single tasks - protected by _mutex
+	std::deque<std::function<void()>> _tasks;
+
+	// the current job - only written while the workers are idle
+	Invoker _invoker = nullptr;
+	const void* _func = nullptr;
+	size_t _count = 0u;
+	size_t _chunkSize = 1u;
+
+	static inline uint64_t pack(uint32_t front, uint32_t back) {
+		return (uint64_t)front | ((uint64_t)back << 32);
+	}
+
+	template<typename Func>
+	static void invoke(const void* func, size_t begin, size_t end) {
+		const Func& f = *static_cast<const Func*>(func);
+		for (size_t i = begin; i < end; ++i) {
+			f(i);
+		}
+	}
+
+	static const ParallelExecutor*& runningExecutor() {
+		AI_THREAD_LOCAL const ParallelExecutor* executor = nullptr;
+		return executor;
+	}
+
+	bool takeFront(size_t participant, uint32_t& chunk) {
+		std::atomic<uint64_t>& range = _ranges[participant].range;
+		uint64_t current = range.load(std::memory_order_acquire);
+		for (;;) {
+			const uint32_t front = (uint32_t)current;
+			const uint32_t back = (uint32_t)(current >> 32);
+			if (front >= back) {
+				return false;
+			}
+			if (range.compare_exchange_weak(current, pack(front + 1, back), std::memory_order_acq_rel)) {
+				chunk = front;
+				return true;
+			}
+		}
+	}
+
+	bool takeBack(size_t participant, uint32_t& chunk) {
+		std::atomic<uint64_t>& range = _ranges[participant].range;
+		uint64_t current = range.load(std::memory_order_acquire);
+		for (;;) {
+			const uint32_t front = (uint32_t)current;
+			const uint32_t back = (uint32_t)(current >> 32);
+			if (front >= back) {
+				return false;
+			}
+			if (range.compare_exchange_weak(current, pack(front, back - 1), std::memory_order_acq_rel)) {
+				chunk = back - 1;
+				return true;
+			}
+		}
+	}
+
+	inline void executeChunk(uint32_t chunk) {
+		const size_t begin = (size_t)chunk * _chunkSize;
+		const size_t end = std::min(_count, begin + _chunkSize);
+		_invoker(_func, begin, end);
+	}
+
+	void work(size_t participant) {
+		const ParallelExecutor*& running = runningExecutor();
+		const ParallelExecutor* previous = running;
+		running = this;
+		uint32_t chunk;
+		while (takeFront(participant, chunk)) {
+			executeChunk(chunk);
+		}
+		for (size_t i = 1; i < _participants; ++i) {
+			const size_t victim = (participant + i) % _participants;
+			while (takeBack(victim, chunk)) {
+				executeChunk(chunk);
+			}
+		}
+		running = previous;
+	}
+
+	void workerLoop(size_t participant) {
+		uint64_t generation = 0u;
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_startCondition.wait(lock, [&] {
+					return _stop || _generation != generation || !_tasks.empty();
+				});
+				if (_generation != generation) {
+					// a job is waiting for all workers - it has precedence over the tasks
+					generation = _generation;
+				} else if (!_tasks.empty()) {
+					task = std::move(_tasks.front());
+					_tasks.pop_front();
+				} else {
+					// stopped and all the queued tasks are executed
+					return;
+				}
+			}
+			if (task) {
+				const ParallelExecutor*& running = runningExecutor();
+				const ParallelExecutor* previous = running;
+				// a run() call inside the task is executed on this thread
+				running = this;
+				task();
+				running = previous;
+				continue;
+			}
+			work(participant);
+			if (_busyWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				std::lock_guard<std::mutex> lock(_mutex);
+				_doneCondition.notify_one();
+			}
+		}
+	}
+
+public:
+	/**
+	 * @param[in] threads The amount of threads that execute a job - including the thread that
+	 * calls @c run(). A value of @c 1 or less executes the jobs on the calling thread - there is still
+	 * one worker for the queued tasks then.
+	 */
+	explicit ParallelExecutor(size_t threads) :
+			_ranges(new ChunkRange[std::max((size_t)1, threads)]), _participants(std::max((size_t)1, threads)) {
+		for (size_t i = 0; i < _participants; ++i) {
+			_ranges[i].range = 0u;
+		}
+		const size_t workers = std::max((size_t)1, _participants - 1);
+		_workers.reserve(workers);
+		// the calling thread is the last participant
+		for (size_t i = 0; i < workers; ++i) {
+			_workers.emplace_back([this, i] {
+				workerLoop(i);
+			});
+		}
+	}
+
+	~ParallelExecutor() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_startCondition.notify_all();
+		for (std::thread& worker : _workers) {
+			worker.join();
+		}
+	}
+
+	/**
+	 * @return The amount of threads that execute a job - including the calling thread
+	 */
+	inline size_t threads() const {
+		return _participants;
+	}
+
+	/**
+	 * @brief Calls @c func(index) for each index in [0, count) and waits until all calls are done.
+	 * @param[in] chunkSize The amount of consecutive indices that are executed by one thread without
+	 * looking for new work.
+	 */
+	template<typename Func>
+	void run(size_t count, const Func& func, size_t chunkSize = 64) {
+		if (count == 0) {
+			return;
+		}
+		chunkSize = std::max((size_t)1, chunkSize);
+		if (_participants <= 1 || count <= chunkSize || runningExecutor() == this) {
+			invoke<Func>(&func, 0, count);
+			return;
+		}
+
+		std::lock_guard<std::mutex> runLock(_runMutex);
+		const size_t chunks = (count + chunkSize - 1) / chunkSize;
+		_invoker = &invoke<Func>;
+		_func = &func;
+		_count = count;
+		_chunkSize = chunkSize;
+		for (size_t i = 0; i < _participants; ++i) {
+			const uint32_t front = (uint32_t)(chunks * i / _participants);
+			const uint32_t back = (uint32_t)(chunks * (i + 1) / _participants);
+			_ranges[i].range.store(pack(front, back), std::memory_order_relaxed);
+		}
+		_busyWorkers.store((int)_participants - 1, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			++_generation;
+		}
+		_startCondition.notify_all();
+
+		work(_participants - 1);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_doneCondition.wait(lock, [this] {
+			return _busyWorkers.load(std::memory_order_acquire) == 0;
+		});
+	}
+
+	/**
+	 * @brief Queues a single task for the workers - it is executed while there is no job to run
+	 * @return The future with the result of the task
+	 */
+	template<class F, class ... Args>
+	auto enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type> {
+		using return_type = typename std::result_of<F(Args...)>::type;
+		auto task = std::make_shared<std::packaged_task<return_type()> >(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+		std::future<return_type> res = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.emplace_back([task] () {(*task)();});
+		}
+		_startCondition.notify_one();
+		return res;
+	}
+};
+
+}
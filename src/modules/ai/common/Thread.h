@@ -7,37 +7,139 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define AI_CPU_RELAX() _mm_pause()
+#elif defined(__i386__) || defined(__x86_64__)
+#define AI_CPU_RELAX() __builtin_ia32_pause()
+#else
+#define AI_CPU_RELAX() std::this_thread::yield()
+#endif
 
 namespace ai {
 
-// TODO: not a real read-write-lock - maybe someday
+/**
+ * @brief Reader-writer lock - any amount of readers or one writer can hold the lock.
+ *
+ * Waiting threads spin for a short time before they are parked on a condition variable. A waiting
+ * writer blocks new readers - so writers don't starve in the read-dominated ai code paths.
+ *
+ * @note The lock is not recursive - don't acquire a read lock again while the same thread
+ * already holds it, a writer waiting in between would deadlock.
+ */
 class ReadWriteLock {
 private:
+	static constexpr uint32_t WRITER = 1u << 31;
+	static constexpr uint32_t WRITER_WAITING = 1u << 30;
+	static constexpr uint32_t READERS = WRITER_WAITING - 1u;
+	// the amount of busy wait iterations before the thread is parked
+	static constexpr int SPIN_COUNT = 128;
+
 	const std::string _name;
-	mutable std::atomic_flag _locked = ATOMIC_FLAG_INIT;
+	// the writer bits and the amount of readers that are holding the lock
+	mutable std::atomic<uint32_t> _state { 0u };
+	// the amount of parked threads - the unlock only notifies if there are any
+	mutable std::atomic<uint32_t> _parked { 0u };
+	mutable std::mutex _parkMutex;
+	mutable std::condition_variable _parkCondition;
+	// only one writer at a time competes with the readers
+	std::mutex _writerMutex;
+
+	inline bool tryLockReadFast() const {
+		uint32_t state = _state.load(std::memory_order_relaxed);
+		while ((state & (WRITER | WRITER_WAITING)) == 0u) {
+			if (_state.compare_exchange_weak(state, state + 1u, std::memory_order_acquire, std::memory_order_relaxed)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline bool tryLockWriteFast() {
+		uint32_t expected = WRITER_WAITING;
+		return _state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	template<class Func>
+	void spinThenPark(Func&& tryAcquire) const {
+		for (int i = 0; i < SPIN_COUNT; ++i) {
+			if (tryAcquire()) {
+				return;
+			}
+			AI_CPU_RELAX();
+		}
+		for (;;) {
+			std::unique_lock<std::mutex> lock(_parkMutex);
+			_parked.fetch_add(1u, std::memory_order_seq_cst);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			// check again after we are registered - an unlock in between would not notify us
+			if (tryAcquire()) {
+				_parked.fetch_sub(1u, std::memory_order_relaxed);
+				return;
+			}
+			_parkCondition.wait(lock);
+			_parked.fetch_sub(1u, std::memory_order_relaxed);
+			lock.unlock();
+			if (tryAcquire()) {
+				return;
+			}
+		}
+	}
+
+	inline void wakeParked() const {
+		if (_parked.load(std::memory_order_seq_cst) == 0u) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(_parkMutex);
+		_parkCondition.notify_all();
+	}
+
 public:
 	ReadWriteLock(const std::string& name) :
 			_name(name) {
 	}
 
 	inline void lockRead() const {
-		while (_locked.test_and_set(std::memory_order_acquire)) {
-			std::this_thread::yield();
+		if (tryLockReadFast()) {
+			return;
 		}
+		spinThenPark([this] () {
+			return tryLockReadFast();
+		});
 	}
 
 	inline void unlockRead() const {
-		_locked.clear(std::memory_order_release);
+		const uint32_t previous = _state.fetch_sub(1u, std::memory_order_seq_cst);
+		// the last reader lets a waiting writer in
+		if ((previous & READERS) == 1u && (previous & WRITER_WAITING) != 0u) {
+			wakeParked();
+		}
 	}
 
 	inline void lockWrite() {
-		while (_locked.test_and_set(std::memory_order_acquire)) {
-			std::this_thread::yield();
+		_writerMutex.lock();
+		// no new readers from now on - wait for the current ones to leave
+		_state.fetch_or(WRITER_WAITING, std::memory_order_seq_cst);
+		if (tryLockWriteFast()) {
+			return;
 		}
+		spinThenPark([this] () {
+			return const_cast<ReadWriteLock*>(this)->tryLockWriteFast();
+		});
 	}
 
 	inline void unlockWrite() {
-		_locked.clear(std::memory_order_release);
+		_state.store(0u, std::memory_order_seq_cst);
+		wakeParked();
+		_writerMutex.unlock();
+	}
+
+	inline const std::string& name() const {
+		return _name;
 	}
 };
 
@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @ingroup Filter
+ */
+#pragma once
+
+#include "filter/IFilter.h"
+#include "common/Math.h"
+#include "common/String.h"
+#include "zone/Zone.h"
+
+namespace ai {
+
+/**
+ * @brief This filter will pick the entities of the zone that are in the field of view of the given
+ * entity. The field of view is a circular sector on the xz plane around the orientation of the entity.
+ * The entity itself is not selected.
+ *
+ * The parameters are the view distance and the opening angle of the field of view in degrees
+ * (defaults to 90).
+ * @code
+ * someNode:addNode("AttackTarget", "attack"):setCondition("Filter(SelectInFieldOfView{20,120})")
+ * @endcode
+ */
+class SelectInFieldOfView: public IFilter {
+protected:
+	float _distance;
+	// cosine of the half opening angle
+	float _cosHalfAngle;
+public:
+	FILTER_FACTORY(SelectInFieldOfView)
+
+	explicit SelectInFieldOfView(const std::string& parameters = "") :
+		IFilter("SelectInFieldOfView", parameters) {
+		std::vector<std::string> tokens;
+		Str::splitString(_parameters, tokens, ",");
+		_distance = tokens.empty() ? -1.0f : std::stof(tokens[0]);
+		const float angle = tokens.size() < 2 ? 90.0f : std::stof(tokens[1]);
+		_cosHalfAngle = glm::cos(toRadians(glm::clamp(angle, 0.0f, 360.0f)) * 0.5f);
+	}
+
+	void filter (const AIPtr& entity) override {
+		const Zone* zone = entity->getZone();
+		if (zone == nullptr) {
+			return;
+		}
+		FilteredEntities& entities = getFilteredEntities(entity);
+		const ICharacterPtr& chr = entity->getCharacter();
+		const CharacterId id = chr->getId();
+		const glm::vec3& position = chr->getPosition();
+		const glm::vec3& direction = fromRadians(chr->getOrientation());
+		const float cosHalfAngle = _cosHalfAngle;
+		zone->visitRadius(position, _distance, [&] (const SpatialIndex::Entry& e, float) {
+			if (e.id == id) {
+				return;
+			}
+			const glm::vec3 delta(e.position.x - position.x, 0.0f, e.position.z - position.z);
+			const float length = glm::length(delta);
+			// an entity at the same spot is always visible
+			if (length > glm::epsilon<float>() && glm::dot(delta, direction) < cosHalfAngle * length) {
+				return;
+			}
+			entities.push_back(e.id);
+		});
+	}
+};
+
+}
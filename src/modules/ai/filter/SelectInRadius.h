@@ -0,0 +1,43 @@
+/**
+ * @file
+ * @ingroup Filter
+ */
+#pragma once
+
+#include "filter/IFilter.h"
+#include "zone/Zone.h"
+
+namespace ai {
+
+/**
+ * @brief This filter will pick the entities of the zone that are not further away from the given
+ * entity than the radius that is given as parameter. The entity itself is not selected. The radius
+ * is mandatory.
+ *
+ * @code
+ * someNode:addNode("AttackTarget", "attack"):setCondition("Filter(SelectInRadius{10})")
+ * @endcode
+ */
+class SelectInRadius: public IFilter {
+protected:
+	float _radius;
+public:
+	FILTER_FACTORY(SelectInRadius)
+
+	explicit SelectInRadius(const std::string& parameters = "") :
+		IFilter("SelectInRadius", parameters) {
+		ai_assert(!_parameters.empty(), "SelectInRadius needs the radius as parameter");
+		_radius = _parameters.empty() ? -1.0f : std::stof(_parameters);
+	}
+
+	void filter (const AIPtr& entity) override {
+		const Zone* zone = entity->getZone();
+		if (zone == nullptr) {
+			return;
+		}
+		const ICharacterPtr& chr = entity->getCharacter();
+		zone->queryRadius(chr->getPosition(), _radius, getFilteredEntities(entity), chr->getId());
+	}
+};
+
+}
@@ -0,0 +1,50 @@
+/**
+ * @file
+ * @ingroup Filter
+ */
+#pragma once
+
+#include "filter/IFilter.h"
+#include "common/String.h"
+#include "zone/Zone.h"
+
+namespace ai {
+
+/**
+ * @brief This filter will pick the given amount of entities of the zone that are closest to the given
+ * entity - the closest first. The entity itself is not selected.
+ *
+ * The parameters are the amount of entities and an optional max distance.
+ * @code
+ * someNode:addNode("AttackTarget", "attack"):setCondition("Filter(SelectKNearest{3,20})")
+ * @endcode
+ */
+class SelectKNearest: public IFilter {
+protected:
+	int _k;
+	float _maxDistance;
+public:
+	FILTER_FACTORY(SelectKNearest)
+
+	explicit SelectKNearest(const std::string& parameters = "") :
+		IFilter("SelectKNearest", parameters) {
+		std::vector<std::string> tokens;
+		Str::splitString(_parameters, tokens, ",");
+		_k = tokens.empty() ? 1 : std::stoi(tokens[0]);
+		_maxDistance = tokens.size() < 2 ? -1.0f : std::stof(tokens[1]);
+	}
+
+	void filter (const AIPtr& entity) override {
+		if (_k <= 0) {
+			return;
+		}
+		const Zone* zone = entity->getZone();
+		if (zone == nullptr) {
+			return;
+		}
+		const ICharacterPtr& chr = entity->getCharacter();
+		zone->queryNearest(chr->getPosition(), (size_t)_k, getFilteredEntities(entity), _maxDistance, chr->getId());
+	}
+};
+
+}
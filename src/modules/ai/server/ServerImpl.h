@@ -352,6 +352,7 @@ inline bool Server::updateNode(const CharacterId& characterId, int32_t nodeId, c
 		}
 		parent->replaceChild(nodeId, newNode);
 	}
+	TreeNode::compileStateIndices(ai->getBehaviour().get());
 
 	Event event;
 	event.type = EV_UPDATESTATICCHRDETAILS;
@@ -389,6 +390,7 @@ inline bool Server::addNode(const CharacterId& characterId, int32_t parentNodeId
 	if (!node->addChild(newNode)) {
 		return false;
 	}
+	TreeNode::compileStateIndices(ai->getBehaviour().get());
 
 	Event event;
 	event.type = EV_UPDATESTATICCHRDETAILS;
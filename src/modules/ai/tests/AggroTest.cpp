@@ -73,3 +73,22 @@ TEST_F(AggroTest, testAggroMgrDegradeValue) {
 	const float newAggro = entry->getAggro();
 	ASSERT_FLOAT_EQ(expected, newAggro);
 }
+
+TEST_F(AggroTest, testAggroMgrReductionScheduler) {
+	ai::AggroMgr mgr;
+	mgr.setReduceByValue(0.5f);
+	int scheduled = 0;
+	mgr.setReductionScheduler([&] () { ++scheduled; });
+	const ai::CharacterId id = 1;
+	mgr.addAggro(id, 1.0f);
+	mgr.addAggro(id, 1.0f);
+	ASSERT_EQ(1, scheduled) << "The reduction should only get scheduled once";
+	mgr.update(1000);
+	ASSERT_FLOAT_EQ(2.0f, mgr.getHighestEntry()->getAggro()) << "The update should not reduce the aggro if a scheduler is set";
+	ASSERT_TRUE(mgr.reduce(2000)) << "There is aggro left - the next reduction should get scheduled";
+	ASSERT_FLOAT_EQ(1.0f, mgr.getHighestEntry()->getAggro());
+	ASSERT_FALSE(mgr.reduce(2000)) << "There is no aggro left";
+	ASSERT_TRUE(mgr.getEntries().empty());
+	mgr.addAggro(id, 1.0f);
+	ASSERT_EQ(2, scheduled) << "The reduction should get scheduled again for new aggro";
+}
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <streambuf>
 #include <unistd.h>
+#include <thread>
 
 class LUAAIRegistryTest: public TestSuite {
 protected:
@@ -145,3 +146,49 @@ TEST_F(LUAAIRegistryTest, testFilter_100) {
 TEST_F(LUAAIRegistryTest, testSteeringEmpty) {
 	testSteering("LuaSteeringTest");
 }
+
+TEST_F(LUAAIRegistryTest, testParallelExecution) {
+	const int threadCount = 4;
+	const ai::TreeNodeFactoryContext ctx = ai::TreeNodeFactoryContext("TreeNodeName", "", ai::True::get());
+	const ai::TreeNodePtr& node = _registry.createNode("LuaTest2", ctx);
+	ASSERT_TRUE((bool)node) << "Could not create lua provided node";
+	const ai::ConditionPtr& condition = _registry.createCondition("LuaTestTrue", ctxCondition);
+	ASSERT_TRUE((bool)condition) << "Could not create lua provided condition";
+	std::atomic_int failures { 0 };
+	std::atomic_int started { 0 };
+	std::atomic_int finished { 0 };
+	std::atomic_bool release { false };
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; ++i) {
+		threads.emplace_back([&, i] () {
+			// all threads must be alive at the same time - every one of them gets its own state
+			++started;
+			while (started < threadCount) {
+				std::this_thread::yield();
+			}
+			const ai::AIPtr& ai = std::make_shared<ai::AI>(node);
+			ai->setCharacter(std::make_shared<TestEntity>(_id + 1 + i));
+			for (int n = 0; n < 100; ++n) {
+				if (node->execute(ai, 1L) != ai::TreeNodeStatus::RUNNING || !condition->evaluate(ai)) {
+					++failures;
+				}
+			}
+			// keep the thread alive until the states were counted
+			++finished;
+			while (!release) {
+				std::this_thread::yield();
+			}
+		});
+	}
+	while (finished < threadCount) {
+		std::this_thread::yield();
+	}
+	const size_t stateCount = _registry.getLuaStateCount();
+	release = true;
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	ASSERT_EQ(0, failures) << "The lua node or condition failed in one of the threads";
+	ASSERT_EQ((size_t)threadCount + 1, stateCount) << "Every thread should get its own lua state";
+	ASSERT_EQ(1u, _registry.getLuaStateCount()) << "The states of the exited threads should get closed";
+}
@@ -149,3 +149,77 @@ TEST_F(NodeTest, testPrioritySelectorWithCondition) {
 	ASSERT_EQ(ai::CANNOTEXECUTE, idle1->getLastStatus(e));
 	ASSERT_EQ(ai::FINISHED, idle2->getLastStatus(e));
 }
+
+TEST_F(NodeTest, testStateIndices) {
+	ai::TreeNodeFactoryContext ctx("testsequence", "", ai::True::get());
+	ai::TreeNodePtr node = ai::Sequence::Factory().create(&ctx);
+	ai::TreeNodeFactoryContext idleCtx1("testidle", "2", ai::True::get());
+	ai::TreeNodePtr idle1 = ai::Idle::Factory().create(&idleCtx1);
+	ai::TreeNodeFactoryContext idleCtx2("testidle2", "2", ai::True::get());
+	ai::TreeNodePtr idle2 = ai::Idle::Factory().create(&idleCtx2);
+	node->addChild(idle1);
+	node->addChild(idle2);
+	ASSERT_EQ(-1, node->getStateIndex());
+	ASSERT_EQ(0, node->getStateSize());
+	ASSERT_EQ(3, ai::TreeNode::compileStateIndices(node.get()));
+	ASSERT_EQ(3, node->getStateSize());
+	ASSERT_EQ(0, node->getStateIndex());
+	ASSERT_EQ(1, idle1->getStateIndex());
+	ASSERT_EQ(2, idle2->getStateIndex());
+
+	// two entities that share the tree must not share the states
+	ai::AIPtr ai1(new ai::AI(node));
+	ai1->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	ai::AIPtr ai2(new ai::AI(node));
+	ai2->setCharacter(ai::ICharacterPtr(new ai::ICharacter(2)));
+	for (int i = 0; i < 3; ++i) {
+		ai1->update(1, true);
+		node->execute(ai1, 1);
+	}
+	ai2->update(1, true);
+	node->execute(ai2, 1);
+	ASSERT_EQ(ai::FINISHED, idle1->getLastStatus(ai1));
+	ASSERT_EQ(ai::RUNNING, idle2->getLastStatus(ai1));
+	ASSERT_EQ(ai::RUNNING, idle1->getLastStatus(ai2));
+	ASSERT_EQ(ai::UNKNOWN, idle2->getLastStatus(ai2));
+
+	// a node that is added later is not compiled by the tick - the entity keeps its states apart
+	ai::TreeNodeFactoryContext idleCtx3("testidle3", "2", ai::True::get());
+	ai::TreeNodePtr idle3 = ai::Idle::Factory().create(&idleCtx3);
+	node->addChild(idle3);
+	ASSERT_EQ(ai::UNKNOWN, idle3->getLastStatus(ai1));
+	ASSERT_EQ(-1, idle3->getStateIndex());
+	ASSERT_EQ(ai::RUNNING, node->getLastStatus(ai1));
+
+	// compiling the modified tree gives the new node the next index - the existing ones are kept
+	ASSERT_EQ(4, ai::TreeNode::compileStateIndices(node.get()));
+	ASSERT_EQ(3, idle3->getStateIndex());
+	ASSERT_EQ(1, idle1->getStateIndex());
+	ASSERT_EQ(ai::UNKNOWN, idle3->getLastStatus(ai1));
+	ASSERT_EQ(ai::FINISHED, idle1->getLastStatus(ai1));
+	ASSERT_EQ(ai::RUNNING, idle2->getLastStatus(ai1));
+}
+
+TEST_F(NodeTest, testStateOfForeignNode) {
+	ai::TreeNodeFactoryContext ctx("testsequence", "", ai::True::get());
+	ai::TreeNodePtr node = ai::Sequence::Factory().create(&ctx);
+	ai::TreeNodeFactoryContext idleCtx1("testidle", "2", ai::True::get());
+	ai::TreeNodePtr idle1 = ai::Idle::Factory().create(&idleCtx1);
+	node->addChild(idle1);
+	ai::AIPtr entity(new ai::AI(node));
+	entity->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	entity->update(1, true);
+	node->execute(entity, 1);
+	ASSERT_EQ(ai::RUNNING, node->getLastStatus(entity));
+
+	// a node of no tree must neither be compiled nor share the state of the root node
+	ai::TreeNodeFactoryContext foreignCtx("foreignidle", "1000", ai::True::get());
+	ai::TreeNodePtr foreign = ai::Idle::Factory().create(&foreignCtx);
+	ASSERT_EQ(ai::RUNNING, foreign->execute(entity, 1));
+	ASSERT_EQ(-1, foreign->getStateIndex());
+	ASSERT_EQ(ai::RUNNING, foreign->getLastStatus(entity));
+	ASSERT_EQ(ai::RUNNING, node->getLastStatus(entity));
+	ASSERT_EQ(ai::FINISHED, foreign->execute(entity, 1000));
+	ASSERT_EQ(ai::FINISHED, foreign->getLastStatus(entity));
+	ASSERT_EQ(ai::RUNNING, node->getLastStatus(entity));
+}
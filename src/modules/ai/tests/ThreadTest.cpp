@@ -23,3 +23,102 @@ TEST_F(ThreadTest, testThreadScheduler_schedule) {
 	std::this_thread::sleep_for(std::chrono::milliseconds(100));
 	ASSERT_EQ(1, countExecutionOnce);
 }
+
+TEST_F(ThreadTest, testParallelExecutor) {
+	ai::ParallelExecutor executor(4);
+	ASSERT_EQ(4u, executor.threads());
+	const size_t n = 100000;
+	std::unique_ptr<std::atomic_int[]> executions(new std::atomic_int[n]);
+	for (size_t i = 0; i < n; ++i) {
+		executions[i] = 0;
+	}
+	for (int run = 0; run < 10; ++run) {
+		executor.run(n, [&] (size_t index) {
+			++executions[index];
+		}, 16);
+	}
+	for (size_t i = 0; i < n; ++i) {
+		ASSERT_EQ(10, executions[i]) << "Index " << i << " was not executed for each run";
+	}
+}
+
+TEST_F(ThreadTest, testParallelExecutorNested) {
+	ai::ParallelExecutor executor(4);
+	std::atomic_int executions(0);
+	executor.run(100, [&] (size_t) {
+		executor.run(10, [&] (size_t) {
+			++executions;
+		}, 1);
+	}, 1);
+	ASSERT_EQ(1000, executions);
+}
+
+TEST_F(ThreadTest, testParallelExecutorEnqueue) {
+	for (size_t threads = 1; threads <= 4; threads += 3) {
+		ai::ParallelExecutor executor(threads);
+		std::vector<std::future<int>> results;
+		for (int i = 0; i < 100; ++i) {
+			results.push_back(executor.enqueue([&executor] (int value) {
+				// a job of the task is executed on the worker of the task
+				std::atomic_int sum(0);
+				executor.run(10, [&] (size_t) {
+					sum += value;
+				}, 1);
+				return (int)sum;
+			}, i));
+		}
+		executor.run(1000, [] (size_t) {}, 1);
+		for (int i = 0; i < 100; ++i) {
+			ASSERT_EQ(i * 10, results[i].get());
+		}
+	}
+}
+
+TEST_F(ThreadTest, testReadWriteLockSharedReaders) {
+	ai::ReadWriteLock lock("test");
+	std::atomic_bool secondReader(false);
+	lock.lockRead();
+	std::thread reader([&] () {
+		ai::ScopedReadLock scopedLock(lock);
+		secondReader = true;
+	});
+	// the second reader must get the lock while the first one is still holding it
+	for (int i = 0; i < 1000 && !secondReader; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	const bool shared = secondReader;
+	lock.unlockRead();
+	reader.join();
+	ASSERT_TRUE(shared) << "A reader was blocked by another reader";
+}
+
+TEST_F(ThreadTest, testReadWriteLockExclusiveWriter) {
+	ai::ReadWriteLock lock("test");
+	// only modified while holding the write lock - the readers must always see the same values
+	int first = 0;
+	int second = 0;
+	std::atomic_int inconsistentReads(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&, t] () {
+			for (int i = 0; i < 20000; ++i) {
+				if (i % 10 == t) {
+					ai::ScopedWriteLock scopedLock(lock);
+					++first;
+					++second;
+				} else {
+					ai::ScopedReadLock scopedLock(lock);
+					if (first != second) {
+						++inconsistentReads;
+					}
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	ASSERT_EQ(0, inconsistentReads);
+	ASSERT_EQ(4 * 2000, first);
+	ASSERT_EQ(first, second);
+}
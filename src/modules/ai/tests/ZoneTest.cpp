@@ -3,6 +3,24 @@
 class ZoneTest: public TestSuite {
 };
 
+namespace {
+
+class CountingEntity : public ai::ICharacter {
+public:
+	std::atomic_int updates { 0 };
+
+	CountingEntity(const ai::CharacterId& id) :
+			ai::ICharacter(id) {
+	}
+
+	void update(int64_t dt, bool debuggingActive) override {
+		ai::ICharacter::update(dt, debuggingActive);
+		++updates;
+	}
+};
+
+}
+
 TEST_F(ZoneTest, testChanges) {
 	ai::Zone zone("test1");
 	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
@@ -42,3 +60,159 @@ TEST_F(ZoneTest, testMassAdd1000000) {
 	zone.update(0l);
 	ASSERT_EQ(n, (int)zone.size());
 }
+
+TEST_F(ZoneTest, testParallelUpdate) {
+	ai::Zone zone("test1", 4);
+	ASSERT_EQ(4, zone.threadCount());
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const int n = 10000;
+	std::vector<std::shared_ptr<CountingEntity>> characters;
+	std::vector<ai::AIPtr> ais;
+	for (int i = 0; i < n; ++i) {
+		const std::shared_ptr<CountingEntity>& character = std::make_shared<CountingEntity>(i);
+		const ai::AIPtr& ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		characters.push_back(character);
+		ais.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(ais));
+	zone.update(1);
+	ASSERT_EQ(n, (int)zone.size());
+	for (int i = 0; i < n; ++i) {
+		ASSERT_EQ(1, characters[i]->updates) << "Character " << i << " wasn't updated exactly once";
+	}
+
+	// remove every third ai - the remaining ones must still be found and updated
+	std::vector<ai::AIPtr> removed;
+	for (int i = 0; i < n; i += 3) {
+		removed.push_back(ais[i]);
+	}
+	ASSERT_TRUE(zone.removeAIs(removed));
+	zone.update(1);
+	ASSERT_EQ(n - (int)removed.size(), (int)zone.size());
+	for (int i = 0; i < n; ++i) {
+		if (i % 3 == 0) {
+			ASSERT_EQ(1, characters[i]->updates) << "Removed character " << i << " was updated";
+			ASSERT_FALSE(zone.getAI(i)) << "Removed character " << i << " is still in the zone";
+		} else {
+			ASSERT_EQ(2, characters[i]->updates) << "Character " << i << " wasn't updated exactly once";
+			ASSERT_EQ(ais[i], zone.getAI(i)) << "Character " << i << " can't be found anymore";
+		}
+	}
+}
+
+TEST_F(ZoneTest, testSpatialQueries) {
+	ai::Zone zone("test1", 1, 8.0f);
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const int n = 2000;
+	std::vector<ai::AIPtr> ais;
+	ai::randomSeed(42);
+	for (int i = 0; i < n; ++i) {
+		const ai::ICharacterPtr& character = std::make_shared<TestEntity>(i);
+		character->setPosition(glm::vec3(ai::randomf(400.0f) - 200.0f, 0.0f, ai::randomf(400.0f) - 200.0f));
+		const ai::AIPtr& ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		ais.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(ais));
+
+	for (int round = 0; round < 3; ++round) {
+		SCOPED_TRACE(round);
+		zone.update(1);
+		for (int q = 0; q < 50; ++q) {
+			const glm::vec3& center = ais[q]->getCharacter()->getPosition();
+			const float radius = 5.0f + (float)q;
+
+			std::vector<ai::CharacterId> expected;
+			std::vector<std::pair<float, ai::CharacterId>> sorted;
+			for (const ai::AIPtr& ai : ais) {
+				const ai::CharacterId id = ai->getId();
+				const float distance = glm::distance(center, ai->getCharacter()->getPosition());
+				if (id == q) {
+					continue;
+				}
+				if (distance <= radius) {
+					expected.push_back(id);
+				}
+				sorted.emplace_back(distance, id);
+			}
+			std::vector<ai::CharacterId> found;
+			zone.queryRadius(center, radius, found, q);
+			std::sort(found.begin(), found.end());
+			std::sort(expected.begin(), expected.end());
+			ASSERT_EQ(expected, found) << "radius query " << q << " failed";
+
+			std::sort(sorted.begin(), sorted.end());
+			const size_t k = 1 + q % 10;
+			std::vector<ai::CharacterId> nearest;
+			ASSERT_EQ(k, zone.queryNearest(center, k, nearest, -1.0f, q));
+			for (size_t i = 0; i < k; ++i) {
+				ASSERT_FLOAT_EQ(sorted[i].first, glm::distance(center, zone.getAI(nearest[i])->getCharacter()->getPosition()))
+					<< "nearest query " << q << " failed at " << i;
+			}
+		}
+		// move the characters - the index must follow in the next update
+		for (const ai::AIPtr& ai : ais) {
+			const ai::ICharacterPtr& chr = ai->getCharacter();
+			chr->setPosition(chr->getPosition() + glm::vec3(ai::randomf(20.0f) - 10.0f, 0.0f, ai::randomf(20.0f) - 10.0f));
+		}
+	}
+
+	// removed characters must not be found anymore
+	ASSERT_TRUE(zone.removeAI(ais[1]));
+	zone.update(1);
+	std::vector<ai::CharacterId> found;
+	zone.queryNearest(ais[1]->getCharacter()->getPosition(), n, found);
+	ASSERT_EQ(n - 1, (int)found.size());
+	ASSERT_EQ(found.end(), std::find(found.begin(), found.end(), 1));
+}
+
+TEST_F(ZoneTest, testAreaFilters) {
+	ai::Zone zone("test1", 1);
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	// the entity 0 looks along the x axis, the other entities are placed around it
+	const glm::vec3 positions[] = {
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec3(5.0f, 0.0f, 0.0f),
+		glm::vec3(-3.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 8.0f),
+		glm::vec3(20.0f, 0.0f, 1.0f),
+		glm::vec3(100.0f, 0.0f, 0.0f)
+	};
+	std::vector<ai::AIPtr> ais;
+	for (size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); ++i) {
+		const ai::ICharacterPtr& character = std::make_shared<TestEntity>((ai::CharacterId)i);
+		character->setPosition(positions[i]);
+		const ai::AIPtr& ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		ais.push_back(ai);
+	}
+	ais[0]->getCharacter()->setOrientation(0.0f);
+	ASSERT_TRUE(zone.addAIs(ais));
+	zone.update(1);
+
+	const ai::AIPtr& ai = ais[0];
+	auto sorted = [&] () {
+		ai::FilteredEntities entities = ai->getFilteredEntities();
+		std::sort(entities.begin(), entities.end());
+		ai::SelectEmpty::get()->filter(ai);
+		return entities;
+	};
+
+	ai::SelectInRadius("10").filter(ai);
+	ASSERT_EQ(ai::FilteredEntities({1, 2, 3}), sorted());
+
+	ai::SelectKNearest("2").filter(ai);
+	ASSERT_EQ(ai::FilteredEntities({2, 1}), ai->getFilteredEntities());
+	ai::SelectEmpty::get()->filter(ai);
+
+	ai::SelectKNearest("10,25").filter(ai);
+	ASSERT_EQ(ai::FilteredEntities({2, 1, 3, 4}), ai->getFilteredEntities());
+	ai::SelectEmpty::get()->filter(ai);
+
+	ai::SelectInFieldOfView("50,90").filter(ai);
+	ASSERT_EQ(ai::FilteredEntities({1, 4}), sorted());
+
+	ai::SelectInFieldOfView("50,360").filter(ai);
+	ASSERT_EQ(ai::FilteredEntities({1, 2, 3, 4}), sorted());
+}
@@ -11,6 +11,8 @@
 #include <string>
 #include <memory>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 
 namespace ai {
 
@@ -101,6 +103,22 @@ protected:
 	std::string _type;
 	std::string _parameters;
 	ConditionPtr _condition;
+	/**
+	 * @brief The dense index of this node in its behaviour tree - the per node states of an @c AI are
+	 * stored at this index. @c -1 until the tree was compiled.
+	 * @sa compileStateIndices()
+	 */
+	mutable std::atomic_int _stateIndex;
+	/**
+	 * @brief The amount of state entries of the tree - only set for nodes that were compiled as root
+	 * @sa compileStateIndices()
+	 */
+	mutable std::atomic_int _stateSize;
+
+	/**
+	 * @return The index of the node states in the @c AI state block - grows the state block if needed
+	 */
+	int stateIndex(const AIPtr& entity) const;
 
 	TreeNodeStatus state(const AIPtr& entity, TreeNodeStatus treeNodeState);
 	int getSelectorState(const AIPtr& entity) const;
@@ -119,7 +137,7 @@ public:
 	 * @param condition The connected ICondition for this node
 	 */
 	TreeNode(const std::string& name, const std::string& parameters, const ConditionPtr& condition) :
-			_id(getNextId()), _name(name), _parameters(parameters), _condition(condition) {
+			_id(getNextId()), _name(name), _parameters(parameters), _condition(condition), _stateIndex(-1), _stateSize(0) {
 	}
 
 	virtual ~TreeNode() {}
@@ -129,6 +147,19 @@ public:
 	 */
 	int getId() const;
 
+	/**
+	 * @return The dense index of this node in its behaviour tree or @c -1 if the tree wasn't compiled yet
+	 * @sa compileStateIndices()
+	 */
+	int getStateIndex() const;
+
+	/**
+	 * @return The amount of state entries that are needed for the tree of this root node or @c 0 if
+	 * the tree wasn't compiled yet
+	 * @sa compileStateIndices()
+	 */
+	int getStateSize() const;
+
 	/**
 	 * @brief Each node can have a user defines name that can be retrieved with this method.
 	 */
@@ -196,6 +227,18 @@ public:
 	 * @return An empty TreeNodePtr if not found, or the parent is the root node of the behaviour tree
 	 */
 	TreeNodePtr getParent(const TreeNodePtr& self, int id) const;
+
+	/**
+	 * @brief Assigns a dense state index to every node of the given (sub) tree that doesn't have one yet.
+	 * Nodes that already have an index keep it - so the states of the @c AI instances stay valid if nodes are
+	 * added to or removed from the tree at runtime.
+	 *
+	 * The trees are compiled when they are loaded or modified - not while the entities are ticked.
+	 *
+	 * @note A node instance should only be part of one behaviour tree.
+	 * @return The amount of state entries that are needed for the tree
+	 */
+	static int compileStateIndices(const TreeNode* root);
 };
 
 }
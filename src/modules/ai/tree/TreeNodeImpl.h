@@ -12,6 +12,14 @@ inline int TreeNode::getId() const {
 	return _id;
 }
 
+inline int TreeNode::getStateIndex() const {
+	return _stateIndex.load(std::memory_order_acquire);
+}
+
+inline int TreeNode::getStateSize() const {
+	return _stateSize.load(std::memory_order_acquire);
+}
+
 inline void TreeNode::setName(const std::string& name) {
 	if (name.empty()) {
 		return;
@@ -65,42 +73,66 @@ inline void TreeNode::getRunningChildren(const AIPtr& /*entity*/, std::vector<bo
 	}
 }
 
+inline int TreeNode::compileStateIndices(const TreeNode* root) {
+	static std::mutex compileMutex;
+	std::lock_guard<std::mutex> lock(compileMutex);
+	std::vector<const TreeNode*> nodes;
+	nodes.push_back(root);
+	int maxIndex = -1;
+	// first pass: find the highest index that is already in use
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		const TreeNode* node = nodes[i];
+		maxIndex = std::max(maxIndex, node->_stateIndex.load(std::memory_order_relaxed));
+		for (const TreeNodePtr& child : node->_children) {
+			nodes.push_back(child.get());
+		}
+	}
+	// second pass: the new nodes get the following indices - breadth first
+	for (const TreeNode* node : nodes) {
+		if (node->_stateIndex.load(std::memory_order_relaxed) < 0) {
+			node->_stateIndex.store(++maxIndex, std::memory_order_release);
+		}
+	}
+	root->_stateSize.store(maxIndex + 1, std::memory_order_release);
+	return maxIndex + 1;
+}
+
+inline int TreeNode::stateIndex(const AIPtr& entity) const {
+	const int index = _stateIndex.load(std::memory_order_acquire);
+	if (index >= 0 && index < entity->_treeStatesSize && entity->_treeStatesBehaviour == entity->_behaviour.get()) {
+		return index;
+	}
+	return entity->prepareTreeStates(this);
+}
+
 inline void TreeNode::setLastExecMillis(const AIPtr& entity) {
 	if (!entity->_debuggingActive) {
 		return;
 	}
-	entity->_lastExecMillis[getId()] = entity->_time;
+	entity->_treeStates.lastExecMillis[stateIndex(entity)] = entity->_time;
 }
 
 inline int TreeNode::getSelectorState(const AIPtr& entity) const {
-	AI::SelectorStates::const_iterator i = entity->_selectorStates.find(getId());
-	if (i == entity->_selectorStates.end()) {
-		return AI_NOTHING_SELECTED;
-	}
-	return i->second;
+	return entity->_treeStates.selectorStates[stateIndex(entity)];
 }
 
 inline void TreeNode::setSelectorState(const AIPtr& entity, int selected) {
-	entity->_selectorStates[getId()] = selected;
+	entity->_treeStates.selectorStates[stateIndex(entity)] = selected;
 }
 
 inline int TreeNode::getLimitState(const AIPtr& entity) const {
-	AI::LimitStates::const_iterator i = entity->_limitStates.find(getId());
-	if (i == entity->_limitStates.end()) {
-		return 0;
-	}
-	return i->second;
+	return entity->_treeStates.limitStates[stateIndex(entity)];
 }
 
 inline void TreeNode::setLimitState(const AIPtr& entity, int amount) {
-	entity->_limitStates[getId()] = amount;
+	entity->_treeStates.limitStates[stateIndex(entity)] = amount;
 }
 
 inline TreeNodeStatus TreeNode::state(const AIPtr& entity, TreeNodeStatus treeNodeState) {
 	if (!entity->_debuggingActive) {
 		return treeNodeState;
 	}
-	entity->_lastStatus[getId()] = treeNodeState;
+	entity->_treeStates.lastStatus[stateIndex(entity)] = treeNodeState;
 	return treeNodeState;
 }
 
@@ -108,22 +140,14 @@ inline int64_t TreeNode::getLastExecMillis(const AIPtr& entity) const {
 	if (!entity->_debuggingActive) {
 		return -1L;
 	}
-	AI::LastExecMap::const_iterator i = entity->_lastExecMillis.find(getId());
-	if (i == entity->_lastExecMillis.end()) {
-		return -1L;
-	}
-	return i->second;
+	return entity->_treeStates.lastExecMillis[stateIndex(entity)];
 }
 
 inline TreeNodeStatus TreeNode::getLastStatus(const AIPtr& entity) const {
 	if (!entity->_debuggingActive) {
 		return UNKNOWN;
 	}
-	AI::NodeStates::const_iterator i = entity->_lastStatus.find(getId());
-	if (i == entity->_lastStatus.end()) {
-		return UNKNOWN;
-	}
-	return i->second;
+	return entity->_treeStates.lastStatus[stateIndex(entity)];
 }
 
 inline TreeNodePtr TreeNode::getChild(int id) const {
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "common/Thread.h"
+#include "tree/TreeNode.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -85,6 +86,8 @@ public:
 				return false;
 			}
 		}
+		// the entities that use the tree don't have to compile it on their first tick
+		TreeNode::compileStateIndices(root.get());
 		{
 			ScopedWriteLock scopedLock(_lock);
 			_treeMap.insert(std::make_pair(name, root));
@@ -0,0 +1,329 @@
+/**
+ * @file
+ * @ingroup Zone
+ */
+#pragma once
+
+#include "common/Types.h"
+#include "common/Math.h"
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+namespace ai {
+
+/**
+ * @brief Uniform grid of the character positions of a zone on the xz plane.
+ *
+ * The positions are snapshots - the index is not aware of characters that move afterwards. New
+ * positions are staged with @c stage() (which may be called concurrently for different indices while
+ * the queries still see the old positions) and applied with @c commit(). The entries are stored in a
+ * dense list (in the same order as the ai list of the zone), the cells only reference them. An entry
+ * is only moved between the cells if the character left its cell.
+ *
+ * @note Apart from @c stage() not thread safe - the @c Zone only modifies the index while no queries
+ * are running.
+ */
+class SpatialIndex {
+public:
+	struct Entry {
+		CharacterId id;
+		glm::vec3 position;
+	};
+
+private:
+	// indices into the entry list
+	typedef std::vector<uint32_t> Cell;
+	typedef std::unordered_map<uint64_t, Cell> Cells;
+
+	struct Location {
+		uint64_t cell;
+		// the index in the entry list of the cell
+		uint32_t slot;
+	};
+
+	float _cellSize;
+	float _invCellSize;
+	Cells _cells;
+	std::vector<Entry> _entries;
+	// the cell locations of the entries - same order as _entries
+	std::vector<Location> _locations;
+	// the staged positions - same order as _entries
+	std::vector<glm::vec3> _staged;
+
+	inline int cellCoord(float v) const {
+		return (int)std::floor(v * _invCellSize);
+	}
+
+	static inline uint64_t key(int x, int z) {
+		return ((uint64_t)(uint32_t)x << 32) | (uint64_t)(uint32_t)z;
+	}
+
+	inline uint64_t key(const glm::vec3& position) const {
+		return key(cellCoord(position.x), cellCoord(position.z));
+	}
+
+	void addToCell(uint32_t index, uint64_t cellKey) {
+		Cell& cell = _cells[cellKey];
+		_locations[index] = Location{cellKey, (uint32_t)cell.size()};
+		cell.push_back(index);
+	}
+
+	void removeFromCell(const Location& location) {
+		auto i = _cells.find(location.cell);
+		Cell& cell = i->second;
+		const uint32_t last = (uint32_t)cell.size() - 1;
+		if (location.slot != last) {
+			cell[location.slot] = cell[last];
+			_locations[cell[location.slot]].slot = location.slot;
+		}
+		cell.pop_back();
+		if (cell.empty()) {
+			_cells.erase(i);
+		}
+	}
+
+	/**
+	 * @brief Calls the functor for all entries of the cells in the given cell rectangle
+	 */
+	template<typename Func>
+	void visitCells(int minX, int minZ, int maxX, int maxZ, Func& func) const {
+		for (int x = minX; x <= maxX; ++x) {
+			for (int z = minZ; z <= maxZ; ++z) {
+				auto i = _cells.find(key(x, z));
+				if (i == _cells.end()) {
+					continue;
+				}
+				for (uint32_t index : i->second) {
+					func(_entries[index]);
+				}
+			}
+		}
+	}
+
+public:
+	/**
+	 * @param[in] cellSize The edge length of the grid cells - queries are fastest if their radius is
+	 * in the range of the cell size.
+	 */
+	explicit SpatialIndex(float cellSize = 16.0f) :
+			_cellSize(cellSize), _invCellSize(1.0f / cellSize) {
+		ai_assert(cellSize > 0.0f, "The cell size must be bigger than 0");
+	}
+
+	/**
+	 * @brief Adds a new entry at the end of the entry list
+	 */
+	void add(CharacterId id, const glm::vec3& position) {
+		const uint32_t index = (uint32_t)_entries.size();
+		_entries.push_back(Entry{id, position});
+		_locations.emplace_back();
+		_staged.push_back(position);
+		addToCell(index, key(position));
+	}
+
+	/**
+	 * @brief Updates the position of the entry at the given index
+	 */
+	inline void update(size_t index, const glm::vec3& position) {
+		Entry& entry = _entries[index];
+		if (entry.position == position) {
+			return;
+		}
+		entry.position = position;
+		const uint64_t cellKey = key(position);
+		const Location location = _locations[index];
+		if (location.cell == cellKey) {
+			return;
+		}
+		removeFromCell(location);
+		addToCell((uint32_t)index, cellKey);
+	}
+
+	/**
+	 * @brief Remembers the new position of the entry at the given index - it is applied in @c commit()
+	 * @note Can be called in parallel for different indices - also while queries are running.
+	 */
+	inline void stage(size_t index, const glm::vec3& position) {
+		_staged[index] = position;
+	}
+
+	/**
+	 * @brief Applies all staged positions
+	 */
+	void commit() {
+		const size_t n = _entries.size();
+		for (size_t i = 0; i < n; ++i) {
+			update(i, _staged[i]);
+		}
+	}
+
+	/**
+	 * @brief Removes the entry at the given index - the last entry is moved into the gap
+	 */
+	void remove(size_t index) {
+		removeFromCell(_locations[index]);
+		const size_t last = _entries.size() - 1;
+		if (index != last) {
+			_entries[index] = _entries[last];
+			_locations[index] = _locations[last];
+			_staged[index] = _staged[last];
+			_cells[_locations[index].cell][_locations[index].slot] = (uint32_t)index;
+		}
+		_entries.pop_back();
+		_locations.pop_back();
+		_staged.pop_back();
+	}
+
+	void clear() {
+		_cells.clear();
+		_entries.clear();
+		_locations.clear();
+		_staged.clear();
+	}
+
+	inline size_t size() const {
+		return _entries.size();
+	}
+
+	inline float cellSize() const {
+		return _cellSize;
+	}
+
+	/**
+	 * @brief Calls @c func(entry, distanceSquared) for all entries that are not further away than
+	 * @c radius from the given position
+	 */
+	template<typename Func>
+	void visitRadius(const glm::vec3& position, float radius, Func func) const {
+		if (radius < 0.0f) {
+			return;
+		}
+		const float radiusSquared = radius * radius;
+		auto visitor = [&] (const Entry& entry) {
+			const glm::vec3 delta = entry.position - position;
+			const float distanceSquared = glm::dot(delta, delta);
+			if (distanceSquared <= radiusSquared) {
+				func(entry, distanceSquared);
+			}
+		};
+		const int minX = cellCoord(position.x - radius);
+		const int minZ = cellCoord(position.z - radius);
+		const int maxX = cellCoord(position.x + radius);
+		const int maxZ = cellCoord(position.z + radius);
+		if ((uint64_t)(maxX - minX + 1) * (uint64_t)(maxZ - minZ + 1) > _cells.size()) {
+			// the radius covers more cells than there are occupied cells - just check all of them
+			for (const Entry& entry : _entries) {
+				visitor(entry);
+			}
+			return;
+		}
+		visitCells(minX, minZ, maxX, maxZ, visitor);
+	}
+
+	/**
+	 * @brief Collects the ids of all characters that are not further away than @c radius
+	 * @param[in] exclude This character id is not added to the result - e.g. the character that executes the query
+	 * @return The amount of added ids
+	 */
+	size_t queryRadius(const glm::vec3& position, float radius, std::vector<CharacterId>& out,
+			CharacterId exclude) const {
+		const size_t before = out.size();
+		visitRadius(position, radius, [&] (const Entry& entry, float) {
+			if (entry.id != exclude) {
+				out.push_back(entry.id);
+			}
+		});
+		return out.size() - before;
+	}
+
+	/**
+	 * @brief Collects the ids of the @c k closest characters - sorted by their distance, the closest first
+	 * @param[in] maxRadius Characters further away than this are not taken into account - a negative value
+	 * means no limit
+	 * @param[in] exclude This character id is not added to the result - e.g. the character that executes the query
+	 * @return The amount of added ids
+	 */
+	size_t queryNearest(const glm::vec3& position, size_t k, std::vector<CharacterId>& out,
+			float maxRadius, CharacterId exclude) const {
+		if (k == 0 || _entries.empty()) {
+			return 0;
+		}
+		typedef std::pair<float, CharacterId> Candidate;
+		// max heap of the k closest candidates so far
+		std::vector<Candidate> heap;
+		heap.reserve(k + 1);
+		const float maxRadiusSquared = maxRadius < 0.0f ? std::numeric_limits<float>::max() : maxRadius * maxRadius;
+		const int centerX = cellCoord(position.x);
+		const int centerZ = cellCoord(position.z);
+		size_t visited = 0;
+		auto visitor = [&] (const Entry& entry) {
+			++visited;
+			if (entry.id == exclude) {
+				return;
+			}
+			const glm::vec3 delta = entry.position - position;
+			const float distanceSquared = glm::dot(delta, delta);
+			if (distanceSquared > maxRadiusSquared) {
+				return;
+			}
+			if (heap.size() == k) {
+				if (distanceSquared >= heap.front().first) {
+					return;
+				}
+				std::pop_heap(heap.begin(), heap.end());
+				heap.pop_back();
+			}
+			heap.emplace_back(distanceSquared, entry.id);
+			std::push_heap(heap.begin(), heap.end());
+		};
+
+		// search the cells in rings around the center cell - every entry of ring r + 1 is at least
+		// r cells away from the given position
+		for (int ring = 0;; ++ring) {
+			const size_t side = 2 * (size_t)ring + 1;
+			if (side * side > _cells.size()) {
+				// the ring covers more cells than there are occupied cells - just check all of them
+				heap.clear();
+				for (const Entry& entry : _entries) {
+					visitor(entry);
+				}
+				break;
+			}
+			if (ring == 0) {
+				visitCells(centerX, centerZ, centerX, centerZ, visitor);
+			} else {
+				const int minX = centerX - ring;
+				const int maxX = centerX + ring;
+				const int minZ = centerZ - ring;
+				const int maxZ = centerZ + ring;
+				visitCells(minX, minZ, maxX, minZ, visitor);
+				visitCells(minX, maxZ, maxX, maxZ, visitor);
+				visitCells(minX, minZ + 1, minX, maxZ - 1, visitor);
+				visitCells(maxX, minZ + 1, maxX, maxZ - 1, visitor);
+			}
+			if (visited >= _entries.size()) {
+				break;
+			}
+			const float nextRingDistance = (float)ring * _cellSize;
+			const float nextRingDistanceSquared = nextRingDistance * nextRingDistance;
+			if (nextRingDistanceSquared > maxRadiusSquared) {
+				break;
+			}
+			if (heap.size() == k && heap.front().first <= nextRingDistanceSquared) {
+				break;
+			}
+		}
+
+		std::sort_heap(heap.begin(), heap.end());
+		for (const Candidate& candidate : heap) {
+			out.push_back(candidate.second);
+		}
+		return heap.size();
+	}
+};
+
+}
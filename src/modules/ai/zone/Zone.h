@@ -16,9 +16,10 @@
 #include "ICharacter.h"
 #include "group/GroupMgr.h"
 #include "common/Thread.h"
-#include "common/ThreadPool.h"
+#include "common/ParallelExecutor.h"
 #include "common/Types.h"
 #include "common/ExecutionTime.h"
+#include "zone/SpatialIndex.h"
 #include <unordered_map>
 #include <vector>
 #include <memory>
@@ -39,23 +40,48 @@ typedef std::shared_ptr<AI> AIPtr;
  */
 class Zone {
 public:
-	typedef std::unordered_map<CharacterId, AIPtr> AIMap;
+	typedef std::vector<AIPtr> AIList;
 	typedef std::vector<AIPtr> AIScheduleList;
 	typedef std::vector<CharacterId> CharacterIdList;
-	typedef AIMap::const_iterator AIMapConstIter;
-	typedef AIMap::iterator AIMapIter;
+	// maps the character id to the index in the ai list
+	typedef std::unordered_map<CharacterId, size_t> AIIndexMap;
 
 protected:
 	const std::string _name;
-	AIMap _ais;
+	// contiguous list of all ai instances - the ai tick iterates over this. Only
+	// modified in Zone::update - the positions are staged during the tick and committed under the write lock.
+	AIList _ais;
+	// the character ids of the entries in _ais
+	CharacterIdList _aiIds;
+	AIIndexMap _aiIndex;
 	AIScheduleList _scheduledAdd;
 	AIScheduleList _scheduledRemove;
 	CharacterIdList _scheduledDestroy;
+	// the schedule lists are swapped with these to process them without holding the schedule lock
+	AIScheduleList _processAdd;
+	AIScheduleList _processRemove;
+	CharacterIdList _processDestroy;
 	bool _debug;
 	ReadWriteLock _lock {"zone"};
 	ReadWriteLock _scheduleLock {"zone-schedulelock"};
 	ai::GroupMgr _groupManager;
-	mutable ThreadPool _threadPool;
+	mutable ParallelExecutor _executor;
+	// the character positions at the end of the last tick - same order as _ais. Only
+	// modified in Zone::update - the positions are staged during the tick and committed under the write lock
+	SpatialIndex _spatialIndex;
+
+	/**
+	 * @brief Removes the entry at the given index from the ai list - the last entry is moved into the gap
+	 */
+	void removeIndex(size_t index);
+
+	/**
+	 * @return A copy of the current ai list - for the functors that are executed outside of the zone update
+	 */
+	AIList snapshot() const {
+		ScopedReadLock scopedLock(_lock);
+		return _ais;
+	}
 
 	/**
 	 * @brief called in the zone update to add new @c AI instances.
@@ -78,8 +104,14 @@ protected:
 	bool doDestroyAI(const CharacterId& id);
 
 public:
-	Zone(const std::string& name, int threadCount = std::min(1u, std::thread::hardware_concurrency())) :
-			_name(name), _debug(false), _threadPool(threadCount) {
+	/**
+	 * @param[in] threadCount The amount of threads that tick the @c AI instances of this zone - including
+	 * the thread that calls @c Zone::update
+	 * @param[in] cellSize The cell size of the spatial index that is used for the area queries
+	 */
+	Zone(const std::string& name, int threadCount = std::max(1u, std::thread::hardware_concurrency()), float cellSize = 16.0f) :
+			_name(name), _debug(false), _executor(std::max(1, threadCount)),
+			_spatialIndex(cellSize) {
 	}
 
 	virtual ~Zone() {}
@@ -87,7 +119,8 @@ public:
 	/**
 	 * @brief Update all the @c ICharacter and @c AI instances in this zone.
 	 * @param dt Delta time in millis since the last update call happened
-	 * @note You have to call this on your own.
+	 * @note You have to call this on your own - and always from the same thread.
+	 * @note The @c AI instances are ticked in parallel - see @c threadCount()
 	 */
 	void update(int64_t dt);
 
@@ -157,6 +190,11 @@ public:
 	void setDebug(bool debug);
 	bool isDebug () const;
 
+	/**
+	 * @return The amount of threads that tick the @c AI instances
+	 */
+	int threadCount() const;
+
 	GroupMgr& getGroupMgr();
 
 	const GroupMgr& getGroupMgr() const;
@@ -170,11 +208,11 @@ public:
 	 */
 	inline AIPtr getAI(CharacterId id) const {
 		ScopedReadLock scopedLock(_lock);
-		auto i = _ais.find(id);
-		if (i == _ais.end()) {
+		auto i = _aiIndex.find(id);
+		if (i == _aiIndex.end()) {
 			return AIPtr();
 		}
-		const AIPtr& ai = i->second;
+		const AIPtr& ai = _ais[i->second];
 		return ai;
 	}
 
@@ -203,14 +241,14 @@ public:
 	 * @brief Executes a lambda or functor for the given character
 	 *
 	 * @returns @c std::future with the result of @c func.
-	 * @note This is executed in a thread pool - so make sure to synchronize your lambda or functor.
-	 * We also don't wait for the functor or lambda here, we are scheduling it in a worker in the
-	 * thread pool. If you want to wait - you have to use the returned future.
+	 * @note This is executed by the workers that also tick the @c AI instances - so make sure to synchronize
+	 * your lambda or functor. We also don't wait for the functor or lambda here, we are scheduling it in a
+	 * worker. If you want to wait - you have to use the returned future.
 	 */
 	template<typename Func>
 	inline auto executeAsync(const AIPtr& ai, const Func& func) const
 		-> std::future<typename std::result_of<Func(const AIPtr&)>::type> {
-		return _threadPool.enqueue(func, ai);
+		return _executor.enqueue(func, ai);
 	}
 
 	template<typename Func>
@@ -256,17 +294,10 @@ public:
 	 */
 	template<typename Func>
 	void executeParallel(Func& func) {
-		std::vector<std::future<void> > results;
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != _ais.end(); ++i) {
-			const AIPtr& ai = i->second;
-			results.emplace_back(executeAsync(ai, func));
-		}
-		for (auto & result: results) {
-			result.wait();
-		}
+		const AIList& copy = snapshot();
+		_executor.run(copy.size(), [&] (size_t index) {
+			func(copy[index]);
+		});
 	}
 
 	/**
@@ -278,17 +309,10 @@ public:
 	 */
 	template<typename Func>
 	void executeParallel(const Func& func) const {
-		std::vector<std::future<void> > results;
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
-			results.emplace_back(executeAsync(ai, func));
-		}
-		for (auto & result: results) {
-			result.wait();
-		}
+		const AIList& copy = snapshot();
+		_executor.run(copy.size(), [&] (size_t index) {
+			func(copy[index]);
+		});
 	}
 
 	/**
@@ -299,11 +323,8 @@ public:
 	 */
 	template<typename Func>
 	void execute(const Func& func) const {
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
+		const AIList& copy = snapshot();
+		for (const AIPtr& ai : copy) {
 			func(ai);
 		}
 	}
@@ -316,11 +337,8 @@ public:
 	 */
 	template<typename Func>
 	void execute(Func& func) {
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
+		const AIList& copy = snapshot();
+		for (const AIPtr& ai : copy) {
 			func(ai);
 		}
 	}
@@ -329,6 +347,44 @@ public:
 		ScopedReadLock scopedLock(_lock);
 		return _ais.size();
 	}
+
+	/**
+	 * @brief Collects the ids of all characters that are not further away than @c radius from the
+	 * given position.
+	 * @param[in] exclude This character id is not added to the result - e.g. the querying character
+	 * @note The positions are those of the end of the last tick
+	 * @note This locks the zone for reading
+	 */
+	inline size_t queryRadius(const glm::vec3& position, float radius, std::vector<CharacterId>& out,
+			CharacterId exclude = AI_NOTHING_SELECTED) const {
+		ScopedReadLock scopedLock(_lock);
+		return _spatialIndex.queryRadius(position, radius, out, exclude);
+	}
+
+	/**
+	 * @brief Collects the ids of the @c k closest characters - the closest first.
+	 * @param[in] maxRadius Characters that are further away are ignored - a negative value means no limit
+	 * @param[in] exclude This character id is not added to the result - e.g. the querying character
+	 * @note The positions are those of the end of the last tick
+	 * @note This locks the zone for reading
+	 */
+	inline size_t queryNearest(const glm::vec3& position, size_t k, std::vector<CharacterId>& out,
+			float maxRadius = -1.0f, CharacterId exclude = AI_NOTHING_SELECTED) const {
+		ScopedReadLock scopedLock(_lock);
+		return _spatialIndex.queryNearest(position, k, out, maxRadius, exclude);
+	}
+
+	/**
+	 * @brief Calls @c func(entry, distanceSquared) for each @c SpatialIndex::Entry that is not further
+	 * away than @c radius from the given position.
+	 * @note The functor must not modify the zone
+	 * @note This locks the zone for reading
+	 */
+	template<typename Func>
+	inline void visitRadius(const glm::vec3& position, float radius, const Func& func) const {
+		ScopedReadLock scopedLock(_lock);
+		_spatialIndex.visitRadius(position, radius, func);
+	}
 };
 
 inline void Zone::setDebug (bool debug) {
@@ -343,6 +399,10 @@ inline const std::string& Zone::getName() const {
 	return _name;
 }
 
+inline int Zone::threadCount() const {
+	return (int)_executor.threads();
+}
+
 inline GroupMgr& Zone::getGroupMgr() {
 	return _groupManager;
 }
@@ -351,15 +411,30 @@ inline const GroupMgr& Zone::getGroupMgr() const {
 	return _groupManager;
 }
 
+inline void Zone::removeIndex(size_t index) {
+	const size_t last = _ais.size() - 1;
+	if (index != last) {
+		_ais[index] = std::move(_ais[last]);
+		_aiIds[index] = _aiIds[last];
+		_aiIndex[_aiIds[index]] = index;
+	}
+	_ais.pop_back();
+	_aiIds.pop_back();
+	_spatialIndex.remove(index);
+}
+
 inline bool Zone::doAddAI(const AIPtr& ai) {
 	if (ai == nullptr) {
 		return false;
 	}
 	const CharacterId& id = ai->getCharacter()->getId();
-	if (_ais.find(id) != _ais.end()) {
+	if (_aiIndex.find(id) != _aiIndex.end()) {
 		return false;
 	}
-	_ais.insert(std::make_pair(id, ai));
+	_aiIndex.insert(std::make_pair(id, _ais.size()));
+	_ais.push_back(ai);
+	_aiIds.push_back(id);
+	_spatialIndex.add(id, ai->getCharacter()->getPosition());
 	ai->setZone(this);
 	return true;
 }
@@ -369,22 +444,27 @@ inline bool Zone::doRemoveAI(const AIPtr& ai) {
 		return false;
 	}
 	const CharacterId& id = ai->getCharacter()->getId();
-	AIMapIter i = _ais.find(id);
-	if (i == _ais.end()) {
+	auto i = _aiIndex.find(id);
+	if (i == _aiIndex.end()) {
 		return false;
 	}
-	i->second->setZone(nullptr);
-	_groupManager.removeFromAllGroups(i->second);
-	_ais.erase(i);
+	const size_t index = i->second;
+	_aiIndex.erase(i);
+	const AIPtr& removed = _ais[index];
+	removed->setZone(nullptr);
+	_groupManager.removeFromAllGroups(removed);
+	removeIndex(index);
 	return true;
 }
 
 inline bool Zone::doDestroyAI(const CharacterId& id) {
-	AIMapIter i = _ais.find(id);
-	if (i == _ais.end()) {
+	auto i = _aiIndex.find(id);
+	if (i == _aiIndex.end()) {
 		return false;
 	}
-	_ais.erase(i);
+	const size_t index = i->second;
+	_aiIndex.erase(i);
+	removeIndex(index);
 	return true;
 }
 
@@ -414,38 +494,42 @@ inline bool Zone::removeAI(const AIPtr& ai) {
 
 inline void Zone::update(int64_t dt) {
 	{
-		AIScheduleList scheduledRemove;
-		AIScheduleList scheduledAdd;
-		CharacterIdList scheduledDestroy;
 		{
 			ScopedWriteLock scopedLock(_scheduleLock);
-			scheduledAdd = _scheduledAdd;
-			scheduledRemove = _scheduledRemove;
-			scheduledDestroy = _scheduledDestroy;
-			_scheduledAdd.clear();
-			_scheduledRemove.clear();
-			_scheduledDestroy.clear();
+			_processAdd.swap(_scheduledAdd);
+			_processRemove.swap(_scheduledRemove);
+			_processDestroy.swap(_scheduledDestroy);
 		}
 		ScopedWriteLock scopedLock(_lock);
-		for (const AIPtr& ai : scheduledAdd) {
+		for (const AIPtr& ai : _processAdd) {
 			doAddAI(ai);
 		}
-		for (const AIPtr& ai : scheduledRemove) {
+		for (const AIPtr& ai : _processRemove) {
 			doRemoveAI(ai);
 		}
-		for (auto id : scheduledDestroy) {
+		for (auto id : _processDestroy) {
 			doDestroyAI(id);
 		}
+		_processAdd.clear();
+		_processRemove.clear();
+		_processDestroy.clear();
 	}
 
-	auto func = [&] (const AIPtr& ai) {
-		if (ai->isPause()) {
-			return;
+	// the ai list is only modified above - so there is no need to lock or copy it for the tick
+	const bool debug = _debug;
+	_executor.run(_ais.size(), [this, dt, debug] (size_t index) {
+		const AIPtr& ai = _ais[index];
+		if (!ai->isPause()) {
+			ai->update(dt, debug);
+			ai->getBehaviour()->execute(ai, dt);
 		}
-		ai->update(dt, _debug);
-		ai->getBehaviour()->execute(ai, dt);
-	};
-	executeParallel(func);
+		// the queries of this tick still see the positions of the last tick
+		_spatialIndex.stage(index, ai->getCharacter()->getPosition());
+	});
+	{
+		ScopedWriteLock scopedLock(_lock);
+		_spatialIndex.commit();
+	}
 	_groupManager.update(dt);
 }
 
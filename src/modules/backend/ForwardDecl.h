@@ -65,6 +65,13 @@ typedef std::shared_ptr<Npc> NpcPtr;
 class EntityStorage;
 typedef std::shared_ptr<EntityStorage> EntityStoragePtr;
 
+namespace db {
+
+class StockModel;
+class InventoryModel;
+
+}
+
 }
 
 namespace poi {
@@ -93,6 +100,9 @@ namespace core {
 class TimeProvider;
 typedef std::shared_ptr<TimeProvider> TimeProviderPtr;
 
+class TimerWheel;
+typedef std::shared_ptr<TimerWheel> TimerWheelPtr;
+
 }
 
 namespace persistence {
@@ -100,4 +110,10 @@ namespace persistence {
 class DBHandler;
 typedef std::shared_ptr<DBHandler> DBHandlerPtr;
 
+class PersistenceMgr;
+typedef std::shared_ptr<PersistenceMgr> PersistenceMgrPtr;
+
+class AsyncDBHandler;
+typedef std::shared_ptr<AsyncDBHandler> AsyncDBHandlerPtr;
+
 }
@@ -9,8 +9,8 @@
 
 namespace backend {
 
-Entity::Entity(EntityId id, const network::ServerMessageSenderPtr& messageSender, const core::TimeProviderPtr& timeProvider, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider) :
-		_messageSender(messageSender), _containerProvider(containerProvider), _cooldowns(timeProvider, cooldownProvider), _entityId(id) {
+Entity::Entity(EntityId id, const network::ServerMessageSenderPtr& messageSender, const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider) :
+		_messageSender(messageSender), _containerProvider(containerProvider), _timeProvider(timeProvider), _timerWheel(timerWheel), _cooldowns(timeProvider, timerWheel, cooldownProvider), _entityId(id) {
 	_attribs.addListener(std::bind(&Entity::onAttribChange, this, std::placeholders::_1));
 }
 
@@ -23,6 +23,9 @@ void Entity::visibleAdd(const EntitySet& entities) {
 	}
 }
 
+void Entity::visibleUpdated() {
+}
+
 void Entity::visibleRemove(const EntitySet& entities) {
 	for (const EntityPtr& e : entities) {
 		Log::trace("entity %i is no longer visible for %i", (int)e->id(), (int)id());
@@ -113,7 +116,6 @@ bool Entity::update(long dt) {
 		sendAttribUpdate();
 		_dirtyAttributeTypes.clear();
 	}
-	_cooldowns.update();
 	return true;
 }
 
@@ -126,26 +128,14 @@ void Entity::updateVisible(const EntitySet& set) {
 	core_assert(stillVisible.size() + add.size() == _visible.size());
 	_visibleLock.unlockWrite();
 
-	for (const auto& e : _visible) {
-		sendEntityUpdate(e);
-	}
-
 	if (!add.empty()) {
 		visibleAdd(add);
 	}
 	if (!remove.empty()) {
 		visibleRemove(remove);
 	}
-}
 
-void Entity::sendEntityUpdate(const EntityPtr& entity) const {
-	if (_peer == nullptr) {
-		return;
-	}
-	flatbuffers::FlatBufferBuilder fbb;
-	const glm::vec3& _pos = entity->pos();
-	const network::Vec3 pos { _pos.x, _pos.y, _pos.z };
-	_messageSender->sendServerMessage(_peer, fbb, network::ServerMsgType::EntityUpdate, network::CreateEntityUpdate(fbb, entity->id(), &pos, entity->orientation()).Union());
+	visibleUpdated();
 }
 
 void Entity::sendEntitySpawn(const EntityPtr& entity) const {
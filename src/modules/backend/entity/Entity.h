@@ -29,8 +29,9 @@ typedef std::unordered_set<EntityPtr> EntitySet;
 /**
  * @brief Every actor in the world is an entity
  *
- * Entities are updated via @c network::ServerMsgType::EntityUpdate
- * message for the clients that are seeing the entity
+ * Entities are updated via @c network::ServerMsgType::EntityUpdates
+ * message for the clients that are seeing the entity - one message per tick
+ * that contains all the visible entities that changed.
  *
  * @sa EntityUpdateHandler
  */
@@ -49,6 +50,9 @@ protected:
 	attrib::Attributes _attribs;
 	std::unordered_set<attrib::DirtyValue> _dirtyAttributeTypes;
 
+	core::TimeProviderPtr _timeProvider;
+	core::TimerWheelPtr _timerWheel;
+
 	// cooldowns
 	cooldown::CooldownMgr _cooldowns;
 
@@ -67,14 +71,18 @@ protected:
 	 */
 	virtual void visibleRemove(const EntitySet& entities);
 
+	/**
+	 * @brief Called after every visibility update - also if the set of visible entities didn't change
+	 */
+	virtual void visibleUpdated();
+
 	void sendAttribUpdate();
-	void sendEntityUpdate(const EntityPtr& entity) const;
 	void sendEntitySpawn(const EntityPtr& entity) const;
 	void sendEntityRemove(const EntityPtr& entity) const;
 
 	void onAttribChange(const attrib::DirtyValue& v);
 public:
-	Entity(EntityId id, const network::ServerMessageSenderPtr& messageSender, const core::TimeProviderPtr& timeProvider,
+	Entity(EntityId id, const network::ServerMessageSenderPtr& messageSender, const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel,
 			const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider);
 	virtual ~Entity();
 
@@ -6,10 +6,14 @@
 #include "core/Var.h"
 #include "core/Password.h"
 #include "core/EventBus.h"
+#include "core/TimerWheel.h"
 #include "User.h"
 #include "UserModel.h"
+#include "StockModel.h"
+#include "InventoryModel.h"
 #include "Npc.h"
 #include "persistence/DBHandler.h"
+#include "persistence/AsyncDBHandler.h"
 #include "stock/StockDataProvider.h"
 #include "metric/MetricEvent.h"
 
@@ -17,51 +21,95 @@
 
 namespace backend {
 
-EntityStorage::EntityStorage(const network::ServerMessageSenderPtr& messageSender, const voxel::WorldPtr& world, const core::TimeProviderPtr& timeProvider,
+EntityStorage::EntityStorage(const network::ServerMessageSenderPtr& messageSender, const voxel::WorldPtr& world, const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel,
 		const attrib::ContainerProviderPtr& containerProvider, const poi::PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider,
-		const persistence::DBHandlerPtr& dbHandler, const stock::StockProviderPtr& stockDataProvider, const core::EventBusPtr& eventBus) :
-		_quadTree(core::RectFloat::getMaxRect(), 100.0f), _quadTreeCache(_quadTree), _messageSender(messageSender), _world(world), _timeProvider(
-				timeProvider), _containerProvider(containerProvider), _poiProvider(poiProvider), _cooldownProvider(cooldownProvider), _dbHandler(dbHandler),
-				_stockDataProvider(stockDataProvider), _eventBus(eventBus), _time(0L) {
+		const persistence::DBHandlerPtr& dbHandler, const persistence::PersistenceMgrPtr& persistenceMgr,
+		const persistence::AsyncDBHandlerPtr& asyncDbHandler, const stock::StockProviderPtr& stockDataProvider,
+		const core::EventBusPtr& eventBus) :
+		_grid(100.0f), _messageSender(messageSender), _world(world), _timeProvider(
+				timeProvider), _timerWheel(timerWheel), _containerProvider(containerProvider), _poiProvider(poiProvider), _cooldownProvider(cooldownProvider), _dbHandler(dbHandler),
+				_persistenceMgr(persistenceMgr), _asyncDbHandler(asyncDbHandler), _stockDataProvider(stockDataProvider), _eventBus(eventBus), _time(0L) {
 }
 
-core::RectFloat EntityStorage::QuadTreeNode::getRect() const {
-	return entity->rect();
+void EntityStorage::registerUser(const UserPtr& user) {
+	_users[user->id()] = user;
+	_grid.insert(user, user->rect());
 }
 
-bool EntityStorage::QuadTreeNode::operator==(const QuadTreeNode& rhs) const {
-	return rhs.entity == entity;
+void EntityStorage::login(ENetPeer* peer, const std::string& email, const std::string& password, const LoginCallback& callback) {
+	const enet_uint32 connectId = peer->connectID;
+	_asyncDbHandler->select(db::UserModel(), db::DBConditionUserEmail(email), [=] (bool success, std::vector<db::UserModel>&& users) {
+		// the peer might have been reused for another connection in the meantime
+		if (peer->state != ENET_PEER_STATE_CONNECTED || peer->connectID != connectId) {
+			Log::info("Peer of %s disconnected during the login", email.c_str());
+			return;
+		}
+		if (!success || users.empty() || password != core::pwhash(users.back().password())) {
+			Log::warn("Could not get user id for email: %s", email.c_str());
+			callback(UserPtr());
+			return;
+		}
+		const EntityId id = users.back().id();
+		if (_users.find(id) != _users.end()) {
+			callback(login(peer, id, {}, {}));
+			return;
+		}
+		loadUser(peer, id, callback);
+	});
 }
 
-void EntityStorage::registerUser(const UserPtr& user) {
-	_users[user->id()] = user;
-}
+namespace {
 
-EntityId EntityStorage::getUserId(const std::string& email, const std::string& password) const {
-	db::UserModel userStore;
-	if (!_dbHandler->select(userStore, db::DBConditionUserEmail(email.c_str()))) {
-		return EntityIdNone;
-	}
-	EntityId checkId = userStore.id();
-	if (password != core::pwhash(userStore.password())) {
-		return EntityIdNone;
-	}
+/**
+ * @brief The state of a user that is loaded from the database before the user is created
+ */
+struct LoadedUser {
+	std::vector<db::StockModel> stock;
+	std::vector<db::InventoryModel> inventory;
+	int pending = 2;
+	bool success = true;
+};
 
-	return checkId;
 }
 
-UserPtr EntityStorage::login(ENetPeer* peer, const std::string& email, const std::string& passwd) {
-	EntityId id = getUserId(email, passwd);
-	if (id <= EntityIdNone) {
-		Log::warn("Could not get user id for email: %s", email.c_str());
-		return UserPtr();
-	}
+void EntityStorage::loadUser(ENetPeer* peer, EntityId id, const LoginCallback& callback) {
+	const enet_uint32 connectId = peer->connectID;
+	const std::shared_ptr<LoadedUser> loaded = std::make_shared<LoadedUser>();
+	// both queries are sent at once - the user is created as soon as the last result arrived
+	auto done = [=] () {
+		if (--loaded->pending > 0) {
+			return;
+		}
+		if (peer->state != ENET_PEER_STATE_CONNECTED || peer->connectID != connectId) {
+			Log::info("Peer of user %" PRIEntId " disconnected during the login", id);
+			return;
+		}
+		if (!loaded->success) {
+			Log::warn("Could not load the state of user %" PRIEntId, id);
+			callback(UserPtr());
+			return;
+		}
+		callback(login(peer, id, loaded->stock, loaded->inventory));
+	};
+	_asyncDbHandler->select(db::StockModel(), db::DBConditionStockUserid(id), [=] (bool success, std::vector<db::StockModel>&& stock) {
+		loaded->success = loaded->success && success;
+		loaded->stock = std::move(stock);
+		done();
+	});
+	_asyncDbHandler->select(db::InventoryModel(), db::DBConditionInventoryUserid(id), [=] (bool success, std::vector<db::InventoryModel>&& inventory) {
+		loaded->success = loaded->success && success;
+		loaded->inventory = std::move(inventory);
+		done();
+	});
+}
+
+UserPtr EntityStorage::login(ENetPeer* peer, EntityId id, const std::vector<db::StockModel>& stock, const std::vector<db::InventoryModel>& inventory) {
 	auto i = _users.find(id);
 	if (i == _users.end()) {
 		static const std::string name = "NONAME";
 		Log::info("user %i connects with host %i on port %i", (int) id, peer->address.host, peer->address.port);
-		const UserPtr& u = std::make_shared<User>(peer, id, name, _messageSender, _world, _timeProvider, _containerProvider, _cooldownProvider, _poiProvider, _dbHandler, _stockDataProvider);
-		u->init();
+		const UserPtr& u = std::make_shared<User>(peer, id, name, _messageSender, _world, _timeProvider, _timerWheel, _containerProvider, _cooldownProvider, _poiProvider, _dbHandler, _persistenceMgr, _stockDataProvider);
+		u->init(stock, inventory);
 		registerUser(u);
 		return u;
 	}
@@ -82,6 +130,8 @@ bool EntityStorage::logout(EntityId userId) {
 	if (i == _users.end()) {
 		return false;
 	}
+	i->second->shutdown();
+	_grid.remove(i->second);
 	_users.erase(i);
 	return true;
 }
@@ -89,6 +139,7 @@ bool EntityStorage::logout(EntityId userId) {
 void EntityStorage::addNpc(const NpcPtr& npc) {
 	_eventBus->publish(metric::increment("count.npc"));
 	_npcs.insert(std::make_pair(npc->id(), npc));
+	_grid.insert(npc, npc->rect());
 }
 
 bool EntityStorage::removeNpc(ai::CharacterId id) {
@@ -96,7 +147,7 @@ bool EntityStorage::removeNpc(ai::CharacterId id) {
 	if (i == _npcs.end()) {
 		return false;
 	}
-	_quadTree.remove(QuadTreeNode { i->second });
+	_grid.remove(i->second);
 	_npcs.erase(id);
 	_eventBus->publish(metric::decrement("count.npc"));
 	return true;
@@ -114,6 +165,8 @@ NpcPtr EntityStorage::getNpc(ai::CharacterId id) {
 void EntityStorage::onFrame(long dt) {
 	static long lastFrame = _time;
 	_time += dt;
+	// the cooldowns and aggro reductions of all entities
+	_timerWheel->update(_timeProvider->tickMillis());
 
 	// let this run at 4 frames per second
 	const long deltaLastTick = _time - lastFrame;
@@ -124,7 +177,7 @@ void EntityStorage::onFrame(long dt) {
 		return;
 	}
 
-	updateQuadTree();
+	updateGrid();
 	for (auto i : _users) {
 		updateEntity(i.second, deltaLastTick);
 	}
@@ -132,7 +185,7 @@ void EntityStorage::onFrame(long dt) {
 		NpcPtr npc = i->second;
 		if (!updateEntity(npc, deltaLastTick)) {
 			Log::info("remove npc %li", npc->id());
-			_quadTree.remove(QuadTreeNode { npc });
+			_grid.remove(npc);
 			i = _npcs.erase(i);
 		} else {
 			++i;
@@ -140,15 +193,14 @@ void EntityStorage::onFrame(long dt) {
 	}
 }
 
-void EntityStorage::updateQuadTree() {
-	// TODO: a full rebuild is not needed every frame
-	_quadTree.clear();
-	for (auto i : _npcs) {
-		_quadTree.insert(QuadTreeNode { i.second });
+void EntityStorage::updateGrid() {
+	for (const auto& i : _npcs) {
+		const NpcPtr& npc = i.second;
+		_grid.update(npc, npc->rect());
 	}
-	for (auto i : _users) {
+	for (const auto& i : _users) {
 		const UserPtr& user = i.second;
-		_quadTree.insert(QuadTreeNode { user });
+		_grid.update(user, user->rect());
 	}
 }
 
@@ -157,20 +209,16 @@ bool EntityStorage::updateEntity(const EntityPtr& entity, long dt) {
 		return false;
 	}
 	const core::RectFloat& rect = entity->viewRect();
-	// TODO: maybe move into the entity instance to reduce memory allocations.
-	core::QuadTree<QuadTreeNode, float>::Contents contents;
-	contents.reserve(entity->visibleCount() + 10);
-	_quadTreeCache.query(rect, contents);
-	EntitySet set;
-	set.reserve(contents.size());
-	for (const QuadTreeNode& node : contents) {
+	_queryBuffer.clear();
+	_grid.query(rect, _queryBuffer);
+	_visibleBuffer.clear();
+	for (const EntityPtr& other : _queryBuffer) {
 		// TODO: check the distance - the rect might contain more than the circle would...
-		if (entity->inFrustum(*node.entity.get())) {
-			set.insert(node.entity);
+		if (other != entity && entity->inFrustum(*other.get())) {
+			_visibleBuffer.insert(other);
 		}
 	}
-	set.erase(entity);
-	entity->updateVisible(set);
+	entity->updateVisible(_visibleBuffer);
 	return true;
 }
 
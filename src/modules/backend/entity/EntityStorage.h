@@ -6,10 +6,13 @@
 
 #include "backend/ForwardDecl.h"
 #include "network/Network.h"
-#include "core/QuadTree.h"
+#include "core/HashGrid.h"
+#include "backend/entity/Entity.h"
 #include "core/TimeProvider.h"
 #include "ai/common/Types.h"
+#include <functional>
 #include <unordered_map>
+#include <vector>
 
 namespace backend {
 
@@ -19,6 +22,8 @@ namespace backend {
  * This includes calling the Entity::update() method as well as performing the visibility calculations.
  */
 class EntityStorage {
+public:
+	typedef std::function<void(const UserPtr& user)> LoginCallback;
 private:
 	typedef std::unordered_map<EntityId, UserPtr> Users;
 	typedef Users::iterator UsersIter;
@@ -28,38 +33,52 @@ private:
 	typedef Npcs::iterator NpcsIter;
 	Npcs _npcs;
 
-	struct QuadTreeNode {
-		EntityPtr entity;
-
-		core::RectFloat getRect() const;
-		bool operator==(const QuadTreeNode& rhs) const;
-	};
-
-	core::QuadTree<QuadTreeNode, float> _quadTree;
-	core::QuadTreeCache<QuadTreeNode, float> _quadTreeCache;
+	typedef core::HashGrid<EntityPtr, float> Grid;
+	// the entities are moved in here with every tick - the cell size should be around the view distance
+	Grid _grid;
+	// reused by the visibility calculation of all entities
+	Grid::Contents _queryBuffer;
+	EntitySet _visibleBuffer;
 
 	network::ServerMessageSenderPtr _messageSender;
 	voxel::WorldPtr _world;
 	core::TimeProviderPtr _timeProvider;
+	core::TimerWheelPtr _timerWheel;
 	attrib::ContainerProviderPtr _containerProvider;
 	poi::PoiProviderPtr _poiProvider;
 	cooldown::CooldownProviderPtr _cooldownProvider;
 	persistence::DBHandlerPtr _dbHandler;
+	persistence::PersistenceMgrPtr _persistenceMgr;
+	persistence::AsyncDBHandlerPtr _asyncDbHandler;
 	stock::StockProviderPtr _stockDataProvider;
 	core::EventBusPtr _eventBus;
 	long _time;
 
 	void registerUser(const UserPtr& user);
 	bool updateEntity(const EntityPtr& entity, long dt);
-	void updateQuadTree();
-
-	EntityId getUserId(const std::string& email, const std::string& password) const;
+	void updateGrid();
+
+	/**
+	 * @brief Loads the state of the user without blocking the frame and logs the user in afterwards
+	 */
+	void loadUser(ENetPeer* peer, EntityId id, const LoginCallback& callback);
+	/**
+	 * @brief Creates the user from the given database state - or reconnects the user if it is still known
+	 */
+	UserPtr login(ENetPeer* peer, EntityId id, const std::vector<db::StockModel>& stock, const std::vector<db::InventoryModel>& inventory);
 public:
-	EntityStorage(const network::ServerMessageSenderPtr& messageSender, const voxel::WorldPtr& world, const core::TimeProviderPtr& timeProvider,
+	EntityStorage(const network::ServerMessageSenderPtr& messageSender, const voxel::WorldPtr& world, const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel,
 			const attrib::ContainerProviderPtr& containerProvider, const poi::PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider,
-			const persistence::DBHandlerPtr& dbHandler, const stock::StockProviderPtr& stockDataProvider, const core::EventBusPtr& eventBus);
-
-	UserPtr login(ENetPeer* peer, const std::string& email, const std::string& password);
+			const persistence::DBHandlerPtr& dbHandler, const persistence::PersistenceMgrPtr& persistenceMgr,
+			const persistence::AsyncDBHandlerPtr& asyncDbHandler, const stock::StockProviderPtr& stockDataProvider,
+			const core::EventBusPtr& eventBus);
+
+	/**
+	 * @brief Looks up the user in the database without blocking the frame
+	 * @param[in] callback Executed in the frame the database result arrives in - with an empty pointer if
+	 * the login failed. Not executed if the peer disconnected in the meantime.
+	 */
+	void login(ENetPeer* peer, const std::string& email, const std::string& password, const LoginCallback& callback);
 	bool logout(EntityId userId);
 
 	void addNpc(const NpcPtr& npc);
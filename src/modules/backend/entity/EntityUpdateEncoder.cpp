@@ -0,0 +1,82 @@
+/**
+ * @file
+ */
+
+#include "EntityUpdateEncoder.h"
+#include <limits>
+
+namespace backend {
+
+static inline bool fitsDelta(int32_t from, int32_t to) {
+	const int64_t delta = (int64_t)to - (int64_t)from;
+	return delta >= std::numeric_limits<int16_t>::min() && delta <= std::numeric_limits<int16_t>::max();
+}
+
+void EntityUpdateEncoder::begin() {
+	_baseline = _snapshots.get(_ackedSequence);
+	_baselineSequence = _baseline == nullptr ? 0u : _ackedSequence;
+	_snapshot.clear();
+	_states.clear();
+	_deltas.clear();
+	_removed.clear();
+}
+
+void EntityUpdateEncoder::add(EntityId id, const glm::vec3& pos, float orientation) {
+	const network::QuantizedEntity& entity = network::EntityQuantizer::quantize(pos, orientation);
+	_snapshot[id] = entity;
+	if (_baseline != nullptr) {
+		auto i = _baseline->find(id);
+		if (i != _baseline->end()) {
+			const network::QuantizedEntity& base = i->second;
+			if (base == entity) {
+				return;
+			}
+			if (fitsDelta(base.x, entity.x) && fitsDelta(base.y, entity.y) && fitsDelta(base.z, entity.z)) {
+				_deltas.emplace_back(id, (int16_t)(entity.x - base.x), (int16_t)(entity.y - base.y),
+						(int16_t)(entity.z - base.z), entity.rotation);
+				return;
+			}
+		}
+	}
+	_states.emplace_back(id, entity.x, entity.y, entity.z, entity.rotation);
+}
+
+flatbuffers::Offset<network::EntityUpdates> EntityUpdateEncoder::finish(flatbuffers::FlatBufferBuilder& fbb) {
+	if (_baseline != nullptr) {
+		for (const auto& e : *_baseline) {
+			if (_snapshot.find(e.first) == _snapshot.end()) {
+				_removed.push_back(e.first);
+			}
+		}
+	}
+	if (_states.empty() && _deltas.empty() && _removed.empty()) {
+		return flatbuffers::Offset<network::EntityUpdates>();
+	}
+	if (++_sequence == 0u) {
+		// 0 is reserved for "no baseline"
+		++_sequence;
+	}
+	// the baseline might get replaced here - don't use it anymore
+	_snapshots.put(_sequence, _snapshot);
+	_baseline = nullptr;
+	return network::CreateEntityUpdates(fbb, _sequence, _baselineSequence,
+			_states.empty() ? 0 : fbb.CreateVectorOfStructs(_states),
+			_deltas.empty() ? 0 : fbb.CreateVectorOfStructs(_deltas),
+			_removed.empty() ? 0 : fbb.CreateVector(_removed));
+}
+
+void EntityUpdateEncoder::ack(uint32_t sequence) {
+	// only move forward - acks might arrive out of order
+	if (_snapshots.get(sequence) == nullptr || (int32_t)(sequence - _ackedSequence) <= 0) {
+		return;
+	}
+	_ackedSequence = sequence;
+}
+
+void EntityUpdateEncoder::reset() {
+	_snapshots.clear();
+	_ackedSequence = 0u;
+	_baseline = nullptr;
+}
+
+}
@@ -0,0 +1,79 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "network/EntityUpdates.h"
+#include "EntityId.h"
+#include <vector>
+
+namespace backend {
+
+/**
+ * @brief Builds the @c network::EntityUpdates messages for one peer.
+ *
+ * The states are delta compressed against the last updates that were acked by the peer - entities that
+ * didn't change since then are not sent at all. As long as nothing was acked, the full states are sent.
+ *
+ * @code
+ * encoder.begin();
+ * for (const EntityPtr& e : visible) {
+ *   encoder.add(e->id(), e->pos(), e->orientation());
+ * }
+ * auto updates = encoder.finish(fbb);
+ * if (!updates.IsNull()) {
+ *   // send
+ * }
+ * @endcode
+ */
+class EntityUpdateEncoder {
+private:
+	network::EntitySnapshots _snapshots;
+	uint32_t _sequence = 0u;
+	uint32_t _ackedSequence = 0u;
+
+	// the updates that are currently built
+	const network::EntitySnapshot* _baseline = nullptr;
+	uint32_t _baselineSequence = 0u;
+	network::EntitySnapshot _snapshot;
+	std::vector<network::EntityState> _states;
+	std::vector<network::EntityDelta> _deltas;
+	std::vector<int64_t> _removed;
+public:
+	/**
+	 * @brief Starts new updates - relative to the last acked ones
+	 */
+	void begin();
+
+	/**
+	 * @brief Adds the current state of a visible entity
+	 */
+	void add(EntityId id, const glm::vec3& pos, float orientation);
+
+	/**
+	 * @return A null offset if nothing changed since the baseline - there is no need to send anything
+	 * in this case.
+	 */
+	flatbuffers::Offset<network::EntityUpdates> finish(flatbuffers::FlatBufferBuilder& fbb);
+
+	/**
+	 * @brief The peer received the updates with the given sequence - they are used as the new baseline
+	 */
+	void ack(uint32_t sequence);
+
+	/**
+	 * @brief Forget all baselines - e.g. after a reconnect
+	 */
+	void reset();
+
+	inline uint32_t sequence() const {
+		return _sequence;
+	}
+
+	inline uint32_t ackedSequence() const {
+		return _ackedSequence;
+	}
+};
+
+}
@@ -16,8 +16,8 @@ namespace backend {
 std::atomic<EntityId> Npc::_nextNpcId(5000000);
 
 Npc::Npc(network::EntityType type, const EntityStoragePtr& entityStorage, const ai::TreeNodePtr& behaviour, const voxel::WorldPtr& world, const network::ServerMessageSenderPtr& messageSender,
-		const core::TimeProviderPtr& timeProvider, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider, const poi::PoiProviderPtr& poiProvider) :
-		Entity(_nextNpcId++, messageSender, timeProvider, containerProvider, cooldownProvider), _world(world), _poiProvider(poiProvider) {
+		const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider, const poi::PoiProviderPtr& poiProvider) :
+		Entity(_nextNpcId++, messageSender, timeProvider, timerWheel, containerProvider, cooldownProvider), _world(world), _poiProvider(poiProvider) {
 	_entityType = type;
 	_ai = std::make_shared<ai::AI>(behaviour);
 	_aiChr = std::make_shared<AICharacter>(_entityId, *this);
@@ -25,6 +25,9 @@ Npc::Npc(network::EntityType type, const EntityStoragePtr& entityStorage, const
 }
 
 Npc::~Npc() {
+	// the ai might outlive the npc
+	_ai->getAggroMgr().setReductionScheduler(ai::AggroMgr::ReductionScheduler());
+	_timerWheel->cancel(_aggroReductionTimer);
 	ai::Zone* zone = _ai->getZone();
 	if (zone == nullptr) {
 		return;
@@ -46,7 +49,31 @@ void Npc::init(const glm::ivec3* pos) {
 	setHomePosition(randomPos);
 	_aiChr->setPosition(glm::vec3(randomPos.x, randomPos.y, randomPos.z));
 	init();
-	_ai->getAggroMgr().setReduceByValue(0.1f);
+	ai::AggroMgr& aggroMgr = _ai->getAggroMgr();
+	aggroMgr.setReduceByValue(0.1f);
+	const std::weak_ptr<Npc> self = shared_from_this();
+	aggroMgr.setReductionScheduler([self] () {
+		if (const NpcPtr npc = self.lock()) {
+			npc->scheduleAggroReduction();
+		}
+	});
+}
+
+void Npc::scheduleAggroReduction() {
+	static const uint64_t aggroReductionDelay = 250u;
+	_lastAggroReductionMillis = _timeProvider->tickMillis();
+	const std::weak_ptr<Npc> self = shared_from_this();
+	_aggroReductionTimer = _timerWheel->schedule(_lastAggroReductionMillis + aggroReductionDelay, [self] () {
+		const NpcPtr npc = self.lock();
+		if (!npc) {
+			return;
+		}
+		npc->_aggroReductionTimer = core::TimerWheel::InvalidTimerId;
+		const uint64_t delta = npc->_timeProvider->tickMillis() - npc->_lastAggroReductionMillis;
+		if (npc->_ai->getAggroMgr().reduce(delta)) {
+			npc->scheduleAggroReduction();
+		}
+	});
 }
 
 std::string Npc::name() const {
@@ -7,13 +7,14 @@
 #include "ai/ForwardDecl.h"
 #include "ai/common/Types.h"
 #include <atomic>
+#include <memory>
 #include "Entity.h"
 #include "poi/PoiProvider.h"
 #include "backend/ForwardDecl.h"
 
 namespace backend {
 
-class Npc: public Entity {
+class Npc: public Entity, public std::enable_shared_from_this<Npc> {
 private:
 	friend class AICharacter;
 	static std::atomic<EntityId> _nextNpcId;
@@ -23,14 +24,21 @@ private:
 	glm::ivec3 _homePosition;
 	ai::AIPtr _ai;
 	AICharacterPtr _aiChr;
+	core::TimerWheel::TimerId _aggroReductionTimer = core::TimerWheel::InvalidTimerId;
+	uint64_t _lastAggroReductionMillis = 0u;
 
 	void moveToGround();
+	/**
+	 * @brief Reduces the aggro values in intervals as long as there is any aggro left
+	 * @note The timer only holds a weak reference - the npc might be gone when it expires
+	 */
+	void scheduleAggroReduction();
 
 	void init() override;
 
 public:
 	Npc(network::EntityType type, const EntityStoragePtr& entityStorage, const ai::TreeNodePtr& behaviour, const voxel::WorldPtr& world, const network::ServerMessageSenderPtr& messageSender,
-			const core::TimeProviderPtr& timeProvider, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider, const poi::PoiProviderPtr& poiProvider);
+			const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider, const poi::PoiProviderPtr& poiProvider);
 	~Npc();
 
 	void init(const glm::ivec3* pos);
@@ -9,11 +9,11 @@
 namespace backend {
 
 User::User(ENetPeer* peer, EntityId id, const std::string& name, const network::ServerMessageSenderPtr& messageSender,
-		const voxel::WorldPtr& world, const core::TimeProviderPtr& timeProvider, const attrib::ContainerProviderPtr& containerProvider,
+		const voxel::WorldPtr& world, const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel, const attrib::ContainerProviderPtr& containerProvider,
 		const cooldown::CooldownProviderPtr& cooldownProvider, const poi::PoiProviderPtr& poiProvider, const persistence::DBHandlerPtr& dbHandler,
-		const stock::StockProviderPtr& stockDataProvider) :
-		Super(id, messageSender, timeProvider, containerProvider, cooldownProvider),
-		_name(name), _world(world), _poiProvider(poiProvider), _dbHandler(dbHandler), _stockMgr(this, stockDataProvider, dbHandler) {
+		const persistence::PersistenceMgrPtr& persistenceMgr, const stock::StockProviderPtr& stockDataProvider) :
+		Super(id, messageSender, timeProvider, timerWheel, containerProvider, cooldownProvider),
+		_name(name), _world(world), _poiProvider(poiProvider), _dbHandler(dbHandler), _stockMgr(this, stockDataProvider, persistenceMgr) {
 	setPeer(peer);
 	const glm::vec3& poi = _poiProvider->getPointOfInterest();
 	_pos = poi;
@@ -23,7 +23,15 @@ User::User(ENetPeer* peer, EntityId id, const std::string& name, const network::
 
 void User::init() {
 	Super::init();
-	_stockMgr.init();
+}
+
+void User::init(const std::vector<db::StockModel>& stock, const std::vector<db::InventoryModel>& inventory) {
+	init();
+	_stockMgr.init(stock, inventory);
+}
+
+void User::shutdown() {
+	_stockMgr.shutdown();
 }
 
 void User::visibleAdd(const EntitySet& entities) {
@@ -40,9 +48,32 @@ void User::visibleRemove(const EntitySet& entities) {
 	}
 }
 
+void User::visibleUpdated() {
+	if (_peer == nullptr) {
+		return;
+	}
+	_entityUpdates.begin();
+	visitVisible([this] (const EntityPtr& e) {
+		_entityUpdates.add(e->id(), e->pos(), e->orientation());
+	});
+	const auto& updates = _entityUpdates.finish(_entityUpdatesFbb);
+	if (updates.IsNull()) {
+		_entityUpdatesFbb.Clear();
+		return;
+	}
+	// unreliable - lost updates are covered by the next ones as they are relative to the acked state
+	_messageSender->sendServerMessage(_peer, _entityUpdatesFbb, network::ServerMsgType::EntityUpdates, updates.Union(), 0u);
+}
+
+void User::ackEntityUpdates(uint32_t sequence) {
+	_entityUpdates.ack(sequence);
+}
+
 ENetPeer* User::setPeer(ENetPeer* peer) {
 	ENetPeer* old = _peer;
 	_peer = peer;
+	// a new connection doesn't know any of the previous entity updates
+	_entityUpdates.reset();
 	if (_peer) {
 		_host = _peer->address.host;
 		_peer->data = this;
@@ -6,6 +6,7 @@
 
 #include "network/ServerMessageSender.h"
 #include "Entity.h"
+#include "EntityUpdateEncoder.h"
 #include "core/Var.h"
 #include "user/UserStockMgr.h"
 #include "poi/PoiProvider.h"
@@ -32,6 +33,8 @@ private:
 	uint64_t _time = 0u;
 	core::VarPtr _userTimeout;
 	flatbuffers::FlatBufferBuilder _entityUpdateFbb;
+	EntityUpdateEncoder _entityUpdates;
+	flatbuffers::FlatBufferBuilder _entityUpdatesFbb;
 
 	UserStockMgr _stockMgr;
 
@@ -42,11 +45,16 @@ private:
 protected:
 	void visibleAdd(const EntitySet& entities) override;
 	void visibleRemove(const EntitySet& entities) override;
+	/**
+	 * @brief Sends the changes of all visible entities to the peer of this user
+	 */
+	void visibleUpdated() override;
 
 public:
 	User(ENetPeer* peer, EntityId id, const std::string& name, const network::ServerMessageSenderPtr& messageSender, const voxel::WorldPtr& world,
-			const core::TimeProviderPtr& timeProvider, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider,
-			const poi::PoiProviderPtr& poiProvider, const persistence::DBHandlerPtr& dbHandler, const stock::StockProviderPtr& stockDataProvider);
+			const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider,
+			const poi::PoiProviderPtr& poiProvider, const persistence::DBHandlerPtr& dbHandler, const persistence::PersistenceMgrPtr& persistenceMgr,
+			const stock::StockProviderPtr& stockDataProvider);
 
 	void setEntityId(EntityId id);
 
@@ -60,6 +68,11 @@ public:
 
 	void attack(EntityId id);
 
+	/**
+	 * @brief The peer received the entity updates with the given sequence
+	 */
+	void ackEntityUpdates(uint32_t sequence);
+
 	/**
 	 * @brief The client closed the connection - the user object itself will stay in the server until
 	 * a logout cooldown was hit
@@ -69,7 +82,16 @@ public:
 	void reconnect();
 
 	void init() override;
+	/**
+	 * @brief Initializes the user with the state that was loaded from the database
+	 */
+	void init(const std::vector<db::StockModel>& stock, const std::vector<db::InventoryModel>& inventory);
 	bool update(long dt) override;
+	/**
+	 * @brief The user is removed from the server - the remaining state changes are handed over to the
+	 * persistence manager
+	 */
+	void shutdown();
 
 	/**
 	 * @brief Sets a new ENetPeer and returns the old one.
@@ -4,41 +4,70 @@
 
 #include "UserStockMgr.h"
 #include "BackendModels.h"
-#include "persistence/DBHandler.h"
+#include "persistence/PersistenceMgr.h"
 #include "stock/StockDataProvider.h"
 #include "../User.h"
 
 namespace backend {
 
-UserStockMgr::UserStockMgr(User* user, const stock::StockProviderPtr& stockDataProvider, const persistence::DBHandlerPtr& dbHandler) :
-		_user(user), _dbHandler(dbHandler), _stock(stockDataProvider) {
+UserStockMgr::UserStockMgr(User* user, const stock::StockProviderPtr& stockDataProvider, const persistence::PersistenceMgrPtr& persistenceMgr) :
+		_user(user), _stockDataProvider(stockDataProvider), _persistenceMgr(persistenceMgr), _stock(stockDataProvider) {
 }
 
 void UserStockMgr::update(long dt) {
 }
 
-void UserStockMgr::init() {
-	const EntityId userId = _user->id();
-	if (!_dbHandler->select(db::StockModel(), db::DBConditionStockUserid(userId), [this] (db::StockModel&& model) {
+void UserStockMgr::init(const std::vector<db::StockModel>& stock, const std::vector<db::InventoryModel>& inventory) {
+	for (const db::StockModel& model : stock) {
 		const stock::ItemId itemId = model.itemid();
 		const stock::ItemPtr& item = _stockDataProvider->createItem(itemId);
 		if (!item) {
-			return;
+			continue;
 		}
 		item->changeAmount(model.amount());
 		_stock.add(item);
-	})) {
-		Log::warn("Could not load stock for user %" PRIEntId, userId);
+		_persistedAmounts[itemId] = model.amount();
 	}
-	if (!_dbHandler->select(db::InventoryModel(), db::DBConditionInventoryUserid(userId), [this] (db::InventoryModel&& model) {
-		// TODO: load inventory
-		//_stock.inventory().add();
-	})) {
-		Log::warn("Could not load inventory for user %" PRIEntId, userId);
+	// TODO: load inventory
+	//_stock.inventory().add();
+	if (_persistenceMgr) {
+		_persistenceMgr->registerSavable(this);
 	}
 }
 
 void UserStockMgr::shutdown() {
+	if (_persistenceMgr) {
+		_persistenceMgr->unregisterSavable(this);
+	}
+}
+
+bool UserStockMgr::getDirtyModels(persistence::Models& models) {
+	const size_t before = models.size();
+	const EntityId userId = _user->id();
+	auto addModel = [&] (stock::ItemId itemId, stock::ItemAmount amount) {
+		db::StockModel* model = new db::StockModel();
+		model->setUserid(userId);
+		model->setItemid(itemId);
+		model->setAmount(amount);
+		models.emplace_back(model);
+		_persistedAmounts[itemId] = amount;
+	};
+	const auto& items = _stock.items();
+	for (const auto& e : items) {
+		const stock::ItemAmount amount = e.second->amount();
+		auto i = _persistedAmounts.find(e.first);
+		if (i != _persistedAmounts.end() && i->second == amount) {
+			continue;
+		}
+		addModel(e.first, amount);
+	}
+	// removed items are stored with an amount of zero
+	for (const auto& e : _persistedAmounts) {
+		if (e.second != 0 && items.find(e.first) == items.end()) {
+			addModel(e.first, 0);
+		}
+	}
+	return models.size() > before;
 }
 
 }
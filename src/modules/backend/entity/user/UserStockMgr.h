@@ -6,29 +6,40 @@
 
 #include "backend/ForwardDecl.h"
 #include "stock/Stock.h"
+#include "persistence/ISavable.h"
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace backend {
 
 class User;
 
 /**
- * @brief User stock manager that restores the state on login
+ * @brief User stock manager that restores the state on login and hands the changed items over to
+ * the @c persistence::PersistenceMgr
  */
-class UserStockMgr {
+class UserStockMgr : public persistence::ISavable {
 private:
 	User* _user;
 	const stock::StockProviderPtr _stockDataProvider;
-	persistence::DBHandlerPtr _dbHandler;
+	persistence::PersistenceMgrPtr _persistenceMgr;
 	stock::Stock _stock;
+	// the amounts that are already stored in the database - or handed over to be stored
+	std::unordered_map<stock::ItemId, stock::ItemAmount> _persistedAmounts;
 
 public:
-	UserStockMgr(User* user, const stock::StockProviderPtr& stockDataProvider, const persistence::DBHandlerPtr& dbHandler);
+	UserStockMgr(User* user, const stock::StockProviderPtr& stockDataProvider, const persistence::PersistenceMgrPtr& persistenceMgr);
 
-	void init();
+	/**
+	 * @brief Restores the state from the database rows of the user - they are loaded before the user is created
+	 */
+	void init(const std::vector<db::StockModel>& stock, const std::vector<db::InventoryModel>& inventory);
 	void shutdown();
 
 	void update(long dt);
+
+	bool getDirtyModels(persistence::Models& models) override;
 };
 
 typedef std::shared_ptr<UserStockMgr> StockMgrPtr;
@@ -21,6 +21,7 @@
 #include "backend/network/UserDisconnectHandler.h"
 #include "backend/network/AttackHandler.h"
 #include "backend/network/MoveHandler.h"
+#include "backend/network/EntityUpdatesAckHandler.h"
 #include "core/command/CommandHandler.h"
 #include "voxel/MaterialColor.h"
 #include "eventmgr/EventMgr.h"
@@ -32,7 +33,8 @@ namespace backend {
 constexpr int aiDebugServerPort = 11338;
 constexpr const char* aiDebugServerInterface = "127.0.0.1";
 
-ServerLoop::ServerLoop(const persistence::DBHandlerPtr& dbHandler, const network::ServerNetworkPtr& network,
+ServerLoop::ServerLoop(const persistence::DBHandlerPtr& dbHandler, const persistence::PersistenceMgrPtr& persistenceMgr,
+		const persistence::AsyncDBHandlerPtr& asyncDbHandler, const network::ServerNetworkPtr& network,
 		const SpawnMgrPtr& spawnMgr, const voxel::WorldPtr& world,  const EntityStoragePtr& entityStorage,
 		const core::EventBusPtr& eventBus, const AIRegistryPtr& registry,
 		const attrib::ContainerProviderPtr& containerProvider, const poi::PoiProviderPtr& poiProvider,
@@ -41,7 +43,7 @@ ServerLoop::ServerLoop(const persistence::DBHandlerPtr& dbHandler, const network
 		_network(network), _spawnMgr(spawnMgr), _world(world),
 		_entityStorage(entityStorage), _eventBus(eventBus), _registry(registry), _attribContainerProvider(containerProvider),
 		_poiProvider(poiProvider), _cooldownProvider(cooldownProvider), _eventMgr(eventMgr), _dbHandler(dbHandler),
-		_stockDataProvider(stockDataProvider), _metric(std::make_shared<metric::UDPMetricSender>(), "server.") {
+		_persistenceMgr(persistenceMgr), _asyncDbHandler(asyncDbHandler), _stockDataProvider(stockDataProvider), _metric(std::make_shared<metric::UDPMetricSender>(), "server.") {
 	_world->setClientData(false);
 	_eventBus->subscribe<network::NewConnectionEvent>(*this);
 	_eventBus->subscribe<network::DisconnectEvent>(*this);
@@ -72,6 +74,14 @@ bool ServerLoop::init() {
 		Log::error("Failed to create stock table");
 		return false;
 	}
+	if (!_persistenceMgr->init()) {
+		Log::error("Failed to init the persistence manager");
+		return false;
+	}
+	if (!_asyncDbHandler->init()) {
+		Log::error("Failed to init the database workers");
+		return false;
+	}
 	if (!_eventMgr->init()) {
 		Log::error("Failed to init event manager");
 		return false;
@@ -95,7 +105,7 @@ bool ServerLoop::init() {
 		return false;
 	}
 
-	_zone = new ai::Zone("Zone");
+	_zone = new ai::Zone("Zone", core::Var::getSafe(cfg::ServerAIThreads)->intVal());
 	_aiServer = new ai::Server(*_registry, aiDebugServerPort, aiDebugServerInterface);
 	_registry->init(_spawnMgr);
 	if (!_spawnMgr->init()) {
@@ -109,6 +119,7 @@ bool ServerLoop::init() {
 	regHandler(network::ClientMsgType::UserDisconnect, UserDisconnectHandler);
 	regHandler(network::ClientMsgType::Attack, AttackHandler);
 	regHandler(network::ClientMsgType::Move, MoveHandler);
+	regHandler(network::ClientMsgType::EntityUpdatesAck, EntityUpdatesAckHandler);
 
 	if (!voxel::initDefaultMaterialColors()) {
 		Log::error("Failed to initialize the palette data");
@@ -129,12 +140,51 @@ bool ServerLoop::init() {
 	} else {
 		Log::error("Could not start the ai debug server");
 	}
+	initStages();
 	return true;
 }
 
+void ServerLoop::initStages() {
+	const int threads = std::max(1, core::Var::getSafe(cfg::ServerStageThreads)->intVal());
+	_stages = std::make_unique<core::StageScheduler>(threads, "serverloop");
+	// the results of the database workers are handled together with the network messages - e.g. the logins
+	const core::StageScheduler::StageId network = _stages->addStage("network", [this] (long dt) {
+		_network->update();
+		_asyncDbHandler->update();
+	});
+	_stages->addStage("poi", [this] (long dt) {
+		_poiProvider->update(dt);
+	}, {network});
+	_stages->addStage("world", [this] (long dt) {
+		_world->onFrame(dt);
+	}, {network});
+	const core::StageScheduler::StageId zone = _stages->addStage("zone", [this] (long dt) {
+		_zone->update(dt);
+	}, {network});
+	const core::StageScheduler::StageId aiServer = _stages->addStage("aiserver", [this] (long dt) {
+		_aiServer->update(dt);
+	}, {zone});
+	// the spawned npcs are added to the zone and the entity storage
+	const core::StageScheduler::StageId spawn = _stages->addStage("spawn", [this] (long dt) {
+		_spawnMgr->onFrame(*_zone, dt);
+	}, {zone});
+	const core::StageScheduler::StageId entityStorage = _stages->addStage("entitystorage", [this] (long dt) {
+		_entityStorage->onFrame(dt);
+	}, {spawn, aiServer});
+	// collects the state changes of the users after they were updated
+	_stages->addStage("persistence", [this] (long dt) {
+		_persistenceMgr->update(dt);
+	}, {entityStorage});
+}
+
 void ServerLoop::shutdown() {
+	if (_stages) {
+		_stages->shutdown();
+	}
 	_world->shutdown();
 	_spawnMgr->shutdown();
+	_persistenceMgr->shutdown();
+	_asyncDbHandler->shutdown();
 	_dbHandler->shutdown();
 	delete _zone;
 	delete _aiServer;
@@ -158,28 +208,10 @@ void ServerLoop::onFrame(long dt) {
 	core::Var::visitReplicate([] (const core::VarPtr& var) {
 		Log::info("TODO: %s needs replicate", var->name().c_str());
 	});
-	_network->update();
-	{ // TODO: move into own thread
-		core_trace_scoped(PoiUpdate);
-		_poiProvider->update(dt);
-	}
-	{ // TODO: move into own thread
-		core_trace_scoped(WorldUpdate);
-		_world->onFrame(dt);
-	}
-	{ // TODO: move into own thread
-		core_trace_scoped(AIServerUpdate);
-		_zone->update(dt);
-		_aiServer->update(dt);
-	}
-	{ // TODO: move into own thread
-		core_trace_scoped(SpawnMgrUpdate);
-		_spawnMgr->onFrame(*_zone, dt);
-	}
-	{
-		core_trace_scoped(EntityStorage);
-		_entityStorage->onFrame(dt);
-	}
+	_stages->run(dt);
+	_stages->visitTimings([this] (const std::string& name, uint64_t micros) {
+		_metric.timing(("stage." + name).c_str(), (uint32_t)(micros / 1000u));
+	});
 	_metric.timing("frame.delta", dt);
 }
 
@@ -6,7 +6,8 @@
 
 #include "core/EventBus.h"
 #include "core/Trace.h"
-#include "metric/Metric.h"
+#include "core/StageScheduler.h"
+#include "metric/MetricAggregator.h"
 #include "metric/MetricEvent.h"
 #include "network/ServerNetwork.h"
 #include "network/NetworkEvents.h"
@@ -18,6 +19,8 @@
 #include "backend/entity/EntityStorage.h"
 #include "core/EventBus.h"
 #include "persistence/DBHandler.h"
+#include "persistence/PersistenceMgr.h"
+#include "persistence/AsyncDBHandler.h"
 
 #include <memory>
 #include <thread>
@@ -43,13 +46,18 @@ private:
 	cooldown::CooldownProviderPtr _cooldownProvider;
 	eventmgr::EventMgrPtr _eventMgr;
 	persistence::DBHandlerPtr _dbHandler;
+	persistence::PersistenceMgrPtr _persistenceMgr;
+	persistence::AsyncDBHandlerPtr _asyncDbHandler;
 	stock::StockProviderPtr _stockDataProvider;
 	core::Input _input;
-	metric::Metric _metric;
+	metric::MetricAggregator _metric;
+	std::unique_ptr<core::StageScheduler> _stages;
 
 	void readInput();
+	void initStages();
 public:
-	ServerLoop(const persistence::DBHandlerPtr& dbHandler, const network::ServerNetworkPtr& network, const SpawnMgrPtr& spawnMgr,
+	ServerLoop(const persistence::DBHandlerPtr& dbHandler, const persistence::PersistenceMgrPtr& persistenceMgr,
+			const persistence::AsyncDBHandlerPtr& asyncDbHandler, const network::ServerNetworkPtr& network, const SpawnMgrPtr& spawnMgr,
 			const voxel::WorldPtr& world, const EntityStoragePtr& entityStorage, const core::EventBusPtr& eventBus,
 			const AIRegistryPtr& registry, const attrib::ContainerProviderPtr& containerProvider,
 			const poi::PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider,
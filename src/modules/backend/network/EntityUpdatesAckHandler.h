@@ -0,0 +1,16 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "network/Network.h"
+#include "IUserProtocolHandler.h"
+
+namespace backend {
+
+USERPROTOHANDLERIMPL(EntityUpdatesAck) {
+	user->ackEntityUpdates(message->sequence());
+}
+
+}
@@ -41,15 +41,15 @@ void UserConnectHandler::execute(ENetPeer* peer, const void* raw) {
 	}
 	Log::info("User %s tries to log into the gameserver", email.c_str());
 
-	UserPtr user = _entityStorage->login(peer, email, password);
-	if (!user) {
-		sendAuthFailed(peer);
-		return;
-	}
-
-	Log::info("User '%s' logged into the gameserver", email.c_str());
-	user->sendSeed(_world->seed());
-	user->sendUserSpawn();
+	_entityStorage->login(peer, email, password, [this, peer, email] (const UserPtr& user) {
+		if (!user) {
+			sendAuthFailed(peer);
+			return;
+		}
+		Log::info("User '%s' logged into the gameserver", email.c_str());
+		user->sendSeed(_world->seed());
+		user->sendUserSpawn();
+	});
 }
 
 }
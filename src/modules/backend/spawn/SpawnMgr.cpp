@@ -19,9 +19,9 @@ namespace backend {
 static const long spawnTime = 15000L;
 
 SpawnMgr::SpawnMgr(const voxel::WorldPtr& world, const EntityStoragePtr& entityStorage, const network::ServerMessageSenderPtr& messageSender,
-		const core::TimeProviderPtr& timeProvider, const AILoaderPtr& loader, const attrib::ContainerProviderPtr& containerProvider,
+		const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel, const AILoaderPtr& loader, const attrib::ContainerProviderPtr& containerProvider,
 		const poi::PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider) :
-		_loader(loader), _world(world), _entityStorage(entityStorage), _messageSender(messageSender), _timeProvider(timeProvider),
+		_loader(loader), _world(world), _entityStorage(entityStorage), _messageSender(messageSender), _timeProvider(timeProvider), _timerWheel(timerWheel),
 		_containerProvider(containerProvider), _poiProvider(poiProvider), _cooldownProvider(cooldownProvider), _time(15000L) {
 }
 
@@ -79,7 +79,7 @@ int SpawnMgr::spawn(ai::Zone& zone, network::EntityType type, int amount, const
 		return 0;
 	}
 	for (int x = 0; x < amount; ++x) {
-		const NpcPtr& npc = std::make_shared<Npc>(type, _entityStorage, behaviour, _world, _messageSender, _timeProvider, _containerProvider, _cooldownProvider, _poiProvider);
+		const NpcPtr& npc = std::make_shared<Npc>(type, _entityStorage, behaviour, _world, _messageSender, _timeProvider, _timerWheel, _containerProvider, _cooldownProvider, _poiProvider);
 		npc->init(pos);
 		// now let it tick
 		zone.addAI(npc->ai());
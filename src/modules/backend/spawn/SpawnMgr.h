@@ -18,6 +18,7 @@ private:
 	EntityStoragePtr _entityStorage;
 	network::ServerMessageSenderPtr _messageSender;
 	core::TimeProviderPtr _timeProvider;
+	core::TimerWheelPtr _timerWheel;
 	attrib::ContainerProviderPtr _containerProvider;
 	poi::PoiProviderPtr _poiProvider;
 	cooldown::CooldownProviderPtr _cooldownProvider;
@@ -29,7 +30,7 @@ private:
 
 public:
 	SpawnMgr(const voxel::WorldPtr& world, const EntityStoragePtr& entityStorage, const network::ServerMessageSenderPtr& messageSender,
-			const core::TimeProviderPtr& timeProvider, const AILoaderPtr& loader, const attrib::ContainerProviderPtr& containerProvider,
+			const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel, const AILoaderPtr& loader, const attrib::ContainerProviderPtr& containerProvider,
 			const poi::PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider);
 	bool init();
 	void shutdown();
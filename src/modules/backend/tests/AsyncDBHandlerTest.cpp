@@ -0,0 +1,107 @@
+/**
+ * @file
+ */
+
+#include "persistence/tests/AbstractDatabaseTest.h"
+#include "UserModel.h"
+#include "persistence/AsyncDBHandler.h"
+#include "persistence/DBHandler.h"
+#include "core/String.h"
+#include "engine-config.h"
+#include <chrono>
+#include <thread>
+
+namespace backend {
+
+class AsyncDBHandlerTest: public persistence::AbstractDatabaseTest {
+private:
+	using Super = persistence::AbstractDatabaseTest;
+protected:
+	bool _supported = true;
+	persistence::DBHandler _dbHandler;
+
+	/**
+	 * @brief Executes the callbacks until the given amount of callbacks was executed or the timeout is hit
+	 */
+	int waitForResults(persistence::AsyncDBHandler& handler, int expected) {
+		int executed = 0;
+		const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (executed < expected && std::chrono::steady_clock::now() < end) {
+			executed += handler.update();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return executed;
+	}
+public:
+	void SetUp() override {
+		Super::SetUp();
+		_supported = _dbHandler.init();
+		if (_supported) {
+			_dbHandler.dropTable(db::UserModel());
+			ASSERT_TRUE(_dbHandler.createTable(db::UserModel())) << "Could not create table";
+		}
+	}
+
+	void TearDown() override {
+		Super::TearDown();
+		_dbHandler.shutdown();
+	}
+};
+
+TEST_F(AsyncDBHandlerTest, testNotInitialized) {
+	persistence::AsyncDBHandler handler;
+	int failed = 0;
+	handler.select(db::UserModel(), db::DBConditionUserEmail("a@b.c.d"), [&] (bool success, std::vector<db::UserModel>&& users) {
+		EXPECT_FALSE(success);
+		EXPECT_TRUE(users.empty());
+		++failed;
+	});
+	EXPECT_EQ(0, failed) << "The callbacks are only executed in the update() call";
+	EXPECT_EQ(1, handler.update());
+	EXPECT_EQ(1, failed);
+	EXPECT_EQ(0, handler.update());
+}
+
+TEST_F(AsyncDBHandlerTest, testPipelinedSelects) {
+	if (!_supported) {
+		return;
+	}
+	const int users = 20;
+	for (int i = 0; i < users; ++i) {
+		db::UserModel u;
+		u.setEmail(core::string::format("a%i@b.c.d", i));
+		u.setPassword("secret");
+		u.setRegistrationdate(persistence::Timestamp::now());
+		ASSERT_TRUE(_dbHandler.insert(u));
+	}
+
+	persistence::AsyncDBHandler handler(2, 8);
+	ASSERT_TRUE(handler.init());
+	int found = 0;
+	for (int i = 0; i < users; ++i) {
+		const std::string& email = core::string::format("a%i@b.c.d", i);
+		handler.select(db::UserModel(), db::DBConditionUserEmail(email), [&found, email] (bool success, std::vector<db::UserModel>&& models) {
+			ASSERT_TRUE(success);
+			ASSERT_EQ(1u, models.size());
+			EXPECT_EQ(email, models[0].email());
+			EXPECT_NE(0, models[0].id());
+			++found;
+		});
+	}
+	// a failing query doesn't abort the other queries of the pipeline
+	bool invalidFailed = false;
+	handler.exec("SELECT * FROM \"doesnotexist\"", {}, [&invalidFailed] (persistence::State& state) {
+		invalidFailed = !state.result;
+	});
+	bool empty = false;
+	handler.select(db::UserModel(), db::DBConditionUserEmail("unknown@b.c.d"), [&empty] (bool success, std::vector<db::UserModel>&& models) {
+		empty = success && models.empty();
+	});
+	EXPECT_EQ(users + 2, waitForResults(handler, users + 2));
+	EXPECT_EQ(users, found);
+	EXPECT_TRUE(invalidFailed);
+	EXPECT_TRUE(empty);
+	handler.shutdown();
+}
+
+}
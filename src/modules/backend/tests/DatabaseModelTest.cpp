@@ -60,6 +60,58 @@ public:
 	}
 };
 
+TEST_F(DatabaseModelTest, testColumnIndex) {
+	const db::UserModel model;
+	std::vector<int> columns;
+	ASSERT_TRUE(model.fillColumnIndex({"id", "registrationdate", "email"}, columns));
+	ASSERT_EQ(3u, columns.size());
+	EXPECT_EQ("id", model.fields()[columns[0]].name);
+	EXPECT_EQ("registrationdate", model.fields()[columns[1]].name);
+	EXPECT_EQ("email", model.fields()[columns[2]].name);
+	EXPECT_FALSE(model.fillColumnIndex({"id", "unknown"}, columns));
+}
+
+/**
+ * @brief The parameters for the cached prepared statements must match the ones of the generated statements
+ */
+TEST_F(DatabaseModelTest, testStatementParameters) {
+	db::UserModel u;
+	u.setId(42);
+	u.setEmail("a@b.c.d");
+	u.setPassword("secret");
+	u.setRegistrationdate(persistence::Timestamp(1000));
+
+	auto expectEqual = [] (const persistence::BindParam& expected, const persistence::BindParam& actual) {
+		ASSERT_EQ(expected.position, actual.position);
+		for (int i = 0; i < expected.position; ++i) {
+			EXPECT_STREQ(expected.values[i], actual.values[i]) << "Parameter " << i;
+		}
+	};
+
+	persistence::BindParam insertStatement(10);
+	persistence::createInsertStatement(u, &insertStatement);
+	persistence::BindParam insertParams(10);
+	persistence::createInsertParameters(u, insertParams);
+	expectEqual(insertStatement, insertParams);
+
+	persistence::BindParam updateStatement(10);
+	persistence::createUpdateStatement(u, &updateStatement);
+	persistence::BindParam updateParams(10);
+	persistence::createUpdateParameters(u, updateParams);
+	expectEqual(updateStatement, updateParams);
+
+	// NOW() is part of the statement - no parameter, and a different statement
+	const std::string shape = persistence::createStatementShape(u);
+	u.setRegistrationdate(persistence::Timestamp::now());
+	EXPECT_NE(shape, persistence::createStatementShape(u));
+	persistence::BindParam nowStatement(10);
+	persistence::createInsertStatement(u, &nowStatement);
+	persistence::BindParam nowParams(10);
+	persistence::createInsertParameters(u, nowParams);
+	EXPECT_LT(nowParams.position, insertParams.position);
+	expectEqual(nowStatement, nowParams);
+}
+
 TEST_F(DatabaseModelTest, testCreateUser) {
 	if (!_supported) {
 		return;
@@ -0,0 +1,202 @@
+/**
+ * @file
+ */
+
+#include "core/tests/AbstractTest.h"
+#include "backend/entity/EntityUpdateEncoder.h"
+#include <random>
+#include <unordered_map>
+
+namespace backend {
+
+class EntityUpdateEncoderTest: public core::AbstractTest {
+protected:
+	struct State {
+		glm::vec3 pos;
+		float orientation;
+	};
+	typedef std::unordered_map<EntityId, State> States;
+
+	flatbuffers::FlatBufferBuilder _fbb;
+
+	/**
+	 * @brief Encodes the given states, decodes them again and acks the sequence
+	 * @return The size of the message or @c 0 if nothing was sent
+	 */
+	size_t transfer(EntityUpdateEncoder& encoder, network::EntityUpdatesDecoder& decoder, const States& states, States& received, bool ack = true) {
+		encoder.begin();
+		for (const auto& e : states) {
+			encoder.add(e.first, e.second.pos, e.second.orientation);
+		}
+		const auto& updates = encoder.finish(_fbb);
+		if (updates.IsNull()) {
+			_fbb.Clear();
+			return 0u;
+		}
+		_fbb.Finish(network::CreateServerMessage(_fbb, network::ServerMsgType::EntityUpdates, updates.Union()));
+		const size_t size = _fbb.GetSize();
+		const network::ServerMessage* message = network::GetServerMessage(_fbb.GetBufferPointer());
+		const network::EntityUpdates* msg = message->data_as_EntityUpdates();
+		EXPECT_TRUE(decoder.decode(msg, [&] (int64_t id, const glm::vec3& pos, float rotation) {
+			received[id] = State { pos, rotation };
+		}));
+		if (ack) {
+			encoder.ack(msg->sequence());
+		}
+		_fbb.Clear();
+		return size;
+	}
+
+	/**
+	 * @return The size of the old message with one packet for each visible entity
+	 */
+	size_t singleUpdateSize(EntityId id, const State& state) {
+		const network::Vec3 pos { state.pos.x, state.pos.y, state.pos.z };
+		_fbb.Finish(network::CreateServerMessage(_fbb, network::ServerMsgType::EntityUpdate,
+				network::CreateEntityUpdate(_fbb, id, &pos, state.orientation).Union()));
+		const size_t size = _fbb.GetSize();
+		_fbb.Clear();
+		return size;
+	}
+
+	static void expectNear(const State& expected, const State& received) {
+		const float precision = 1.0f / network::EntityQuantizer::PositionScale;
+		EXPECT_NEAR(expected.pos.x, received.pos.x, precision);
+		EXPECT_NEAR(expected.pos.y, received.pos.y, precision);
+		EXPECT_NEAR(expected.pos.z, received.pos.z, precision);
+		EXPECT_NEAR(expected.orientation, received.orientation, 0.001f);
+	}
+};
+
+TEST_F(EntityUpdateEncoderTest, testQuantize) {
+	const glm::vec3 pos(-1024.3f, 17.25f, 3000.7f);
+	const network::QuantizedEntity& q = network::EntityQuantizer::quantize(pos, 1.0f);
+	const glm::vec3& restored = network::EntityQuantizer::position(q);
+	EXPECT_NEAR(pos.x, restored.x, 1.0f / network::EntityQuantizer::PositionScale);
+	EXPECT_NEAR(pos.y, restored.y, 1.0f / network::EntityQuantizer::PositionScale);
+	EXPECT_NEAR(pos.z, restored.z, 1.0f / network::EntityQuantizer::PositionScale);
+	EXPECT_NEAR(1.0f, network::EntityQuantizer::rotation(q), 0.001f);
+	const network::QuantizedEntity& negative = network::EntityQuantizer::quantize(pos, -glm::half_pi<float>());
+	EXPECT_NEAR(glm::three_over_two_pi<float>(), network::EntityQuantizer::rotation(negative), 0.001f);
+}
+
+TEST_F(EntityUpdateEncoderTest, testDelta) {
+	EntityUpdateEncoder encoder;
+	network::EntityUpdatesDecoder decoder;
+	States states;
+	states[1] = State { glm::vec3(10.0f, 1.0f, 10.0f), 0.5f };
+	states[2] = State { glm::vec3(20.0f, 1.0f, 20.0f), 1.5f };
+	States received;
+	EXPECT_GT(transfer(encoder, decoder, states, received), 0u);
+	ASSERT_EQ(2u, received.size());
+	expectNear(states[1], received[1]);
+	expectNear(states[2], received[2]);
+
+	received.clear();
+	EXPECT_EQ(0u, transfer(encoder, decoder, states, received)) << "Nothing changed - nothing should get sent";
+	EXPECT_TRUE(received.empty());
+
+	states[2].pos.x += 0.5f;
+	EXPECT_GT(transfer(encoder, decoder, states, received), 0u);
+	ASSERT_EQ(1u, received.size()) << "Only the changed entity should get sent";
+	expectNear(states[2], received[2]);
+
+	// a jump that doesn't fit into a delta
+	received.clear();
+	states[1].pos.z += 5000.0f;
+	EXPECT_GT(transfer(encoder, decoder, states, received), 0u);
+	ASSERT_EQ(1u, received.size());
+	expectNear(states[1], received[1]);
+}
+
+TEST_F(EntityUpdateEncoderTest, testLostUpdates) {
+	EntityUpdateEncoder encoder;
+	network::EntityUpdatesDecoder decoder;
+	States states;
+	states[1] = State { glm::vec3(10.0f, 1.0f, 10.0f), 0.5f };
+	States received;
+	transfer(encoder, decoder, states, received);
+	const uint32_t acked = encoder.ackedSequence();
+
+	// the peer receives the updates, but the acks get lost - the deltas are still relative to the old baseline
+	states[1].pos.x += 1.0f;
+	transfer(encoder, decoder, states, received, false);
+	states[1].pos.x += 1.0f;
+	transfer(encoder, decoder, states, received, false);
+	EXPECT_EQ(acked, encoder.ackedSequence());
+	expectNear(states[1], received[1]);
+
+	// an ack for older updates arrives late
+	encoder.ack(acked);
+	states[1].pos.x += 1.0f;
+	transfer(encoder, decoder, states, received);
+	expectNear(states[1], received[1]);
+	EXPECT_EQ(encoder.sequence(), encoder.ackedSequence());
+
+	// the entity is no longer visible
+	states.erase(1);
+	states[2] = State { glm::vec3(30.0f, 1.0f, 30.0f), 0.0f };
+	received.clear();
+	transfer(encoder, decoder, states, received);
+	ASSERT_EQ(1u, received.size());
+	expectNear(states[2], received[2]);
+}
+
+/**
+ * @brief Compares one batched message per peer with the single entity update packets for each
+ * visible entity of a crowd where every entity sees every other entity.
+ */
+TEST_F(EntityUpdateEncoderTest, testBandwidth) {
+	const int entities = 100;
+	const int ticks = 40;
+	std::mt19937 rnd(42);
+	std::uniform_real_distribution<float> coord(0.0f, 100.0f);
+	std::uniform_real_distribution<float> step(-1.0f, 1.0f);
+	std::uniform_int_distribution<int> moving(0, 3);
+
+	States states;
+	for (int i = 1; i <= entities; ++i) {
+		states[i] = State { glm::vec3(coord(rnd), 1.0f, coord(rnd)), 0.0f };
+	}
+	std::vector<EntityUpdateEncoder> encoders(entities);
+	std::vector<network::EntityUpdatesDecoder> decoders(entities);
+	std::vector<States> received(entities);
+
+	size_t oldPackets = 0u;
+	size_t oldBytes = 0u;
+	size_t newPackets = 0u;
+	size_t newBytes = 0u;
+	for (int tick = 0; tick < ticks; ++tick) {
+		// a quarter of the entities is moving
+		for (auto& e : states) {
+			if (moving(rnd) == 0) {
+				e.second.pos.x += step(rnd);
+				e.second.pos.z += step(rnd);
+				e.second.orientation = std::abs(step(rnd)) * glm::pi<float>();
+			}
+		}
+		for (int peer = 0; peer < entities; ++peer) {
+			for (const auto& e : states) {
+				++oldPackets;
+				oldBytes += singleUpdateSize(e.first, e.second);
+			}
+			const size_t size = transfer(encoders[peer], decoders[peer], states, received[peer]);
+			if (size > 0u) {
+				++newPackets;
+				newBytes += size;
+			}
+		}
+	}
+	for (int peer = 0; peer < entities; ++peer) {
+		ASSERT_EQ(states.size(), received[peer].size());
+		for (const auto& e : states) {
+			expectNear(e.second, received[peer][e.first]);
+		}
+	}
+	Log::info("entity updates for %i entities in %i ticks: %i packets with %i bytes before, %i packets with %i bytes now",
+			entities, ticks, (int)oldPackets, (int)oldBytes, (int)newPackets, (int)newBytes);
+	EXPECT_LE(newPackets, (size_t)(entities * ticks)) << "There should be at most one packet per peer and tick";
+	EXPECT_LT(newBytes * 5u, oldBytes) << "The batched updates should be a lot smaller";
+}
+
+}
@@ -0,0 +1,178 @@
+/**
+ * @file
+ */
+
+#include "persistence/tests/AbstractDatabaseTest.h"
+#include "BackendModels.h"
+#include "persistence/DBHandler.h"
+#include "persistence/PersistenceMgr.h"
+#include "persistence/SQLGenerator.h"
+#include "engine-config.h"
+
+namespace backend {
+
+class TestSavable : public persistence::ISavable {
+public:
+	// itemid and amount of the dirty stock rows
+	std::vector<std::pair<int32_t, int64_t>> dirty;
+	int64_t userId = 1;
+
+	bool getDirtyModels(persistence::Models& models) override {
+		for (const auto& e : dirty) {
+			db::StockModel* model = new db::StockModel();
+			model->setUserid(userId);
+			model->setItemid(e.first);
+			model->setAmount(e.second);
+			models.emplace_back(model);
+		}
+		const bool added = !dirty.empty();
+		dirty.clear();
+		return added;
+	}
+};
+
+class PersistenceMgrTest: public persistence::AbstractDatabaseTest {
+private:
+	using Super = persistence::AbstractDatabaseTest;
+protected:
+	bool _supported = true;
+	persistence::DBHandler _dbHandler;
+public:
+	void SetUp() override {
+		Super::SetUp();
+		_supported = _dbHandler.init();
+		if (_supported) {
+			_dbHandler.dropTable(db::StockModel());
+			_dbHandler.dropTable(db::UserModel());
+			ASSERT_TRUE(_dbHandler.createTable(db::UserModel())) << "Could not create table";
+			ASSERT_TRUE(_dbHandler.createTable(db::StockModel())) << "Could not create table";
+		}
+	}
+
+	void TearDown() override {
+		Super::TearDown();
+		_dbHandler.shutdown();
+	}
+
+	int64_t amount(int64_t userId, int32_t itemId) {
+		int64_t amount = -1;
+		_dbHandler.select(db::StockModel(), db::DBConditionStockUserid(userId), [&] (db::StockModel&& model) {
+			if (model.itemid() == itemId) {
+				amount = model.amount();
+			}
+		});
+		return amount;
+	}
+};
+
+TEST_F(PersistenceMgrTest, testUpsertStatement) {
+	db::StockModel first;
+	first.setUserid(1);
+	first.setItemid(2);
+	first.setAmount(3);
+	db::StockModel second;
+	second.setUserid(1);
+	second.setItemid(3);
+	second.setAmount(4);
+	persistence::BindParam params(6);
+	const std::string& statement = persistence::createUpsertStatement({&first, &second}, &params);
+	EXPECT_EQ("INSERT INTO \"stock\" (\"amount\", \"itemid\", \"userid\") VALUES ($1, $2, $3), ($4, $5, $6) "
+			"ON CONFLICT (\"itemid\", \"userid\") DO UPDATE SET \"amount\" = EXCLUDED.\"amount\"", statement);
+	ASSERT_EQ(6, params.position);
+	EXPECT_STREQ("3", params.values[0]);
+	EXPECT_STREQ("2", params.values[1]);
+	EXPECT_STREQ("1", params.values[2]);
+	EXPECT_STREQ("4", params.values[3]);
+	EXPECT_STREQ("3", params.values[4]);
+	EXPECT_STREQ("1", params.values[5]);
+
+	const std::vector<const persistence::Field*>& conflictFields = persistence::createConflictFields(db::UserModel());
+	ASSERT_EQ(1u, conflictFields.size());
+	EXPECT_EQ("id", conflictFields[0]->name);
+}
+
+TEST_F(PersistenceMgrTest, testCollect) {
+	persistence::PersistenceMgr mgr(core::EventBusPtr(), 100l);
+	TestSavable savable;
+	ASSERT_TRUE(mgr.registerSavable(&savable));
+	EXPECT_FALSE(mgr.registerSavable(&savable));
+
+	savable.dirty = {{1, 10}, {2, 20}};
+	mgr.update(50l);
+	EXPECT_EQ(0u, mgr.pendingRows()) << "The collect interval is not yet reached";
+	mgr.update(50l);
+	EXPECT_EQ(2u, mgr.pendingRows());
+	EXPECT_TRUE(savable.dirty.empty());
+
+	// the same rows are merged - the latest state wins
+	savable.dirty = {{1, 11}, {3, 30}};
+	mgr.update(100l);
+	EXPECT_EQ(3u, mgr.pendingRows());
+
+	// the last state is collected when the savable is removed
+	savable.dirty = {{4, 40}};
+	ASSERT_TRUE(mgr.unregisterSavable(&savable));
+	EXPECT_EQ(4u, mgr.pendingRows());
+	EXPECT_FALSE(mgr.unregisterSavable(&savable));
+	savable.dirty = {{5, 50}};
+	mgr.update(100l);
+	EXPECT_EQ(4u, mgr.pendingRows());
+}
+
+TEST_F(PersistenceMgrTest, testFlush) {
+	if (!_supported) {
+		return;
+	}
+	db::UserModel u;
+	u.setEmail("a@b.c.d");
+	u.setPassword("secret");
+	u.setRegistrationdate(persistence::Timestamp::now());
+	ASSERT_TRUE(_dbHandler.insert(u));
+
+	TestSavable savable;
+	savable.userId = u.id();
+	persistence::PersistenceMgr mgr(core::EventBusPtr(), 0l, 2);
+	ASSERT_TRUE(mgr.init());
+	ASSERT_TRUE(mgr.registerSavable(&savable));
+	savable.dirty = {{1, 10}, {2, 20}, {3, 30}};
+	mgr.update(0l);
+	savable.dirty = {{1, 5}};
+	mgr.shutdown();
+	EXPECT_EQ(0u, mgr.pendingRows());
+
+	EXPECT_EQ(5, amount(u.id(), 1)) << "The existing row should get overwritten";
+	EXPECT_EQ(20, amount(u.id(), 2));
+	EXPECT_EQ(30, amount(u.id(), 3));
+}
+
+TEST_F(PersistenceMgrTest, testRejectedRow) {
+	if (!_supported) {
+		return;
+	}
+	db::UserModel u;
+	u.setEmail("a@b.c.d");
+	u.setPassword("secret");
+	u.setRegistrationdate(persistence::Timestamp::now());
+	ASSERT_TRUE(_dbHandler.insert(u));
+
+	TestSavable savable;
+	savable.userId = u.id();
+	// violates the foreign key constraint
+	TestSavable unknownUser;
+	unknownUser.userId = u.id() + 1000;
+	persistence::PersistenceMgr mgr(core::EventBusPtr(), 0l);
+	ASSERT_TRUE(mgr.init());
+	ASSERT_TRUE(mgr.registerSavable(&savable));
+	ASSERT_TRUE(mgr.registerSavable(&unknownUser));
+	savable.dirty = {{1, 10}, {2, 20}};
+	unknownUser.dirty = {{1, 30}};
+	mgr.update(0l);
+	mgr.shutdown();
+	EXPECT_EQ(0u, mgr.pendingRows()) << "The rejected row should get dropped";
+
+	EXPECT_EQ(10, amount(u.id(), 1));
+	EXPECT_EQ(20, amount(u.id(), 2));
+	EXPECT_EQ(-1, amount(unknownUser.userId, 1));
+}
+
+}
@@ -8,25 +8,82 @@
 
 namespace cooldown {
 
-CooldownMgr::CooldownMgr(const core::TimeProviderPtr& timeProvider, const cooldown::CooldownProviderPtr& cooldownProvider) :
-		_timeProvider(timeProvider), _cooldownProvider(cooldownProvider), _lock("CooldownMgr") {
+CooldownMgr::CooldownMgr(const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel, const cooldown::CooldownProviderPtr& cooldownProvider) :
+		_timeProvider(timeProvider), _timerWheel(timerWheel), _cooldownProvider(cooldownProvider), _lock("CooldownMgr") {
 }
 
-CooldownTriggerState CooldownMgr::triggerCooldown(Type type) {
+CooldownMgr::~CooldownMgr() {
+	Timers timers;
+	{
+		core::ScopedWriteLock lock(_lock);
+		timers.swap(_timers);
+	}
+	// waits for the callbacks that are currently executed
+	for (const auto& e : timers) {
+		_timerWheel->cancel(e.second.id);
+	}
+}
+
+void CooldownMgr::expire(Type type, uint64_t sequence) {
 	core::ScopedWriteLock lock(_lock);
-	CooldownPtr cooldown = _cooldowns[type];
-	if (!cooldown) {
-		// TODO: use a pool here
-		cooldown = std::make_shared<Cooldown>(type, defaultDuration(type), _timeProvider);
-		_cooldowns[type] = cooldown;
-	} else if (cooldown->running()) {
-		Log::error("Failed to trigger the cooldown of type %i: already running", std::enum_value(type));
-		return CooldownTriggerState::ALREADY_RUNNING;
+	// the timer stays in the map - whoever removes it cancels it, which waits for this callback
+	auto t = _timers.find(type);
+	if (t == _timers.end() || t->second.sequence != sequence) {
+		return;
+	}
+	auto i = _cooldowns.find(type);
+	if (i == _cooldowns.end()) {
+		return;
+	}
+	Log::debug("Cooldown of type %i has just expired at %li",
+			std::enum_value(type), _timeProvider->tickMillis());
+	i->second->expire();
+}
+
+void CooldownMgr::cancelTimer(Type type) {
+	core::TimerWheel::TimerId id;
+	{
+		core::ScopedWriteLock lock(_lock);
+		auto i = _timers.find(type);
+		if (i == _timers.end()) {
+			return;
+		}
+		id = i->second.id;
+		_timers.erase(i);
+	}
+	_timerWheel->cancel(id);
+}
+
+CooldownTriggerState CooldownMgr::triggerCooldown(Type type) {
+	core::TimerWheel::TimerId expiredTimer = core::TimerWheel::InvalidTimerId;
+	{
+		core::ScopedWriteLock lock(_lock);
+		CooldownPtr cooldown = _cooldowns[type];
+		if (!cooldown) {
+			// TODO: use a pool here
+			cooldown = std::make_shared<Cooldown>(type, defaultDuration(type), _timeProvider);
+			_cooldowns[type] = cooldown;
+		} else if (cooldown->running()) {
+			Log::error("Failed to trigger the cooldown of type %i: already running", std::enum_value(type));
+			return CooldownTriggerState::ALREADY_RUNNING;
+		}
+		cooldown->start();
+		auto i = _timers.find(type);
+		if (i != _timers.end()) {
+			// the timer of the last run - it didn't fire yet or its callback might still be running
+			expiredTimer = i->second.id;
+		}
+		const uint64_t sequence = ++_timerSequence;
+		const core::TimerWheel::TimerId id = _timerWheel->schedule(cooldown->startMillis() + cooldown->duration(), [this, type, sequence] () {
+			expire(type, sequence);
+		});
+		_timers[type] = Timer{id, sequence};
+		Log::debug("Triggered the cooldown of type %i (expires in %lims, started at %li)",
+				std::enum_value(type), cooldown->duration(), cooldown->startMillis());
+	}
+	if (expiredTimer != core::TimerWheel::InvalidTimerId) {
+		_timerWheel->cancel(expiredTimer);
 	}
-	cooldown->start();
-	_queue.push(cooldown);
-	Log::debug("Triggered the cooldown of type %i (expires in %lims, started at %li)",
-			std::enum_value(type), cooldown->duration(), cooldown->startMillis());
 	return CooldownTriggerState::SUCCESS;
 }
 
@@ -48,6 +105,7 @@ bool CooldownMgr::resetCooldown(Type type) {
 	if (!c) {
 		return false;
 	}
+	cancelTimer(type);
 	c->reset();
 	return true;
 }
@@ -57,6 +115,7 @@ bool CooldownMgr::cancelCooldown(Type type) {
 	if (!c) {
 		return false;
 	}
+	cancelTimer(type);
 	c->cancel();
 	return true;
 }
@@ -72,25 +131,4 @@ bool CooldownMgr::isCooldown(Type type) {
 	return true;
 }
 
-void CooldownMgr::update() {
-	for (;;) {
-		_lock.lockRead();
-		if (_queue.empty()) {
-			_lock.unlockRead();
-			break;
-		}
-		CooldownPtr cooldown = _queue.top();
-		_lock.unlockRead();
-		if (cooldown->running()) {
-			break;
-		}
-
-		_lock.lockWrite();
-		_queue.pop();
-		_lock.unlockWrite();
-		Log::debug("Cooldown of type %i has just expired at %li",
-				std::enum_value(cooldown->type()), _timeProvider->tickMillis());
-		cooldown->expire();
-	}
-}
 }
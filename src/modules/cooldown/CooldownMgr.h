@@ -8,39 +8,49 @@
 #include "Cooldown.h"
 #include "core/NonCopyable.h"
 #include "core/TimeProvider.h"
-#include "core/ReadWriteLock.h"
+#include "core/TimerWheel.h"
 #include "CooldownProvider.h"
 
 #include <memory>
 #include <unordered_map>
-#include <queue>
-#include <functional>
-#include <vector>
 
 namespace cooldown {
 
 /**
  * @brief Cooldown manager that handles cooldowns for one entity
+ *
+ * The expiration of a cooldown is scheduled in the given timer wheel - there is nothing to poll. The
+ * wheel is shared by all entities and updated once per frame.
+ *
+ * @note The timers are never cancelled while holding the lock - cancelling waits for a running expire
+ * callback, and that one needs the lock.
+ *
  * @ingroup Cooldowns
  */
 class CooldownMgr: public core::NonCopyable {
 private:
 	core::TimeProviderPtr _timeProvider;
+	core::TimerWheelPtr _timerWheel;
 	cooldown::CooldownProviderPtr _cooldownProvider;
 	core::ReadWriteLock _lock;
 
-	struct CooldownComparatorLess: public std::binary_function<CooldownPtr, CooldownPtr, bool> {
-		inline bool operator()(const CooldownPtr& x, const CooldownPtr& y) const {
-			return std::less<Cooldown>()(*x.get(), *y.get());
-		}
-	};
-
-	typedef std::priority_queue<CooldownPtr, std::vector<CooldownPtr>, CooldownComparatorLess> CooldownQueue;
-	CooldownQueue _queue;
 	typedef std::unordered_map<Type, CooldownPtr, network::EnumHash<Type> > Cooldowns;
 	Cooldowns _cooldowns;
+	struct Timer {
+		core::TimerWheel::TimerId id;
+		// to detect the callbacks of timers that were replaced or cancelled in the meantime
+		uint64_t sequence;
+	};
+	// the timers of the running cooldowns
+	typedef std::unordered_map<Type, Timer, network::EnumHash<Type> > Timers;
+	Timers _timers;
+	uint64_t _timerSequence = 0u;
+
+	void expire(Type type, uint64_t sequence);
+	void cancelTimer(Type type);
 public:
-	CooldownMgr(const core::TimeProviderPtr& timeProvider, const cooldown::CooldownProviderPtr& cooldownProvider);
+	CooldownMgr(const core::TimeProviderPtr& timeProvider, const core::TimerWheelPtr& timerWheel, const cooldown::CooldownProviderPtr& cooldownProvider);
+	~CooldownMgr();
 
 	/**
 	 * @brief Tries to trigger the specified cooldown for the given entity
@@ -64,11 +74,6 @@ public:
 	 * @brief Checks whether a user has the given cooldown running
 	 */
 	bool isCooldown(Type type);
-
-	/**
-	 * @brief Update cooldown states
-	 */
-	void update();
 };
 
 typedef std::shared_ptr<CooldownMgr> CooldownMgrPtr;
@@ -7,19 +7,30 @@
 
 #include "../CooldownProvider.h"
 #include "core/Singleton.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace cooldown {
 
 class CooldownMgrTest : public core::AbstractTest {
 protected:
 	core::TimeProviderPtr _timeProvider;
+	core::TimerWheelPtr _timerWheel;
 	cooldown::CooldownProviderPtr _cooldownProvider;
 	CooldownMgr _mgr;
+
+	void update() {
+		_timerWheel->update(_timeProvider->tickMillis());
+	}
 public:
 	CooldownMgrTest() :
 		_timeProvider(std::make_shared<core::TimeProvider>()),
+		_timerWheel(std::make_shared<core::TimerWheel>()),
 		_cooldownProvider(std::make_shared<cooldown::CooldownProvider>()),
-		_mgr(_timeProvider, _cooldownProvider) {
+		_mgr(_timeProvider, _timerWheel, _cooldownProvider) {
 	}
 
 	void SetUp() override {
@@ -35,7 +46,9 @@ TEST_F(CooldownMgrTest, testTriggerCooldown) {
 
 TEST_F(CooldownMgrTest, testCancelCooldown) {
 	ASSERT_EQ(CooldownTriggerState::SUCCESS, _mgr.triggerCooldown(Type::LOGOUT)) << "Logout cooldown couldn't get triggered";
+	ASSERT_EQ(1u, _timerWheel->pending());
 	ASSERT_TRUE(_mgr.cancelCooldown(Type::LOGOUT)) << "Failed to cancel the logout cooldown";
+	ASSERT_EQ(0u, _timerWheel->pending()) << "The timer of the cancelled cooldown is still scheduled";
 }
 
 TEST_F(CooldownMgrTest, testExpireCooldown) {
@@ -46,15 +59,17 @@ TEST_F(CooldownMgrTest, testExpireCooldown) {
 	ASSERT_TRUE(_mgr.cooldown(Type::LOGOUT)->started()) << "Cooldown is not started";
 	ASSERT_TRUE(_mgr.cooldown(Type::LOGOUT)->running()) << "Cooldown is not running";
 	ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
-	_mgr.update();
+	update();
 	ASSERT_TRUE(_mgr.cooldown(Type::LOGOUT)->started()) << "Cooldown is not started";
 	ASSERT_TRUE(_mgr.cooldown(Type::LOGOUT)->running()) << "Cooldown is not running";
 	ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
 	_timeProvider->update(_mgr.defaultDuration(Type::LOGOUT));
 	ASSERT_FALSE(_mgr.isCooldown(Type::LOGOUT));
-	_mgr.update();
+	update();
 	ASSERT_FALSE(_mgr.cooldown(Type::LOGOUT)->running()) << "Cooldown is still running";
+	ASSERT_FALSE(_mgr.cooldown(Type::LOGOUT)->started()) << "Cooldown didn't expire";
 	ASSERT_FALSE(_mgr.isCooldown(Type::LOGOUT));
+	ASSERT_EQ(0u, _timerWheel->pending());
 	ASSERT_TRUE(_mgr.resetCooldown(Type::LOGOUT)) << "Failed to reset the logout cooldown";
 }
 
@@ -64,7 +79,7 @@ TEST_F(CooldownMgrTest, testMultipleCooldown) {
 	ASSERT_EQ(CooldownTriggerState::SUCCESS, _mgr.triggerCooldown(Type::INCREASE)) << "Increase cooldown couldn't get triggered";
 	ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
 	ASSERT_TRUE(_mgr.isCooldown(Type::INCREASE));
-	_mgr.update();
+	update();
 	ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
 	ASSERT_TRUE(_mgr.isCooldown(Type::INCREASE));
 
@@ -73,12 +88,12 @@ TEST_F(CooldownMgrTest, testMultipleCooldown) {
 
 	if (logoutDuration > increaseDuration) {
 		_timeProvider->update(increaseDuration);
-		_mgr.update();
+		update();
 		ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
 		ASSERT_FALSE(_mgr.isCooldown(Type::INCREASE));
 	} else {
 		_timeProvider->update(logoutDuration);
-		_mgr.update();
+		update();
 		ASSERT_TRUE(_mgr.isCooldown(Type::INCREASE));
 		ASSERT_FALSE(_mgr.isCooldown(Type::LOGOUT));
 	}
@@ -89,4 +104,49 @@ TEST_F(CooldownMgrTest, testTriggerCooldownTwice) {
 	ASSERT_EQ(CooldownTriggerState::ALREADY_RUNNING, _mgr.triggerCooldown(Type::LOGOUT)) << "Logout cooldown was triggered twice";
 }
 
+TEST_F(CooldownMgrTest, testCancelWhileExpiring) {
+	// not owned by the fixture - it can't be destroyed if the threads deadlock
+	const core::TimerWheelPtr timerWheel = std::make_shared<core::TimerWheel>();
+	CooldownMgr* mgr = new CooldownMgr(_timeProvider, timerWheel, _cooldownProvider);
+	// every triggered cooldown expires with the next update - the expire callbacks run on this thread
+	std::atomic_bool stop { false };
+	std::thread updater([timerWheel, &stop] () {
+		uint64_t now = 0u;
+		while (!stop) {
+			now += 1000000u;
+			timerWheel->update(now);
+		}
+	});
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool finished = false;
+	// cancels the timers while their callbacks might be executed by the updater
+	std::thread canceller([&] () {
+		const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+		while (std::chrono::steady_clock::now() < end) {
+			mgr->triggerCooldown(Type::LOGOUT);
+			mgr->cancelCooldown(Type::LOGOUT);
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+		condition.notify_one();
+	});
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait_for(lock, std::chrono::seconds(30), [&finished] () {
+			return finished;
+		});
+	}
+	if (!finished) {
+		// the threads can't be joined anymore - and the manager is leaked
+		updater.detach();
+		canceller.detach();
+		FAIL() << "Cancelling a cooldown while its expire callback runs deadlocked";
+	}
+	stop = true;
+	canceller.join();
+	updater.join();
+	delete mgr;
+}
+
 }
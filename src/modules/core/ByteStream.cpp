@@ -4,6 +4,7 @@
 
 #include "ByteStream.h"
 #include <SDL_stdinc.h>
+#include <algorithm>
 
 namespace core {
 
@@ -16,34 +17,30 @@ ByteStream::~ByteStream() {
 	_buffer.clear();
 }
 
+uint8_t* ByteStream::growFront(size_t size) {
+	if ((size_t)_pos < size) {
+		// reserve at least as much space in front as there are bytes - the
+		// bytes are only moved again after that space was used up by prepending
+		const size_t front = std::max(size - _pos, std::max(getSize(), (size_t)16));
+		_buffer.insert(_buffer.begin(), front, 0);
+		_pos += (int)front;
+	}
+	_pos -= (int)size;
+	return &_buffer[_pos];
+}
+
 int32_t ByteStream::peekInt() const {
-	const int l = 4;
-	if (size() < l) {
+	if (size() < 4) {
 		return -1;
 	}
-	uint8_t buf[l];
-	VectorBuffer::const_iterator it = begin();
-	for (int i = 0; i < l; ++i) {
-		buf[i] = *it++;
-	}
-	const int32_t *word = (const int32_t*) (void*) buf;
-	const int32_t val = SDL_SwapLE32(*word);
-	return val;
+	return (int32_t)_priv::loadLE32(getBuffer());
 }
 
 int16_t ByteStream::peekShort() const {
-	const int l = 2;
-	if (size() < l) {
+	if (size() < 2) {
 		return -1;
 	}
-	uint8_t buf[l];
-	VectorBuffer::const_iterator it = begin();
-	for (int i = 0; i < l; ++i) {
-		buf[i] = *it++;
-	}
-	const int16_t *word = reinterpret_cast<const int16_t*>(buf);
-	const int16_t val = SDL_SwapLE16(*word);
-	return val;
+	return (int16_t)_priv::loadLE16(getBuffer());
 }
 
 void ByteStream::addFormat(const char *fmt, ...) {
@@ -103,20 +100,16 @@ void ByteStream::readFormat(const char *fmt, ...) {
 }
 
 std::string ByteStream::readString() {
-	int size = 0;
-	std::string strbuff;
-	strbuff.reserve(64);
-	for (;;) {
-		const char chr = *std::next(begin(), size);
-		++size;
-		core_assert(size <= this->size());
-		if (chr == '\0') {
-			break;
-		}
-		strbuff += chr;
+	const uint8_t* buf = getBuffer();
+	const uint8_t* end = (const uint8_t*)memchr(buf, '\0', getSize());
+	core_assert(end != nullptr);
+	if (end == nullptr) {
+		return "";
 	}
-	_pos += size;
-	return strbuff;
+	const size_t length = end - buf;
+	std::string str(reinterpret_cast<const char*>(buf), length);
+	_pos += (int)length + 1;
+	return str;
 }
 
 }
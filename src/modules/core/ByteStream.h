@@ -10,6 +10,7 @@
 #include <list>
 #include <string>
 #include <cstdarg>
+#include <cstring>
 #include <SDL_endian.h>
 #include <climits>
 #include "Common.h"
@@ -20,6 +21,171 @@ namespace core {
 #define BYTE_MASK 0XFF
 #define WORD_MASK 0XFFFF
 
+namespace _priv {
+
+// memcpy instead of a pointer cast - the data doesn't have to be aligned
+inline uint16_t loadLE16(const uint8_t* buf) {
+	uint16_t val;
+	memcpy(&val, buf, sizeof(val));
+	return SDL_SwapLE16(val);
+}
+
+inline uint32_t loadLE32(const uint8_t* buf) {
+	uint32_t val;
+	memcpy(&val, buf, sizeof(val));
+	return SDL_SwapLE32(val);
+}
+
+inline uint64_t loadLE64(const uint8_t* buf) {
+	uint64_t val;
+	memcpy(&val, buf, sizeof(val));
+	return SDL_SwapLE64(val);
+}
+
+}
+
+/**
+ * @brief Bounds checked little endian reader for a contiguous memory range
+ *
+ * The view doesn't copy or own the data - the memory must outlive the view. All reads fail
+ * without advancing the view if not enough bytes are left.
+ */
+class ByteView {
+private:
+	const uint8_t* _data;
+	size_t _size;
+	size_t _pos = 0u;
+public:
+	ByteView(const uint8_t* data, size_t size) :
+			_data(data), _size(size) {
+	}
+
+	explicit ByteView(const std::vector<uint8_t>& data) :
+			ByteView(data.data(), data.size()) {
+	}
+
+	bool readByte(uint8_t& val);
+	bool readBool(bool& val);
+	bool readShort(int16_t& val);
+	bool readInt(int32_t& val);
+	bool readLong(int64_t& val);
+	bool readFloat(float& val);
+	/**
+	 * @brief Copies the next @c size bytes into the given buffer
+	 */
+	bool readBytes(uint8_t* buf, size_t size);
+	/**
+	 * @brief Advances the view by @c size bytes without copying them
+	 * @return Pointer to the skipped bytes or @c nullptr if not enough bytes are left
+	 */
+	const uint8_t* readSpan(size_t size);
+	bool skip(size_t size);
+
+	/**
+	 * @return Pointer to the bytes that were not yet read
+	 */
+	const uint8_t* data() const;
+	/**
+	 * @return The amount of bytes that were not yet read
+	 */
+	size_t remaining() const;
+	bool empty() const;
+};
+
+inline const uint8_t* ByteView::data() const {
+	return _data + _pos;
+}
+
+inline size_t ByteView::remaining() const {
+	return _size - _pos;
+}
+
+inline bool ByteView::empty() const {
+	return _pos >= _size;
+}
+
+inline const uint8_t* ByteView::readSpan(size_t size) {
+	if (remaining() < size) {
+		return nullptr;
+	}
+	const uint8_t* span = data();
+	_pos += size;
+	return span;
+}
+
+inline bool ByteView::skip(size_t size) {
+	return readSpan(size) != nullptr;
+}
+
+inline bool ByteView::readBytes(uint8_t* buf, size_t size) {
+	const uint8_t* span = readSpan(size);
+	if (span == nullptr) {
+		return false;
+	}
+	memcpy(buf, span, size);
+	return true;
+}
+
+inline bool ByteView::readByte(uint8_t& val) {
+	if (empty()) {
+		return false;
+	}
+	val = _data[_pos++];
+	return true;
+}
+
+inline bool ByteView::readBool(bool& val) {
+	uint8_t byte;
+	if (!readByte(byte)) {
+		return false;
+	}
+	val = byte != 0;
+	return true;
+}
+
+inline bool ByteView::readShort(int16_t& val) {
+	const uint8_t* span = readSpan(2);
+	if (span == nullptr) {
+		return false;
+	}
+	val = (int16_t)_priv::loadLE16(span);
+	return true;
+}
+
+inline bool ByteView::readInt(int32_t& val) {
+	const uint8_t* span = readSpan(4);
+	if (span == nullptr) {
+		return false;
+	}
+	val = (int32_t)_priv::loadLE32(span);
+	return true;
+}
+
+inline bool ByteView::readLong(int64_t& val) {
+	const uint8_t* span = readSpan(8);
+	if (span == nullptr) {
+		return false;
+	}
+	val = (int64_t)_priv::loadLE64(span);
+	return true;
+}
+
+inline bool ByteView::readFloat(float& val) {
+	const uint8_t* span = readSpan(4);
+	if (span == nullptr) {
+		return false;
+	}
+	const uint32_t i = _priv::loadLE32(span);
+	memcpy(&val, &i, sizeof(val));
+	return true;
+}
+
+/**
+ * @brief Growing little endian byte buffer with a read position
+ *
+ * Prepending reuses the bytes in front of the read position and reserves more space at the
+ * front if they are used up - so prepending is amortized constant, too.
+ */
 class ByteStream {
 private:
 	typedef std::vector<uint8_t> VectorBuffer;
@@ -38,6 +204,15 @@ private:
 		return _buffer.begin() + _pos;
 	}
 
+	/**
+	 * @return Pointer to @c size new bytes at the end of the buffer
+	 */
+	uint8_t* grow(size_t size);
+	/**
+	 * @return Pointer to @c size new bytes in front of the unread bytes
+	 */
+	uint8_t* growFront(size_t size);
+
 public:
 	ByteStream(int size = 0);
 	virtual ~ByteStream();
@@ -50,6 +225,7 @@ public:
 	void addFloat(float value);
 	void addString(const std::string& string);
 	void addFormat(const char *fmt, ...);
+	void writeBytes(const uint8_t *buf, size_t size);
 
 	bool readBool();
 	uint8_t readByte();
@@ -59,6 +235,7 @@ public:
 	float readFloat();
 	std::string readString();
 	void readFormat(const char *fmt, ...);
+	void readBytes(uint8_t *buf, size_t size);
 
 	int32_t peekInt() const;
 	int16_t peekShort() const;
@@ -66,6 +243,11 @@ public:
 	// get the raw data pointer for the buffer
 	const uint8_t* getBuffer() const;
 
+	/**
+	 * @return A view of the unread bytes - it gets invalid as soon as the stream is modified
+	 */
+	ByteView view() const;
+
 	void append(const uint8_t *buf, size_t size);
 
 	bool empty() const;
@@ -109,25 +291,39 @@ public:
 	}
 };
 
+inline uint8_t* ByteStream::grow(size_t size) {
+	const size_t oldSize = _buffer.size();
+	_buffer.resize(oldSize + size);
+	return &_buffer[oldSize];
+}
+
 inline bool ByteStream::empty() const {
 	return size() <= 0;
 }
 
 inline void ByteStream::resize(size_t size) {
-	_buffer.resize(size);
+	_buffer.resize(_pos + size);
 }
 
-inline void ByteStream::append(const uint8_t *buf, size_t size) {
-	_buffer.reserve(_buffer.size() + size);
+inline void ByteStream::writeBytes(const uint8_t *buf, size_t size) {
 	_buffer.insert(_buffer.end(), buf, buf + size);
 }
 
+inline void ByteStream::append(const uint8_t *buf, size_t size) {
+	writeBytes(buf, size);
+}
+
 inline const uint8_t* ByteStream::getBuffer() const {
-	return &_buffer[0] + _pos;
+	return _buffer.data() + _pos;
+}
+
+inline ByteView ByteStream::view() const {
+	return ByteView(getBuffer(), getSize());
 }
 
 inline void ByteStream::clear() {
 	_buffer.clear();
+	_pos = 0;
 }
 
 inline size_t ByteStream::getSize() const {
@@ -136,7 +332,7 @@ inline size_t ByteStream::getSize() const {
 
 inline void ByteStream::addByte(uint8_t byte, bool prepend) {
 	if (prepend) {
-		_buffer.insert(_buffer.begin(), byte);
+		*growFront(1) = byte;
 	} else {
 		_buffer.push_back(byte);
 	}
@@ -147,42 +343,23 @@ inline void ByteStream::addBool(bool value, bool prepend) {
 }
 
 inline void ByteStream::addString(const std::string& string) {
-	const size_t length = string.length();
-	for (std::size_t i = 0; i < length; i++) {
-		addByte(uint8_t(string[i]));
-	}
-	addByte(uint8_t('\0'));
+	// including the terminating '\0'
+	writeBytes(reinterpret_cast<const uint8_t*>(string.c_str()), string.length() + 1);
 }
 
 inline void ByteStream::addShort(int16_t word, bool prepend) {
-	const int16_t swappedWord = SDL_SwapLE16(word);
-	if (prepend) {
-		_buffer.insert(_buffer.begin(), uint8_t(swappedWord >> CHAR_BIT));
-		_buffer.insert(_buffer.begin(), uint8_t(swappedWord));
-	} else {
-		_buffer.push_back(uint8_t(swappedWord));
-		_buffer.push_back(uint8_t(swappedWord >> CHAR_BIT));
-	}
+	const uint16_t swappedWord = SDL_SwapLE16((uint16_t)word);
+	memcpy(prepend ? growFront(2) : grow(2), &swappedWord, 2);
 }
 
 inline void ByteStream::addInt(int32_t dword) {
-	int32_t swappedDWord = SDL_SwapLE32(dword);
-	_buffer.push_back(uint8_t(swappedDWord));
-	_buffer.push_back(uint8_t(swappedDWord >>= CHAR_BIT));
-	_buffer.push_back(uint8_t(swappedDWord >>= CHAR_BIT));
-	_buffer.push_back(uint8_t(swappedDWord >> CHAR_BIT));
+	const uint32_t swappedDWord = SDL_SwapLE32((uint32_t)dword);
+	memcpy(grow(4), &swappedDWord, 4);
 }
 
 inline void ByteStream::addLong(int64_t dword) {
-	int64_t swappedDWord = SDL_SwapLE64(dword);
-	_buffer.push_back(uint8_t(swappedDWord));
-	_buffer.push_back(uint8_t(swappedDWord >>= CHAR_BIT));
-	_buffer.push_back(uint8_t(swappedDWord >>= CHAR_BIT));
-	_buffer.push_back(uint8_t(swappedDWord >>= CHAR_BIT));
-	_buffer.push_back(uint8_t(swappedDWord >>= CHAR_BIT));
-	_buffer.push_back(uint8_t(swappedDWord >>= CHAR_BIT));
-	_buffer.push_back(uint8_t(swappedDWord >>= CHAR_BIT));
-	_buffer.push_back(uint8_t(swappedDWord >> CHAR_BIT));
+	const uint64_t swappedDWord = SDL_SwapLE64((uint64_t)dword);
+	memcpy(grow(8), &swappedDWord, 8);
 }
 
 inline void ByteStream::addFloat(float value) {
@@ -194,6 +371,12 @@ inline void ByteStream::addFloat(float value) {
 	addInt(tmp.i);
 }
 
+inline void ByteStream::readBytes(uint8_t *buf, size_t size) {
+	core_assert(getSize() >= size);
+	memcpy(buf, getBuffer(), size);
+	_pos += (int)size;
+}
+
 inline uint8_t ByteStream::readByte() {
 	core_assert(size() > 0);
 	const uint8_t byte = _buffer[_pos];
@@ -207,8 +390,7 @@ inline bool ByteStream::readBool() {
 
 inline int16_t ByteStream::readShort() {
 	core_assert(size() >= 2);
-	const int16_t *word = reinterpret_cast<const int16_t*>(getBuffer());
-	const int16_t val = SDL_SwapLE16(*word);
+	const int16_t val = (int16_t)_priv::loadLE16(getBuffer());
 	_pos += 2;
 	return val;
 }
@@ -225,16 +407,14 @@ inline float ByteStream::readFloat() {
 
 inline int32_t ByteStream::readInt() {
 	core_assert(size() >= 4);
-	const int32_t *word = reinterpret_cast<const int32_t*>(getBuffer());
-	const int32_t val = SDL_SwapLE32(*word);
+	const int32_t val = (int32_t)_priv::loadLE32(getBuffer());
 	_pos += 4;
 	return val;
 }
 
 inline int64_t ByteStream::readLong() {
 	core_assert(size() >= 8);
-	const int64_t *word = reinterpret_cast<const int64_t*>(getBuffer());
-	const int64_t val = SDL_SwapLE64(*word);
+	const int64_t val = (int64_t)_priv::loadLE64(getBuffer());
 	_pos += 8;
 	return val;
 }
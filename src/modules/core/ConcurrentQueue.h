@@ -1,8 +1,9 @@
 #pragma once
 
 #include <cstdint>
-#include <queue>
 #include <vector>
+#include <algorithm>
+#include <functional>
 #include <condition_variable>
 #include <mutex>
 #include <atomic>
@@ -12,8 +13,10 @@ namespace core {
 template<class Data, class Compare = std::less<Data> >
 class ConcurrentQueue {
 private:
-	using Collection = std::priority_queue<Data, std::vector<Data>, Compare>;
+	// heap ordered by the given comparator - the vector is used directly to allow re-prioritization
+	using Collection = std::vector<Data>;
 	Collection _data;
+	Compare _compare;
 	mutable std::mutex _mutex;
 	std::condition_variable _conditionVariable;
 	std::atomic_bool _abort { false };
@@ -24,27 +27,40 @@ public:
 		abortWait();
 	}
 
+	/**
+	 * @brief Wakes up all threads that are blocked in @c waitAndPop(). The abort state is kept
+	 * until @c reset() is called - this allows multiple consumers to leave the wait cleanly.
+	 */
 	void abortWait() {
 		_abort = true;
 		std::unique_lock<std::mutex> lock(_mutex);
 		_conditionVariable.notify_all();
 	}
 
+	/**
+	 * @brief Allows to wait for new elements again after @c abortWait() was called.
+	 */
+	void reset() {
+		_abort = false;
+	}
+
 	void clear() {
 		std::unique_lock<std::mutex> lock(_mutex);
-		_data = Collection();
+		_data.clear();
 	}
 
 	void push(Data const& data) {
 		std::unique_lock<std::mutex> lock(_mutex);
-		_data.push(data);
+		_data.push_back(data);
+		std::push_heap(_data.begin(), _data.end(), _compare);
 		lock.unlock();
 		_conditionVariable.notify_one();
 	}
 
 	void push(Data&& data) {
 		std::unique_lock<std::mutex> lock(_mutex);
-		_data.push(data);
+		_data.push_back(std::move(data));
+		std::push_heap(_data.begin(), _data.end(), _compare);
 		lock.unlock();
 		_conditionVariable.notify_one();
 	}
@@ -65,11 +81,25 @@ public:
 			return false;
 		}
 
-		poppedValue = std::move(_data.top());
-		_data.pop();
+		std::pop_heap(_data.begin(), _data.end(), _compare);
+		poppedValue = std::move(_data.back());
+		_data.pop_back();
 		return true;
 	}
 
+	/**
+	 * @brief Gives access to all queued elements to update, reorder or remove them. The priority
+	 * order is restored afterwards.
+	 * @note The functor is called with a reference to the @c std::vector of elements (in heap order)
+	 * while the lock is held - keep it short, the consumers are blocked meanwhile.
+	 */
+	template<class FUNC>
+	void modify(FUNC&& func) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		func(_data);
+		std::make_heap(_data.begin(), _data.end(), _compare);
+	}
+
 	bool waitAndPop(Data& poppedValue) {
 		std::unique_lock<std::mutex> lock(_mutex);
 		while (_data.empty()) {
@@ -77,7 +107,6 @@ public:
 				return _abort || !_data.empty();
 			});
 			if (_abort) {
-				_abort = false;
 				return false;
 			}
 			if (_data.empty()) {
@@ -85,8 +114,9 @@ public:
 			}
 		}
 
-		poppedValue = std::move(_data.top());
-		_data.pop();
+		std::pop_heap(_data.begin(), _data.end(), _compare);
+		poppedValue = std::move(_data.back());
+		_data.pop_back();
 		return true;
 	}
 };
@@ -42,6 +42,10 @@ constexpr const char *ServerSeed = "sv_seed";
 constexpr const char *ServerHost = "sv_host";
 constexpr const char *ServerPort = "sv_port";
 constexpr const char *ServerMaxClients = "sv_maxclients";
+// the amount of threads that tick the npcs
+constexpr const char *ServerAIThreads = "sv_aithreads";
+// the amount of threads that execute the independent stages of a server frame
+constexpr const char *ServerStageThreads = "sv_stagethreads";
 
 constexpr const char *ShapeToolExtractRadius = "sh_extractradius";
 
@@ -0,0 +1,251 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include "Assert.h"
+#include "GLM.h"
+#include "Rect.h"
+#include "Trace.h"
+
+namespace core {
+
+/**
+ * @brief Uniform hash grid for moving objects.
+ *
+ * Every item is stored in the cell that contains the center of its rect. Only the occupied cells
+ * exist - so the grid is not limited to an area. Moving an item inside its cell only updates the
+ * rect, moving it to another cell is a swap-remove from the old and an append to the new cell -
+ * both is O(1).
+ *
+ * A query visits the cells that overlap the query area (extended by the largest item extent) and
+ * checks the rects of the items in there. Choose a cell size in the range of the typical query
+ * size - e.g. the view distance.
+ *
+ * @note The item type must be usable as a key in a @c std::unordered_map
+ * @note Not thread safe
+ */
+template<class NODE, typename TYPE = float>
+class HashGrid {
+public:
+	typedef typename std::vector<NODE> Contents;
+private:
+	typedef uint64_t CellKey;
+	typedef std::vector<int32_t> Cell;
+
+	struct Entry {
+		NODE item;
+		Rect<TYPE> rect;
+		CellKey cell;
+		// the index of the entry in its cell
+		int32_t cellIndex;
+		TYPE extent;
+	};
+
+	const TYPE _cellSize;
+	std::vector<Entry> _entries;
+	std::unordered_map<NODE, int32_t> _index;
+	std::unordered_map<CellKey, Cell> _cells;
+	// the amount of entries per extent - the largest one is removed again together with the last item of that size
+	std::map<TYPE, int32_t> _extents;
+	// the largest distance of a rect border to the center of the rect - the query area is extended by this
+	TYPE _maxExtent = TYPE(0);
+
+	inline int32_t cellCoord(TYPE value) const {
+		// clamped - the query area might be e.g. Rect::getMaxRect()
+		const double coord = std::floor((double)value / (double)_cellSize);
+		return (int32_t)glm::clamp(coord, (double)std::numeric_limits<int32_t>::min(), (double)std::numeric_limits<int32_t>::max());
+	}
+
+	static inline CellKey cellKey(int32_t x, int32_t z) {
+		return ((CellKey)(uint32_t)x << 32) | (CellKey)(uint32_t)z;
+	}
+
+	inline CellKey cellKey(const Rect<TYPE>& rect) const {
+		const glm::tvec2<TYPE>& center = rect.center();
+		return cellKey(cellCoord(center.x), cellCoord(center.y));
+	}
+
+	void addToCell(int32_t entryIndex) {
+		Entry& entry = _entries[entryIndex];
+		Cell& cell = _cells[entry.cell];
+		entry.cellIndex = (int32_t)cell.size();
+		cell.push_back(entryIndex);
+	}
+
+	void removeFromCell(int32_t entryIndex) {
+		const Entry& entry = _entries[entryIndex];
+		auto i = _cells.find(entry.cell);
+		core_assert(i != _cells.end());
+		Cell& cell = i->second;
+		const int32_t last = cell.back();
+		cell[entry.cellIndex] = last;
+		_entries[last].cellIndex = entry.cellIndex;
+		cell.pop_back();
+		if (cell.empty()) {
+			_cells.erase(i);
+		}
+	}
+
+	static inline TYPE extent(const Rect<TYPE>& rect) {
+		const glm::tvec2<TYPE>& size = rect.size();
+		return glm::max(size.x, size.y) / TYPE(2);
+	}
+
+	void addExtent(TYPE extent) {
+		++_extents[extent];
+		_maxExtent = glm::max(_maxExtent, extent);
+	}
+
+	void removeExtent(TYPE extent) {
+		auto i = _extents.find(extent);
+		core_assert(i != _extents.end());
+		if (--i->second > 0) {
+			return;
+		}
+		_extents.erase(i);
+		_maxExtent = _extents.empty() ? TYPE(0) : _extents.rbegin()->first;
+	}
+
+	inline void queryCell(const Cell& cell, const Rect<TYPE>& area, Contents& results) const {
+		for (int32_t entryIndex : cell) {
+			const Entry& entry = _entries[entryIndex];
+			if (area.intersectsWith(entry.rect)) {
+				results.push_back(entry.item);
+			}
+		}
+	}
+public:
+	explicit HashGrid(TYPE cellSize) :
+			_cellSize(cellSize) {
+		core_assert(cellSize > TYPE(0));
+	}
+
+	inline int count() const {
+		return (int)_entries.size();
+	}
+
+	/**
+	 * @return The largest distance of a rect border to the center of its rect of all items
+	 */
+	inline TYPE maxExtent() const {
+		return _maxExtent;
+	}
+
+	inline bool contains(const NODE& item) const {
+		return _index.find(item) != _index.end();
+	}
+
+	/**
+	 * @return @c false if the item is already part of the grid
+	 */
+	bool insert(const NODE& item, const Rect<TYPE>& rect) {
+		const int32_t entryIndex = (int32_t)_entries.size();
+		if (!_index.emplace(item, entryIndex).second) {
+			return false;
+		}
+		const TYPE rectExtent = extent(rect);
+		_entries.push_back(Entry { item, rect, cellKey(rect), -1, rectExtent });
+		addToCell(entryIndex);
+		addExtent(rectExtent);
+		return true;
+	}
+
+	/**
+	 * @brief Moves the item to the given rect
+	 * @return @c false if the item is not part of the grid
+	 */
+	bool update(const NODE& item, const Rect<TYPE>& rect) {
+		auto i = _index.find(item);
+		if (i == _index.end()) {
+			return false;
+		}
+		const int32_t entryIndex = i->second;
+		Entry& entry = _entries[entryIndex];
+		entry.rect = rect;
+		const TYPE rectExtent = extent(rect);
+		if (rectExtent != entry.extent) {
+			addExtent(rectExtent);
+			removeExtent(entry.extent);
+			entry.extent = rectExtent;
+		}
+		const CellKey cell = cellKey(rect);
+		if (cell == entry.cell) {
+			return true;
+		}
+		removeFromCell(entryIndex);
+		entry.cell = cell;
+		addToCell(entryIndex);
+		return true;
+	}
+
+	bool remove(const NODE& item) {
+		auto i = _index.find(item);
+		if (i == _index.end()) {
+			return false;
+		}
+		const int32_t entryIndex = i->second;
+		_index.erase(i);
+		removeFromCell(entryIndex);
+		removeExtent(_entries[entryIndex].extent);
+		const int32_t last = (int32_t)_entries.size() - 1;
+		if (entryIndex != last) {
+			// move the last entry into the gap and fix the references to it
+			Entry& moved = _entries[last];
+			_cells[moved.cell][moved.cellIndex] = entryIndex;
+			_index[moved.item] = entryIndex;
+			_entries[entryIndex] = std::move(moved);
+		}
+		_entries.pop_back();
+		return true;
+	}
+
+	void clear() {
+		_entries.clear();
+		_index.clear();
+		_cells.clear();
+		_extents.clear();
+		_maxExtent = TYPE(0);
+	}
+
+	/**
+	 * @brief Appends all items whose rect intersects with the given area to the results
+	 */
+	void query(const Rect<TYPE>& area, Contents& results) const {
+		core_trace_scoped(HashGridQuery);
+		if (_entries.empty()) {
+			return;
+		}
+		const int64_t minX = cellCoord(area.getMinX() - _maxExtent);
+		const int64_t maxX = cellCoord(area.getMaxX() + _maxExtent);
+		const int64_t minZ = cellCoord(area.getMinZ() - _maxExtent);
+		const int64_t maxZ = cellCoord(area.getMaxZ() + _maxExtent);
+		const uint64_t width = (uint64_t)(maxX - minX + 1);
+		const uint64_t depth = (uint64_t)(maxZ - minZ + 1);
+		const uint64_t occupiedCells = _cells.size();
+		if (width > occupiedCells || depth > occupiedCells || width * depth > occupiedCells) {
+			// the area is larger than the occupied part of the grid
+			for (const auto& e : _cells) {
+				queryCell(e.second, area, results);
+			}
+			return;
+		}
+		for (int64_t x = minX; x <= maxX; ++x) {
+			for (int64_t z = minZ; z <= maxZ; ++z) {
+				auto i = _cells.find(cellKey((int32_t)x, (int32_t)z));
+				if (i != _cells.end()) {
+					queryCell(i->second, area, results);
+				}
+			}
+		}
+	}
+};
+
+}
@@ -0,0 +1,78 @@
+/**
+ * @file
+ */
+
+#include "StageScheduler.h"
+#include "Assert.h"
+#include "Trace.h"
+#include <chrono>
+
+namespace core {
+
+StageScheduler::StageScheduler(size_t threads, const char* name) :
+		_threadPool(threads, name) {
+}
+
+StageScheduler::~StageScheduler() {
+	shutdown();
+}
+
+void StageScheduler::shutdown() {
+	_stopped = true;
+	_threadPool.shutdown(true);
+}
+
+StageScheduler::StageId StageScheduler::addStage(const std::string& name, const StageFunc& func, const std::vector<StageId>& dependencies) {
+	const StageId id = (StageId)_stages.size();
+	_stages.emplace_back(new Stage(name, func));
+	for (StageId dependency : dependencies) {
+		core_assert_msg(dependency >= 0 && dependency < id, "Stage %s depends on an unknown stage", name.c_str());
+		_stages[dependency]->dependents.push_back(id);
+		++_stages[id]->dependencies;
+	}
+	return id;
+}
+
+void StageScheduler::execute(StageId id, long dt) {
+	Stage& stage = *_stages[id];
+	{
+		core::TraceScoped trace(stage.name.c_str());
+		const auto start = std::chrono::steady_clock::now();
+		stage.func(dt);
+		stage.micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+	for (StageId dependentId : stage.dependents) {
+		Stage& dependent = *_stages[dependentId];
+		if (--dependent.pending == 0) {
+			_threadPool.enqueue([this, dependentId, dt] () {
+				execute(dependentId, dt);
+			});
+		}
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	++_finished;
+	_done.notify_one();
+}
+
+void StageScheduler::run(long dt) {
+	if (_stages.empty() || _stopped) {
+		return;
+	}
+	_finished = 0;
+	for (auto& stage : _stages) {
+		stage->pending = stage->dependencies;
+	}
+	for (StageId id = 0; id < (StageId)_stages.size(); ++id) {
+		if (_stages[id]->dependencies == 0) {
+			_threadPool.enqueue([this, id, dt] () {
+				execute(id, dt);
+			});
+		}
+	}
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done.wait(lock, [this] () {
+		return _finished == (int)_stages.size();
+	});
+}
+
+}
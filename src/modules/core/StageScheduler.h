@@ -0,0 +1,102 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "ThreadPool.h"
+#include "NonCopyable.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace core {
+
+/**
+ * @brief Executes the stages of a frame on a thread pool - every stage as soon as the stages it depends
+ * on are done. Stages that don't depend on each other run concurrently.
+ *
+ * @code
+ * StageScheduler scheduler(4, "frame");
+ * const StageScheduler::StageId input = scheduler.addStage("input", [] (long dt) { ... });
+ * scheduler.addStage("physics", [] (long dt) { ... }, {input});
+ * scheduler.addStage("sound", [] (long dt) { ... }, {input});
+ * scheduler.run(dt);
+ * @endcode
+ *
+ * @note The stages must be added before the first @c run() call. A stage can only depend on stages
+ * that were added before - so there are no cycles.
+ */
+class StageScheduler : public NonCopyable {
+public:
+	typedef std::function<void(long dt)> StageFunc;
+	typedef int StageId;
+private:
+	struct Stage {
+		std::string name;
+		StageFunc func;
+		std::vector<StageId> dependents;
+		int dependencies = 0;
+		// the amount of dependencies that are not yet done in the current run
+		std::atomic_int pending { 0 };
+		uint64_t micros = 0u;
+
+		Stage(const std::string& _name, const StageFunc& _func) :
+				name(_name), func(_func) {
+		}
+	};
+
+	ThreadPool _threadPool;
+	// pointers - the atomics can't be moved
+	std::vector<std::unique_ptr<Stage>> _stages;
+
+	std::mutex _mutex;
+	std::condition_variable _done;
+	int _finished = 0;
+	std::atomic_bool _stopped { false };
+
+	void execute(StageId id, long dt);
+public:
+	/**
+	 * @param[in] threads The amount of worker threads - the maximum amount of stages that run at
+	 * the same time.
+	 */
+	StageScheduler(size_t threads, const char* name = "stages");
+	~StageScheduler();
+
+	/**
+	 * @param[in] dependencies The stages that must be done before this stage is executed
+	 * @return The id of the new stage
+	 */
+	StageId addStage(const std::string& name, const StageFunc& func, const std::vector<StageId>& dependencies = {});
+
+	/**
+	 * @brief Executes all stages and waits until they are done
+	 * @note Doesn't do anything after @c shutdown() was called
+	 */
+	void run(long dt);
+
+	void shutdown();
+
+	inline size_t size() const {
+		return _stages.size();
+	}
+
+	/**
+	 * @brief Calls the given function with the name of every stage and its duration in the last
+	 * @c run() call in microseconds
+	 */
+	template<typename Func>
+	void visitTimings(Func&& func) const {
+		for (const auto& stage : _stages) {
+			func(stage->name, stage->micros);
+		}
+	}
+};
+
+}
@@ -44,14 +44,17 @@ ThreadPool::~ThreadPool() {
 }
 
 void ThreadPool::shutdown(bool wait) {
-	_stop = true;
-	if (!wait) {
+	{
 		std::unique_lock<std::mutex> lock(_queueMutex);
-		while (!_tasks.empty()) {
-			_tasks.pop();
+		_stop = true;
+		if (!wait) {
+			while (!_tasks.empty()) {
+				_tasks.pop();
+			}
 		}
-		_condition.notify_all();
 	}
+	// wake up the idle workers - they would wait forever otherwise
+	_condition.notify_all();
 	for (std::thread &worker : _workers) {
 		worker.join();
 	}
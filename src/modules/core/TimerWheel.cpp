@@ -0,0 +1,224 @@
+/**
+ * @file
+ */
+
+#include "TimerWheel.h"
+#include "core/Assert.h"
+#include <algorithm>
+
+namespace core {
+
+constexpr TimerWheel::TimerId TimerWheel::InvalidTimerId;
+constexpr int32_t TimerWheel::None;
+constexpr int32_t TimerWheel::DueSlot;
+
+TimerWheel::TimerWheel(uint32_t resolutionMillis) :
+		_resolutionMillis(std::max(1u, resolutionMillis)) {
+	std::fill(std::begin(_slots), std::end(_slots), None);
+	std::fill(std::begin(_levelTimers), std::end(_levelTimers), 0u);
+}
+
+void TimerWheel::link(int32_t index) {
+	Timer& timer = _timers[index];
+	uint64_t expireTick = std::max(timer.expireTick, _currentTick);
+	uint64_t delta = expireTick - _currentTick;
+	if (delta > MaxDelta) {
+		// park it in the highest level - it's inserted again once the wheel comes around
+		delta = MaxDelta;
+		expireTick = _currentTick + MaxDelta;
+	}
+	int level = 0;
+	while (level < Levels - 1 && delta >= (uint64_t(1) << (RootBits + level * LevelBits))) {
+		++level;
+	}
+	const int32_t slot = (int32_t)slotIndex(level, expireTick);
+	timer.slot = slot;
+	timer.prev = None;
+	timer.next = _slots[slot];
+	if (timer.next != None) {
+		_timers[timer.next].prev = index;
+	}
+	_slots[slot] = index;
+	++_levelTimers[level];
+}
+
+void TimerWheel::unlink(int32_t index) {
+	Timer& timer = _timers[index];
+	core_assert(timer.slot >= 0);
+	if (timer.prev != None) {
+		_timers[timer.prev].next = timer.next;
+	} else {
+		_slots[timer.slot] = timer.next;
+	}
+	if (timer.next != None) {
+		_timers[timer.next].prev = timer.prev;
+	}
+	--_levelTimers[slotLevel(timer.slot)];
+	timer.prev = timer.next = None;
+	timer.slot = None;
+}
+
+void TimerWheel::release(int32_t index) {
+	Timer& timer = _timers[index];
+	timer.callback = Callback();
+	timer.slot = None;
+	++timer.generation;
+	_freeTimers.push_back(index);
+}
+
+void TimerWheel::cascade(int level) {
+	const uint32_t slot = slotIndex(level, _currentTick);
+	int32_t index = _slots[slot];
+	_slots[slot] = None;
+	while (index != None) {
+		Timer& timer = _timers[index];
+		const int32_t next = timer.next;
+		timer.slot = None;
+		--_levelTimers[level];
+		link(index);
+		index = next;
+	}
+}
+
+void TimerWheel::advanceTo(uint64_t tick) {
+	while (_currentTick <= tick) {
+		int lowestLevel = 0;
+		while (lowestLevel < Levels && _levelTimers[lowestLevel] == 0u) {
+			++lowestLevel;
+		}
+		if (lowestLevel == Levels) {
+			// nothing left - the wheel can jump to the given tick
+			_currentTick = tick + 1u;
+			return;
+		}
+		if (lowestLevel > 0) {
+			// the lower levels are empty - nothing happens until the next slot of the lowest used level starts
+			const uint64_t granularity = uint64_t(1) << (RootBits + (lowestLevel - 1) * LevelBits);
+			const uint64_t next = (_currentTick + granularity - 1u) & ~(granularity - 1u);
+			if (next > tick) {
+				_currentTick = tick + 1u;
+				return;
+			}
+			_currentTick = next;
+		}
+
+		if ((_currentTick & RootMask) == 0u) {
+			for (int level = 1; level < Levels; ++level) {
+				cascade(level);
+				const int shift = RootBits + (level - 1) * LevelBits;
+				if (((_currentTick >> shift) & LevelMask) != 0u) {
+					break;
+				}
+			}
+		}
+
+		const uint32_t slot = slotIndex(0, _currentTick);
+		int32_t index = _slots[slot];
+		_slots[slot] = None;
+		while (index != None) {
+			Timer& timer = _timers[index];
+			const int32_t next = timer.next;
+			timer.prev = timer.next = None;
+			timer.slot = DueSlot;
+			--_levelTimers[0];
+			_dueTimers.push_back(toId(index, timer.generation));
+			index = next;
+		}
+		++_currentTick;
+	}
+}
+
+TimerWheel::TimerId TimerWheel::schedule(uint64_t expireMillis, const Callback& callback) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	int32_t index;
+	if (_freeTimers.empty()) {
+		index = (int32_t)_timers.size();
+		_timers.emplace_back();
+	} else {
+		index = _freeTimers.back();
+		_freeTimers.pop_back();
+	}
+	Timer& timer = _timers[index];
+	timer.expireTick = (expireMillis + _resolutionMillis - 1u) / _resolutionMillis;
+	timer.callback = callback;
+	if (timer.expireTick < _currentTick) {
+		// the wheel already passed this tick
+		timer.prev = timer.next = None;
+		timer.slot = DueSlot;
+		_dueTimers.push_back(toId(index, timer.generation));
+	} else {
+		link(index);
+	}
+	++_pending;
+	return toId(index, timer.generation);
+}
+
+bool TimerWheel::cancel(TimerId id) {
+	if (id == InvalidTimerId) {
+		return false;
+	}
+	const int32_t index = (int32_t)(id & 0xFFFFFFFFu) - 1;
+	const uint32_t generation = (uint32_t)(id >> 32);
+	std::unique_lock<std::mutex> lock(_mutex);
+	// the callback might cancel its own timer
+	_callbackDone.wait(lock, [&] () {
+		return _runningTimer != id || _runningThread == std::this_thread::get_id();
+	});
+	if (index < 0 || index >= (int32_t)_timers.size()) {
+		return false;
+	}
+	Timer& timer = _timers[index];
+	if (timer.generation != generation || timer.slot == None) {
+		return false;
+	}
+	if (timer.slot != DueSlot) {
+		unlink(index);
+	}
+	release(index);
+	--_pending;
+	return true;
+}
+
+size_t TimerWheel::update(uint64_t nowMillis) {
+	const uint64_t nowTick = nowMillis / _resolutionMillis;
+	std::unique_lock<std::mutex> lock(_mutex);
+	advanceTo(nowTick);
+	if (_dueTimers.empty()) {
+		return 0u;
+	}
+	std::vector<TimerId> due;
+	due.swap(_dueTimers);
+	size_t executed = 0u;
+	for (TimerId id : due) {
+		const int32_t index = (int32_t)(id & 0xFFFFFFFFu) - 1;
+		Timer& timer = _timers[index];
+		// might have been cancelled by one of the previous callbacks - and the timer reused
+		if (timer.slot != DueSlot || toId(index, timer.generation) != id) {
+			continue;
+		}
+		const Callback callback = std::move(timer.callback);
+		release(index);
+		--_pending;
+		++executed;
+		_runningTimer = id;
+		_runningThread = std::this_thread::get_id();
+		lock.unlock();
+		callback();
+		lock.lock();
+		_runningTimer = InvalidTimerId;
+		_callbackDone.notify_all();
+	}
+	due.clear();
+	if (_dueTimers.empty()) {
+		// keep the memory for the next update
+		_dueTimers.swap(due);
+	}
+	return executed;
+}
+
+size_t TimerWheel::pending() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _pending;
+}
+
+}
@@ -0,0 +1,142 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+/**
+ * @brief Hierarchical timing wheel that executes callbacks at given points in time.
+ *
+ * The time is split into ticks of a fixed resolution. The first level has one slot for each of the
+ * next 256 ticks, every further level has 64 slots that each cover a whole revolution of the level
+ * below. If the wheel passes a slot of a higher level, its timers are moved down into the slots of
+ * the lower levels. Scheduling and cancelling a timer is O(1), and @c update() only costs time for
+ * the timers that expire (plus the empty levels that are skipped as a whole).
+ *
+ * Timers that are further away than the range of the wheel (2^26 ticks) are parked in the highest
+ * level and re-inserted when they come around.
+ *
+ * @note Thread safe. The callbacks are executed without holding the lock - so they may schedule new
+ * timers or cancel other ones. Cancelling a timer whose callback is currently executed by another thread
+ * waits until the callback returned.
+ */
+class TimerWheel {
+public:
+	typedef uint64_t TimerId;
+	typedef std::function<void()> Callback;
+
+	static constexpr TimerId InvalidTimerId = 0u;
+
+private:
+	static constexpr int Levels = 4;
+	static constexpr int RootBits = 8;
+	static constexpr int LevelBits = 6;
+	static constexpr uint32_t RootSize = 1u << RootBits;
+	static constexpr uint32_t LevelSize = 1u << LevelBits;
+	static constexpr uint64_t RootMask = RootSize - 1u;
+	static constexpr uint64_t LevelMask = LevelSize - 1u;
+	static constexpr uint64_t MaxDelta = (uint64_t(1) << (RootBits + (Levels - 1) * LevelBits)) - 1u;
+	static constexpr uint32_t SlotCount = RootSize + (Levels - 1) * LevelSize;
+	static constexpr int32_t None = -1;
+	// the timer isn't in a slot but in the list of the timers that expire in the current update
+	static constexpr int32_t DueSlot = -2;
+
+	struct Timer {
+		uint64_t expireTick = 0u;
+		Callback callback;
+		uint32_t generation = 1u;
+		int32_t prev = None;
+		int32_t next = None;
+		// the slot of the timer - or None if the timer isn't used
+		int32_t slot = None;
+	};
+
+	std::mutex _mutex;
+	// the timer whose callback is currently executed by the thread that calls update()
+	TimerId _runningTimer = InvalidTimerId;
+	std::thread::id _runningThread;
+	std::condition_variable _callbackDone;
+	const uint32_t _resolutionMillis;
+	uint64_t _currentTick = 0u;
+	std::vector<Timer> _timers;
+	std::vector<int32_t> _freeTimers;
+	int32_t _slots[SlotCount];
+	size_t _levelTimers[Levels];
+	std::vector<TimerId> _dueTimers;
+	size_t _pending = 0u;
+
+	static inline uint32_t slotIndex(int level, uint64_t tick) {
+		if (level == 0) {
+			return (uint32_t)(tick & RootMask);
+		}
+		const int shift = RootBits + (level - 1) * LevelBits;
+		return RootSize + (level - 1) * LevelSize + (uint32_t)((tick >> shift) & LevelMask);
+	}
+
+	static inline int slotLevel(int32_t slot) {
+		if (slot < (int32_t)RootSize) {
+			return 0;
+		}
+		return 1 + (slot - (int32_t)RootSize) / (int32_t)LevelSize;
+	}
+
+	static inline TimerId toId(int32_t index, uint32_t generation) {
+		return ((TimerId)generation << 32) | (TimerId)(index + 1);
+	}
+
+	void link(int32_t index);
+	void unlink(int32_t index);
+	void release(int32_t index);
+	void cascade(int level);
+	void advanceTo(uint64_t tick);
+public:
+	/**
+	 * @param[in] resolutionMillis The length of one tick. Timers never expire before their time, but might
+	 * expire up to one tick later.
+	 */
+	explicit TimerWheel(uint32_t resolutionMillis = 10u);
+
+	/**
+	 * @brief Executes the callback in the first @c update() call that is at or after the given time
+	 * @param[in] expireMillis The absolute point in time - in the same time base as the @c update() calls.
+	 * A time in the past expires with the next @c update() call.
+	 * @return The id of the timer that can be used to cancel it - never @c InvalidTimerId
+	 */
+	TimerId schedule(uint64_t expireMillis, const Callback& callback);
+
+	/**
+	 * @return @c false if the timer already expired or was cancelled before
+	 * @note If the callback of the timer is just executed by another thread, this waits until it returned - so
+	 * the caller can release the resources the callback uses afterwards.
+	 */
+	bool cancel(TimerId id);
+
+	/**
+	 * @brief Executes the callbacks of all timers that expired until the given time
+	 * @return The amount of executed callbacks
+	 */
+	size_t update(uint64_t nowMillis);
+
+	/**
+	 * @return The amount of timers that didn't expire yet
+	 */
+	size_t pending();
+
+	inline uint32_t resolutionMillis() const {
+		return _resolutionMillis;
+	}
+};
+
+typedef std::shared_ptr<TimerWheel> TimerWheelPtr;
+
+}
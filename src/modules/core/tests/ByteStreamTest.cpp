@@ -74,6 +74,81 @@ TEST(ByteStreamTest, testFormat) {
 	ASSERT_EQ(12345678, size);
 }
 
+TEST(ByteStreamTest, testPrepend) {
+	ByteStream byteStream;
+	byteStream.addInt(42);
+	const int prepended = 10000;
+	for (int i = 0; i < prepended; ++i) {
+		byteStream.addShort((int16_t)i, true);
+	}
+	byteStream.addByte(1, true);
+	ASSERT_EQ(4u + prepended * 2u + 1u, byteStream.getSize());
+	ASSERT_EQ(1, byteStream.readByte());
+	for (int i = prepended - 1; i >= 0; --i) {
+		ASSERT_EQ((int16_t)i, byteStream.readShort());
+	}
+	// the space of the read bytes is reused for prepending
+	byteStream.addByte(2, true);
+	ASSERT_EQ(2, byteStream.readByte());
+	ASSERT_EQ(42, byteStream.readInt());
+	ASSERT_TRUE(byteStream.empty());
+}
+
+TEST(ByteStreamTest, testBytes) {
+	ByteStream byteStream;
+	const uint8_t data[] = {1, 2, 3, 4, 5};
+	byteStream.writeBytes(data, sizeof(data));
+	byteStream.addString("abc");
+	ASSERT_EQ(9u, byteStream.getSize());
+	uint8_t buf[3];
+	byteStream.readBytes(buf, sizeof(buf));
+	ASSERT_EQ(1, buf[0]);
+	ASSERT_EQ(3, buf[2]);
+	ASSERT_EQ(1284, byteStream.peekShort());
+	byteStream.readShort();
+	ASSERT_EQ("abc", byteStream.readString());
+	ASSERT_TRUE(byteStream.empty());
+	byteStream.clear();
+	byteStream.addByte(7);
+	ASSERT_EQ(7, byteStream.readByte());
+}
+
+TEST(ByteStreamTest, testView) {
+	ByteStream byteStream;
+	byteStream.addByte(0xFF);
+	byteStream.addShort(-2);
+	byteStream.addInt(-3);
+	byteStream.addLong(-4l);
+	byteStream.addFloat(0.5f);
+	byteStream.addByte(9);
+	byteStream.readByte();
+
+	ByteView view = byteStream.view();
+	ASSERT_EQ(byteStream.getBuffer(), view.data()) << "The view must not copy the data";
+	ASSERT_EQ(byteStream.getSize(), view.remaining());
+	int16_t word;
+	int32_t dword;
+	int64_t qword;
+	float value;
+	ASSERT_TRUE(view.readShort(word));
+	ASSERT_EQ(-2, word);
+	ASSERT_TRUE(view.readInt(dword));
+	ASSERT_EQ(-3, dword);
+	ASSERT_TRUE(view.readLong(qword));
+	ASSERT_EQ(-4l, qword);
+	ASSERT_TRUE(view.readFloat(value));
+	ASSERT_FLOAT_EQ(0.5f, value);
+	ASSERT_FALSE(view.readInt(dword)) << "Only one byte is left";
+	ASSERT_EQ(1u, view.remaining());
+	ASSERT_EQ(nullptr, view.readSpan(2));
+	const uint8_t* span = view.readSpan(1);
+	ASSERT_NE(nullptr, span);
+	ASSERT_EQ(9, *span);
+	uint8_t byte;
+	ASSERT_FALSE(view.readByte(byte));
+	ASSERT_TRUE(view.empty());
+}
+
 TEST(ByteStreamTest, testWriteByte) {
 	ByteStream byteStream;
 	const size_t previous = byteStream.getSize();
@@ -5,6 +5,8 @@
 #include "core/tests/AbstractTest.h"
 #include "core/ConcurrentQueue.h"
 #include <thread>
+#include <vector>
+#include <algorithm>
 
 namespace core {
 
@@ -25,6 +27,28 @@ TEST_F(ConcurrentQueueTest, testPushPop) {
 	}
 }
 
+TEST_F(ConcurrentQueueTest, testModify) {
+	core::ConcurrentQueue<int> queue;
+	for (int i = 0; i < 10; ++i) {
+		queue.push(i);
+	}
+	// invert the order and remove the odd values
+	queue.modify([] (std::vector<int>& data) {
+		data.erase(std::remove_if(data.begin(), data.end(), [] (int v) {
+			return v % 2 == 1;
+		}), data.end());
+		for (int& v : data) {
+			v = -v;
+		}
+	});
+	ASSERT_EQ(5u, queue.size());
+	for (int i = 0; i < 10; i += 2) {
+		int v;
+		ASSERT_TRUE(queue.pop(v));
+		ASSERT_EQ(-i, v);
+	}
+}
+
 TEST_F(ConcurrentQueueTest, testPushWaitAndPop) {
 	core::ConcurrentQueue<int> queue;
 	const int n = 1000;
@@ -83,4 +107,25 @@ TEST_F(ConcurrentQueueTest, testAbortWait) {
 	threadWait.join();
 }
 
+TEST_F(ConcurrentQueueTest, testAbortWaitMultipleConsumers) {
+	core::ConcurrentQueue<int> queue;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i) {
+		threads.emplace_back([&] () {
+			int v;
+			ASSERT_FALSE(queue.waitAndPop(v));
+		});
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	queue.abortWait();
+	for (std::thread& t : threads) {
+		t.join();
+	}
+	queue.reset();
+	queue.push(1);
+	int v;
+	ASSERT_TRUE(queue.waitAndPop(v));
+	ASSERT_EQ(1, v);
+}
+
 }
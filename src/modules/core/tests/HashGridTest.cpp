@@ -0,0 +1,117 @@
+/**
+ * @file
+ */
+
+#include <gtest/gtest.h>
+#include "core/HashGrid.h"
+#include <algorithm>
+#include <random>
+
+namespace core {
+
+TEST(HashGridTest, testInsertRemove) {
+	HashGrid<int> grid(10.0f);
+	EXPECT_EQ(0, grid.count());
+	EXPECT_TRUE(grid.insert(1, RectFloat(51.0f, 51.0f, 53.0f, 53.0f)));
+	EXPECT_FALSE(grid.insert(1, RectFloat(51.0f, 51.0f, 53.0f, 53.0f))) << "Inserted the same item twice";
+	EXPECT_TRUE(grid.insert(2, RectFloat(-15.0f, -15.0f, -13.0f, -13.0f)));
+	EXPECT_EQ(2, grid.count());
+	EXPECT_TRUE(grid.remove(1));
+	EXPECT_FALSE(grid.remove(1));
+	EXPECT_FALSE(grid.contains(1));
+	EXPECT_TRUE(grid.contains(2));
+	EXPECT_EQ(1, grid.count());
+}
+
+TEST(HashGridTest, testQuery) {
+	HashGrid<int> grid(10.0f);
+	grid.insert(1, RectFloat(51.0f, 51.0f, 53.0f, 53.0f));
+	grid.insert(2, RectFloat(-15.0f, -15.0f, -13.0f, -13.0f));
+	HashGrid<int>::Contents contents;
+	grid.query(RectFloat(40.0f, 40.0f, 60.0f, 60.0f), contents);
+	ASSERT_EQ(1u, contents.size());
+	EXPECT_EQ(1, contents[0]);
+	contents.clear();
+	grid.query(RectFloat::getMaxRect(), contents);
+	EXPECT_EQ(2u, contents.size());
+	contents.clear();
+	// only touches the rect of the item - but not the cell of its center
+	grid.query(RectFloat(52.5f, 0.0f, 60.0f, 51.5f), contents);
+	ASSERT_EQ(1u, contents.size());
+	EXPECT_EQ(1, contents[0]);
+}
+
+TEST(HashGridTest, testUpdate) {
+	HashGrid<int> grid(10.0f);
+	grid.insert(1, RectFloat(51.0f, 51.0f, 53.0f, 53.0f));
+	EXPECT_TRUE(grid.update(1, RectFloat(-51.0f, -51.0f, -49.0f, -49.0f)));
+	EXPECT_FALSE(grid.update(2, RectFloat(-51.0f, -51.0f, -49.0f, -49.0f))) << "Updated an unknown item";
+	HashGrid<int>::Contents contents;
+	grid.query(RectFloat(40.0f, 40.0f, 60.0f, 60.0f), contents);
+	EXPECT_TRUE(contents.empty()) << "The item is still found at its old position";
+	grid.query(RectFloat(-60.0f, -60.0f, -40.0f, -40.0f), contents);
+	ASSERT_EQ(1u, contents.size());
+	EXPECT_EQ(1, contents[0]);
+}
+
+/**
+ * @brief Moves a lot of items around and compares the query results with a brute force search
+ */
+TEST(HashGridTest, testRandomMovement) {
+	HashGrid<int> grid(16.0f);
+	std::mt19937 rnd(42);
+	std::uniform_real_distribution<float> coord(-200.0f, 200.0f);
+	const int amount = 500;
+	std::vector<RectFloat> rects(amount);
+	std::vector<bool> inserted(amount, false);
+	auto randomRect = [&] () {
+		const float x = coord(rnd);
+		const float z = coord(rnd);
+		return RectFloat(x - 1.0f, z - 1.0f, x + 1.0f, z + 1.0f);
+	};
+	for (int round = 0; round < 20; ++round) {
+		for (int i = 0; i < amount; ++i) {
+			const int action = rnd() % 10;
+			rects[i] = randomRect();
+			if (!inserted[i]) {
+				ASSERT_TRUE(grid.insert(i, rects[i]));
+				inserted[i] = true;
+			} else if (action == 0) {
+				ASSERT_TRUE(grid.remove(i));
+				inserted[i] = false;
+			} else {
+				ASSERT_TRUE(grid.update(i, rects[i]));
+			}
+		}
+		for (int q = 0; q < 20; ++q) {
+			const float x = coord(rnd);
+			const float z = coord(rnd);
+			const RectFloat area(x - 30.0f, z - 30.0f, x + 30.0f, z + 30.0f);
+			HashGrid<int>::Contents contents;
+			grid.query(area, contents);
+			std::sort(contents.begin(), contents.end());
+			HashGrid<int>::Contents expected;
+			for (int i = 0; i < amount; ++i) {
+				if (inserted[i] && area.intersectsWith(rects[i])) {
+					expected.push_back(i);
+				}
+			}
+			ASSERT_EQ(expected, contents);
+		}
+	}
+}
+
+TEST(HashGridTest, testMaxExtent) {
+	HashGrid<int> grid(10.0f);
+	ASSERT_TRUE(grid.insert(1, RectFloat(0.0f, 0.0f, 2.0f, 2.0f)));
+	ASSERT_TRUE(grid.insert(2, RectFloat(0.0f, 0.0f, 100.0f, 100.0f)));
+	EXPECT_FLOAT_EQ(50.0f, grid.maxExtent());
+	ASSERT_TRUE(grid.update(2, RectFloat(0.0f, 0.0f, 4.0f, 4.0f)));
+	EXPECT_FLOAT_EQ(2.0f, grid.maxExtent()) << "The extent must shrink again with the large rect";
+	ASSERT_TRUE(grid.remove(2));
+	EXPECT_FLOAT_EQ(1.0f, grid.maxExtent());
+	ASSERT_TRUE(grid.remove(1));
+	EXPECT_FLOAT_EQ(0.0f, grid.maxExtent());
+}
+
+}
@@ -0,0 +1,118 @@
+/**
+ * @file
+ */
+
+#include "AbstractTest.h"
+#include "core/StageScheduler.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+class StageSchedulerTest: public AbstractTest {
+protected:
+	std::mutex _mutex;
+	std::vector<std::string> _order;
+
+	StageScheduler::StageFunc record(const std::string& name) {
+		return [this, name] (long dt) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_order.push_back(name);
+		};
+	}
+
+	int position(const std::string& name) const {
+		for (size_t i = 0; i < _order.size(); ++i) {
+			if (_order[i] == name) {
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+};
+
+TEST_F(StageSchedulerTest, testDependencies) {
+	StageScheduler scheduler(4);
+	const StageScheduler::StageId network = scheduler.addStage("network", record("network"));
+	const StageScheduler::StageId poi = scheduler.addStage("poi", record("poi"), {network});
+	const StageScheduler::StageId zone = scheduler.addStage("zone", record("zone"), {network});
+	const StageScheduler::StageId ai = scheduler.addStage("ai", record("ai"), {zone});
+	const StageScheduler::StageId spawn = scheduler.addStage("spawn", record("spawn"), {zone});
+	scheduler.addStage("entities", record("entities"), {ai, spawn, poi});
+	ASSERT_EQ(6u, scheduler.size());
+	scheduler.run(10L);
+	ASSERT_EQ(6u, _order.size());
+	EXPECT_EQ(0, position("network"));
+	EXPECT_LT(position("zone"), position("ai"));
+	EXPECT_LT(position("zone"), position("spawn"));
+	EXPECT_EQ(5, position("entities"));
+}
+
+TEST_F(StageSchedulerTest, testConcurrentStages) {
+	StageScheduler scheduler(2);
+	std::atomic_int arrived(0);
+	std::atomic_bool met(true);
+	// both stages wait for each other - this only finishes if they run at the same time
+	auto barrier = [&] (long dt) {
+		++arrived;
+		const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (arrived < 2) {
+			if (std::chrono::steady_clock::now() > timeout) {
+				met = false;
+				return;
+			}
+			std::this_thread::yield();
+		}
+	};
+	scheduler.addStage("a", barrier);
+	scheduler.addStage("b", barrier);
+	scheduler.run(10L);
+	EXPECT_TRUE(met) << "Independent stages should be executed concurrently";
+}
+
+TEST_F(StageSchedulerTest, testMultipleRuns) {
+	StageScheduler scheduler(3);
+	std::atomic_int count(0);
+	long lastDt = 0L;
+	const StageScheduler::StageId first = scheduler.addStage("first", [&] (long dt) {
+		++count;
+	});
+	scheduler.addStage("second", [&] (long dt) {
+		++count;
+	}, {first});
+	scheduler.addStage("third", [&] (long dt) {
+		++count;
+		lastDt = dt;
+	}, {first});
+	for (int i = 1; i <= 100; ++i) {
+		scheduler.run((long)i);
+		ASSERT_EQ(i * 3, count) << "Not all stages were executed in run " << i;
+	}
+	EXPECT_EQ(100L, lastDt);
+	scheduler.shutdown();
+	scheduler.run(1L);
+	EXPECT_EQ(300, count) << "No stages should be executed after the shutdown";
+}
+
+TEST_F(StageSchedulerTest, testTimings) {
+	StageScheduler scheduler(2);
+	scheduler.addStage("sleep", [] (long dt) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	});
+	scheduler.addStage("noop", [] (long dt) {
+	});
+	scheduler.run(10L);
+	std::map<std::string, uint64_t> timings;
+	scheduler.visitTimings([&] (const std::string& name, uint64_t micros) {
+		timings[name] = micros;
+	});
+	ASSERT_EQ(2u, timings.size());
+	EXPECT_GE(timings["sleep"], 5000u);
+	EXPECT_LT(timings["noop"], timings["sleep"]);
+}
+
+}
@@ -0,0 +1,164 @@
+/**
+ * @file
+ */
+
+#include "AbstractTest.h"
+#include "core/TimerWheel.h"
+#include <random>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace core {
+
+class TimerWheelTest: public AbstractTest {
+};
+
+TEST_F(TimerWheelTest, testExpire) {
+	TimerWheel wheel(1u);
+	int executed = 0;
+	wheel.schedule(100u, [&] () { ++executed; });
+	EXPECT_EQ(1u, wheel.pending());
+	EXPECT_EQ(0u, wheel.update(99u));
+	EXPECT_EQ(0, executed);
+	EXPECT_EQ(1u, wheel.update(100u));
+	EXPECT_EQ(1, executed);
+	EXPECT_EQ(0u, wheel.update(1000u));
+	EXPECT_EQ(1, executed);
+	EXPECT_EQ(0u, wheel.pending());
+}
+
+TEST_F(TimerWheelTest, testResolution) {
+	TimerWheel wheel(10u);
+	int executed = 0;
+	wheel.schedule(105u, [&] () { ++executed; });
+	EXPECT_EQ(0u, wheel.update(105u)) << "A timer must never expire before its time";
+	EXPECT_EQ(1u, wheel.update(110u));
+	EXPECT_EQ(1, executed);
+}
+
+TEST_F(TimerWheelTest, testCancel) {
+	TimerWheel wheel(1u);
+	int executed = 0;
+	const TimerWheel::TimerId id = wheel.schedule(100u, [&] () { ++executed; });
+	wheel.schedule(200u, [&] () { ++executed; });
+	EXPECT_TRUE(wheel.cancel(id));
+	EXPECT_FALSE(wheel.cancel(id)) << "Cancelled a timer twice";
+	EXPECT_FALSE(wheel.cancel(TimerWheel::InvalidTimerId));
+	EXPECT_EQ(1u, wheel.update(1000u));
+	EXPECT_EQ(1, executed);
+	EXPECT_FALSE(wheel.cancel(id));
+}
+
+TEST_F(TimerWheelTest, testPastTimer) {
+	TimerWheel wheel(1u);
+	wheel.update(1000u);
+	int executed = 0;
+	wheel.schedule(10u, [&] () { ++executed; });
+	EXPECT_EQ(1u, wheel.update(1000u)) << "A timer in the past should expire with the next update";
+	EXPECT_EQ(1, executed);
+}
+
+TEST_F(TimerWheelTest, testCallbacks) {
+	TimerWheel wheel(1u);
+	int executed = 0;
+	int rescheduled = 0;
+	TimerWheel::TimerId ids[2];
+	for (int i = 0; i < 2; ++i) {
+		// both expire in the same update - the one that is executed first cancels the other one
+		ids[i] = wheel.schedule(10u, [&, i] () {
+			++executed;
+			EXPECT_TRUE(wheel.cancel(ids[1 - i]));
+			// expires with the next update - not with this one
+			wheel.schedule(10u, [&] () { ++rescheduled; });
+		});
+	}
+	EXPECT_EQ(1u, wheel.update(10u));
+	EXPECT_EQ(1, executed);
+	EXPECT_EQ(0, rescheduled);
+	EXPECT_EQ(1u, wheel.update(11u));
+	EXPECT_EQ(1, executed);
+	EXPECT_EQ(1, rescheduled);
+	EXPECT_EQ(0u, wheel.pending());
+}
+
+TEST_F(TimerWheelTest, testLargeTimeBase) {
+	TimerWheel wheel(1u);
+	// e.g. the unix time in millis - the wheel starts at 0
+	const uint64_t now = 1500000000000u;
+	int executed = 0;
+	wheel.schedule(now + 1000u, [&] () { ++executed; });
+	EXPECT_EQ(0u, wheel.update(now));
+	EXPECT_EQ(0, executed);
+	EXPECT_EQ(1u, wheel.update(now + 1000u));
+	EXPECT_EQ(1, executed);
+}
+
+/**
+ * @brief Compares the wheel with the expected expire times of a lot of timers on all levels - and
+ * beyond the range of the wheel
+ */
+TEST_F(TimerWheelTest, testLevels) {
+	TimerWheel wheel(1u);
+	std::mt19937 rnd(42);
+	const int amount = 5000;
+	std::vector<uint64_t> expireTimes(amount);
+	std::vector<uint64_t> executedAt(amount, 0u);
+	uint64_t now = 0u;
+	std::uniform_int_distribution<int> bits(0, 30);
+	for (int i = 0; i < amount; ++i) {
+		const uint64_t delay = std::uniform_int_distribution<uint64_t>(0u, uint64_t(1) << bits(rnd))(rnd);
+		expireTimes[i] = delay;
+		wheel.schedule(delay, [&, i] () {
+			EXPECT_EQ(0u, executedAt[i]) << "Timer " << i << " was executed twice";
+			executedAt[i] = now;
+		});
+	}
+	size_t executed = 0u;
+	while (executed < (size_t)amount) {
+		const uint64_t previous = now;
+		now += std::uniform_int_distribution<uint64_t>(1u, uint64_t(1) << bits(rnd))(rnd);
+		executed += wheel.update(now);
+		for (int i = 0; i < amount; ++i) {
+			if (expireTimes[i] <= previous || expireTimes[i] > now) {
+				continue;
+			}
+			ASSERT_EQ(now, executedAt[i]) << "Timer " << i << " with expire time " << expireTimes[i]
+					<< " was not executed in the update for " << now;
+		}
+	}
+	EXPECT_EQ(0u, wheel.pending());
+}
+
+TEST_F(TimerWheelTest, testCancelWaitsForCallback) {
+	TimerWheel wheel(1u);
+	std::atomic_bool started(false);
+	std::atomic_bool finished(false);
+	const TimerWheel::TimerId id = wheel.schedule(1u, [&] () {
+		started = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		finished = true;
+	});
+	std::thread updater([&] () {
+		wheel.update(1u);
+	});
+	while (!started) {
+		std::this_thread::yield();
+	}
+	EXPECT_FALSE(wheel.cancel(id)) << "The timer already expired";
+	EXPECT_TRUE(finished) << "Cancelling a running timer must wait for its callback";
+	updater.join();
+}
+
+TEST_F(TimerWheelTest, testCancelInOwnCallback) {
+	TimerWheel wheel(1u);
+	TimerWheel::TimerId id = TimerWheel::InvalidTimerId;
+	bool cancelled = true;
+	id = wheel.schedule(1u, [&] () {
+		cancelled = wheel.cancel(id);
+	});
+	EXPECT_EQ(1u, wheel.update(1u));
+	EXPECT_FALSE(cancelled);
+}
+
+}
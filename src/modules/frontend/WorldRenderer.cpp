@@ -907,13 +907,15 @@ void WorldRenderer::onRunning(const video::Camera& camera, long dt) {
 	_now += dt;
 	_deltaFrame = dt;
 
-	_world->updateExtractionOrder(camera.position(), camera.frustum());
+	const glm::ivec3 cameraPos(camera.position() / glm::vec3(_worldScale));
+	// the world works in voxel space - thus we need a frustum that includes the world scale
+	core::Frustum worldFrustum;
+	worldFrustum.updatePlanes(camera.viewMatrix() * glm::scale(glm::vec3(_worldScale)), camera.projectionMatrix());
+	_world->updateExtractionOrder(cameraPos, worldFrustum, _maxAllowedDistance);
 
 	const bool shadowMap = _shadowMap->boolVal();
 	_shadow.calculateShadowData(camera, shadowMap, _maxDepthBuffers, _depthBuffer.dimension());
 
-	const glm::ivec3 cameraPos(camera.position() / glm::vec3(_worldScale));
-
 	for (ChunkBuffer& chunkBuffer : _chunkBuffers) {
 		if (!chunkBuffer.inuse) {
 			continue;
@@ -6,20 +6,109 @@
 #include <SDL_stdinc.h>
 #include "io/File.h"
 #include "core/Assert.h"
+#include "core/Log.h"
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 namespace io {
 
-FileStream::FileStream(File* file) :
-		FileStream(file->_file) {
+constexpr int64_t FileStream::BufferSize;
+
+FileStream::FileStream(File* file, FileStreamMode mode) :
+		FileStream(file->_file, mode) {
+	if (mode == FileStreamMode::Mapped && map(file->_rawPath)) {
+		_mode = FileStreamMode::Mapped;
+	}
 }
 
-FileStream::FileStream(SDL_RWops* rwops) :
-		_rwops(rwops) {
+FileStream::FileStream(SDL_RWops* rwops, FileStreamMode mode) :
+		_rwops(rwops), _mode(mode == FileStreamMode::Mapped ? FileStreamMode::Buffered : mode) {
 	core_assert(rwops != nullptr);
 	_size = SDL_RWsize(_rwops);
 }
 
 FileStream::~FileStream() {
+	unmap();
+}
+
+bool FileStream::map(const std::string& path) {
+#ifndef _WIN32
+	if (_size <= 0) {
+		return false;
+	}
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		Log::debug("Could not open %s for mapping it", path.c_str());
+		return false;
+	}
+	void *mapping = mmap(nullptr, (size_t)_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED) {
+		Log::debug("Could not map %s", path.c_str());
+		return false;
+	}
+	madvise(mapping, (size_t)_size, MADV_SEQUENTIAL);
+	_mapping = mapping;
+	_view = (const uint8_t*)mapping;
+	_viewStart = 0;
+	_viewLength = _size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FileStream::unmap() {
+	if (_mapping == nullptr) {
+		return;
+	}
+#ifndef _WIN32
+	munmap(_mapping, (size_t)_viewLength);
+#endif
+	_mapping = nullptr;
+	_view = nullptr;
+	_viewLength = 0;
+}
+
+const uint8_t* FileStream::view(int64_t length) const {
+	if (length > remaining()) {
+		return nullptr;
+	}
+	if (_pos >= _viewStart && _pos + length <= _viewStart + _viewLength) {
+		return _view + (_pos - _viewStart);
+	}
+	if (_mapping != nullptr) {
+		return nullptr;
+	}
+	// refill the buffer starting at the current position
+	const int64_t fillLength = std::min(std::max(length, BufferSize), _size - _pos);
+	if ((int64_t)_buffer.size() < fillLength) {
+		_buffer.resize(fillLength);
+	}
+	_view = nullptr;
+	_viewLength = 0;
+	if (SDL_RWseek(_rwops, _pos, RW_SEEK_SET) < 0) {
+		return nullptr;
+	}
+	int64_t completeBytesRead = 0;
+	while (completeBytesRead < fillLength) {
+		const size_t bytesRead = SDL_RWread(_rwops, _buffer.data() + completeBytesRead, 1, fillLength - completeBytesRead);
+		if (bytesRead == 0) {
+			break;
+		}
+		completeBytesRead += bytesRead;
+	}
+	_view = _buffer.data();
+	_viewStart = _pos;
+	_viewLength = completeBytesRead;
+	if (completeBytesRead < length) {
+		return nullptr;
+	}
+	return _view;
 }
 
 int FileStream::peekInt(uint32_t& val) const {
@@ -130,17 +219,7 @@ bool FileStream::readFormat(const char *fmt, ...) {
 }
 
 bool FileStream::readString(int length, char *strbuff) {
-	for (int i = 0; i < length; ++i) {
-		if (_pos >= _size) {
-			return false;
-		}
-		uint8_t chr;
-		if (readByte(chr) != 0) {
-			return false;
-		}
-		strbuff[i] = chr;
-	}
-	return true;
+	return readBuf((uint8_t*)strbuff, length) == 0;
 }
 
 int FileStream::readByte(uint8_t& val) {
@@ -184,10 +263,33 @@ int FileStream::readInt(uint32_t& val) {
 }
 
 int FileStream::readBuf(uint8_t *buf, size_t bufSize) {
-	for (size_t i = 0; i < bufSize; ++i) {
-		if (readByte(buf[i]) == -1) {
+	if (remaining() < (int64_t)bufSize) {
+		return -1;
+	}
+	if (_mode == FileStreamMode::Direct) {
+		SDL_RWseek(_rwops, _pos, RW_SEEK_SET);
+		size_t completeBytesRead = 0;
+		while (completeBytesRead < bufSize) {
+			const size_t bytesRead = SDL_RWread(_rwops, buf + completeBytesRead, 1, bufSize - completeBytesRead);
+			if (bytesRead == 0) {
+				return -1;
+			}
+			completeBytesRead += bytesRead;
+		}
+		_pos += bufSize;
+		return 0;
+	}
+	while (bufSize > 0) {
+		// chunks - the buffer doesn't grow beyond its size
+		const int64_t length = std::min((int64_t)bufSize, BufferSize);
+		const uint8_t *data = view(length);
+		if (data == nullptr) {
 			return -1;
 		}
+		memcpy(buf, data, length);
+		buf += length;
+		bufSize -= length;
+		_pos += length;
 	}
 	return 0;
 }
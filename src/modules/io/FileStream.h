@@ -8,28 +8,73 @@
 #include <cstddef>
 #include <string>
 #include <cstdarg>
+#include <cstring>
+#include <vector>
 #include <SDL_endian.h>
 #include "core/Common.h"
+#include "core/Assert.h"
+#include "core/NonCopyable.h"
 #include <climits>
 
 namespace io {
 
 class File;
 
+/**
+ * @brief The way the @c FileStream accesses the file
+ */
+enum class FileStreamMode {
+	/** every value is read from or written to the file */
+	Direct,
+	/** read only - the values are decoded from a buffer that is refilled with chunks of the file */
+	Buffered,
+	/** read only - the values are decoded from the file that is mapped into memory */
+	Mapped
+};
+
 /**
  * @brief Little endian file stream
  */
-class FileStream {
+class FileStream : public core::NonCopyable {
+public:
+	static constexpr int64_t BufferSize = 64 * 1024;
 private:
 	int64_t _pos = 0;
 	int64_t _size = 0;
 	mutable SDL_RWops *_rwops;
+	FileStreamMode _mode;
+
+	// the contiguous data of the file for the buffered and the mapped mode - starting at _viewStart
+	mutable const uint8_t *_view = nullptr;
+	mutable int64_t _viewStart = 0;
+	mutable int64_t _viewLength = 0;
+	mutable std::vector<uint8_t> _buffer;
+	void *_mapping = nullptr;
+
+	bool map(const std::string& path);
+	void unmap();
+	/**
+	 * @return Pointer to the given amount of bytes at the current position - or @c nullptr if the
+	 * stream doesn't have that many bytes left
+	 */
+	const uint8_t* view(int64_t length) const;
 
 public:
-	FileStream(File* file);
-	FileStream(SDL_RWops* rwops);
+	/**
+	 * @note The @c FileStreamMode::Mapped mode falls back to @c FileStreamMode::Buffered if the file can't
+	 * be mapped.
+	 */
+	FileStream(File* file, FileStreamMode mode = FileStreamMode::Direct);
+	/**
+	 * @note The @c FileStreamMode::Mapped mode is not supported here - @c FileStreamMode::Buffered is used
+	 */
+	FileStream(SDL_RWops* rwops, FileStreamMode mode = FileStreamMode::Direct);
 	virtual ~FileStream();
 
+	inline FileStreamMode mode() const {
+		return _mode;
+	}
+
 	inline int64_t remaining() const {
 		return _size - _pos;
 	}
@@ -54,6 +99,14 @@ public:
 		if (remaining() < (int64_t)bufSize) {
 			return -1;
 		}
+		if (_mode != FileStreamMode::Direct) {
+			const uint8_t *data = view(bufSize);
+			if (data == nullptr) {
+				return -1;
+			}
+			memcpy(&val, data, bufSize);
+			return 0;
+		}
 		uint8_t buf[bufSize];
 		SDL_RWseek(_rwops, _pos, RW_SEEK_SET);
 		uint8_t *b = buf;
@@ -75,6 +128,10 @@ public:
 
 	template<class Type>
 	inline bool write(Type val) {
+		core_assert_msg(_mode == FileStreamMode::Direct, "Writing is only supported for direct streams");
+		if (_mode != FileStreamMode::Direct) {
+			return false;
+		}
 		SDL_RWseek(_rwops, _pos, RW_SEEK_SET);
 		const size_t bufSize = sizeof(Type);
 		uint8_t buf[bufSize];
@@ -53,4 +53,44 @@ TEST_F(FileStreamTest, testFileStreamWrite) {
 	EXPECT_TRUE(file->exists());
 }
 
+TEST_F(FileStreamTest, testReadModes) {
+	// more than one buffer - so the buffered stream must refill
+	const uint32_t values = (uint32_t)(FileStream::BufferSize / sizeof(uint32_t)) * 2 + 3;
+	{
+		const FilePtr& file = _testApp->filesystem()->open("filestream-modetest", io::FileMode::Write);
+		FileStream stream(file.get());
+		for (uint32_t i = 0; i < values; ++i) {
+			ASSERT_TRUE(stream.addInt(i));
+		}
+		ASSERT_TRUE(stream.addShort(42));
+	}
+	for (FileStreamMode mode : {FileStreamMode::Direct, FileStreamMode::Buffered, FileStreamMode::Mapped}) {
+		const FilePtr& file = _testApp->filesystem()->open("filestream-modetest");
+		FileStream stream(file.get(), mode);
+		EXPECT_EQ(mode, stream.mode()) << "Mode " << (int)mode;
+		ASSERT_EQ((int64_t)(values * sizeof(uint32_t) + sizeof(uint16_t)), stream.size());
+		// a read that crosses the end of the buffer
+		uint8_t byte;
+		ASSERT_EQ(0, stream.readByte(byte));
+		EXPECT_EQ(0, byte);
+		ASSERT_EQ(3, stream.skip(2));
+		uint8_t buf[FileStream::BufferSize + 5];
+		ASSERT_EQ(0, stream.readBuf(buf, sizeof(buf)));
+		EXPECT_EQ(1, buf[1]) << "Mode " << (int)mode;
+		ASSERT_EQ(0, stream.seek(4));
+		for (uint32_t i = 1; i < values; ++i) {
+			uint32_t val;
+			ASSERT_EQ(0, stream.readInt(val)) << "Mode " << (int)mode;
+			ASSERT_EQ(i, val) << "Mode " << (int)mode;
+		}
+		uint32_t val;
+		EXPECT_EQ(-1, stream.peekInt(val)) << "Only a short is left";
+		uint16_t shortVal;
+		ASSERT_EQ(0, stream.readShort(shortVal));
+		EXPECT_EQ(42, shortVal);
+		EXPECT_EQ(-1, stream.readByte(byte));
+		EXPECT_EQ(0, stream.remaining());
+	}
+}
+
 }
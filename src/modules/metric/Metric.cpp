@@ -25,7 +25,7 @@ void Metric::shutdown() {
 	_messageSender->shutdown();
 }
 
-bool Metric::createTags(char* buffer, size_t len, const TagMap& tags, const char* sep, const char* preamble, const char *split) const {
+bool Metric::createTags(char* buffer, size_t len, const TagMap& tags, const char* sep, const char* preamble, const char *split) {
 	if (tags.empty()) {
 		return true;
 	}
@@ -60,31 +60,42 @@ bool Metric::createTags(char* buffer, size_t len, const TagMap& tags, const char
 	return true;
 }
 
-bool Metric::assemble(const char* key, int value, const char* type, const TagMap& tags) const {
-	constexpr int metricSize = 256;
-	char buffer[metricSize];
+int Metric::format(char *buffer, size_t len, const std::string& prefix, Flavor flavor, const char* key, int value, const char* type, const TagMap& tags, float sampleRate) {
 	constexpr int tagsSize = 256;
-	char tagsBuffer[tagsSize];
+	char tagsBuffer[tagsSize] = "";
+	char sampleRateBuffer[32] = "";
+	if (sampleRate < 1.0f) {
+		snprintf(sampleRateBuffer, sizeof(sampleRateBuffer), "|@%g", sampleRate);
+	}
 	int written;
-	switch (_flavor) {
+	switch (flavor) {
 	case Flavor::Etsy:
-		written = snprintf(buffer, sizeof(buffer), "%s%s:%i|%s", _prefix.c_str(), key, value, type);
+		written = snprintf(buffer, len, "%s%s:%i|%s%s", prefix.c_str(), key, value, type, sampleRateBuffer);
 		break;
 	case Flavor::Datadog:
 		if (!createTags(tagsBuffer, sizeof(tagsBuffer), tags, ":", "|#", ",")) {
-			return false;
+			return -1;
 		}
-		written = snprintf(buffer, sizeof(buffer), "%s%s:%i|%s%s", _prefix.c_str(), key, value, type, tagsBuffer);
+		written = snprintf(buffer, len, "%s%s:%i|%s%s%s", prefix.c_str(), key, value, type, sampleRateBuffer, tagsBuffer);
 		break;
 	case Flavor::Telegraf:
 	default:
 		if (!createTags(tagsBuffer, sizeof(tagsBuffer), tags, "=", ",", ",")) {
-			return false;
+			return -1;
 		}
-		written = snprintf(buffer, sizeof(buffer), "%s%s%s:%i|%s", _prefix.c_str(), key, tagsBuffer, value, type);
+		written = snprintf(buffer, len, "%s%s%s:%i|%s%s", prefix.c_str(), key, tagsBuffer, value, type, sampleRateBuffer);
 		break;
 	}
-	if (written >= metricSize) {
+	if (written < 0 || written >= (int)len) {
+		return -1;
+	}
+	return written;
+}
+
+bool Metric::assemble(const char* key, int value, const char* type, const TagMap& tags) const {
+	constexpr int metricSize = 256;
+	char buffer[metricSize];
+	if (format(buffer, sizeof(buffer), _prefix, _flavor, key, value, type, tags) < 0) {
 		return false;
 	}
 	return _messageSender->send(buffer);
@@ -34,9 +34,19 @@ private:
 	 * @param[in] split The separator between key/value pairs
 	 * @return @c false if not all tags could get written into the specified target buffer, @c true otherwise
 	 */
-	bool createTags(char *buffer, size_t len, const TagMap& tags, const char* sep, const char* preamble, const char *split = ",") const;
+	static bool createTags(char *buffer, size_t len, const TagMap& tags, const char* sep, const char* preamble, const char *split = ",");
 	bool assemble(const char* key, int value, const char* type, const TagMap& tags = {}) const;
 public:
+	/**
+	 * @brief Writes a single metric line in the format of the given flavor
+	 * @param[out] buffer The buffer to write the metric line into
+	 * @param[in] len The size of the target buffer
+	 * @param[in] type The statsd type of the metric - e.g. @c c or @c ms
+	 * @param[in] sampleRate Only written if it's less than @c 1.0 - e.g. @c |@0.1
+	 * @return The length of the metric line or @c -1 if it doesn't fit into the target buffer
+	 */
+	static int format(char *buffer, size_t len, const std::string& prefix, Flavor flavor, const char* key, int value, const char* type, const TagMap& tags = {}, float sampleRate = 1.0f);
+
 	Metric(const IMetricSenderPtr& messageSender,
 			const std::string& prefix,
 			Flavor flavor = Flavor::Telegraf);
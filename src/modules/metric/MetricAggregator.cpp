@@ -0,0 +1,337 @@
+/**
+ * @file
+ */
+
+#include "MetricAggregator.h"
+#include "core/Log.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace metric {
+
+constexpr size_t MetricAggregator::DefaultMaxDatagramSize;
+constexpr size_t MetricAggregator::MaxSamples;
+
+static std::atomic<uint64_t> aggregatorIds { 0u };
+
+/**
+ * @brief splitmix64 - cheap enough for the recording thread
+ */
+static inline uint64_t nextRandom(uint64_t& state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+/**
+ * @brief The buffers of the aggregators a thread has recorded metrics for. The aggregators own the
+ * buffers - they are marked as orphaned when the thread exits, so the aggregator can drop them.
+ */
+struct ThreadBuffers {
+	struct Entry {
+		std::weak_ptr<MetricAggregator::ThreadBuffer> owner;
+		// only used while the aggregator is alive - which is the case as long as it records metrics
+		MetricAggregator::ThreadBuffer* buffer;
+	};
+	std::unordered_map<uint64_t, Entry> entries;
+
+	~ThreadBuffers() {
+		for (auto& e : entries) {
+			const MetricAggregator::ThreadBufferPtr& buffer = e.second.owner.lock();
+			if (!buffer) {
+				continue;
+			}
+			std::lock_guard<std::mutex> lock(buffer->mutex);
+			buffer->orphaned = true;
+		}
+	}
+
+	/**
+	 * @brief Removes the entries of the aggregators that were destroyed
+	 */
+	void prune() {
+		for (auto i = entries.begin(); i != entries.end();) {
+			if (i->second.owner.expired()) {
+				i = entries.erase(i);
+			} else {
+				++i;
+			}
+		}
+	}
+};
+
+static const char* typeName(int type) {
+	static const char* names[] = { "c", "g", "ms", "h", "m" };
+	return names[type];
+}
+
+MetricAggregator::MetricAggregator(const IMetricSenderPtr& messageSender, const std::string& prefix, Flavor flavor,
+		uint32_t flushIntervalMillis, size_t maxDatagramSize) :
+		_prefix(prefix), _flavor(flavor), _messageSender(messageSender), _flushIntervalMillis(flushIntervalMillis),
+		_maxDatagramSize(maxDatagramSize), _id(++aggregatorIds) {
+}
+
+MetricAggregator::~MetricAggregator() {
+	shutdown();
+}
+
+bool MetricAggregator::init() {
+	if (!_messageSender->init()) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(_threadMutex);
+	if (_running) {
+		return true;
+	}
+	_running = true;
+	_thread = std::thread(&MetricAggregator::run, this);
+	return true;
+}
+
+void MetricAggregator::shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(_threadMutex);
+		if (!_running) {
+			return;
+		}
+		_running = false;
+	}
+	_wakeup.notify_all();
+	_thread.join();
+	flush();
+	_messageSender->shutdown();
+}
+
+void MetricAggregator::run() {
+	std::unique_lock<std::mutex> lock(_threadMutex);
+	while (_running) {
+		_wakeup.wait_for(lock, std::chrono::milliseconds(_flushIntervalMillis), [this] () {
+			return !_running;
+		});
+		if (!_running) {
+			break;
+		}
+		lock.unlock();
+		flush();
+		lock.lock();
+	}
+}
+
+MetricAggregator::ThreadBuffer& MetricAggregator::threadBuffer() {
+	thread_local ThreadBuffers buffers;
+	auto i = buffers.entries.find(_id);
+	if (i != buffers.entries.end()) {
+		return *i->second.buffer;
+	}
+	buffers.prune();
+	const ThreadBufferPtr& buffer = std::make_shared<ThreadBuffer>();
+	buffer->random = _id ^ (uint64_t)(uintptr_t)buffer.get();
+	{
+		std::lock_guard<std::mutex> lock(_buffersMutex);
+		_buffers.push_back(buffer);
+	}
+	buffers.entries.emplace(_id, ThreadBuffers::Entry{buffer, buffer.get()});
+	return *buffer;
+}
+
+bool MetricAggregator::record(Type type, const char* key, int32_t value, const TagMap& tags) {
+	ThreadBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	std::string& lookupKey = buffer.lookupKey;
+	lookupKey.assign(1, (char)type);
+	lookupKey.append(key);
+	for (const auto& tag : tags) {
+		lookupKey.append(1, '\0');
+		lookupKey.append(tag.first);
+		lookupKey.append(1, '\0');
+		lookupKey.append(tag.second);
+	}
+	auto i = buffer.aggregates.find(lookupKey);
+	if (i == buffer.aggregates.end()) {
+		i = buffer.aggregates.emplace(lookupKey, Aggregate()).first;
+		Aggregate& aggregate = i->second;
+		aggregate.type = type;
+		aggregate.key = key;
+		aggregate.tags = tags;
+	}
+	Aggregate& aggregate = i->second;
+	switch (type) {
+	case Type::Count:
+	case Type::Meter:
+		aggregate.value += value;
+		break;
+	case Type::Gauge:
+		aggregate.value = value;
+		aggregate.sequence = ++_sequence;
+		break;
+	case Type::Timing:
+	case Type::Histogram:
+		// reservoir sampling - every recorded value ends up in the sample with the same probability
+		++aggregate.recorded;
+		if (aggregate.samples.size() < MaxSamples) {
+			aggregate.samples.push_back(value);
+		} else {
+			const uint64_t index = nextRandom(buffer.random) % aggregate.recorded;
+			if (index < MaxSamples) {
+				aggregate.samples[index] = value;
+			}
+		}
+		break;
+	}
+	return true;
+}
+
+void MetricAggregator::mergeSamples(Aggregate& target, Aggregate& other) {
+	if (target.samples.size() + other.samples.size() <= MaxSamples) {
+		// nothing was dropped yet
+		target.samples.insert(target.samples.end(), other.samples.begin(), other.samples.end());
+		target.recorded += other.recorded;
+		return;
+	}
+	// draw from both samples - weighted by the amount of values they stand for
+	std::vector<int32_t> merged;
+	merged.reserve(MaxSamples);
+	uint64_t targetRemaining = target.recorded;
+	uint64_t otherRemaining = other.recorded;
+	while (merged.size() < MaxSamples && (!target.samples.empty() || !other.samples.empty())) {
+		bool fromTarget = nextRandom(_random) % (targetRemaining + otherRemaining) < targetRemaining;
+		if (target.samples.empty()) {
+			fromTarget = false;
+		} else if (other.samples.empty()) {
+			fromTarget = true;
+		}
+		std::vector<int32_t>& source = fromTarget ? target.samples : other.samples;
+		const size_t index = nextRandom(_random) % source.size();
+		merged.push_back(source[index]);
+		source[index] = source.back();
+		source.pop_back();
+		uint64_t& remaining = fromTarget ? targetRemaining : otherRemaining;
+		if (remaining > 1u) {
+			--remaining;
+		}
+	}
+	target.samples.swap(merged);
+	target.recorded += other.recorded;
+}
+
+void MetricAggregator::collect(Aggregates& target) {
+	std::vector<ThreadBufferPtr> buffers;
+	{
+		std::lock_guard<std::mutex> lock(_buffersMutex);
+		buffers = _buffers;
+	}
+	Aggregates aggregates;
+	bool orphaned = false;
+	for (const ThreadBufferPtr& buffer : buffers) {
+		{
+			std::lock_guard<std::mutex> lock(buffer->mutex);
+			orphaned |= buffer->orphaned;
+			if (buffer->aggregates.empty()) {
+				continue;
+			}
+			aggregates.swap(buffer->aggregates);
+		}
+		for (auto& e : aggregates) {
+			auto i = target.find(e.first);
+			if (i == target.end()) {
+				target.emplace(e.first, std::move(e.second));
+				continue;
+			}
+			Aggregate& existing = i->second;
+			Aggregate& other = e.second;
+			switch (existing.type) {
+			case Type::Count:
+			case Type::Meter:
+				existing.value += other.value;
+				break;
+			case Type::Gauge:
+				if (other.sequence > existing.sequence) {
+					existing.value = other.value;
+					existing.sequence = other.sequence;
+				}
+				break;
+			case Type::Timing:
+			case Type::Histogram:
+				mergeSamples(existing, other);
+				break;
+			}
+		}
+		aggregates.clear();
+	}
+	if (!orphaned) {
+		return;
+	}
+	// the threads of these buffers exited - their values were collected above
+	std::lock_guard<std::mutex> lock(_buffersMutex);
+	_buffers.erase(std::remove_if(_buffers.begin(), _buffers.end(), [] (const ThreadBufferPtr& buffer) {
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+		return buffer->orphaned && buffer->aggregates.empty();
+	}), _buffers.end());
+}
+
+bool MetricAggregator::send(const Aggregates& aggregates) {
+	constexpr int metricSize = 256;
+	char line[metricSize];
+	std::string datagram;
+	datagram.reserve(_maxDatagramSize);
+	bool success = true;
+
+	auto add = [&] (const Aggregate& aggregate, int32_t value, float sampleRate) {
+		const int len = Metric::format(line, sizeof(line), _prefix, _flavor, aggregate.key.c_str(), value,
+				typeName((int)aggregate.type), aggregate.tags, sampleRate);
+		if (len < 0) {
+			Log::debug("Metric %s doesn't fit into the line buffer", aggregate.key.c_str());
+			success = false;
+			return;
+		}
+		if (!datagram.empty() && datagram.size() + 1u + (size_t)len > _maxDatagramSize) {
+			success &= _messageSender->send(datagram.c_str());
+			datagram.clear();
+		}
+		if (!datagram.empty()) {
+			datagram.append(1, '\n');
+		}
+		datagram.append(line, len);
+	};
+
+	for (const auto& e : aggregates) {
+		const Aggregate& aggregate = e.second;
+		switch (aggregate.type) {
+		case Type::Count:
+		case Type::Meter:
+		case Type::Gauge: {
+			const int64_t value = std::max((int64_t)std::numeric_limits<int32_t>::min(),
+					std::min(aggregate.value, (int64_t)std::numeric_limits<int32_t>::max()));
+			add(aggregate, (int32_t)value, 1.0f);
+			break;
+		}
+		case Type::Timing:
+		case Type::Histogram: {
+			const float sampleRate = (float)aggregate.samples.size() / (float)aggregate.recorded;
+			for (int32_t sample : aggregate.samples) {
+				add(aggregate, sample, sampleRate);
+			}
+			break;
+		}
+		}
+	}
+	if (!datagram.empty()) {
+		success &= _messageSender->send(datagram.c_str());
+	}
+	return success;
+}
+
+bool MetricAggregator::flush() {
+	// the background thread and the caller of shutdown might flush at the same time
+	std::lock_guard<std::mutex> lock(_flushMutex);
+	Aggregates aggregates;
+	collect(aggregates);
+	if (aggregates.empty()) {
+		return true;
+	}
+	return send(aggregates);
+}
+
+}
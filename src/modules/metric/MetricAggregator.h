@@ -0,0 +1,167 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "Metric.h"
+#include "IMetricSender.h"
+#include "core/NonCopyable.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace metric {
+
+/**
+ * @brief Aggregates the metrics in memory and sends them on an interval from a background thread.
+ *
+ * Counters and meters are summed up, for gauges only the last value is sent. Timings and histograms
+ * keep a uniform random sample of at most @c MaxSamples values per flush interval - they are sent
+ * with their sample rate, so the statsd server still calculates the percentiles and the counts.
+ * Each thread records into its own buffer - the only lock that is taken on the recording thread is
+ * the one of this buffer, which is only contended while the flush thread picks up the values (see
+ * the metric benchmarks). The buffer of a thread is dropped after the thread exited and its values
+ * were sent.
+ *
+ * The metric lines are packed into multi-line datagrams that don't exceed the given size - the
+ * default fits into an ethernet frame.
+ *
+ * @note Has the same api as @c Metric - but the return value only indicates whether the metric
+ * could get recorded, not whether it was sent.
+ */
+class MetricAggregator : public core::NonCopyable {
+public:
+	static constexpr size_t DefaultMaxDatagramSize = 1432u;
+	static constexpr size_t MaxSamples = 64u;
+private:
+	enum class Type : uint8_t {
+		Count, Gauge, Timing, Histogram, Meter
+	};
+
+	struct Aggregate {
+		Type type;
+		std::string key;
+		TagMap tags;
+		// sum for counters and meters, last value for gauges
+		int64_t value = 0;
+		// the global sequence number of the last gauge value - to find the latest value of all threads
+		uint64_t sequence = 0u;
+		// timings and histograms - the amount of recorded values and a uniform sample of them
+		uint64_t recorded = 0u;
+		std::vector<int32_t> samples;
+	};
+	typedef std::unordered_map<std::string, Aggregate> Aggregates;
+
+	struct ThreadBuffer {
+		std::mutex mutex;
+		Aggregates aggregates;
+		std::string lookupKey;
+		// for the reservoir sampling of the timings and histograms
+		uint64_t random = 0u;
+		// the thread exited - the buffer is dropped with the next flush
+		bool orphaned = false;
+	};
+	typedef std::shared_ptr<ThreadBuffer> ThreadBufferPtr;
+	friend struct ThreadBuffers;
+
+	const std::string _prefix;
+	const Flavor _flavor;
+	const IMetricSenderPtr _messageSender;
+	const uint32_t _flushIntervalMillis;
+	const size_t _maxDatagramSize;
+	// to find the thread buffers in the thread local storage - the address might get reused
+	const uint64_t _id;
+
+	std::mutex _buffersMutex;
+	std::vector<ThreadBufferPtr> _buffers;
+	std::atomic<uint64_t> _sequence { 0u };
+	// for merging the samples - only used while holding the flush mutex
+	uint64_t _random = 0u;
+
+	std::mutex _flushMutex;
+	std::thread _thread;
+	std::mutex _threadMutex;
+	std::condition_variable _wakeup;
+	bool _running = false;
+
+	ThreadBuffer& threadBuffer();
+	bool record(Type type, const char* key, int32_t value, const TagMap& tags);
+	/**
+	 * @brief Merges the samples of @c other into @c target - @c other is empty afterwards
+	 */
+	void mergeSamples(Aggregate& target, Aggregate& other);
+	void collect(Aggregates& target);
+	bool send(const Aggregates& aggregates);
+	void run();
+public:
+	/**
+	 * @param[in] flushIntervalMillis The interval in which the background thread sends the metrics
+	 * @param[in] maxDatagramSize The maximum size of a datagram - multiple metric lines are packed into one.
+	 */
+	MetricAggregator(const IMetricSenderPtr& messageSender,
+			const std::string& prefix,
+			Flavor flavor = Flavor::Telegraf,
+			uint32_t flushIntervalMillis = 1000u,
+			size_t maxDatagramSize = DefaultMaxDatagramSize);
+	~MetricAggregator();
+
+	/**
+	 * @brief Initializes the sender and starts the flush thread
+	 */
+	bool init();
+	/**
+	 * @brief Stops the flush thread and sends the remaining metrics
+	 */
+	void shutdown();
+
+	/**
+	 * @brief Sends all the metrics that were recorded since the last flush
+	 * @return @c false if not all datagrams could get sent
+	 */
+	bool flush();
+
+	bool increment(const char* key, const TagMap& tags = {});
+	bool decrement(const char* key, const TagMap& tags = {});
+	bool count(const char* key, int delta, const TagMap& tags = {});
+	bool gauge(const char* key, uint32_t value, const TagMap& tags = {});
+	bool timing(const char* key, uint32_t millis, const TagMap& tags = {});
+	bool histogram(const char* key, uint32_t millis, const TagMap& tags = {});
+	bool meter(const char* key, int value, const TagMap& tags = {});
+};
+
+inline bool MetricAggregator::increment(const char* key, const TagMap& tags) {
+	return count(key, 1, tags);
+}
+
+inline bool MetricAggregator::decrement(const char* key, const TagMap& tags) {
+	return count(key, -1, tags);
+}
+
+inline bool MetricAggregator::count(const char* key, int delta, const TagMap& tags) {
+	return record(Type::Count, key, delta, tags);
+}
+
+inline bool MetricAggregator::gauge(const char* key, uint32_t value, const TagMap& tags) {
+	return record(Type::Gauge, key, (int32_t)value, tags);
+}
+
+inline bool MetricAggregator::timing(const char* key, uint32_t millis, const TagMap& tags) {
+	return record(Type::Timing, key, (int32_t)millis, tags);
+}
+
+inline bool MetricAggregator::histogram(const char* key, uint32_t millis, const TagMap& tags) {
+	return record(Type::Histogram, key, (int32_t)millis, tags);
+}
+
+inline bool MetricAggregator::meter(const char* key, int value, const TagMap& tags) {
+	return record(Type::Meter, key, value, tags);
+}
+
+}
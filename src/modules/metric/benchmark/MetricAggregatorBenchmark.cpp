@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+#include "metric/MetricAggregator.h"
+
+namespace {
+
+class NullMetricSender: public metric::IMetricSender {
+public:
+	bool send(const char* buffer) const override {
+		benchmark::DoNotOptimize(buffer);
+		return true;
+	}
+};
+
+/**
+ * Flushes every millisecond - much more often than in production, to make the contention between
+ * the recording threads and the flush thread visible
+ */
+metric::MetricAggregator benchmarkAggregator(std::make_shared<NullMetricSender>(), "benchmark.", metric::Flavor::Telegraf, 1u);
+
+}
+
+/**
+ * The time per recorded metric should not grow with the amount of threads - every thread records
+ * into its own buffer
+ */
+static void aggregatorRecord(benchmark::State& state) {
+	if (state.thread_index == 0) {
+		benchmarkAggregator.init();
+	}
+	const metric::TagMap tags {{"zone", "1"}};
+	uint32_t n = 0u;
+	while (state.KeepRunning()) {
+		benchmarkAggregator.increment("count", tags);
+		benchmarkAggregator.timing("timing", ++n % 100u, tags);
+	}
+	if (state.thread_index == 0) {
+		benchmarkAggregator.shutdown();
+	}
+	state.SetItemsProcessed(state.iterations() * 2);
+}
+
+BENCHMARK(aggregatorRecord)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN()
@@ -0,0 +1,253 @@
+/**
+ * @file
+ */
+
+#include "core/tests/AbstractTest.h"
+#include "metric/MetricAggregator.h"
+#include "metric/UDPMetricSender.h"
+#include "core/String.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+
+namespace metric {
+
+#define PREFIX "test."
+
+/**
+ * @brief Receives the datagrams of the aggregator on a local udp socket
+ */
+class MetricAggregatorTest: public core::AbstractTest {
+private:
+	using Super = core::AbstractTest;
+protected:
+	int _socket = -1;
+	uint16_t _port = 0u;
+
+	void SetUp() override {
+		Super::SetUp();
+		_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		ASSERT_NE(-1, _socket);
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		ASSERT_EQ(0, bind(_socket, (struct sockaddr*)&addr, sizeof(addr)));
+		socklen_t len = sizeof(addr);
+		ASSERT_EQ(0, getsockname(_socket, (struct sockaddr*)&addr, &len));
+		_port = ntohs(addr.sin_port);
+		// the whole send buffer of a flush must fit into the receive buffer
+		const int bufferSize = 4 * 1024 * 1024;
+		setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+		setTimeout(200);
+	}
+
+	void TearDown() override {
+		close(_socket);
+		Super::TearDown();
+	}
+
+	void setTimeout(int millis) {
+		struct timeval tv;
+		tv.tv_sec = millis / 1000;
+		tv.tv_usec = (millis % 1000) * 1000;
+		setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	}
+
+	std::shared_ptr<MetricAggregator> create(Flavor flavor, uint32_t flushIntervalMillis = 60000u,
+			size_t maxDatagramSize = MetricAggregator::DefaultMaxDatagramSize) {
+		return std::make_shared<MetricAggregator>(std::make_shared<UDPMetricSender>(_port), PREFIX, flavor,
+				flushIntervalMillis, maxDatagramSize);
+	}
+
+	/**
+	 * @brief Receives datagrams until the timeout is hit
+	 */
+	std::vector<std::string> receive() {
+		std::vector<std::string> datagrams;
+		char buffer[65536];
+		for (;;) {
+			const ssize_t len = recv(_socket, buffer, sizeof(buffer), 0);
+			if (len <= 0) {
+				break;
+			}
+			datagrams.emplace_back(buffer, len);
+		}
+		return datagrams;
+	}
+
+	static std::vector<std::string> lines(const std::vector<std::string>& datagrams) {
+		std::vector<std::string> result;
+		for (const std::string& datagram : datagrams) {
+			std::vector<std::string> tokens;
+			core::string::splitString(datagram, tokens, "\n");
+			result.insert(result.end(), tokens.begin(), tokens.end());
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+};
+
+TEST_F(MetricAggregatorTest, testAggregate) {
+	const int threads = 4;
+	const int increments = 1000;
+	auto aggregator = create(Flavor::Etsy);
+	ASSERT_TRUE(aggregator->init());
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; ++i) {
+		workers.emplace_back([&aggregator] () {
+			for (int n = 0; n < increments; ++n) {
+				aggregator->increment("count");
+				aggregator->meter("meter", 2);
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	aggregator->gauge("gauge", 1);
+	aggregator->gauge("gauge", 42);
+	aggregator->timing("timing", 3);
+	aggregator->timing("timing", 5);
+	ASSERT_TRUE(aggregator->flush());
+
+	const std::vector<std::string>& datagrams = receive();
+	ASSERT_EQ(1u, datagrams.size()) << "All metrics should fit into one datagram";
+	const std::vector<std::string> expected {
+		PREFIX "count:4000|c",
+		PREFIX "gauge:42|g",
+		PREFIX "meter:8000|m",
+		PREFIX "timing:3|ms",
+		PREFIX "timing:5|ms"
+	};
+	ASSERT_EQ(expected, lines(datagrams));
+
+	ASSERT_TRUE(aggregator->flush());
+	EXPECT_TRUE(receive().empty()) << "Nothing was recorded since the last flush";
+	aggregator->shutdown();
+}
+
+TEST_F(MetricAggregatorTest, testSampledTimings) {
+	const int threads = 4;
+	const int timings = 1000;
+	auto aggregator = create(Flavor::Etsy);
+	ASSERT_TRUE(aggregator->init());
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; ++i) {
+		workers.emplace_back([&aggregator] () {
+			for (int n = 0; n < timings; ++n) {
+				aggregator->timing("timing", n);
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	ASSERT_TRUE(aggregator->flush());
+
+	const std::vector<std::string>& received = lines(receive());
+	ASSERT_EQ(MetricAggregator::MaxSamples, received.size()) << "Only a sample of the timings should be sent";
+	const std::string sampleRate = core::string::format("|ms|@%g", (float)MetricAggregator::MaxSamples / (float)(threads * timings));
+	for (const std::string& line : received) {
+		ASSERT_EQ(0u, line.find(PREFIX "timing:")) << line;
+		const size_t pos = line.size() - sampleRate.size();
+		EXPECT_EQ(sampleRate, line.substr(pos)) << line;
+		const size_t start = strlen(PREFIX "timing:");
+		const int value = core::string::toInt(line.substr(start, pos - start));
+		EXPECT_GE(value, 0);
+		EXPECT_LT(value, timings);
+	}
+	aggregator->shutdown();
+}
+
+TEST_F(MetricAggregatorTest, testExitedThread) {
+	auto aggregator = create(Flavor::Etsy);
+	ASSERT_TRUE(aggregator->init());
+	for (int i = 0; i < 2; ++i) {
+		std::thread worker([&aggregator] () {
+			aggregator->increment("count");
+		});
+		worker.join();
+		ASSERT_TRUE(aggregator->flush());
+		const std::vector<std::string> expected { PREFIX "count:1|c" };
+		EXPECT_EQ(expected, lines(receive())) << "The metrics of an exited thread must still be sent";
+	}
+	aggregator->shutdown();
+}
+
+TEST_F(MetricAggregatorTest, testDatagramSize) {
+	const size_t maxDatagramSize = 512u;
+	const int keys = 200;
+	auto aggregator = create(Flavor::Etsy, 60000u, maxDatagramSize);
+	ASSERT_TRUE(aggregator->init());
+	for (int i = 0; i < keys; ++i) {
+		aggregator->increment(core::string::format("key%03i", i).c_str());
+	}
+	ASSERT_TRUE(aggregator->flush());
+	const std::vector<std::string>& datagrams = receive();
+	ASSERT_GT(datagrams.size(), 1u);
+	EXPECT_LT(datagrams.size(), (size_t)keys / 10) << "The metrics should be packed into a few datagrams";
+	for (const std::string& datagram : datagrams) {
+		EXPECT_LE(datagram.size(), maxDatagramSize);
+	}
+	const std::vector<std::string>& received = lines(datagrams);
+	ASSERT_EQ((size_t)keys, received.size());
+	for (int i = 0; i < keys; ++i) {
+		EXPECT_EQ(core::string::format(PREFIX "key%03i:1|c", i), received[i]);
+	}
+	aggregator->shutdown();
+}
+
+TEST_F(MetricAggregatorTest, testTags) {
+	const TagMap tags1 {{"key1", "value1"}};
+	const TagMap tags2 {{"key1", "value2"}};
+	auto telegraf = create(Flavor::Telegraf);
+	ASSERT_TRUE(telegraf->init());
+	telegraf->count("test", 1, tags1);
+	telegraf->count("test", 2, tags1);
+	telegraf->count("test", 5, tags2);
+	ASSERT_TRUE(telegraf->flush());
+	const std::vector<std::string> expectedTelegraf {
+		PREFIX "test,key1=value1:3|c",
+		PREFIX "test,key1=value2:5|c"
+	};
+	ASSERT_EQ(expectedTelegraf, lines(receive())) << "Different tags must be aggregated separately";
+	telegraf->shutdown();
+
+	auto datadog = create(Flavor::Datadog);
+	ASSERT_TRUE(datadog->init());
+	datadog->count("test", 1, tags1);
+	datadog->count("test", 2, tags1);
+	ASSERT_TRUE(datadog->flush());
+	const std::vector<std::string> expectedDatadog {
+		PREFIX "test:3|c|#key1:value1"
+	};
+	ASSERT_EQ(expectedDatadog, lines(receive()));
+	datadog->shutdown();
+}
+
+TEST_F(MetricAggregatorTest, testBackgroundFlush) {
+	auto aggregator = create(Flavor::Etsy, 10u);
+	ASSERT_TRUE(aggregator->init());
+	aggregator->increment("count");
+	setTimeout(5000);
+	char buffer[1024];
+	const ssize_t len = recv(_socket, buffer, sizeof(buffer), 0);
+	ASSERT_GT(len, 0) << "The flush thread didn't send the metrics";
+	EXPECT_EQ(PREFIX "count:1|c", std::string(buffer, len));
+
+	// the remaining metrics are sent on shutdown
+	aggregator->increment("shutdown");
+	aggregator->shutdown();
+	setTimeout(200);
+	const std::vector<std::string> expected { PREFIX "shutdown:1|c" };
+	EXPECT_EQ(expected, lines(receive()));
+}
+
+}
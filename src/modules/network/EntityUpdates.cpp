@@ -0,0 +1,112 @@
+/**
+ * @file
+ */
+
+#include "EntityUpdates.h"
+#include "core/Log.h"
+#include <cmath>
+#include <limits>
+
+namespace network {
+
+constexpr float EntityQuantizer::PositionScale;
+constexpr uint32_t EntitySnapshots::Size;
+
+static inline int32_t quantizeCoord(float value) {
+	const double scaled = std::round((double)value * EntityQuantizer::PositionScale);
+	return (int32_t)glm::clamp(scaled, (double)std::numeric_limits<int32_t>::min(), (double)std::numeric_limits<int32_t>::max());
+}
+
+QuantizedEntity EntityQuantizer::quantize(const glm::vec3& pos, float rotation) {
+	QuantizedEntity entity;
+	entity.x = quantizeCoord(pos.x);
+	entity.y = quantizeCoord(pos.y);
+	entity.z = quantizeCoord(pos.z);
+	float turns = std::fmod(rotation / glm::two_pi<float>(), 1.0f);
+	if (turns < 0.0f) {
+		turns += 1.0f;
+	}
+	entity.rotation = (uint16_t)((uint32_t)std::lround(turns * 65536.0f) & 0xFFFFu);
+	return entity;
+}
+
+glm::vec3 EntityQuantizer::position(const QuantizedEntity& entity) {
+	return glm::vec3(entity.x, entity.y, entity.z) / PositionScale;
+}
+
+float EntityQuantizer::rotation(const QuantizedEntity& entity) {
+	return (float)entity.rotation / 65536.0f * glm::two_pi<float>();
+}
+
+const EntitySnapshot* EntitySnapshots::get(uint32_t sequence) const {
+	if (sequence == 0u) {
+		return nullptr;
+	}
+	const Slot& slot = _slots[sequence % Size];
+	if (slot.sequence != sequence) {
+		return nullptr;
+	}
+	return &slot.entities;
+}
+
+void EntitySnapshots::put(uint32_t sequence, EntitySnapshot& snapshot) {
+	Slot& slot = _slots[sequence % Size];
+	slot.sequence = sequence;
+	slot.entities.swap(snapshot);
+	snapshot.clear();
+}
+
+void EntitySnapshots::clear() {
+	for (Slot& slot : _slots) {
+		slot.sequence = 0u;
+		slot.entities.clear();
+	}
+}
+
+bool EntityUpdatesDecoder::decode(const EntityUpdates* message, const Callback& callback) {
+	const uint32_t baselineSequence = message->baseline();
+	const EntitySnapshot* baseline = _snapshots.get(baselineSequence);
+	if (baselineSequence != 0u && baseline == nullptr) {
+		Log::debug("The baseline %u of the entity updates %u is not available", baselineSequence, message->sequence());
+		return false;
+	}
+	if (baseline != nullptr) {
+		_snapshot = *baseline;
+	} else {
+		_snapshot.clear();
+	}
+	if (const auto* removed = message->removed()) {
+		for (int64_t id : *removed) {
+			_snapshot.erase(id);
+		}
+	}
+	if (const auto* deltas = message->deltas()) {
+		for (const EntityDelta* delta : *deltas) {
+			auto i = _snapshot.find(delta->id());
+			if (i == _snapshot.end()) {
+				Log::warn("Entity %li is not part of the baseline %u", (long)delta->id(), baselineSequence);
+				return false;
+			}
+			QuantizedEntity& entity = i->second;
+			entity.x += delta->dx();
+			entity.y += delta->dy();
+			entity.z += delta->dz();
+			entity.rotation = delta->rotation();
+			callback(delta->id(), EntityQuantizer::position(entity), EntityQuantizer::rotation(entity));
+		}
+	}
+	if (const auto* states = message->states()) {
+		for (const EntityState* state : *states) {
+			QuantizedEntity& entity = _snapshot[state->id()];
+			entity.x = state->x();
+			entity.y = state->y();
+			entity.z = state->z();
+			entity.rotation = state->rotation();
+			callback(state->id(), EntityQuantizer::position(entity), EntityQuantizer::rotation(entity));
+		}
+	}
+	_snapshots.put(message->sequence(), _snapshot);
+	return true;
+}
+
+}
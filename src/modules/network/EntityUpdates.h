@@ -0,0 +1,105 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "ServerMessages_generated.h"
+#include "core/GLM.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace network {
+
+/**
+ * @brief The state of an entity as it is transferred in the @c EntityUpdates message
+ */
+struct QuantizedEntity {
+	int32_t x = 0;
+	int32_t y = 0;
+	int32_t z = 0;
+	uint16_t rotation = 0u;
+
+	inline bool operator==(const QuantizedEntity& rhs) const {
+		return x == rhs.x && y == rhs.y && z == rhs.z && rotation == rhs.rotation;
+	}
+
+	inline bool operator!=(const QuantizedEntity& rhs) const {
+		return !(*this == rhs);
+	}
+};
+
+/**
+ * @brief Converts between the entity positions and rotations and their fixed point representation.
+ *
+ * The positions have a precision of 1/32 of a voxel, the rotation is stored in 1/65536 of a full turn.
+ */
+class EntityQuantizer {
+public:
+	static constexpr float PositionScale = 32.0f;
+
+	static QuantizedEntity quantize(const glm::vec3& pos, float rotation);
+	static glm::vec3 position(const QuantizedEntity& entity);
+	/**
+	 * @return The rotation in radians - in the range [0, 2pi)
+	 */
+	static float rotation(const QuantizedEntity& entity);
+};
+
+/**
+ * @brief The states of all entities that were part of the updates for one peer
+ */
+typedef std::unordered_map<int64_t, QuantizedEntity> EntitySnapshot;
+
+/**
+ * @brief Keeps the snapshots of the last sequences - the deltas of the @c EntityUpdates message are
+ * relative to one of them.
+ */
+class EntitySnapshots {
+public:
+	static constexpr uint32_t Size = 32u;
+private:
+	struct Slot {
+		uint32_t sequence = 0u;
+		EntitySnapshot entities;
+	};
+	std::array<Slot, Size> _slots;
+public:
+	/**
+	 * @return @c nullptr for the sequence @c 0 or if the snapshot is no longer available
+	 */
+	const EntitySnapshot* get(uint32_t sequence) const;
+
+	/**
+	 * @brief Stores the snapshot for the given sequence - replaces the oldest one.
+	 * @param[in,out] snapshot Receives the replaced snapshot - cleared, but with its memory.
+	 */
+	void put(uint32_t sequence, EntitySnapshot& snapshot);
+
+	void clear();
+};
+
+/**
+ * @brief Restores the entity states from the @c EntityUpdates messages of the server.
+ *
+ * The received states are stored for each sequence - the server uses the acked sequences as
+ * baseline for the deltas.
+ */
+class EntityUpdatesDecoder {
+private:
+	EntitySnapshots _snapshots;
+	EntitySnapshot _snapshot;
+public:
+	typedef std::function<void(int64_t id, const glm::vec3& pos, float rotation)> Callback;
+
+	/**
+	 * @brief Calls the callback for every entity that changed
+	 * @return @c false if the baseline of the message is unknown - the message should not be acked in
+	 * this case.
+	 */
+	bool decode(const EntityUpdates* message, const Callback& callback);
+};
+
+}
@@ -9,6 +9,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/norm.hpp>
 #include <limits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define GLM_NOISE 0
 #define CINDER_NOISE 1
@@ -56,6 +59,285 @@ float Noise4D(const glm::vec4& pos, int octaves, float persistence, float freque
 	return Noise(pos, octaves, persistence, 2.0f, frequency, amplitude);
 }
 
+namespace {
+
+#if defined(__SSE2__)
+
+/**
+ * The amount of positions that are evaluated at once by the batch functions
+ */
+constexpr int LANES = 4;
+
+/**
+ * The skewing factors of the 2D and 3D simplex grid - same values as in Simplex.h. They are
+ * double values there, too - we have to apply them in double precision to get the same results.
+ */
+constexpr double SimplexF2 = 0.366025403;
+constexpr double SimplexG2 = 0.211324865;
+constexpr double SimplexF3 = 0.333333333;
+constexpr double SimplexG3 = 0.166666667;
+
+/**
+ * The gradients of @c details::grad(int, float, float) as factors for x and y
+ */
+alignas(16) const float Gradients2D[8][2] = {
+	{ 1.0f, 2.0f }, { -1.0f, 2.0f }, { 1.0f, -2.0f }, { -1.0f, -2.0f },
+	{ 2.0f, 1.0f }, { 2.0f, -1.0f }, { -2.0f, 1.0f }, { -2.0f, -1.0f }
+};
+
+/**
+ * The gradients of @c details::grad(int, float, float, float) as factors for x, y and z
+ */
+alignas(16) const float Gradients3D[16][3] = {
+	{ 1.0f, 1.0f, 0.0f }, { -1.0f, 1.0f, 0.0f }, { 1.0f, -1.0f, 0.0f }, { -1.0f, -1.0f, 0.0f },
+	{ 1.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, -1.0f }, { -1.0f, 0.0f, -1.0f },
+	{ 0.0f, 1.0f, 1.0f }, { 0.0f, -1.0f, 1.0f }, { 0.0f, 1.0f, -1.0f }, { 0.0f, -1.0f, -1.0f },
+	{ 1.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 1.0f }, { -1.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, -1.0f }
+};
+
+/**
+ * @brief Same as the @c FASTFLOOR macro - including the off by one for negative integers
+ */
+inline __m128i fastFloor(__m128 v) {
+	const __m128i truncated = _mm_cvttps_epi32(v);
+	return _mm_add_epi32(truncated, _mm_castps_si128(_mm_cmple_ps(v, _mm_setzero_ps())));
+}
+
+/**
+ * @return @c v * c rounded to float - but multiplied in double precision like the scalar version does
+ */
+inline __m128 mulDouble(__m128 v, double c) {
+	const __m128d dc = _mm_set1_pd(c);
+	const __m128 lo = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtps_pd(v), dc));
+	const __m128 hi = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), dc));
+	return _mm_movelh_ps(lo, hi);
+}
+
+/**
+ * @return @c v + c rounded to float - but added in double precision like the scalar version does
+ */
+inline __m128 addDouble(__m128 v, double c) {
+	const __m128d dc = _mm_set1_pd(c);
+	const __m128 lo = _mm_cvtpd_ps(_mm_add_pd(_mm_cvtps_pd(v), dc));
+	const __m128 hi = _mm_cvtpd_ps(_mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), dc));
+	return _mm_movelh_ps(lo, hi);
+}
+
+/**
+ * @return @c t^4*dot for lanes with a positive @c t and 0 for all others
+ */
+inline __m128 contribution(__m128 t, __m128 dot) {
+	const __m128 mask = _mm_cmpge_ps(t, _mm_setzero_ps());
+	const __m128 tt = _mm_mul_ps(t, t);
+	return _mm_and_ps(mask, _mm_mul_ps(_mm_mul_ps(tt, tt), dot));
+}
+
+/**
+ * @brief Simd version of @c noise(const glm::vec2&)
+ */
+__m128 simplex4(__m128 x, __m128 y) {
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 s = mulDouble(_mm_add_ps(x, y), SimplexF2);
+	const __m128i i = fastFloor(_mm_add_ps(x, s));
+	const __m128i j = fastFloor(_mm_add_ps(y, s));
+	const __m128 t = mulDouble(_mm_cvtepi32_ps(_mm_add_epi32(i, j)), SimplexG2);
+	const __m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+	const __m128 y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+
+	// lower triangle if x0 > y0 - upper triangle otherwise
+	const __m128 lower = _mm_cmpgt_ps(x0, y0);
+	const __m128 i1 = _mm_and_ps(lower, one);
+	const __m128 j1 = _mm_andnot_ps(lower, one);
+
+	const __m128 x1 = addDouble(_mm_sub_ps(x0, i1), SimplexG2);
+	const __m128 y1 = addDouble(_mm_sub_ps(y0, j1), SimplexG2);
+	const __m128 x2 = addDouble(_mm_sub_ps(x0, one), 2.0 * SimplexG2);
+	const __m128 y2 = addDouble(_mm_sub_ps(y0, one), 2.0 * SimplexG2);
+
+	const __m128i mask = _mm_set1_epi32(0xff);
+	alignas(16) int ii[LANES], jj[LANES], li1[LANES];
+	_mm_store_si128((__m128i*)ii, _mm_and_si128(i, mask));
+	_mm_store_si128((__m128i*)jj, _mm_and_si128(j, mask));
+	_mm_store_si128((__m128i*)li1, _mm_cvttps_epi32(i1));
+
+	// the permutation lookups can't be vectorized with sse2 - gather the gradients per lane
+	alignas(16) float gx[3][LANES], gy[3][LANES];
+	for (int l = 0; l < LANES; ++l) {
+		const int lj1 = 1 - li1[l];
+		const int h0 = details::perm[ii[l] + details::perm[jj[l]]] & 7;
+		const int h1 = details::perm[ii[l] + li1[l] + details::perm[jj[l] + lj1]] & 7;
+		const int h2 = details::perm[ii[l] + 1 + details::perm[jj[l] + 1]] & 7;
+		gx[0][l] = Gradients2D[h0][0];
+		gy[0][l] = Gradients2D[h0][1];
+		gx[1][l] = Gradients2D[h1][0];
+		gy[1][l] = Gradients2D[h1][1];
+		gx[2][l] = Gradients2D[h2][0];
+		gy[2][l] = Gradients2D[h2][1];
+	}
+
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 t0 = _mm_sub_ps(_mm_sub_ps(half, _mm_mul_ps(x0, x0)), _mm_mul_ps(y0, y0));
+	const __m128 t1 = _mm_sub_ps(_mm_sub_ps(half, _mm_mul_ps(x1, x1)), _mm_mul_ps(y1, y1));
+	const __m128 t2 = _mm_sub_ps(_mm_sub_ps(half, _mm_mul_ps(x2, x2)), _mm_mul_ps(y2, y2));
+	const __m128 d0 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx[0]), x0), _mm_mul_ps(_mm_load_ps(gy[0]), y0));
+	const __m128 d1 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx[1]), x1), _mm_mul_ps(_mm_load_ps(gy[1]), y1));
+	const __m128 d2 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(gx[2]), x2), _mm_mul_ps(_mm_load_ps(gy[2]), y2));
+	const __m128 n = _mm_add_ps(_mm_add_ps(contribution(t0, d0), contribution(t1, d1)), contribution(t2, d2));
+	return _mm_mul_ps(_mm_set1_ps(40.0f), n);
+}
+
+/**
+ * @brief Simd version of @c noise(const glm::vec3&)
+ */
+__m128 simplex4(__m128 x, __m128 y, __m128 z) {
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 all = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	const __m128 s = mulDouble(_mm_add_ps(_mm_add_ps(x, y), z), SimplexF3);
+	const __m128i i = fastFloor(_mm_add_ps(x, s));
+	const __m128i j = fastFloor(_mm_add_ps(y, s));
+	const __m128i k = fastFloor(_mm_add_ps(z, s));
+	const __m128 t = mulDouble(_mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(i, j), k)), SimplexG3);
+	const __m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+	const __m128 y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+	const __m128 z0 = _mm_sub_ps(z, _mm_sub_ps(_mm_cvtepi32_ps(k), t));
+
+	// branchless version of the simplex selection in the scalar implementation
+	const __m128 xGeY = _mm_cmpge_ps(x0, y0);
+	const __m128 yGeZ = _mm_cmpge_ps(y0, z0);
+	const __m128 xGeZ = _mm_cmpge_ps(x0, z0);
+	const __m128 i1 = _mm_and_ps(_mm_and_ps(xGeY, xGeZ), one);
+	const __m128 j1 = _mm_and_ps(_mm_andnot_ps(xGeY, yGeZ), one);
+	const __m128 k1 = _mm_andnot_ps(_mm_or_ps(xGeZ, yGeZ), one);
+	const __m128 i2 = _mm_and_ps(_mm_or_ps(xGeY, xGeZ), one);
+	const __m128 j2 = _mm_and_ps(_mm_or_ps(_mm_andnot_ps(xGeY, all), yGeZ), one);
+	const __m128 k2 = _mm_andnot_ps(_mm_and_ps(xGeZ, yGeZ), one);
+
+	const __m128 x1 = addDouble(_mm_sub_ps(x0, i1), SimplexG3);
+	const __m128 y1 = addDouble(_mm_sub_ps(y0, j1), SimplexG3);
+	const __m128 z1 = addDouble(_mm_sub_ps(z0, k1), SimplexG3);
+	const __m128 x2 = addDouble(_mm_sub_ps(x0, i2), 2.0 * SimplexG3);
+	const __m128 y2 = addDouble(_mm_sub_ps(y0, j2), 2.0 * SimplexG3);
+	const __m128 z2 = addDouble(_mm_sub_ps(z0, k2), 2.0 * SimplexG3);
+	const __m128 x3 = addDouble(_mm_sub_ps(x0, one), 3.0 * SimplexG3);
+	const __m128 y3 = addDouble(_mm_sub_ps(y0, one), 3.0 * SimplexG3);
+	const __m128 z3 = addDouble(_mm_sub_ps(z0, one), 3.0 * SimplexG3);
+
+	const __m128i mask = _mm_set1_epi32(0xff);
+	alignas(16) int ii[LANES], jj[LANES], kk[LANES];
+	alignas(16) int li1[LANES], lj1[LANES], lk1[LANES], li2[LANES], lj2[LANES], lk2[LANES];
+	_mm_store_si128((__m128i*)ii, _mm_and_si128(i, mask));
+	_mm_store_si128((__m128i*)jj, _mm_and_si128(j, mask));
+	_mm_store_si128((__m128i*)kk, _mm_and_si128(k, mask));
+	_mm_store_si128((__m128i*)li1, _mm_cvttps_epi32(i1));
+	_mm_store_si128((__m128i*)lj1, _mm_cvttps_epi32(j1));
+	_mm_store_si128((__m128i*)lk1, _mm_cvttps_epi32(k1));
+	_mm_store_si128((__m128i*)li2, _mm_cvttps_epi32(i2));
+	_mm_store_si128((__m128i*)lj2, _mm_cvttps_epi32(j2));
+	_mm_store_si128((__m128i*)lk2, _mm_cvttps_epi32(k2));
+
+	// the permutation lookups can't be vectorized with sse2 - gather the gradients per lane
+	alignas(16) float gx[4][LANES], gy[4][LANES], gz[4][LANES];
+	for (int l = 0; l < LANES; ++l) {
+		const int h[4] = {
+			details::perm[ii[l] + details::perm[jj[l] + details::perm[kk[l]]]] & 15,
+			details::perm[ii[l] + li1[l] + details::perm[jj[l] + lj1[l] + details::perm[kk[l] + lk1[l]]]] & 15,
+			details::perm[ii[l] + li2[l] + details::perm[jj[l] + lj2[l] + details::perm[kk[l] + lk2[l]]]] & 15,
+			details::perm[ii[l] + 1 + details::perm[jj[l] + 1 + details::perm[kk[l] + 1]]] & 15
+		};
+		for (int c = 0; c < 4; ++c) {
+			gx[c][l] = Gradients3D[h[c]][0];
+			gy[c][l] = Gradients3D[h[c]][1];
+			gz[c][l] = Gradients3D[h[c]][2];
+		}
+	}
+
+	const __m128 radius = _mm_set1_ps(0.6f);
+	const __m128 t0 = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(radius, _mm_mul_ps(x0, x0)), _mm_mul_ps(y0, y0)), _mm_mul_ps(z0, z0));
+	const __m128 t1 = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(radius, _mm_mul_ps(x1, x1)), _mm_mul_ps(y1, y1)), _mm_mul_ps(z1, z1));
+	const __m128 t2 = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(radius, _mm_mul_ps(x2, x2)), _mm_mul_ps(y2, y2)), _mm_mul_ps(z2, z2));
+	const __m128 t3 = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(radius, _mm_mul_ps(x3, x3)), _mm_mul_ps(y3, y3)), _mm_mul_ps(z3, z3));
+	const __m128 d0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(gx[0]), x0), _mm_mul_ps(_mm_load_ps(gy[0]), y0)), _mm_mul_ps(_mm_load_ps(gz[0]), z0));
+	const __m128 d1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(gx[1]), x1), _mm_mul_ps(_mm_load_ps(gy[1]), y1)), _mm_mul_ps(_mm_load_ps(gz[1]), z1));
+	const __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(gx[2]), x2), _mm_mul_ps(_mm_load_ps(gy[2]), y2)), _mm_mul_ps(_mm_load_ps(gz[2]), z2));
+	const __m128 d3 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(gx[3]), x3), _mm_mul_ps(_mm_load_ps(gy[3]), y3)), _mm_mul_ps(_mm_load_ps(gz[3]), z3));
+	const __m128 n = _mm_add_ps(_mm_add_ps(_mm_add_ps(contribution(t0, d0), contribution(t1, d1)), contribution(t2, d2)), contribution(t3, d3));
+	return _mm_mul_ps(_mm_set1_ps(32.0f), n);
+}
+
+#endif
+
+}
+
+void Noise2DGrid(const glm::vec2& pos, int width, int height, float step, float* out, int octaves, float persistence, float frequency, float amplitude) {
+	core_trace_scoped(NoiseGrid);
+	const float lacunarity = 2.0f;
+	const int n = width * height;
+	for (int i = 0; i < n; ++i) {
+		out[i] = 0.0f;
+	}
+	for (int o = 0; o < octaves; ++o) {
+		for (int y = 0; y < height; ++y) {
+			const float posY = pos.y + (float)y * step;
+			float* row = out + y * width;
+			int x = 0;
+#if defined(__SSE2__)
+			const __m128 freq = _mm_set1_ps(frequency);
+			const __m128 amp = _mm_set1_ps(amplitude);
+			const __m128 vy = _mm_mul_ps(_mm_set1_ps(posY), freq);
+			for (; x < width; x += LANES) {
+				alignas(16) float values[LANES];
+				const __m128 vx = _mm_add_ps(_mm_set1_ps(pos.x), _mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(x, x + 1, x + 2, x + 3)), _mm_set1_ps(step)));
+				_mm_store_ps(values, _mm_mul_ps(simplex4(_mm_mul_ps(vx, freq), vy), amp));
+				const int lanes = glm::min(LANES, width - x);
+				for (int l = 0; l < lanes; ++l) {
+					row[x + l] += values[l];
+				}
+			}
+#endif
+			for (; x < width; ++x) {
+				const glm::vec2 p(pos.x + (float)x * step, posY);
+				row[x] += noise(p * frequency) * amplitude;
+			}
+		}
+		frequency *= lacunarity;
+		amplitude *= persistence;
+	}
+}
+
+void Noise3DColumn(float x, float z, int yMin, int yMax, float* out, int octaves, float persistence, float frequency, float amplitude) {
+	core_trace_scoped(NoiseColumn);
+	const float lacunarity = 2.0f;
+	const int n = yMax - yMin;
+	for (int i = 0; i < n; ++i) {
+		out[i] = 0.0f;
+	}
+	for (int o = 0; o < octaves; ++o) {
+		int i = 0;
+#if defined(__SSE2__)
+		const __m128 freq = _mm_set1_ps(frequency);
+		const __m128 amp = _mm_set1_ps(amplitude);
+		const __m128 vx = _mm_mul_ps(_mm_set1_ps(x), freq);
+		const __m128 vz = _mm_mul_ps(_mm_set1_ps(z), freq);
+		for (; i < n; i += LANES) {
+			alignas(16) float values[LANES];
+			const int y = yMin + i;
+			const __m128 vy = _mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(y, y + 1, y + 2, y + 3)), freq);
+			_mm_store_ps(values, _mm_mul_ps(simplex4(vx, vy, vz), amp));
+			const int lanes = glm::min(LANES, n - i);
+			for (int l = 0; l < lanes; ++l) {
+				out[i + l] += values[l];
+			}
+		}
+#endif
+		for (; i < n; ++i) {
+			const glm::vec3 p(x, (float)(yMin + i), z);
+			out[i] += noise(p * frequency) * amplitude;
+		}
+		frequency *= lacunarity;
+		amplitude *= persistence;
+	}
+}
+
 int32_t intValueNoise(const glm::ivec3& pos, int32_t seed) {
 	constexpr int32_t xgen = 1619;
 	constexpr int32_t ygen = 31337;
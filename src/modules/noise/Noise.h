@@ -38,6 +38,30 @@ extern float Noise2D(const glm::vec2& pos, int octaves = 1, float persistence =
  */
 extern float Noise3D(const glm::vec3& pos, int octaves = 1, float persistence = 1.0f, float frequency = 1.0f, float amplitude = 1.0f);
 
+/**
+ * @brief Evaluates @c Noise2D for a grid of positions in one call
+ *
+ * The noise is evaluated for several positions at once by using the simd lanes of the cpu. The result is the
+ * same as calling @c Noise2D for each position (within floating point precision).
+ * @param[in] pos the position of the first grid cell
+ * @param[in] width the amount of cells along the x axis
+ * @param[in] height the amount of cells along the y axis
+ * @param[in] step the distance between two grid cells
+ * @param[out] out buffer of size @c width * @c height - the value for the cell @c x, @c y is stored at @c y * width + x
+ * @sa Noise2D()
+ */
+extern void Noise2DGrid(const glm::vec2& pos, int width, int height, float step, float* out, int octaves = 1, float persistence = 1.0f, float frequency = 1.0f, float amplitude = 1.0f);
+
+/**
+ * @brief Evaluates @c Noise3D for the column @c x, @c z from @c yMin (inclusive) to @c yMax (exclusive) in one call
+ *
+ * The noise is evaluated for several positions at once by using the simd lanes of the cpu. The result is the
+ * same as calling @c Noise3D for each position (within floating point precision).
+ * @param[out] out buffer of size @c yMax - @c yMin - the value for @c y is stored at @c y - yMin
+ * @sa Noise3D()
+ */
+extern void Noise3DColumn(float x, float z, int yMin, int yMax, float* out, int octaves = 1, float persistence = 1.0f, float frequency = 1.0f, float amplitude = 1.0f);
+
 /**
  * @return A value between [-amplitude*octaves*persistence,amplitude*octaves*persistence]
  * @param[in] octaves the amount of noise calls that contribute to the final result
@@ -67,4 +67,32 @@ TEST_F(NoiseTest, test2DNoiseRF) {
 	test2DNoise([] (const glm::vec2& pos) {return noise::ridgedMF(pos, 128.0f, 4, 2.02f, 1.0f);}, 20.0f, "test-ridgedmf-noise-1024-2048.png", 1024, 2048, 4);
 }
 
+TEST_F(NoiseTest, testNoise2DGrid) {
+	const int width = 19;
+	const int height = 7;
+	const float step = 2.0f;
+	const glm::vec2 pos(-13.0f, 1027.0f);
+	float values[width * height];
+	noise::Noise2DGrid(pos, width, height, step, values, 4, 0.5f, 0.01f, 1.5f);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			const float expected = noise::Noise2D(pos + glm::vec2(x, y) * step, 4, 0.5f, 0.01f, 1.5f);
+			ASSERT_NEAR(expected, values[y * width + x], 0.0001f) << "Grid value at " << x << ":" << y << " differs";
+		}
+	}
+}
+
+TEST_F(NoiseTest, testNoise3DColumn) {
+	const int yMin = -5;
+	const int yMax = 130;
+	float values[yMax - yMin];
+	for (const glm::vec2 pos : {glm::vec2(0.0f), glm::vec2(-17.0f, 255.0f), glm::vec2(1024.0f, -3.0f)}) {
+		noise::Noise3DColumn(pos.x, pos.y, yMin, yMax, values, 3, 0.5f, 0.05f, 1.0f);
+		for (int y = yMin; y < yMax; ++y) {
+			const float expected = noise::Noise3D(glm::vec3(pos.x, y, pos.y), 3, 0.5f, 0.05f, 1.0f);
+			ASSERT_NEAR(expected, values[y - yMin], 0.0001f) << "Column value at " << y << " differs";
+		}
+	}
+}
+
 }
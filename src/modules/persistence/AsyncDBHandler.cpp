@@ -0,0 +1,280 @@
+/**
+ * @file
+ */
+
+#include "AsyncDBHandler.h"
+#include "Connection.h"
+#include "core/GameConfig.h"
+#include "core/Log.h"
+#include "core/Var.h"
+#include "engine-config.h"
+#include <algorithm>
+#ifdef HAVE_POSTGRES
+#include <libpq-fe.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#define poll WSAPoll
+#else
+#include <poll.h>
+#endif
+#endif
+
+namespace persistence {
+
+#ifdef HAVE_POSTGRES
+/**
+ * @brief Blocks the worker until the socket of the connection is ready
+ */
+static bool waitSocket(ConnectionType* c, bool write) {
+	struct pollfd fd;
+	fd.fd = PQsocket(c);
+	fd.events = POLLIN | (write ? POLLOUT : 0);
+	fd.revents = 0;
+	if (fd.fd < 0) {
+		return false;
+	}
+	return poll(&fd, 1, -1) >= 0;
+}
+
+/**
+ * @brief Sends all the queued queries of the non-blocking connection to the server
+ */
+static bool flushConnection(ConnectionType* c) {
+	for (;;) {
+		const int state = PQflush(c);
+		if (state == 0) {
+			return true;
+		}
+		if (state < 0 || !waitSocket(c, true)) {
+			return false;
+		}
+		// the server might block on sending results while we are still sending queries
+		if (!PQconsumeInput(c)) {
+			return false;
+		}
+	}
+}
+
+/**
+ * @return The next result of the connection or @c nullptr if the current query doesn't have any more results
+ */
+static PGresult* nextResult(ConnectionType* c, bool& success) {
+	while (PQisBusy(c)) {
+		if (!waitSocket(c, false) || !PQconsumeInput(c)) {
+			success = false;
+			return nullptr;
+		}
+	}
+	return PQgetResult(c);
+}
+
+static bool enterPipelineMode(ConnectionType* c) {
+	if (PQsetnonblocking(c, 1) != 0) {
+		return false;
+	}
+#ifdef LIBPQ_HAS_PIPELINING
+	return PQenterPipelineMode(c) == 1;
+#else
+	return true;
+#endif
+}
+#endif
+
+AsyncDBHandler::AsyncDBHandler(int workerAmount, int maxPipelineDepth) :
+		_workerAmount(std::max(1, workerAmount)), _maxPipelineDepth(std::max(1, maxPipelineDepth)) {
+}
+
+AsyncDBHandler::~AsyncDBHandler() {
+	shutdown();
+}
+
+bool AsyncDBHandler::init() {
+	std::lock_guard<std::mutex> lock(_queryMutex);
+	if (_running) {
+		return true;
+	}
+	for (int i = 0; i < _workerAmount; ++i) {
+		std::unique_ptr<Connection> connection = std::make_unique<Connection>();
+		connection->changeDb(core::Var::getSafe(cfg::DatabaseName)->strVal());
+		connection->changeHost(core::Var::getSafe(cfg::DatabaseHost)->strVal());
+		connection->setLoginData(core::Var::getSafe(cfg::DatabaseUser)->strVal(), core::Var::getSafe(cfg::DatabasePassword)->strVal());
+		if (!connection->connect()) {
+			Log::error("Could not connect the database worker %i", i);
+			_connections.clear();
+			return false;
+		}
+		_connections.push_back(std::move(connection));
+	}
+	_running = true;
+	for (const auto& connection : _connections) {
+		_workers.emplace_back(&AsyncDBHandler::run, this, connection.get());
+	}
+	return true;
+}
+
+void AsyncDBHandler::shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(_queryMutex);
+		if (!_running) {
+			return;
+		}
+		_running = false;
+	}
+	_queryAvailable.notify_all();
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+	_workers.clear();
+	for (const auto& connection : _connections) {
+		connection->disconnect();
+	}
+	_connections.clear();
+}
+
+void AsyncDBHandler::exec(const std::string& statement, std::vector<std::string>&& parameters, StateCallback&& callback, bool binaryResult) {
+	Query query { statement, std::move(parameters), binaryResult, std::move(callback) };
+	{
+		std::lock_guard<std::mutex> lock(_queryMutex);
+		if (_running) {
+			_queries.push_back(std::move(query));
+			_queryAvailable.notify_one();
+			return;
+		}
+	}
+	Log::error("Could not execute '%s' - the database workers are not running", statement.c_str());
+	fail(query);
+}
+
+void AsyncDBHandler::fail(Query& query) {
+	std::lock_guard<std::mutex> lock(_resultMutex);
+	_results.emplace_back(State(), std::move(query.callback));
+}
+
+int AsyncDBHandler::update() {
+	std::deque<Result> results;
+	{
+		std::lock_guard<std::mutex> lock(_resultMutex);
+		results.swap(_results);
+	}
+	for (Result& result : results) {
+		result.callback(result.state);
+	}
+	return (int)results.size();
+}
+
+size_t AsyncDBHandler::queuedQueries() {
+	std::lock_guard<std::mutex> lock(_queryMutex);
+	return _queries.size();
+}
+
+void AsyncDBHandler::run(Connection* connection) {
+#ifdef HAVE_POSTGRES
+	if (!enterPipelineMode(connection->connection())) {
+		Log::error("Could not switch the database worker connection into pipeline mode");
+	}
+#endif
+#ifdef LIBPQ_HAS_PIPELINING
+	const size_t maxPipelineDepth = (size_t)_maxPipelineDepth;
+#else
+	const size_t maxPipelineDepth = 1u;
+#endif
+	std::vector<Query> queries;
+	queries.reserve(maxPipelineDepth);
+	std::unique_lock<std::mutex> lock(_queryMutex);
+	for (;;) {
+		_queryAvailable.wait(lock, [this] () {
+			return !_running || !_queries.empty();
+		});
+		// the queued queries are executed before the worker stops
+		if (_queries.empty()) {
+			break;
+		}
+		while (!_queries.empty() && queries.size() < maxPipelineDepth) {
+			queries.push_back(std::move(_queries.front()));
+			_queries.pop_front();
+		}
+		lock.unlock();
+		execute(connection, queries);
+		queries.clear();
+		lock.lock();
+	}
+}
+
+void AsyncDBHandler::execute(Connection* connection, std::vector<Query>& queries) {
+#ifdef HAVE_POSTGRES
+	if (!connection->status()) {
+		connection->disconnect();
+		if (!connection->connect() || !enterPipelineMode(connection->connection())) {
+			Log::error("Could not reconnect the database worker");
+			for (Query& query : queries) {
+				fail(query);
+			}
+			return;
+		}
+	}
+	ConnectionType* c = connection->connection();
+	size_t sent = 0u;
+	std::vector<const char*> values;
+	for (const Query& query : queries) {
+		values.clear();
+		for (const std::string& parameter : query.parameters) {
+			values.push_back(parameter.c_str());
+		}
+		if (!PQsendQueryParams(c, query.statement.c_str(), (int)values.size(), nullptr, values.data(), nullptr,
+				nullptr, query.binaryResult ? 1 : 0)) {
+			Log::error("Could not send query: %s", PQerrorMessage(c));
+			break;
+		}
+#ifdef LIBPQ_HAS_PIPELINING
+		// a sync point after every query - so a failing query doesn't abort the following ones
+		if (!PQpipelineSync(c)) {
+			Log::error("Could not send pipeline sync: %s", PQerrorMessage(c));
+			break;
+		}
+#endif
+		++sent;
+	}
+	bool success = flushConnection(c);
+
+	std::deque<Result> results;
+	for (size_t i = 0u; i < queries.size(); ++i) {
+		State state(connection);
+		if (success && i < sent) {
+			PGresult* res = nextResult(c, success);
+			if (res != nullptr) {
+				state.setResult(res);
+				// the end of the results of this query
+				while (PGresult* other = nextResult(c, success)) {
+					PQclear(other);
+				}
+			}
+#ifdef LIBPQ_HAS_PIPELINING
+			PGresult* sync = nextResult(c, success);
+			if (sync == nullptr || PQresultStatus(sync) != PGRES_PIPELINE_SYNC) {
+				Log::error("Unexpected result in the pipeline");
+				success = false;
+			}
+			PQclear(sync);
+#endif
+			if (!success) {
+				state.result = false;
+			}
+		}
+		results.emplace_back(std::move(state), std::move(queries[i].callback));
+	}
+	if (!success) {
+		// the pipeline is in an unknown state
+		connection->disconnect();
+	}
+	std::lock_guard<std::mutex> lock(_resultMutex);
+	for (Result& result : results) {
+		_results.push_back(std::move(result));
+	}
+#else
+	for (Query& query : queries) {
+		fail(query);
+	}
+#endif
+}
+
+}
@@ -0,0 +1,158 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "Model.h"
+#include "State.h"
+#include "SQLGenerator.h"
+#include "DBCondition.h"
+#include "core/NonCopyable.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace persistence {
+
+/**
+ * @brief Executes queries on database worker threads without blocking the caller
+ *
+ * Every worker has its own connection in non-blocking pipeline mode - all the queries that are queued
+ * while a worker is busy are sent in one batch without waiting for the result of the previous query.
+ * Every query is followed by a sync point - a failing query doesn't abort the other queries of the batch.
+ *
+ * The callbacks are executed in @c update() - on the thread of the caller, e.g. the server frame.
+ *
+ * @ingroup Persistence
+ */
+class AsyncDBHandler : public core::NonCopyable {
+public:
+	/**
+	 * @param[in,out] state The result of the query - @c State::result is @c false if the query failed
+	 */
+	typedef std::function<void(State& state)> StateCallback;
+private:
+	struct Query {
+		std::string statement;
+		std::vector<std::string> parameters;
+		bool binaryResult;
+		StateCallback callback;
+	};
+
+	struct Result {
+		State state;
+		StateCallback callback;
+
+		Result(State&& _state, StateCallback&& _callback) :
+				state(std::move(_state)), callback(std::move(_callback)) {
+		}
+	};
+
+	const int _workerAmount;
+	const int _maxPipelineDepth;
+
+	std::mutex _queryMutex;
+	std::condition_variable _queryAvailable;
+	std::deque<Query> _queries;
+	bool _running = false;
+	std::vector<std::thread> _workers;
+	std::vector<std::unique_ptr<Connection>> _connections;
+
+	std::mutex _resultMutex;
+	std::deque<Result> _results;
+
+	void run(Connection* connection);
+	void execute(Connection* connection, std::vector<Query>& queries);
+	void fail(Query& query);
+public:
+	/**
+	 * @param[in] workerAmount The amount of worker threads - each one has its own connection
+	 * @param[in] maxPipelineDepth The maximum amount of queries a worker sends without reading the results
+	 */
+	AsyncDBHandler(int workerAmount = 2, int maxPipelineDepth = 64);
+	~AsyncDBHandler();
+
+	/**
+	 * @brief Connects the workers to the database and starts them
+	 */
+	bool init();
+	/**
+	 * @brief Executes the queued queries and stops the workers. The callbacks of the queries are executed
+	 * with the next @c update() call.
+	 */
+	void shutdown();
+
+	/**
+	 * @brief Queues the given statement
+	 * @param[in] parameters The values for the placeholders of the statement
+	 * @param[in] callback Executed in @c update() after the query was executed - or failed. Also if this
+	 * handler isn't initialized.
+	 * @param[in] binaryResult Request the result values in the binary format of the database
+	 */
+	void exec(const std::string& statement, std::vector<std::string>&& parameters, StateCallback&& callback, bool binaryResult = false);
+
+	/**
+	 * @brief Select database entries of the given @c persistence::Model
+	 * @param[in] model The model that should be selected
+	 * @param[in] condition The @c persistence::DBCondition that identifies the entries to select - the values
+	 * are copied, the condition doesn't have to outlive the query.
+	 * @param[in] func Executed in @c update() with the success state and all the selected models - no models
+	 * are given if one of the rows couldn't be decoded
+	 */
+	template<class FUNC, class MODEL>
+	void select(MODEL&& model, const DBCondition& condition, FUNC&& func) {
+		typedef typename std::remove_const<typename std::remove_reference<MODEL>::type>::type ModelType;
+		int conditionAmount = 0;
+		const std::string& statement = createSelect(model) + createWhere(condition, conditionAmount);
+		std::vector<std::string> parameters;
+		parameters.reserve(conditionAmount);
+		for (int i = 0; i < conditionAmount; ++i) {
+			parameters.emplace_back(condition.value(i));
+		}
+		exec(statement, std::move(parameters), [func] (State& state) {
+			std::vector<ModelType> models;
+			if (state.result && state.affectedRows > 0) {
+				std::vector<int> columns;
+				if (!ModelType().fillColumnIndex(state, columns)) {
+					func(false, std::move(models));
+					return;
+				}
+				models.reserve(state.affectedRows);
+				for (int i = 0; i < state.affectedRows; ++i) {
+					ModelType selectedModel;
+					if (!static_cast<Model&>(selectedModel).fillModelValues(state, columns)) {
+						// don't hand out a partial result
+						models.clear();
+						func(false, std::move(models));
+						return;
+					}
+					models.push_back(std::move(selectedModel));
+					++state.currentRow;
+				}
+			}
+			func(state.result, std::move(models));
+		}, true);
+	}
+
+	/**
+	 * @brief Executes the callbacks of all queries that were finished since the last call
+	 * @return The amount of executed callbacks
+	 */
+	int update();
+
+	/**
+	 * @return The amount of queued queries that no worker picked up yet
+	 */
+	size_t queuedQueries();
+};
+
+typedef std::shared_ptr<AsyncDBHandler> AsyncDBHandlerPtr;
+
+}
@@ -16,7 +16,6 @@ namespace persistence {
 
 BindParam::BindParam(int num) :
 		values(num, nullptr), lengths(num, 0), formats(num, 0), fieldTypes(num, FieldType::INT) {
-	valueBuffers.reserve(num);
 }
 
 int BindParam::add() {
@@ -24,7 +23,6 @@ int BindParam::add() {
 	++position;
 	if (values.capacity() < (size_t)position) {
 		values.resize(position);
-		valueBuffers.resize(position);
 		lengths.resize(position);
 		formats.resize(position);
 		fieldTypes.resize(position);
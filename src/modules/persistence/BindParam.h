@@ -5,6 +5,7 @@
 #pragma once
 
 #include "FieldType.h"
+#include <deque>
 #include <string>
 #include <vector>
 
@@ -17,7 +18,8 @@ struct BindParam {
 	std::vector<const char *> values;
 	std::vector<int> lengths;
 	std::vector<int> formats;
-	std::vector<std::string> valueBuffers;
+	// a deque - the values point into the buffers and must stay valid while new buffers are added
+	std::deque<std::string> valueBuffers;
 	std::vector<FieldType> fieldTypes;
 	int position = 0;
 	BindParam(int num);
@@ -100,6 +100,7 @@ bool Connection::connect() {
 	}
 
 	_preparedStatements.clear();
+	_statementCache.clear();
 
 #ifdef HAVE_POSTGRES
 	PQsetNoticeProcessor(_connection, defaultNoticeProcessor, nullptr);
@@ -117,6 +118,19 @@ void Connection::disconnect() {
 		_connection = nullptr;
 	}
 	_preparedStatements.clear();
+	_statementCache.clear();
+}
+
+PreparedStatement* Connection::cacheStatement(const std::string& key, const std::string& name, int parameterCount) {
+	PreparedStatement& statement = _statementCache[key];
+	statement.name = name;
+	statement.parameterCount = parameterCount;
+	statement.columns.clear();
+	return &statement;
+}
+
+std::string Connection::nextStatementName() const {
+	return "stmt" + std::to_string(_statementCache.size());
 }
 
 void Connection::close() {
@@ -6,10 +6,22 @@
 
 #include "ForwardDecl.h"
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace persistence {
 
+/**
+ * @brief A statement that was prepared on a connection by the @c DBHandler
+ */
+struct PreparedStatement {
+	std::string name;
+	int parameterCount = 0;
+	// the index of the model field for every column of the result - filled with the first result
+	std::vector<int> columns;
+};
+
 class Connection {
 private:
 	ConnectionType* _connection;
@@ -19,6 +31,8 @@ private:
 	std::string _password;
 	uint16_t _port;
 	std::unordered_set<std::string> _preparedStatements;
+	// the statements of the DBHandler - the key is built from the model and the condition shape
+	std::unordered_map<std::string, PreparedStatement> _statementCache;
 public:
 	Connection();
 	~Connection();
@@ -26,6 +40,19 @@ public:
 	bool hasPreparedStatement(const std::string& name) const;
 	void registerPreparedStatement(const std::string& name);
 
+	/**
+	 * @return The cached prepared statement for the given key or @c nullptr if there is none yet
+	 */
+	PreparedStatement* cachedStatement(const std::string& key);
+	/**
+	 * @brief Remembers a statement that was prepared on this connection
+	 */
+	PreparedStatement* cacheStatement(const std::string& key, const std::string& name, int parameterCount);
+	/**
+	 * @return A statement name that is unique for this connection
+	 */
+	std::string nextStatementName() const;
+
 	bool status() const;
 
 	void setLoginData(const std::string& username, const std::string& password);
@@ -58,4 +85,12 @@ inline void Connection::registerPreparedStatement(const std::string& name) {
 	_preparedStatements.insert(name);
 }
 
+inline PreparedStatement* Connection::cachedStatement(const std::string& key) {
+	auto i = _statementCache.find(key);
+	if (i == _statementCache.end()) {
+		return nullptr;
+	}
+	return &i->second;
+}
+
 }
@@ -35,16 +35,60 @@ Connection* DBHandler::connection() const {
 	return core::Singleton<ConnectionPool>::getInstance().connection();
 }
 
-bool DBHandler::update(Model& model) const {
+PreparedStatement* DBHandler::prepare(Connection* connection, const std::string& key, const std::string& query, int parameterCount) const {
+	const std::string& name = connection->nextStatementName();
+	State s(connection);
+	if (!s.prepare(name.c_str(), query.c_str(), parameterCount)) {
+		Log::error("Failed to prepare statement '%s'", query.c_str());
+		return nullptr;
+	}
+	Log::debug("Prepared statement %s: '%s'", name.c_str(), query.c_str());
+	return connection->cacheStatement(key, name, parameterCount);
+}
+
+bool DBHandler::execModel(const char* type, Model& model, bool update) const {
+	const std::string& key = type + model.tableName() + createStatementShape(model);
+	ScopedConnection scoped(connection());
+	if (!scoped) {
+		Log::error("Could not execute %s - could not acquire connection", key.c_str());
+		return false;
+	}
+	Connection* c = scoped.connection();
 	BindParam param(10);
-	const std::string& query = createUpdateStatement(model, &param);
-	return execInternalWithParameters(query, model, param).result;
+	PreparedStatement* statement = c->cachedStatement(key);
+	if (statement == nullptr) {
+		const std::string& query = update ? createUpdateStatement(model, &param) : createInsertStatement(model, &param);
+		statement = prepare(c, key, query, param.position);
+		if (statement == nullptr) {
+			return false;
+		}
+	} else if (update) {
+		createUpdateParameters(model, param);
+	} else {
+		createInsertParameters(model, param);
+	}
+	core_assert_msg(param.position == statement->parameterCount, "Parameter count mismatch for %s", key.c_str());
+	State s(c);
+	if (!s.execPrepared(statement->name.c_str(), param.position, &param.values[0], true)) {
+		Log::warn("Failed to execute %s", key.c_str());
+		return false;
+	}
+	if (s.affectedRows <= 0) {
+		Log::trace("No rows affected, can't fill model values");
+		return true;
+	}
+	if (statement->columns.empty() && !model.fillColumnIndex(s, statement->columns)) {
+		return false;
+	}
+	return model.fillModelValues(s, statement->columns);
+}
+
+bool DBHandler::update(Model& model) const {
+	return execModel("update:", model, true);
 }
 
 bool DBHandler::insert(Model& model) const {
-	BindParam param(10);
-	const std::string& query = createInsertStatement(model, &param);
-	return execInternalWithParameters(query, model, param).result;
+	return execModel("insert:", model, false);
 }
 
 bool DBHandler::truncate(const Model& model) const {
@@ -86,26 +130,6 @@ State DBHandler::execInternal(const std::string& query) const {
 	return s;
 }
 
-State DBHandler::execInternalWithParameters(const std::string& query, Model& model, const BindParam& param) const {
-	ScopedConnection scoped(connection());
-	if (!scoped) {
-		Log::error("Could not execute query '%s' - could not acquire connection", query.c_str());
-		return State();
-	}
-	State s(scoped.connection());
-	if (!s.exec(query.c_str(), param.position, &param.values[0])) {
-		Log::warn("Failed to execute query: '%s'", query.c_str());
-	} else {
-		Log::debug("Executed query: '%s'", query.c_str());
-	}
-	if (s.affectedRows <= 0) {
-		Log::trace("No rows affected, can't fill model values");
-		return s;
-	}
-	model.fillModelValues(s);
-	return s;
-}
-
 bool DBHandler::begin() {
 	return exec(createTransactionBegin());
 }
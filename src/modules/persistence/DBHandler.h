@@ -13,6 +13,7 @@
 #include "core/String.h"
 #include "core/Log.h"
 #include "ScopedConnection.h"
+#include "Connection.h"
 #include "BindParam.h"
 #include "SQLGenerator.h"
 #include "DBCondition.h"
@@ -23,6 +24,10 @@ namespace persistence {
 
 /**
  * @brief Database access for insert, update, delete, ...
+ *
+ * The statements for the models are prepared once per connection and cached - the key is built from
+ * the model and the shape of the condition. The selected values are transferred in the binary format.
+ *
  * @ingroup Persistence
  * @sa DatabaseTool
  * @sa Model
@@ -31,38 +36,91 @@ namespace persistence {
 class DBHandler {
 private:
 	State execInternal(const std::string& query) const;
-	State execInternalWithParameters(const std::string& query, Model& model, const BindParam& param) const;
 
 	Connection* connection() const;
 
+	/**
+	 * @brief Looks up the prepared statement for the given key in the cache of the connection - or
+	 * prepares the given statement if it is not yet cached.
+	 * @param[in] query The statement that is prepared if there is no cached statement for the key
+	 * @return @c nullptr if the statement could not get prepared
+	 */
+	PreparedStatement* prepare(Connection* connection, const std::string& key, const std::string& query, int parameterCount) const;
+
+	/**
+	 * @brief Executes a cached prepared statement that is built from a model and a condition
+	 * @param[in] key The cache key - the condition shape part
+	 * @param[in] createStatement Builds the statement - only called if the statement is not yet cached
+	 * @param[in] range The limit and offset values for the placeholders that follow the condition ones
+	 * (see @c createLimitOffset()) - or @c nullptr
+	 */
+	template<class CREATE>
+	bool execCondition(Connection* c, State& s, PreparedStatement*& statement, const std::string& key,
+			CREATE&& createStatement, int conditionAmount, const DBCondition& condition, bool binaryResult,
+			const Range* range = nullptr) const {
+		int parameterAmount = conditionAmount;
+		if (range != nullptr) {
+			parameterAmount += (range->limit > 0 ? 1 : 0) + (range->offset > 0 ? 1 : 0);
+		}
+		statement = c->cachedStatement(key);
+		if (statement == nullptr) {
+			statement = prepare(c, key, createStatement(), parameterAmount);
+			if (statement == nullptr) {
+				return false;
+			}
+		}
+		if (parameterAmount <= 0) {
+			return s.execPrepared(statement->name.c_str(), 0, nullptr, binaryResult);
+		}
+		BindParam params(parameterAmount);
+		for (int i = 0; i < conditionAmount; ++i) {
+			const int index = params.add();
+			const char* value = condition.value(i);
+			Log::debug("Parameter %i: '%s'", index + 1, value);
+			params.values[index] = value;
+		}
+		if (range != nullptr) {
+			for (int value : {range->limit, range->offset}) {
+				if (value <= 0) {
+					continue;
+				}
+				const int index = params.add();
+				params.valueBuffers.emplace_back(std::to_string(value));
+				params.values[index] = params.valueBuffers.back().c_str();
+				Log::debug("Parameter %i: '%s'", index + 1, params.values[index]);
+			}
+		}
+		return s.execPrepared(statement->name.c_str(), parameterAmount, &params.values[0], binaryResult);
+	}
+
+	/**
+	 * @param[in] suffix The part of the statement after the selected fields and the table - this is
+	 * also the key for the statement cache
+	 * @param[in] range The values for the limit and offset placeholders of the suffix - or @c nullptr
+	 */
 	template<class FUNC, class MODEL>
-	bool select(const std::string& query, int conditionAmount, MODEL& model, const DBCondition& condition, FUNC&& func) const {
-		Log::debug("Execute query '%s'", query.c_str());
+	bool select(const std::string& suffix, int conditionAmount, MODEL& model, const DBCondition& condition, FUNC&& func,
+			const Range* range = nullptr) const {
+		const std::string& key = "select:" + model.tableName() + suffix;
 		ScopedConnection scoped(connection());
 		if (!scoped) {
-			Log::error("Could not execute query '%s' - could not acquire connection", query.c_str());
+			Log::error("Could not execute select '%s' - could not acquire connection", key.c_str());
 			return false;
 		}
 		State s(scoped.connection());
-		if (conditionAmount > 0) {
-			BindParam params(conditionAmount);
-			for (int i = 0; i < conditionAmount; ++i) {
-				const int index = params.add();
-				const char* value = condition.value(i);
-				Log::debug("Parameter %i: '%s'", index + 1, value);
-				params.values[index] = value;
-			}
-			if (!s.exec(query.c_str(), conditionAmount, &params.values[0])) {
-				Log::error("Failed to execute query '%s' with %i parameters", query.c_str(), conditionAmount);
-				return false;
-			}
-		} else if (!s.exec(query.c_str())) {
-			Log::error("Failed to execute query '%s'", query.c_str());
+		PreparedStatement* statement = nullptr;
+		if (!execCondition(scoped.connection(), s, statement, key, [&] () {
+			return createSelect(model) + suffix;
+		}, conditionAmount, condition, true, range)) {
+			Log::error("Failed to execute select '%s' with %i parameters", key.c_str(), conditionAmount);
+			return false;
+		}
+		if (s.affectedRows > 0 && statement->columns.empty() && !model.fillColumnIndex(s, statement->columns)) {
 			return false;
 		}
 		for (int i = 0; i < s.affectedRows; ++i) {
 			typename std::remove_reference<MODEL>::type selectedModel;
-			selectedModel.fillModelValues(s);
+			selectedModel.fillModelValues(s, statement->columns);
 			func(std::move(selectedModel));
 			++s.currentRow;
 		}
@@ -70,6 +128,8 @@ private:
 		return true;
 	}
 
+	bool execModel(const char* type, Model& model, bool update) const;
+
 	bool _initialized = false;
 
 public:
@@ -96,28 +156,19 @@ public:
 	template<class MODEL>
 	bool deleteModel(MODEL&& model, const DBCondition& condition) const {
 		int conditionAmount = 0;
-		const std::string& query = createDeleteStatement(model) + createWhere(condition, conditionAmount);
-		Log::debug("Execute query '%s'", query.c_str());
+		const std::string& where = createWhere(condition, conditionAmount);
+		const std::string& key = "delete:" + model.tableName() + where;
 		ScopedConnection scoped(connection());
 		if (!scoped) {
-			Log::error("Could not execute query '%s' - could not acquire connection", query.c_str());
+			Log::error("Could not execute delete '%s' - could not acquire connection", key.c_str());
 			return false;
 		}
 		State s(scoped.connection());
-		if (conditionAmount > 0) {
-			BindParam params(conditionAmount);
-			for (int i = 0; i < conditionAmount; ++i) {
-				const int index = params.add();
-				const char* value = condition.value(i);
-				Log::debug("Parameter %i: '%s'", index + 1, value);
-				params.values[index] = value;
-			}
-			if (!s.exec(query.c_str(), conditionAmount, &params.values[0])) {
-				Log::error("Failed to execute query '%s' with %i parameters", query.c_str(), conditionAmount);
-				return false;
-			}
-		} else if (!s.exec(query.c_str())) {
-			Log::error("Failed to execute query '%s'", query.c_str());
+		PreparedStatement* statement = nullptr;
+		if (!execCondition(scoped.connection(), s, statement, key, [&] () {
+			return createDeleteStatement(model) + where;
+		}, conditionAmount, condition, false)) {
+			Log::error("Failed to execute delete '%s' with %i parameters", key.c_str(), conditionAmount);
 			return false;
 		}
 		if (s.affectedRows <= 0) {
@@ -139,8 +190,8 @@ public:
 	template<class FUNC, class MODEL>
 	bool select(MODEL&& model, const DBCondition& condition, FUNC&& func) const {
 		int conditionAmount = 0;
-		const std::string& query = createSelect(model) + createWhere(condition, conditionAmount);
-		return select(query, conditionAmount, model, condition, func);
+		const std::string& where = createWhere(condition, conditionAmount);
+		return select(where, conditionAmount, model, condition, func);
 	}
 
 	/**
@@ -155,9 +206,11 @@ public:
 	template<class FUNC, class MODEL>
 	bool select(MODEL&& model, const DBCondition& condition, const OrderBy& orderBy, FUNC&& func) const {
 		int conditionAmount = 0;
-		const std::string& query = createSelect(model) + createWhere(condition, conditionAmount)
-				+ createOrderBy(orderBy) + createLimitOffset(orderBy.range);
-		return select(query, conditionAmount, model, condition, func);
+		std::string suffix = createWhere(condition, conditionAmount) + createOrderBy(orderBy);
+		// the limit and the offset are bound as parameters - they are not part of the cache key
+		int parameterAmount = conditionAmount;
+		suffix += createLimitOffset(orderBy.range, parameterAmount);
+		return select(suffix, conditionAmount, model, condition, func, &orderBy.range);
 	}
 
 	/**
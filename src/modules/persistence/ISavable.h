@@ -0,0 +1,35 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "Model.h"
+#include <memory>
+#include <vector>
+
+namespace persistence {
+
+typedef std::unique_ptr<Model> ModelPtr;
+typedef std::vector<ModelPtr> Models;
+
+/**
+ * @brief Interface for the state that is written to the database by the @c PersistenceMgr
+ *
+ * @ingroup Persistence
+ */
+class ISavable {
+public:
+	virtual ~ISavable() {
+	}
+
+	/**
+	 * @brief Adds a model with the complete row for every row that was changed since the last call
+	 * and resets the dirty state.
+	 * @note Called from the thread that calls @c PersistenceMgr::update()
+	 * @return @c true if models were added
+	 */
+	virtual bool getDirtyModels(Models& models) = 0;
+};
+
+}
@@ -79,18 +79,81 @@ const Field& Model::getField(const std::string& name) const {
 	return emptyField;
 }
 
-bool Model::fillModelValues(State& state) {
+bool Model::fillColumnIndex(const std::vector<std::string>& columnNames, std::vector<int>& columns) const {
+	columns.clear();
+	columns.reserve(columnNames.size());
+	for (const std::string& name : columnNames) {
+		int index = -1;
+		for (size_t i = 0; i < _fields.size(); ++i) {
+			if (_fields[i].name == name) {
+				index = (int)i;
+				break;
+			}
+		}
+		if (index == -1) {
+			Log::error("Unknown field name for '%s'", name.c_str());
+			columns.clear();
+			return false;
+		}
+		columns.push_back(index);
+	}
+	return true;
+}
+
+bool Model::fillColumnIndex(const State& state, std::vector<int>& columns) const {
+#ifdef HAVE_POSTGRES
+	const int cols = PQnfields(state.res);
+	std::vector<std::string> columnNames;
+	columnNames.reserve(cols);
+	for (int i = 0; i < cols; ++i) {
+		columnNames.emplace_back(PQfname(state.res, i));
+	}
+	return fillColumnIndex(columnNames, columns);
+#else
+	return false;
+#endif
+}
+
+#ifdef HAVE_POSTGRES
+// see pg_type.h
+static constexpr Oid TimestampOid = 1114;
+static constexpr Oid TimestampTzOid = 1184;
+// the binary timestamps are the microseconds since 2000-01-01
+static constexpr int64_t PostgresEpochOffsetSeconds = 946684800;
+
+/**
+ * @brief Decodes the big endian integers of the binary result format
+ */
+static int64_t readBinaryInteger(const char* value, int length) {
+	const uint8_t* data = (const uint8_t*)value;
+	uint64_t result = 0u;
+	for (int i = 0; i < length; ++i) {
+		result = (result << 8) | data[i];
+	}
+	switch (length) {
+	case 1:
+		return (int8_t)result;
+	case 2:
+		return (int16_t)result;
+	case 4:
+		return (int32_t)result;
+	default:
+		return (int64_t)result;
+	}
+}
+#endif
+
+bool Model::fillModelValues(State& state, const std::vector<int>& columns) {
 #ifdef HAVE_POSTGRES
 	const int cols = PQnfields(state.res);
 	Log::trace("Query has values for %i cols", cols);
+	if ((int)columns.size() != cols) {
+		Log::error("The column index doesn't match the result");
+		state.result = false;
+		return false;
+	}
 	for (int i = 0; i < cols; ++i) {
-		const char* name = PQfname(state.res, i);
-		const Field& f = getField(name);
-		if (f.name != name) {
-			Log::error("Unknown field name for '%s'", name);
-			state.result = false;
-			return false;
-		}
+		const Field& f = _fields[columns[i]];
 		const bool isNull = PQgetisnull(state.res, state.currentRow, i);
 		const char* value = isNull ? nullptr : PQgetvalue(state.res, state.currentRow, i);
 		int length = PQgetlength(state.res, state.currentRow, i);
@@ -98,7 +161,44 @@ bool Model::fillModelValues(State& state) {
 			value = "";
 			length = 0;
 		}
-		Log::debug("Try to set '%s' to '%s' (length: %i)", name, value, length);
+		if (PQfformat(state.res, i) == 1) {
+			switch (f.type) {
+			case FieldType::TEXT:
+			case FieldType::STRING:
+			case FieldType::PASSWORD:
+				setValue(f, std::string(value, length));
+				break;
+			case FieldType::BOOLEAN:
+				setValue(f, length > 0 && value[0] != '\0');
+				break;
+			case FieldType::INT:
+				setValue(f, (int32_t)readBinaryInteger(value, length));
+				break;
+			case FieldType::SHORT:
+				setValue(f, (int16_t)readBinaryInteger(value, length));
+				break;
+			case FieldType::BYTE:
+				setValue(f, (uint8_t)readBinaryInteger(value, length));
+				break;
+			case FieldType::LONG:
+				setValue(f, readBinaryInteger(value, length));
+				break;
+			case FieldType::TIMESTAMP: {
+				const Oid type = PQftype(state.res, i);
+				int64_t seconds = readBinaryInteger(value, length);
+				if (type == TimestampOid || type == TimestampTzOid) {
+					seconds = seconds / 1000000 + PostgresEpochOffsetSeconds;
+				}
+				setValue(f, Timestamp(seconds));
+				break;
+			}
+			case FieldType::MAX:
+				break;
+			}
+			setIsNull(f, isNull);
+			continue;
+		}
+		Log::debug("Try to set '%s' to '%s' (length: %i)", f.name.c_str(), value, length);
 		switch (f.type) {
 		case FieldType::TEXT:
 		case FieldType::STRING:
@@ -136,6 +236,15 @@ bool Model::fillModelValues(State& state) {
 #endif
 }
 
+bool Model::fillModelValues(State& state) {
+	std::vector<int> columns;
+	if (!fillColumnIndex(state, columns)) {
+		state.result = false;
+		return false;
+	}
+	return fillModelValues(state, columns);
+}
+
 void Model::setValue(const Field& f, const std::string& value) {
 	core_assert(f.offset >= 0);
 	uint8_t* target = (uint8_t*)(_membersPointer + f.offset);
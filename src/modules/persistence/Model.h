@@ -91,7 +91,7 @@ typedef std::vector<std::set<std::string>> UniqueKeys;
 class Model {
 protected:
 	friend class DBHandler;
-	friend class PreparedStatement;
+	friend class AsyncDBHandler;
 	Fields _fields;
 	std::string _tableName;
 	int _primaryKeys = 0;
@@ -101,6 +101,11 @@ protected:
 	ForeignKeys _foreignKeys;
 
 	const Field& getField(const std::string& name) const;
+	/**
+	 * @brief Fills the values of the current row of the given state into this model
+	 * @param[in] columns The field index for every column - see @c fillColumnIndex()
+	 */
+	bool fillModelValues(State& state, const std::vector<int>& columns);
 	bool fillModelValues(State& state);
 public:
 	Model(const std::string& tableName);
@@ -120,6 +125,18 @@ public:
 
 	bool isPrimaryKey(const std::string& fieldname) const;
 
+	/**
+	 * @brief Maps the result columns of the given state to the index of the model fields
+	 * @param[out] columns The field index for every column
+	 * @return @c false if the result contains a column that is no field of this model
+	 */
+	bool fillColumnIndex(const State& state, std::vector<int>& columns) const;
+	/**
+	 * @brief Maps the given column names to the index of the model fields
+	 * @return @c false if a column is no field of this model
+	 */
+	bool fillColumnIndex(const std::vector<std::string>& columnNames, std::vector<int>& columns) const;
+
 	template<class T>
 	T getValue(const Field& f) const {
 		core_assert(f.nulloffset < 0);
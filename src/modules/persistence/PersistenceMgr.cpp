@@ -0,0 +1,346 @@
+/**
+ * @file
+ */
+
+#include "PersistenceMgr.h"
+#include "Connection.h"
+#include "SQLGenerator.h"
+#include "State.h"
+#include "metric/MetricEvent.h"
+#include "core/GameConfig.h"
+#include "core/Log.h"
+#include "core/Var.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace persistence {
+
+// the maximum amount of parameters of a postgres statement
+static constexpr int MaxStatementParameters = 65535;
+
+static std::string conflictKey(const Model& model, const std::vector<const Field*>& conflictFields) {
+	BindParam params((int)conflictFields.size());
+	for (const Field* f : conflictFields) {
+		params.push(model, *f);
+	}
+	std::string key;
+	for (int i = 0; i < params.position; ++i) {
+		if (params.values[i] != nullptr) {
+			key.append(params.values[i]);
+		}
+		key.append(1, '\0');
+	}
+	return key;
+}
+
+PersistenceMgr::PersistenceMgr(const core::EventBusPtr& eventBus, long collectIntervalMillis, int maxRowsPerStatement, size_t maxPendingRows) :
+		_eventBus(eventBus), _collectIntervalMillis(collectIntervalMillis), _maxRowsPerStatement(std::max(1, maxRowsPerStatement)),
+		_maxPendingRows(maxPendingRows) {
+}
+
+PersistenceMgr::~PersistenceMgr() {
+	shutdown();
+}
+
+bool PersistenceMgr::init() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_running) {
+		return true;
+	}
+	_connection = std::make_unique<Connection>();
+	_connection->changeDb(core::Var::getSafe(cfg::DatabaseName)->strVal());
+	_connection->changeHost(core::Var::getSafe(cfg::DatabaseHost)->strVal());
+	_connection->setLoginData(core::Var::getSafe(cfg::DatabaseUser)->strVal(), core::Var::getSafe(cfg::DatabasePassword)->strVal());
+	if (!_connection->connect()) {
+		Log::error("Could not connect the persistence manager to the database");
+		_connection.reset();
+		return false;
+	}
+	_running = true;
+	_thread = std::thread(&PersistenceMgr::run, this);
+	return true;
+}
+
+void PersistenceMgr::shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(_savablesMutex);
+		for (ISavable* savable : _savables) {
+			collect(savable);
+		}
+		_savables.clear();
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_running) {
+			return;
+		}
+		_running = false;
+	}
+	_wakeup.notify_all();
+	_thread.join();
+	_connection->disconnect();
+	_connection.reset();
+}
+
+bool PersistenceMgr::registerSavable(ISavable* savable) {
+	std::lock_guard<std::mutex> lock(_savablesMutex);
+	if (std::find(_savables.begin(), _savables.end(), savable) != _savables.end()) {
+		return false;
+	}
+	_savables.push_back(savable);
+	return true;
+}
+
+bool PersistenceMgr::unregisterSavable(ISavable* savable) {
+	std::lock_guard<std::mutex> lock(_savablesMutex);
+	auto i = std::find(_savables.begin(), _savables.end(), savable);
+	if (i == _savables.end()) {
+		return false;
+	}
+	_savables.erase(i);
+	collect(savable);
+	return true;
+}
+
+void PersistenceMgr::update(long dt) {
+	_sinceLastCollect += dt;
+	if (_sinceLastCollect < _collectIntervalMillis) {
+		return;
+	}
+	_sinceLastCollect = 0l;
+	std::lock_guard<std::mutex> lock(_savablesMutex);
+	for (ISavable* savable : _savables) {
+		collect(savable);
+	}
+}
+
+size_t PersistenceMgr::pendingRows() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	size_t rows = 0u;
+	for (const auto& table : _pending) {
+		rows += table.second.size();
+	}
+	return rows;
+}
+
+void PersistenceMgr::collect(ISavable* savable) {
+	Models models;
+	if (!savable->getDirtyModels(models)) {
+		return;
+	}
+	add(models);
+}
+
+void PersistenceMgr::add(Models& models) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (ModelPtr& model : models) {
+			const std::vector<const Field*>& conflictFields = createConflictFields(*model);
+			std::string key;
+			if (conflictFields.empty()) {
+				key = std::to_string(++_rowSequence);
+			} else {
+				key = conflictKey(*model, conflictFields);
+			}
+			_pending[model->tableName()][key] = std::move(model);
+		}
+	}
+	_wakeup.notify_one();
+}
+
+void PersistenceMgr::run() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;) {
+		_wakeup.wait(lock, [this] () {
+			return !_running || !_pending.empty();
+		});
+		if (_pending.empty()) {
+			break;
+		}
+		PendingRows rows;
+		rows.swap(_pending);
+		lock.unlock();
+		bool success = flush(rows);
+		if (!success && _connection->status()) {
+			// the connection is fine - so some of the rows are rejected
+			dropped(flushIsolated(rows));
+			success = rows.empty();
+		}
+		lock.lock();
+		if (success) {
+			continue;
+		}
+		size_t failedRows = 0u;
+		for (const auto& table : rows) {
+			failedRows += table.second.size();
+		}
+		dropped(requeue(rows));
+		if (!_running) {
+			Log::error("Could not write %i rows to the database", (int)failedRows);
+			break;
+		}
+		Log::warn("Could not write %i rows to the database - retry in %li ms", (int)failedRows, _collectIntervalMillis);
+		_wakeup.wait_for(lock, std::chrono::milliseconds(_collectIntervalMillis), [this] () {
+			return !_running;
+		});
+	}
+}
+
+int PersistenceMgr::requeue(PendingRows& rows) {
+	size_t pendingRows = 0u;
+	for (const auto& table : _pending) {
+		pendingRows += table.second.size();
+	}
+	int droppedRows = 0;
+	for (auto& table : rows) {
+		TableRows& pendingTable = _pending[table.first];
+		for (auto& row : table.second) {
+			// rows that were changed while the flush was running are newer than the failed ones
+			if (pendingTable.find(row.first) != pendingTable.end()) {
+				continue;
+			}
+			if (pendingRows >= _maxPendingRows) {
+				++droppedRows;
+				continue;
+			}
+			pendingTable.emplace(row.first, std::move(row.second));
+			++pendingRows;
+		}
+	}
+	if (droppedRows > 0) {
+		Log::error("Dropped %i rows - more than %i rows are waiting to be written", droppedRows, (int)_maxPendingRows);
+	}
+	return droppedRows;
+}
+
+void PersistenceMgr::dropped(int rows) {
+	if (rows <= 0 || !_eventBus) {
+		return;
+	}
+	_eventBus->publish(metric::count("persistence.dropped", rows));
+}
+
+int PersistenceMgr::flushIsolated(PendingRows& rows) {
+	size_t bytes = 0u;
+	int rowCount = 0;
+	int droppedRows = 0;
+	for (auto table = rows.begin(); table != rows.end();) {
+		if (flushTables({&table->second}, bytes, rowCount)) {
+			table = rows.erase(table);
+			continue;
+		}
+		TableRows& tableRows = table->second;
+		for (auto row = tableRows.begin(); row != tableRows.end();) {
+			if (execute({row->second.get()}, bytes)) {
+				++rowCount;
+				row = tableRows.erase(row);
+				continue;
+			}
+			if (!_connection->status()) {
+				// keep the remaining rows for the next retry
+				return droppedRows;
+			}
+			Log::error("Dropped a row of table '%s' that is rejected by the database", table->first.c_str());
+			++droppedRows;
+			row = tableRows.erase(row);
+		}
+		table = rows.erase(table);
+	}
+	if (_eventBus) {
+		_eventBus->publish(metric::count("persistence.rows", rowCount));
+		_eventBus->publish(metric::count("persistence.bytes", (int)bytes));
+	}
+	return droppedRows;
+}
+
+bool PersistenceMgr::execute(const std::vector<const Model*>& models, size_t& bytes) {
+	BindParam params((int)(models.size() * models.front()->fields().size()));
+	const std::string& statement = createUpsertStatement(models, &params);
+	State s(_connection.get());
+	if (!s.exec(statement.c_str(), params.position, params.values.data())) {
+		return false;
+	}
+	bytes += statement.size();
+	for (int i = 0; i < params.position; ++i) {
+		if (params.values[i] != nullptr) {
+			bytes += strlen(params.values[i]);
+		}
+	}
+	return true;
+}
+
+bool PersistenceMgr::flush(PendingRows& rows) {
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<const TableRows*> tables;
+	tables.reserve(rows.size());
+	for (const auto& table : rows) {
+		tables.push_back(&table.second);
+	}
+	size_t bytes = 0u;
+	int rowCount = 0;
+	const bool success = flushTables(tables, bytes, rowCount);
+	if (!_eventBus) {
+		return success;
+	}
+	if (!success) {
+		_eventBus->publish(metric::increment("persistence.failed"));
+		return false;
+	}
+	const long millis = (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	_eventBus->publish(metric::count("persistence.rows", rowCount));
+	_eventBus->publish(metric::count("persistence.bytes", (int)bytes));
+	_eventBus->publish(metric::timing("persistence.flush", (uint32_t)millis));
+	return true;
+}
+
+bool PersistenceMgr::flushTables(const std::vector<const TableRows*>& tables, size_t& bytes, int& rowCount) {
+	State begin(_connection.get());
+	if (!begin.exec(createTransactionBegin())) {
+		return false;
+	}
+	size_t tableBytes = 0u;
+	int tableRowCount = 0;
+	bool success = true;
+	std::vector<const Model*> models;
+	for (const TableRows* table : tables) {
+		if (table->empty()) {
+			continue;
+		}
+		const int fields = (int)table->begin()->second->fields().size();
+		const size_t maxRows = (size_t)std::min(_maxRowsPerStatement, MaxStatementParameters / std::max(1, fields));
+		models.clear();
+		for (const auto& row : *table) {
+			models.push_back(row.second.get());
+			if (models.size() >= maxRows) {
+				success = execute(models, tableBytes);
+				if (!success) {
+					break;
+				}
+				tableRowCount += (int)models.size();
+				models.clear();
+			}
+		}
+		if (success && !models.empty()) {
+			success = execute(models, tableBytes);
+			tableRowCount += (int)models.size();
+		}
+		if (!success) {
+			break;
+		}
+	}
+	if (success) {
+		State commit(_connection.get());
+		success = commit.exec(createTransactionCommit());
+	} else {
+		State rollback(_connection.get());
+		rollback.exec(createTransactionRollback());
+	}
+	if (success) {
+		bytes += tableBytes;
+		rowCount += tableRowCount;
+	}
+	return success;
+}
+
+}
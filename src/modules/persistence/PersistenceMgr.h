@@ -0,0 +1,127 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "ISavable.h"
+#include "core/EventBus.h"
+#include "core/NonCopyable.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace persistence {
+
+class Connection;
+
+/**
+ * @brief Collects the dirty rows of the registered @c ISavable instances on an interval and writes them
+ * in one transaction from a background thread.
+ *
+ * The rows of a table are written with multi-row upserts - see @c createUpsertStatement(). If a row is
+ * changed again before it was written, only the latest state is written. If the transaction fails while the
+ * connection is still fine, the tables are written in their own transactions and the rows of a failing table
+ * one by one - rows that are still rejected are dropped. Everything else is retried with the next flush - rows
+ * that were changed in the meantime are not overwritten by the old state. The amount of rows that are kept for
+ * a retry is limited.
+ *
+ * A change is written at the latest after the collect interval plus the time the pending flush takes.
+ *
+ * @note The background thread uses its own database connection - the @c ConnectionPool is not thread safe.
+ *
+ * @ingroup Persistence
+ */
+class PersistenceMgr : public core::NonCopyable {
+private:
+	// the conflict key of the row is the key - see createConflictFields()
+	typedef std::unordered_map<std::string, ModelPtr> TableRows;
+	// the table name is the key
+	typedef std::unordered_map<std::string, TableRows> PendingRows;
+
+	const core::EventBusPtr _eventBus;
+	const long _collectIntervalMillis;
+	const int _maxRowsPerStatement;
+	const size_t _maxPendingRows;
+	long _sinceLastCollect = 0l;
+	// for rows of tables without a conflict key - they are never merged
+	uint64_t _rowSequence = 0u;
+
+	std::mutex _savablesMutex;
+	std::vector<ISavable*> _savables;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _wakeup;
+	PendingRows _pending;
+	bool _running = false;
+	std::thread _thread;
+	std::unique_ptr<Connection> _connection;
+
+	void collect(ISavable* savable);
+	void add(Models& models);
+	void run();
+	bool flush(PendingRows& rows);
+	/**
+	 * @brief Writes the given tables in one transaction
+	 */
+	bool flushTables(const std::vector<const TableRows*>& tables, size_t& bytes, int& rowCount);
+	/**
+	 * @brief Writes the tables of a failed flush on their own - and the rows of the failing tables one by one
+	 * @note The written and the dropped rows are removed from the given rows. Stops if the connection is lost.
+	 * @return The amount of dropped rows
+	 */
+	int flushIsolated(PendingRows& rows);
+	/**
+	 * @brief Gives the rows of a failed flush back to the pending rows - as long as the limit isn't reached
+	 * @return The amount of dropped rows
+	 */
+	int requeue(PendingRows& rows);
+	void dropped(int rows);
+	bool execute(const std::vector<const Model*>& models, size_t& bytes);
+public:
+	/**
+	 * @param[in] eventBus Receives the metrics of the flushes - might be @c nullptr
+	 * @param[in] collectIntervalMillis The interval in which the dirty rows are collected in @c update()
+	 * @param[in] maxRowsPerStatement The maximum amount of rows in one insert statement
+	 * @param[in] maxPendingRows The maximum amount of rows that are kept for a retry after a failed flush
+	 */
+	PersistenceMgr(const core::EventBusPtr& eventBus, long collectIntervalMillis = 1000l, int maxRowsPerStatement = 500,
+			size_t maxPendingRows = 100000u);
+	~PersistenceMgr();
+
+	/**
+	 * @brief Connects to the database and starts the background thread
+	 */
+	bool init();
+	/**
+	 * @brief Collects the rows of all savables and writes all pending rows before the background
+	 * thread is stopped.
+	 */
+	void shutdown();
+
+	bool registerSavable(ISavable* savable);
+	/**
+	 * @brief Collects the dirty rows of the savable one last time
+	 */
+	bool unregisterSavable(ISavable* savable);
+
+	/**
+	 * @brief Collects the dirty rows of all savables if the collect interval is reached and hands them
+	 * over to the background thread.
+	 */
+	void update(long dt);
+
+	/**
+	 * @return The amount of rows that were collected but not yet written
+	 */
+	size_t pendingRows() const;
+};
+
+typedef std::shared_ptr<PersistenceMgr> PersistenceMgrPtr;
+
+}
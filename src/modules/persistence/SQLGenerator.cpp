@@ -10,6 +10,7 @@
 #include "Model.h"
 #include "DBCondition.h"
 #include "OrderBy.h"
+#include <algorithm>
 
 namespace persistence {
 
@@ -40,6 +41,16 @@ static inline bool placeholder(const Model& model, const Field& field, std::stri
 	return true;
 }
 
+/**
+ * @brief Pushes the parameter for the given field if @c placeholder() would add one for it
+ */
+static inline void pushParameter(const Model& model, const Field& field, BindParam& params) {
+	if (field.type == FieldType::TIMESTAMP && model.getValue<Timestamp>(field).isNow()) {
+		return;
+	}
+	params.push(model, field);
+}
+
 static std::string getDbFlags(int numberPrimaryKeys, const Constraints& constraints, const Field& field) {
 	char buf[1024] = { '\0' };
 	bool empty = true;
@@ -266,6 +277,20 @@ std::string createUpdateStatement(const Model& model, BindParam* params) {
 	return update.str();
 }
 
+void createUpdateParameters(const Model& model, BindParam& params) {
+	const Fields& fields = model.fields();
+	for (const Field& f : fields) {
+		if (!f.isPrimaryKey()) {
+			pushParameter(model, f, params);
+		}
+	}
+	for (const Field& f : fields) {
+		if (f.isPrimaryKey()) {
+			pushParameter(model, f, params);
+		}
+	}
+}
+
 std::string createDeleteStatement(const Model& table) {
 	return core::string::format("DELETE FROM \"%s\"", table.tableName().c_str());
 }
@@ -363,6 +388,132 @@ std::string createInsertStatement(const Model& model, BindParam* params) {
 	return insert.str();
 }
 
+void createInsertParameters(const Model& model, BindParam& params) {
+	const Fields& fields = model.fields();
+	for (const Field& f : fields) {
+		if (f.isAutoincrement() || model.isNull(f)) {
+			continue;
+		}
+		pushParameter(model, f, params);
+	}
+	if (model.primaryKeys() == 1) {
+		for (const Field& f : fields) {
+			if (f.isPrimaryKey() || f.isAutoincrement()) {
+				continue;
+			}
+			pushParameter(model, f, params);
+		}
+	}
+	for (const auto& set : model.uniqueKeys()) {
+		for (const Field& f : fields) {
+			if (f.isPrimaryKey() || f.isAutoincrement()) {
+				continue;
+			}
+			if (set.find(f.name) != set.end()) {
+				continue;
+			}
+			pushParameter(model, f, params);
+		}
+	}
+}
+
+std::string createStatementShape(const Model& model) {
+	const Fields& fields = model.fields();
+	std::string shape(fields.size(), '-');
+	for (size_t i = 0; i < fields.size(); ++i) {
+		const Field& f = fields[i];
+		if (model.isNull(f)) {
+			shape[i] = 'n';
+		} else if (f.type == FieldType::TIMESTAMP && model.getValue<Timestamp>(f).isNow()) {
+			shape[i] = 't';
+		}
+	}
+	return shape;
+}
+
+std::vector<const Field*> createConflictFields(const Model& model) {
+	std::vector<const Field*> conflictFields;
+	const Fields& fields = model.fields();
+	for (const Field& f : fields) {
+		if (f.isPrimaryKey()) {
+			conflictFields.push_back(&f);
+		}
+	}
+	if (!conflictFields.empty() || model.uniqueKeys().empty()) {
+		return conflictFields;
+	}
+	const std::set<std::string>& set = model.uniqueKeys().front();
+	for (const Field& f : fields) {
+		if (set.find(f.name) != set.end()) {
+			conflictFields.push_back(&f);
+		}
+	}
+	return conflictFields;
+}
+
+std::string createUpsertStatement(const std::vector<const Model*>& models, BindParam* params) {
+	if (models.empty()) {
+		return "";
+	}
+	const Model& first = *models.front();
+	const Fields& fields = first.fields();
+	std::stringstream insert;
+	insert << "INSERT INTO \"" << first.tableName() << "\" (";
+	insert << core::string::join(fields.begin(), fields.end(), ", ", [] (const Field& f) {
+		return core::string::format("\"%s\"", f.name.c_str());
+	});
+	insert << ") VALUES ";
+	int insertValueIndex = 1;
+	for (size_t i = 0; i < models.size(); ++i) {
+		const Model& model = *models[i];
+		core_assert_msg(model.tableName() == first.tableName(), "All rows must be of the table %s", first.tableName().c_str());
+		if (i > 0) {
+			insert << ", ";
+		}
+		insert << "(";
+		for (size_t fieldIndex = 0; fieldIndex < fields.size(); ++fieldIndex) {
+			const Field& f = fields[fieldIndex];
+			if (fieldIndex > 0) {
+				insert << ", ";
+			}
+			if (model.isNull(f)) {
+				insert << "NULL";
+				continue;
+			}
+			if (placeholder(model, f, insert, insertValueIndex)) {
+				++insertValueIndex;
+				if (params != nullptr) {
+					params->push(model, f);
+				}
+			}
+		}
+		insert << ")";
+	}
+
+	const std::vector<const Field*>& conflictFields = createConflictFields(first);
+	if (conflictFields.empty()) {
+		return insert.str();
+	}
+	insert << " ON CONFLICT (";
+	insert << core::string::join(conflictFields.begin(), conflictFields.end(), ", ", [] (const Field* f) {
+		return core::string::format("\"%s\"", f->name.c_str());
+	});
+	insert << ") DO ";
+	int updated = 0;
+	for (const Field& f : fields) {
+		if (std::find(conflictFields.begin(), conflictFields.end(), &f) != conflictFields.end()) {
+			continue;
+		}
+		insert << (updated > 0 ? ", " : "UPDATE SET ");
+		insert << "\"" << f.name << "\" = EXCLUDED.\"" << f.name << "\"";
+		++updated;
+	}
+	if (updated == 0) {
+		insert << "NOTHING";
+	}
+	return insert.str();
+}
+
 // https://www.postgresql.org/docs/current/static/functions-formatting.html
 // https://www.postgresql.org/docs/current/static/functions-datetime.html
 std::string createSelect(const Model& model) {
@@ -397,16 +548,16 @@ std::string createOrderBy(const OrderBy& orderBy) {
 	return core::string::format(" ORDER BY \"%s\" %s", orderBy.fieldname, OrderStrings[std::enum_value(orderBy.order)]);
 }
 
-std::string createLimitOffset(const Range& range) {
+std::string createLimitOffset(const Range& range, int &parameterCount) {
 	if (range.limit <= 0 && range.offset <= 0) {
 		return "";
 	}
 	std::stringstream ss;
 	if (range.limit > 0) {
-		ss << " LIMIT " << range.limit;
+		ss << " LIMIT $" << ++parameterCount;
 	}
 	if (range.offset > 0) {
-		ss << " OFFSET " << range.offset;
+		ss << " OFFSET $" << ++parameterCount;
 	}
 	return ss.str();
 }
@@ -11,6 +11,7 @@
 namespace persistence {
 
 struct BindParam;
+struct Field;
 class Model;
 class DBCondition;
 class OrderBy;
@@ -22,6 +23,31 @@ extern std::string createDropTableStatement(const Model& model);
 extern std::string createUpdateStatement(const Model& model, BindParam* params = nullptr);
 extern std::string createDeleteStatement(const Model& model);
 extern std::string createInsertStatement(const Model& model, BindParam* params = nullptr);
+/**
+ * @brief Pushes the parameters for the statement of @c createUpdateStatement() without building the statement
+ */
+extern void createUpdateParameters(const Model& model, BindParam& params);
+/**
+ * @brief Pushes the parameters for the statement of @c createInsertStatement() without building the statement
+ */
+extern void createInsertParameters(const Model& model, BindParam& params);
+/**
+ * @brief The parts of the model values that change the insert and update statements - models with the
+ * same shape can share the same prepared statement.
+ */
+extern std::string createStatementShape(const Model& model);
+/**
+ * @brief The fields that identify a row in the conflict clause of @c createUpsertStatement() - the
+ * primary keys or the first unique key. Empty if the table has neither.
+ */
+extern std::vector<const Field*> createConflictFields(const Model& model);
+/**
+ * @brief Creates one insert statement for all the given rows of the same table. Rows that already exist
+ * are overwritten with the values of the models.
+ * @note The models must contain the complete state of the row - the update operators of the fields are
+ * not applied.
+ */
+extern std::string createUpsertStatement(const std::vector<const Model*>& models, BindParam* params = nullptr);
 
 extern std::string createSelect(const Model& model);
 extern const char* createTransactionBegin();
@@ -30,6 +56,10 @@ extern const char* createTransactionRollback();
 
 extern std::string createWhere(const DBCondition& condition, int &parameterCount);
 extern std::string createOrderBy(const OrderBy& orderBy);
-extern std::string createLimitOffset(const Range& range);
+/**
+ * @brief Placeholders for the limit and the offset - so every page of a select shares one prepared statement
+ * @param[in,out] parameterCount The amount of parameters of the statement so far - increased by the placeholders
+ */
+extern std::string createLimitOffset(const Range& range, int &parameterCount);
 
 }
@@ -19,7 +19,7 @@ State::State(Connection* connection) :
 
 State::State(State&& other) :
 		res(other.res), lastErrorMsg(other.lastErrorMsg), affectedRows(
-				other.affectedRows), result(other.result) {
+				other.affectedRows), currentRow(other.currentRow), result(other.result) {
 	other.res = nullptr;
 	other._connection = nullptr;
 	other.lastErrorMsg = nullptr;
@@ -63,14 +63,22 @@ bool State::prepare(const char *name, const char* statement, int parameterCount)
 	return true;
 }
 
-bool State::execPrepared(const char *name, int parameterCount, const char *const *paramValues) {
+bool State::execPrepared(const char *name, int parameterCount, const char *const *paramValues, bool binaryResult) {
+	core_assert_msg(parameterCount <= 0 || paramValues != nullptr, "Parameters don't match");
 #ifdef HAVE_POSTGRES
-	res = PQexecPrepared(_connection->connection(), name, parameterCount, paramValues, nullptr, nullptr, 0);
+	res = PQexecPrepared(_connection->connection(), name, parameterCount, paramValues, nullptr, nullptr, binaryResult ? 1 : 0);
 #endif
 	checkLastResult(_connection->connection());
 	return result;
 }
 
+bool State::setResult(ResultType* result) {
+	core_assert_msg(res == nullptr, "The state already has a result");
+	res = result;
+	checkLastResult(_connection->connection());
+	return this->result;
+}
+
 void State::checkLastResult(ConnectionType* connection) {
 	affectedRows = 0;
 	if (res == nullptr) {
@@ -24,7 +24,15 @@ public:
 
 	bool exec(const char* statement, int parameterCount = 0, const char *const *paramValues = nullptr);
 	bool prepare(const char *name, const char* statement, int parameterCount);
-	bool execPrepared(const char *name, int parameterCount, const char *const *paramValues);
+	/**
+	 * @param[in] binaryResult Request the result values in the binary format of the database - this
+	 * saves the string conversion of the values.
+	 */
+	bool execPrepared(const char *name, int parameterCount, const char *const *paramValues, bool binaryResult = false);
+	/**
+	 * @brief Takes the ownership of a result that was received for an asynchronously sent query
+	 */
+	bool setResult(ResultType* result);
 
 	ResultType* res = nullptr;
 
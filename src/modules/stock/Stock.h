@@ -73,8 +73,17 @@ public:
 
 	const Inventory& inventory() const;
 	Inventory& inventory();
+
+	/**
+	 * @return All the items of the stock by their @c ItemId
+	 */
+	const std::unordered_map<ItemId, ItemPtr>& items() const;
 };
 
+inline const std::unordered_map<ItemId, ItemPtr>& Stock::items() const {
+	return _items;
+}
+
 inline const Inventory& Stock::inventory() const {
 	return _inventory;
 }
@@ -3,6 +3,7 @@
  */
 
 #include "BiomeManager.h"
+#include "WorldColumnCache.h"
 #include "noise/Noise.h"
 #include "noise/PoissonDiskDistribution.h"
 #include "core/Random.h"
@@ -14,6 +15,8 @@
 #include "BiomeLUAFunctions.h"
 #include "commonlua/LUAFunctions.h"
 #include <utility>
+#include <algorithm>
+#include <limits>
 
 namespace voxel {
 
@@ -46,7 +49,10 @@ void BiomeManager::shutdown() {
 			delete zone;
 		}
 		_zones[i].clear();
+		_zoneGrid[i].clear();
 	}
+	_biomeBands[0].clear();
+	_biomeBands[1].clear();
 }
 
 bool BiomeManager::init(const std::string& luaString) {
@@ -62,6 +68,15 @@ bool BiomeManager::init(const std::string& luaString) {
 	});
 	lua.reg("biomeMgr", &funcs.front());
 	biomelua_biomeregister(lua.state());
+	// the lookup is built once after all the biomes of the script were added
+	_loadingBiomes = true;
+	const bool loaded = loadBiomes(lua, luaString);
+	_loadingBiomes = false;
+	buildBiomeLookup();
+	return loaded;
+}
+
+bool BiomeManager::loadBiomes(lua::LUA& lua, const std::string& luaString) {
 	if (!lua.load(luaString)) {
 		Log::error("Could not load lua script. Failed with error: %s", lua.error().c_str());
 		return false;
@@ -86,9 +101,75 @@ Biome* BiomeManager::addBiome(int lower, int upper, float humidity, float temper
 	const MaterialColorIndices& indices = getMaterialIndices(type);
 	Biome* biome = new Biome(type, indices, int16_t(lower), int16_t(upper), humidity, temperature, underGround);
 	_bioms.push_back(biome);
+	if (!_loadingBiomes) {
+		buildBiomeLookup();
+	}
 	return biome;
 }
 
+void BiomeManager::buildBiomeLookup() {
+	core_trace_scoped(BiomeBuildLookup);
+	const float cellSize = 1.0f / BIOME_LOOKUP_SIZE;
+	// make the cells a little bit bigger to be on the safe side with rounding errors at the borders
+	const float epsilon = 0.0001f;
+	for (int u = 0; u < 2; ++u) {
+		const bool underground = u == 1;
+		std::vector<BiomeBand>& bands = _biomeBands[u];
+		bands.clear();
+
+		std::vector<int> breakpoints;
+		for (const Biome* biome : _bioms) {
+			if (biome->underground != underground) {
+				continue;
+			}
+			breakpoints.push_back(biome->yMin);
+			breakpoints.push_back(biome->yMax + 1);
+		}
+		std::sort(breakpoints.begin(), breakpoints.end());
+		breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+
+		std::vector<const Biome*> biomes;
+		for (size_t b = 1; b < breakpoints.size(); ++b) {
+			BiomeBand band;
+			band.yMin = breakpoints[b - 1];
+			band.yMax = breakpoints[b] - 1;
+			biomes.clear();
+			for (const Biome* biome : _bioms) {
+				if (biome->underground == underground && biome->yMin <= band.yMin && biome->yMax >= band.yMax) {
+					biomes.push_back(biome);
+				}
+			}
+			band.offsets.reserve(BIOME_LOOKUP_SIZE * BIOME_LOOKUP_SIZE + 1);
+			for (int h = 0; h < BIOME_LOOKUP_SIZE; ++h) {
+				const float hMin = h * cellSize - epsilon;
+				const float hMax = (h + 1) * cellSize + epsilon;
+				for (int t = 0; t < BIOME_LOOKUP_SIZE; ++t) {
+					const float tMin = t * cellSize - epsilon;
+					const float tMax = (t + 1) * cellSize + epsilon;
+					band.offsets.push_back((uint32_t)band.candidates.size());
+					// the smallest distance that is reached for every position in this cell
+					float bound = std::numeric_limits<float>::max();
+					for (const Biome* biome : biomes) {
+						const float dT = glm::max(glm::abs(biome->temperature - tMin), glm::abs(biome->temperature - tMax));
+						const float dH = glm::max(glm::abs(biome->humidity - hMin), glm::abs(biome->humidity - hMax));
+						bound = glm::min(bound, dT * dT + dH * dH);
+					}
+					// keep the order of the biomes - the first one wins if the distance is equal
+					for (const Biome* biome : biomes) {
+						const float dT = biome->temperature - glm::clamp(biome->temperature, tMin, tMax);
+						const float dH = biome->humidity - glm::clamp(biome->humidity, hMin, hMax);
+						if (dT * dT + dH * dH <= bound) {
+							band.candidates.push_back(biome);
+						}
+					}
+				}
+			}
+			band.offsets.push_back((uint32_t)band.candidates.size());
+			bands.push_back(std::move(band));
+		}
+	}
+}
+
 float BiomeManager::getHumidity(int x, int z) const {
 	core_trace_scoped(BiomeGetHumidity);
 	const float frequency = 0.001f;
@@ -126,12 +207,55 @@ const Biome* BiomeManager::getBiome(const glm::ivec3& pos, bool underground) con
 		humidity = last.humidity;
 		temperature = last.temperature;
 	} else {
-		last.humidity = humidity = getHumidity(pos.x, pos.z);
-		last.temperature = temperature = getTemperature(pos.x, pos.z);
+		if (_columnCache != nullptr) {
+			const ColumnData& column = _columnCache->column(pos.x, pos.z);
+			humidity = column.humidity;
+			temperature = column.temperature;
+		} else {
+			humidity = getHumidity(pos.x, pos.z);
+			temperature = getTemperature(pos.x, pos.z);
+		}
+		last.humidity = humidity;
+		last.temperature = temperature;
 		last.pos = pos;
 		last.underground = underground;
 	}
+	return getBiome(pos, humidity, temperature, underground);
+}
+
+const Biome* BiomeManager::getBiome(const glm::ivec3& pos, float humidity, float temperature, bool underground) const {
+	core_assert_msg(_defaultBiome != nullptr, "BiomeManager is not yet initialized");
+	if (humidity < 0.0f || humidity > 1.0f || temperature < 0.0f || temperature > 1.0f) {
+		// not covered by the lookup table
+		return getBiomeSlow(pos, humidity, temperature, underground);
+	}
+	core_trace_scoped(BiomeGetBiomeLookup);
+	const std::vector<BiomeBand>& bands = _biomeBands[underground ? 1 : 0];
+	auto band = std::lower_bound(bands.begin(), bands.end(), pos.y, [] (const BiomeBand& b, int y) {
+		return b.yMax < y;
+	});
+	if (band == bands.end() || band->yMin > pos.y) {
+		return _defaultBiome;
+	}
+	const int h = glm::min((int)(humidity * BIOME_LOOKUP_SIZE), BIOME_LOOKUP_SIZE - 1);
+	const int t = glm::min((int)(temperature * BIOME_LOOKUP_SIZE), BIOME_LOOKUP_SIZE - 1);
+	const int cell = h * BIOME_LOOKUP_SIZE + t;
+	const Biome *biomeBestMatch = _defaultBiome;
+	float distMin = std::numeric_limits<float>::max();
+	for (uint32_t i = band->offsets[cell]; i < band->offsets[cell + 1]; ++i) {
+		const Biome* biome = band->candidates[i];
+		const float dTemperature = temperature - biome->temperature;
+		const float dHumidity = humidity - biome->humidity;
+		const float dist = (dTemperature * dTemperature) + (dHumidity * dHumidity);
+		if (dist < distMin) {
+			biomeBestMatch = biome;
+			distMin = dist;
+		}
+	}
+	return biomeBestMatch;
+}
 
+const Biome* BiomeManager::getBiomeSlow(const glm::ivec3& pos, float humidity, float temperature, bool underground) const {
 	const Biome *biomeBestMatch = _defaultBiome;
 	float distMin = std::numeric_limits<float>::max();
 
@@ -255,11 +379,31 @@ int BiomeManager::getCityDensity(const glm::ivec2& pos) const {
 }
 
 void BiomeManager::addZone(const glm::ivec3& pos, float radius, ZoneType type) {
-	_zones[std::enum_value(type)].push_back(new Zone(pos, radius, type));
+	Zone* zone = new Zone(pos, radius, type);
+	_zones[std::enum_value(type)].push_back(zone);
+	// register the zone in every grid cell that its bounding rect touches
+	const int r = (int)glm::ceil(radius);
+	const glm::ivec2& mins = zoneCell(pos.x - r, pos.z - r);
+	const glm::ivec2& maxs = zoneCell(pos.x + r, pos.z + r);
+	ZoneGrid& grid = _zoneGrid[std::enum_value(type)];
+	for (int z = mins.y; z <= maxs.y; ++z) {
+		for (int x = mins.x; x <= maxs.x; ++x) {
+			grid[glm::ivec2(x, z)].push_back(zone);
+		}
+	}
+	if (_columnCache != nullptr) {
+		// the city factor of the cached columns might have changed
+		_columnCache->clear();
+	}
 }
 
 const Zone* BiomeManager::getZone(const glm::ivec3& pos, ZoneType type) const {
-	for (const Zone* z : _zones[std::enum_value(type)]) {
+	const ZoneGrid& grid = _zoneGrid[std::enum_value(type)];
+	auto i = grid.find(zoneCell(pos.x, pos.z));
+	if (i == grid.end()) {
+		return nullptr;
+	}
+	for (const Zone* z : i->second) {
 		const float distance = glm::distance2(glm::vec3(pos), glm::vec3(z->pos()));
 		if (distance < glm::pow(z->radius(), 2)) {
 			return z;
@@ -269,8 +413,13 @@ const Zone* BiomeManager::getZone(const glm::ivec3& pos, ZoneType type) const {
 }
 
 const Zone* BiomeManager::getZone(const glm::ivec2& pos, ZoneType type) const {
+	const ZoneGrid& grid = _zoneGrid[std::enum_value(type)];
+	auto i = grid.find(zoneCell(pos.x, pos.y));
+	if (i == grid.end()) {
+		return nullptr;
+	}
 	const glm::vec3 p(pos.x, 0.0f, pos.y);
-	for (const Zone* z : _zones[std::enum_value(type)]) {
+	for (const Zone* z : i->second) {
 		const glm::ivec3& zp = z->pos();
 		const float distance = glm::distance2(p, glm::vec3(zp.x, 0.0f, zp.z));
 		if (distance < glm::pow(z->radius(), 2)) {
@@ -306,6 +455,10 @@ bool BiomeManager::hasCity(const glm::ivec3& pos) const {
 	return getZone(pos, ZoneType::City) != nullptr;
 }
 
+void BiomeManager::setColumnCache(WorldColumnCache* columnCache) {
+	_columnCache = columnCache;
+}
+
 void BiomeManager::setDefaultBiome(const Biome* biome) {
 	if (biome == nullptr) {
 		biome = &getDefaultBiome();
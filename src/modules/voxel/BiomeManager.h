@@ -7,15 +7,22 @@
 #include "core/Trace.h"
 #include "Biome.h"
 #include "TreeContext.h"
-#include <glm/glm.hpp>
+#include "core/GLM.h"
+#include <vector>
+#include <unordered_map>
 
 namespace core {
 class Random;
 }
 
+namespace lua {
+class LUA;
+}
+
 namespace voxel {
 
 class Region;
+class WorldColumnCache;
 
 enum class ZoneType {
 	City,
@@ -52,10 +59,47 @@ inline float Zone::radius() const {
 
 class BiomeManager {
 private:
+	/**
+	 * @brief The zones are sorted into grid cells of this size (as power of two) on the xz plane
+	 */
+	static constexpr int ZONE_CELL_SHIFT = 8;
+	/**
+	 * @brief The resolution of the humidity/temperature lookup table of each biome band
+	 */
+	static constexpr int BIOME_LOOKUP_SIZE = 32;
+
+	/**
+	 * @brief The biomes that are valid for a range of heights. For each humidity/temperature cell of the
+	 * lookup table only those biomes are stored that might be the closest match for a position in that cell.
+	 */
+	struct BiomeBand {
+		int yMin;
+		int yMax;
+		// BIOME_LOOKUP_SIZE * BIOME_LOOKUP_SIZE + 1 offsets into the candidates
+		std::vector<uint32_t> offsets;
+		std::vector<const Biome*> candidates;
+	};
+
+	typedef std::unordered_map<glm::ivec2, std::vector<const Zone*>, std::hash<glm::ivec2> > ZoneGrid;
+
 	std::vector<Biome*> _bioms;
 	std::vector<Zone*> _zones[int(ZoneType::Max)];
+	ZoneGrid _zoneGrid[int(ZoneType::Max)];
+	// sorted by height - one list for the biomes above and one for those below the ground
+	std::vector<BiomeBand> _biomeBands[2];
 	const Biome* _defaultBiome = nullptr;
+	WorldColumnCache* _columnCache = nullptr;
+	// set while the biome script is executed - the lookup is only built once afterwards
+	bool _loadingBiomes = false;
 	void distributePointsInRegion(const char *type, const Region& region, std::vector<glm::vec2>& positions, core::Random& random, int border, float distribution) const;
+	void buildBiomeLookup();
+	bool loadBiomes(lua::LUA& lua, const std::string& luaString);
+	const Biome* getBiomeSlow(const glm::ivec3& pos, float humidity, float temperature, bool underground) const;
+
+	static inline glm::ivec2 zoneCell(int x, int z) {
+		// arithmetic shift - rounds towards negative infinity
+		return glm::ivec2(x >> ZONE_CELL_SHIFT, z >> ZONE_CELL_SHIFT);
+	}
 
 public:
 	BiomeManager();
@@ -80,6 +124,15 @@ public:
 		return getVoxel(glm::ivec3(x, y, z), underground);
 	}
 
+	/**
+	 * @brief Same as the other @c getVoxel() variants - but with the already known humidity and temperature of the column
+	 */
+	inline Voxel getVoxel(const glm::ivec3& pos, float humidity, float temperature, bool underground = false) const {
+		core_trace_scoped(BiomeGetVoxel);
+		const Biome* biome = getBiome(pos, humidity, temperature, underground);
+		return biome->voxel();
+	}
+
 	bool hasCactus(const glm::ivec3& pos) const;
 	bool hasTrees(const glm::ivec3& pos) const;
 	bool hasCity(const glm::ivec3& pos) const;
@@ -107,7 +160,14 @@ public:
 
 	void setDefaultBiome(const Biome* biome);
 
+	/**
+	 * @brief The humidity and temperature lookups of @c getBiome() are taken from the given cache
+	 * @param[in] columnCache The cache or @c nullptr to compute the noise for each lookup
+	 */
+	void setColumnCache(WorldColumnCache* columnCache);
+
 	const Biome* getBiome(const glm::ivec3& pos, bool underground = false) const;
+	const Biome* getBiome(const glm::ivec3& pos, float humidity, float temperature, bool underground = false) const;
 };
 
 }
@@ -7,6 +7,7 @@
 #include "core/Log.h"
 #include "core/Common.h"
 #include "core/Trace.h"
+#include "core/TimeProvider.h"
 #include "io/File.h"
 #include "core/Random.h"
 #include "core/Concurrency.h"
@@ -21,8 +22,9 @@
 
 namespace voxel {
 
-World::World() :
-		_threadPool(core::halfcpus(), "World"), _random(_seed) {
+World::World(uint32_t extractionThreads) :
+		_extractionThreads((std::max)(1u, extractionThreads)), _threadPool(_extractionThreads, "World"),
+		_workerStats(_extractionThreads), _random(_seed) {
 }
 
 World::~World() {
@@ -34,11 +36,14 @@ glm::ivec3 World::randomPos() const {
 	int lowestZ = -100;
 	int highestX = 100;
 	int highestZ = 100;
-	for (const glm::ivec3& gridPos : _positionsExtracted) {
-		lowestX = std::min(lowestX, gridPos.x);
-		lowestZ = std::min(lowestZ, gridPos.z);
-		highestX = std::min(highestX, gridPos.x);
-		highestZ = std::min(highestZ, gridPos.z);
+	{
+		core::ScopedReadLock lock(_positionsExtractedLock);
+		for (const glm::ivec3& gridPos : _positionsExtracted) {
+			lowestX = std::min(lowestX, gridPos.x);
+			lowestZ = std::min(lowestZ, gridPos.z);
+			highestX = std::min(highestX, gridPos.x);
+			highestZ = std::min(highestZ, gridPos.z);
+		}
 	}
 	const int x = _random.random(lowestX, highestX);
 	const int z = _random.random(lowestZ, highestZ);
@@ -54,13 +59,16 @@ bool World::scheduleMeshExtraction(const glm::ivec3& p) {
 		return false;
 	}
 	const glm::ivec3& pos = meshPos(p);
-	auto i = _positionsExtracted.insert(pos);
-	if (!i.second) {
-		return false;
+	{
+		core::ScopedWriteLock lock(_positionsExtractedLock);
+		auto i = _positionsExtracted.insert(pos);
+		if (!i.second) {
+			return false;
+		}
 	}
 	Log::trace("mesh extraction for %i:%i:%i (%i:%i:%i)",
 			p.x, p.y, p.z, pos.x, pos.y, pos.z);
-	_pendingExtraction.push(pos);
+	_pendingExtraction.push(PendingExtraction{pos, extractionPriority(pos)});
 	return true;
 }
 
@@ -83,12 +91,62 @@ void World::setVoxel(const glm::ivec3& pos, const voxel::Voxel& voxel) {
 	scheduleMeshExtraction(pos);
 }
 
-void World::updateExtractionOrder(const glm::ivec3& sortPos, const core::Frustum& frustum) {
-	// TODO: sort closest to camera and in frustum first
+int64_t World::extractionPriority(const glm::ivec3& pos) const {
+	// 64 bit - the squared distance of far away positions doesn't fit into an int
+	const int64_t dx = (int64_t)pos.x - _extractionSortPos.x;
+	const int64_t dz = (int64_t)pos.z - _extractionSortPos.z;
+	const int64_t distance = dx * dx + dz * dz;
+	if (!_extractionFrustumValid) {
+		return distance;
+	}
+	const glm::vec3 mins(pos);
+	const glm::vec3 maxs(pos + meshSize());
+	if (_extractionFrustum.isVisible(mins, maxs)) {
+		return distance;
+	}
+	// not visible - but still extract those that are close before the visible ones
+	// that are far away, the camera might just turn around.
+	return distance * 4 + 1;
+}
+
+void World::updateExtractionOrder(const glm::ivec3& sortPos, const core::Frustum& frustum, int maxDistanceSquare) {
+	core_trace_scoped(UpdateExtractionOrder);
+	_extractionSortPos = sortPos;
+	_extractionFrustum = frustum;
+	_extractionFrustumValid = true;
+	_staleExtractions.clear();
+	// this is O(n) for updating the priorities and O(n) for rebuilding the heap
+	_pendingExtraction.modify([&] (std::vector<PendingExtraction>& pending) {
+		size_t n = pending.size();
+		for (size_t i = 0; i < n;) {
+			PendingExtraction& e = pending[i];
+			if (maxDistanceSquare >= 0) {
+				const int64_t dx = (int64_t)e.pos.x - sortPos.x;
+				const int64_t dz = (int64_t)e.pos.z - sortPos.z;
+				if (dx * dx + dz * dz > (int64_t)maxDistanceSquare) {
+					_staleExtractions.push_back(e.pos);
+					e = pending[--n];
+					continue;
+				}
+			}
+			e.priority = extractionPriority(e.pos);
+			++i;
+		}
+		pending.resize(n);
+	});
+	if (_staleExtractions.empty()) {
+		return;
+	}
+	Log::trace("Dropped %i stale mesh extractions", (int)_staleExtractions.size());
+	core::ScopedWriteLock lock(_positionsExtractedLock);
+	for (const glm::ivec3& pos : _staleExtractions) {
+		_positionsExtracted.erase(pos);
+	}
 }
 
 bool World::allowReExtraction(const glm::ivec3& pos) {
 	const glm::ivec3& gridPos = meshPos(pos);
+	core::ScopedWriteLock lock(_positionsExtractedLock);
 	return _positionsExtracted.erase(gridPos) != 0;
 }
 
@@ -119,24 +177,30 @@ bool World::init(const std::string& luaParameters, const std::string& luaBiomes,
 	_volumeData = new PagedVolume(&_pager, volumeMemoryMegaBytes * 1024 * 1024, chunkSideLength);
 
 	_pager.init(_volumeData, &_biomeManager, &_ctx);
+	_biomeManager.setColumnCache(&_pager.columnCache());
 	if (_clientData) {
 		_pager.setCreateFlags(voxel::world::WORLDGEN_CLIENT);
 	} else {
 		_pager.setCreateFlags(voxel::world::WORLDGEN_SERVER);
 	}
 
-	_threadPool.enqueue([this] () {extractScheduledMesh();});
+	for (uint32_t i = 0u; i < _extractionThreads; ++i) {
+		_threadPool.enqueue([this, i] () {extractScheduledMesh((int)i);});
+	}
 
 	return true;
 }
 
-void World::extractScheduledMesh() {
+void World::extractScheduledMesh(int workerId) {
+	WorkerStats& workerStats = _workerStats[workerId];
 	while (!_cancelThreads) {
-		core_trace_scoped(MeshExtraction);
-		decltype(_pendingExtraction)::Key pos;
-		if (!_pendingExtraction.waitAndPop(pos)) {
+		PendingExtraction pending;
+		if (!_pendingExtraction.waitAndPop(pending)) {
 			break;
 		}
+		const glm::ivec3& pos = pending.pos;
+		core_trace_scoped(MeshExtraction);
+		const double startSeconds = core::TimeProvider::systemNanos();
 		const glm::ivec3& size = meshSize();
 		const glm::ivec3 mins(pos);
 		const glm::ivec3 maxs(glm::ivec3(pos) + size - 1);
@@ -151,7 +215,11 @@ void World::extractScheduledMesh() {
 				&data.opaqueMesh, &data.waterMesh,
 				IsQuadNeeded(), IsWaterQuadNeeded(),
 				MAX_WATER_HEIGHT);
+		const double deltaSeconds = core::TimeProvider::systemNanos() - startSeconds;
+		workerStats.micros += (uint64_t)(deltaSeconds * 1000000.0);
+		++workerStats.extracted;
 		if (data.waterMesh.isEmpty() && data.opaqueMesh.isEmpty()) {
+			++workerStats.empty;
 			continue;
 		}
 		_extracted.push(std::move(data));
@@ -165,8 +233,12 @@ void World::shutdown() {
 	_extracted.clear();
 	_extracted.abortWait();
 	_threadPool.shutdown();
-	_positionsExtracted.clear();
+	{
+		core::ScopedWriteLock lock(_positionsExtractedLock);
+		_positionsExtracted.clear();
+	}
 	_extracted.clear();
+	_biomeManager.setColumnCache(nullptr);
 	_pager.shutdown();
 	_biomeManager.shutdown();
 	delete _volumeData;
@@ -187,11 +259,25 @@ void World::onFrame(long dt) {
 }
 
 void World::stats(int& meshes, int& extracted, int& pending) const {
-	extracted = _positionsExtracted.size();
+	{
+		core::ScopedReadLock lock(_positionsExtractedLock);
+		extracted = _positionsExtracted.size();
+	}
 	pending = _pendingExtraction.size();
 	meshes = _extracted.size();
 }
 
+void World::stats(std::vector<ExtractionWorkerStats>& workers) const {
+	workers.resize(_workerStats.size());
+	for (size_t i = 0; i < _workerStats.size(); ++i) {
+		const WorkerStats& in = _workerStats[i];
+		ExtractionWorkerStats& out = workers[i];
+		out.extracted = in.extracted;
+		out.empty = in.empty;
+		out.seconds = (double)in.micros / 1000000.0;
+	}
+}
+
 bool World::raycast(const glm::vec3& start, const glm::vec3& direction, float maxDistance, glm::ivec3& hit, Voxel& voxel) const {
 	const bool result = raycast(start, direction, maxDistance, [&] (const PagedVolume::Sampler& sampler) {
 		voxel = sampler.voxel();
@@ -23,6 +23,8 @@
 #include "BiomeManager.h"
 #include "core/ConcurrentQueue.h"
 #include "core/ThreadPool.h"
+#include "core/ReadWriteLock.h"
+#include "core/Concurrency.h"
 #include "core/Var.h"
 #include "core/Random.h"
 #include "core/Log.h"
@@ -50,6 +52,25 @@ struct ChunkMeshes {
 
 typedef std::unordered_set<glm::ivec3, std::hash<glm::ivec3> > PositionSet;
 
+/**
+ * @brief Throughput statistics of a single mesh extraction worker
+ */
+struct ExtractionWorkerStats {
+	/** amount of mesh regions that were extracted by this worker (including empty ones) */
+	int extracted = 0;
+	/** amount of mesh regions that didn't produce any geometry */
+	int empty = 0;
+	/** accumulated time in seconds this worker spent in the extraction */
+	double seconds = 0.0;
+
+	inline double meshesPerSecond() const {
+		if (seconds <= 0.0) {
+			return 0.0;
+		}
+		return extracted / seconds;
+	}
+};
+
 class World {
 public:
 	enum Result {
@@ -58,7 +79,10 @@ public:
 		FAILED
 	};
 
-	World();
+	/**
+	 * @param[in] extractionThreads The amount of worker threads that are used to extract the meshes in parallel
+	 */
+	World(uint32_t extractionThreads = core::halfcpus());
 	~World();
 
 	void setContext(const WorldContext& ctx);
@@ -141,6 +165,17 @@ public:
 
 	void stats(int& meshes, int& extracted, int& pending) const;
 
+	/**
+	 * @brief Per worker throughput of the mesh extraction
+	 * @param[out] workers One entry for each extraction worker thread
+	 */
+	void stats(std::vector<ExtractionWorkerStats>& workers) const;
+
+	/**
+	 * @return The amount of threads that are extracting meshes in parallel
+	 */
+	int extractionThreads() const;
+
 	/**
 	 * @brief If you don't need an extracted mesh anymore, make sure to allow the reextraction at a later time.
 	 * @param[in] pos A World vector that is automatically converted into a mesh tile vector
@@ -149,9 +184,15 @@ public:
 	bool allowReExtraction(const glm::ivec3& pos);
 
 	/**
-	 * @brief Reorder the scheduled extraction commands that the closest chunks to the given position are handled first
+	 * @brief Reorder the scheduled extraction commands that the closest chunks to the given position that are
+	 * inside the given frustum are handled first.
+	 * @param[in] sortPos The world position (in voxel space) of the camera
+	 * @param[in] frustum The view frustum in voxel space
+	 * @param[in] maxDistanceSquare Scheduled extractions whose squared (xz) distance to the @c sortPos is bigger than
+	 * this value are dropped and can get scheduled again. @c -1 disables this.
+	 * @note Must be called from the same thread that calls @c scheduleMeshExtraction()
 	 */
-	void updateExtractionOrder(const glm::ivec3& sortPos, const core::Frustum& frustum);
+	void updateExtractionOrder(const glm::ivec3& sortPos, const core::Frustum& frustum, int maxDistanceSquare = -1);
 
 	/**
 	 * @brief Performs async mesh extraction. You need to call @c pop in order to see if some extraction is ready.
@@ -180,7 +221,28 @@ public:
 	glm::ivec3 meshSize() const;
 
 private:
-	void extractScheduledMesh();
+	void extractScheduledMesh(int workerId);
+	int64_t extractionPriority(const glm::ivec3& pos) const;
+
+	/**
+	 * @brief A scheduled mesh position together with its priority - lower values are extracted first.
+	 */
+	struct PendingExtraction {
+		glm::ivec3 pos;
+		int64_t priority;
+	};
+
+	struct PendingExtractionCompare {
+		inline bool operator()(const PendingExtraction& lhs, const PendingExtraction& rhs) const {
+			return lhs.priority > rhs.priority;
+		}
+	};
+
+	struct WorkerStats {
+		std::atomic_int extracted { 0 };
+		std::atomic_int empty { 0 };
+		std::atomic<uint64_t> micros { 0u };
+	};
 
 	WorldPager _pager;
 	PagedVolume *_volumeData = nullptr;
@@ -190,11 +252,19 @@ private:
 	long _seed = 0l;
 	bool _clientData = false;
 
+	const uint32_t _extractionThreads;
 	core::ThreadPool _threadPool;
 	core::ConcurrentQueue<ChunkMeshes> _extracted;
-	core::ConcurrentQueue<glm::ivec3, VecLessThan<3, int> > _pendingExtraction;
-	// fast lookup for positions that are already extracted
+	core::ConcurrentQueue<PendingExtraction, PendingExtractionCompare> _pendingExtraction;
+	// the state of the last updateExtractionOrder() call - used to prioritize new extractions
+	glm::ivec3 _extractionSortPos { 0 };
+	core::Frustum _extractionFrustum;
+	bool _extractionFrustumValid = false;
+	std::vector<glm::ivec3> _staleExtractions;
+	// fast lookup for positions that are already extracted - accessed by the workers and the caller thread
 	PositionSet _positionsExtracted;
+	core::ReadWriteLock _positionsExtractedLock {"PositionsExtracted"};
+	std::vector<WorkerStats> _workerStats;
 	core::VarPtr _meshSize;
 	core::Random _random;
 	std::atomic_bool _cancelThreads { false };
@@ -202,6 +272,7 @@ private:
 
 inline void World::setContext(const WorldContext& ctx) {
 	_ctx = ctx;
+	_pager.columnCache().clear();
 }
 
 inline void World::setClientData(bool clientData) {
@@ -228,6 +299,10 @@ inline bool World::pop(ChunkMeshes& item) {
 	return _extracted.pop(item);
 }
 
+inline int World::extractionThreads() const {
+	return (int)_extractionThreads;
+}
+
 inline bool World::created() const {
 	return _seed != 0;
 }
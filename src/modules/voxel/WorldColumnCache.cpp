@@ -0,0 +1,180 @@
+/**
+ * @file
+ */
+
+#include "WorldColumnCache.h"
+#include "BiomeManager.h"
+#include "WorldContext.h"
+#include "noise/Noise.h"
+#include "core/Assert.h"
+#include "core/Trace.h"
+#include <tuple>
+#include <vector>
+
+namespace voxel {
+
+static_assert((WorldColumnCache::TILE_SIZE & (WorldColumnCache::TILE_SIZE - 1)) == 0, "Tile size must be a power of two");
+
+WorldColumnCache::WorldColumnCache(size_t maxTiles) :
+		_maxTiles(std::max((size_t)1, maxTiles)) {
+}
+
+void WorldColumnCache::init(const BiomeManager* biomeManager, const WorldContext* ctx, const glm::ivec2& noiseOffset) {
+	core::ScopedWriteLock lock(_lock);
+	_biomeManager = biomeManager;
+	_ctx = ctx;
+	_noiseOffset = noiseOffset;
+	reset();
+}
+
+void WorldColumnCache::setNoiseOffset(const glm::ivec2& noiseOffset) {
+	core::ScopedWriteLock lock(_lock);
+	_noiseOffset = noiseOffset;
+	reset();
+}
+
+void WorldColumnCache::shutdown() {
+	core::ScopedWriteLock lock(_lock);
+	_biomeManager = nullptr;
+	_ctx = nullptr;
+	reset();
+}
+
+void WorldColumnCache::clear() {
+	core::ScopedWriteLock lock(_lock);
+	reset();
+}
+
+void WorldColumnCache::reset() {
+	_tiles.clear();
+	_front = _back = nullptr;
+	++_generation;
+}
+
+void WorldColumnCache::pushFront(Entry* entry) {
+	entry->prev = nullptr;
+	entry->next = _front;
+	if (_front != nullptr) {
+		_front->prev = entry;
+	} else {
+		_back = entry;
+	}
+	_front = entry;
+}
+
+void WorldColumnCache::unlink(Entry* entry) {
+	if (entry->prev != nullptr) {
+		entry->prev->next = entry->next;
+	} else {
+		_front = entry->next;
+	}
+	if (entry->next != nullptr) {
+		entry->next->prev = entry->prev;
+	} else {
+		_back = entry->prev;
+	}
+	entry->prev = entry->next = nullptr;
+}
+
+void WorldColumnCache::evict() {
+	// terminates - every entry loses its referenced flag when it's moved to the front
+	while (_back != nullptr) {
+		Entry* entry = _back;
+		unlink(entry);
+		if (entry->referenced.exchange(false, std::memory_order_relaxed)) {
+			pushFront(entry);
+			continue;
+		}
+		_tiles.erase(entry->tile->pos);
+		return;
+	}
+}
+
+size_t WorldColumnCache::size() const {
+	core::ScopedReadLock lock(_lock);
+	return _tiles.size();
+}
+
+WorldColumnCache::TilePtr WorldColumnCache::tile(int x, int z) {
+	// the mask rounds towards negative infinity - also for negative coordinates
+	const glm::ivec2 tilePos(x & ~(TILE_SIZE - 1), z & ~(TILE_SIZE - 1));
+	glm::ivec2 noiseOffset;
+	uint32_t generation;
+	const BiomeManager* biomeManager;
+	const WorldContext* ctx;
+	{
+		core::ScopedReadLock lock(_lock);
+		core_assert_msg(_biomeManager != nullptr && _ctx != nullptr, "WorldColumnCache is not yet initialized");
+		auto i = _tiles.find(tilePos);
+		if (i != _tiles.end()) {
+			i->second.referenced.store(true, std::memory_order_relaxed);
+			return i->second.tile;
+		}
+		noiseOffset = _noiseOffset;
+		generation = _generation;
+		biomeManager = _biomeManager;
+		ctx = _ctx;
+	}
+
+	// compute the tile without holding the lock - if another thread was faster, its tile is used
+	core_trace_scoped(WorldColumnCacheTile);
+	std::shared_ptr<Tile> newTile = std::make_shared<Tile>();
+	newTile->pos = tilePos;
+	compute(*biomeManager, *ctx, noiseOffset, tilePos.x, tilePos.y, TILE_SIZE, TILE_SIZE, 1, newTile->columns);
+
+	core::ScopedWriteLock lock(_lock);
+	if (generation != _generation) {
+		// the cache was reset in the meantime - don't store outdated data
+		return newTile;
+	}
+	auto i = _tiles.find(tilePos);
+	if (i != _tiles.end()) {
+		i->second.referenced.store(true, std::memory_order_relaxed);
+		return i->second.tile;
+	}
+	if (_tiles.size() >= _maxTiles) {
+		evict();
+	}
+	// the map nodes don't move - the list can point to the entries
+	i = _tiles.emplace(std::piecewise_construct, std::forward_as_tuple(tilePos), std::forward_as_tuple(newTile)).first;
+	pushFront(&i->second);
+	return newTile;
+}
+
+ColumnData WorldColumnCache::column(int x, int z) {
+	const TilePtr& t = tile(x, z);
+	return t->column(x, z);
+}
+
+void WorldColumnCache::compute(const BiomeManager& biomeManager, const WorldContext& ctx, const glm::ivec2& noiseOffset,
+		int lowerX, int lowerZ, int width, int depth, int step, ColumnData* columns) {
+	core_trace_scoped(WorldColumnCacheCompute);
+	const int n = width * depth;
+	std::vector<float> landscapeNoise(n);
+	std::vector<float> mountainNoise(n);
+	// TODO: move the noise settings into the biome
+	const glm::vec2 noisePos2d(noiseOffset.x + lowerX, noiseOffset.y + lowerZ);
+	noise::Noise2DGrid(noisePos2d, width, depth, (float)step, landscapeNoise.data(), ctx.landscapeNoiseOctaves,
+			ctx.landscapeNoisePersistence, ctx.landscapeNoiseFrequency, ctx.landscapeNoiseAmplitude);
+	noise::Noise2DGrid(noisePos2d, width, depth, (float)step, mountainNoise.data(), ctx.mountainNoiseOctaves,
+			ctx.mountainNoisePersistence, ctx.mountainNoiseFrequency, ctx.mountainNoiseAmplitude);
+
+	int i = 0;
+	for (int z = 0; z < depth; ++z) {
+		const int worldZ = lowerZ + z * step;
+		for (int x = 0; x < width; ++x, ++i) {
+			const int worldX = lowerX + x * step;
+			ColumnData& column = columns[i];
+			const float noiseNormalized = noise::norm(landscapeNoise[i]);
+			const float mountainNoiseNormalized = noise::norm(mountainNoise[i]);
+			const float mountainMultiplier = mountainNoiseNormalized * (mountainNoiseNormalized + 0.5f);
+			column.height = glm::clamp(noiseNormalized * mountainMultiplier, 0.0f, 1.0f);
+			column.humidity = biomeManager.getHumidity(worldX, worldZ);
+			column.temperature = biomeManager.getTemperature(worldX, worldZ);
+			column.cityHeight = 0;
+			column.cityMultiplier = biomeManager.getCityMultiplier(glm::ivec2(worldX, worldZ), &column.cityHeight);
+		}
+	}
+}
+
+}
@@ -0,0 +1,138 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "core/GLM.h"
+#include "core/ReadWriteLock.h"
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+namespace voxel {
+
+class BiomeManager;
+struct WorldContext;
+
+/**
+ * @brief The data of a world column that only depends on the x and z coordinates
+ */
+struct ColumnData {
+	/** the normalized terrain height in the range [0,1] */
+	float height = 0.0f;
+	/** @sa BiomeManager::getHumidity() */
+	float humidity = 0.0f;
+	/** @sa BiomeManager::getTemperature() */
+	float temperature = 0.0f;
+	/** @sa BiomeManager::getCityMultiplier() */
+	float cityMultiplier = 1.0f;
+	/** the terrain height of the city - only valid if @c cityMultiplier is less than @c 1.0 */
+	int cityHeight = 0;
+};
+
+/**
+ * @brief Tiled cache of the heightmap, the biome noise and the city factor of the world columns.
+ *
+ * All chunks of a column share the same 2d data - the terrain generation, the tree and plant placement
+ * and the biome lookups get the data from here instead of computing the noise again. The tiles are
+ * computed on first access, the least recently used tiles are dropped if there are more than the
+ * configured maximum.
+ *
+ * A cache hit only takes the read lock and marks the tile as referenced. The lru list is reordered
+ * when a tile must be dropped - referenced tiles get a second chance and are moved to the front.
+ */
+class WorldColumnCache {
+public:
+	static constexpr int TILE_SIZE = 32;
+
+	struct Tile {
+		/** the lower x and z corner of the tile in world coordinates */
+		glm::ivec2 pos;
+		ColumnData columns[TILE_SIZE * TILE_SIZE];
+
+		/**
+		 * @param[in] x The world x coordinate - must be inside this tile
+		 * @param[in] z The world z coordinate - must be inside this tile
+		 */
+		inline const ColumnData& column(int x, int z) const {
+			return columns[(z - pos.y) * TILE_SIZE + (x - pos.x)];
+		}
+
+		inline bool contains(int x, int z) const {
+			return x >= pos.x && z >= pos.y && x < pos.x + TILE_SIZE && z < pos.y + TILE_SIZE;
+		}
+	};
+	typedef std::shared_ptr<const Tile> TilePtr;
+
+	/**
+	 * @param[in] maxTiles The amount of tiles that are kept in memory
+	 */
+	WorldColumnCache(size_t maxTiles = 512);
+
+	/**
+	 * @param[in] noiseOffset The noise offset of the world - the terrain height depends on it
+	 * @note Clears the cache
+	 */
+	void init(const BiomeManager* biomeManager, const WorldContext* ctx, const glm::ivec2& noiseOffset = glm::ivec2(0));
+	void setNoiseOffset(const glm::ivec2& noiseOffset);
+	void shutdown();
+	/**
+	 * @brief Drops all tiles - must be called if the world context or the biome zones changed
+	 */
+	void clear();
+
+	/**
+	 * @return The tile that contains the given column. Hold the pointer as long as you iterate over
+	 * the columns of this tile to prevent the locking for each lookup.
+	 */
+	TilePtr tile(int x, int z);
+	ColumnData column(int x, int z);
+
+	/**
+	 * @return The amount of cached tiles
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief Computes the column data for a grid of columns - without touching the cache
+	 * @param[in] lowerX The world x coordinate of the first column
+	 * @param[in] lowerZ The world z coordinate of the first column
+	 * @param[in] width The amount of columns along the x axis
+	 * @param[in] depth The amount of columns along the z axis
+	 * @param[in] step The distance between two columns
+	 * @param[out] columns Buffer of size @c width * @c depth
+	 */
+	static void compute(const BiomeManager& biomeManager, const WorldContext& ctx, const glm::ivec2& noiseOffset,
+			int lowerX, int lowerZ, int width, int depth, int step, ColumnData* columns);
+private:
+	struct Entry {
+		TilePtr tile;
+		// set by the cache hits - cleared when the entry gets its second chance
+		std::atomic_bool referenced { false };
+		// the intrusive lru list - the front is the most recently inserted entry
+		Entry* prev = nullptr;
+		Entry* next = nullptr;
+
+		Entry(const TilePtr& tilePtr) :
+				tile(tilePtr) {
+		}
+	};
+	const size_t _maxTiles;
+	const BiomeManager* _biomeManager = nullptr;
+	const WorldContext* _ctx = nullptr;
+	glm::ivec2 _noiseOffset { 0 };
+	std::unordered_map<glm::ivec2, Entry, std::hash<glm::ivec2> > _tiles;
+	Entry* _front = nullptr;
+	Entry* _back = nullptr;
+	core::ReadWriteLock _lock {"WorldColumnCache"};
+	// incremented whenever the cache is reset - tiles of an older generation are not stored
+	uint32_t _generation = 0u;
+
+	void reset();
+	void pushFront(Entry* entry);
+	void unlink(Entry* entry);
+	void evict();
+};
+
+}
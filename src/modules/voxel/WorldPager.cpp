@@ -44,12 +44,15 @@ void WorldPager::setCreateFlags(int flags) {
 
 void WorldPager::setNoiseOffset(const glm::vec2& noiseOffset) {
 	_noiseSeedOffset = noiseOffset;
+	// the world generator gets the offset as integer
+	_columnCache.setNoiseOffset(glm::ivec2(noiseOffset));
 }
 
 bool WorldPager::init(PagedVolume *volumeData, BiomeManager* biomeManager, WorldContext* ctx) {
 	_volumeData = volumeData;
 	_biomeManager = biomeManager;
 	_ctx = ctx;
+	_columnCache.init(biomeManager, ctx, glm::ivec2(_noiseSeedOffset));
 	return _ctx != nullptr && _volumeData != nullptr && _biomeManager != nullptr;
 }
 
@@ -57,6 +60,9 @@ void WorldPager::shutdown() {
 	if (_volumeData != nullptr) {
 		_volumeData->flushAll();
 	}
+	// write everything that was paged out
+	_worldPersister.shutdown();
+	_columnCache.shutdown();
 	_volumeData = nullptr;
 	_biomeManager = nullptr;
 	_ctx = nullptr;
@@ -65,7 +71,7 @@ void WorldPager::shutdown() {
 void WorldPager::create(PagedVolume::PagerContext& ctx) {
 	PagedVolumeWrapper wrapper(_volumeData, ctx.chunk, ctx.region);
 	core_trace_scoped(CreateWorld);
-	voxel::world::WorldGenerator gen(*_biomeManager, _seed);
+	voxel::world::WorldGenerator gen(*_biomeManager, _seed, &_columnCache);
 	{
 		core_trace_scoped(World);
 		gen.createWorld(*_ctx, wrapper, _noiseSeedOffset.x, _noiseSeedOffset.y);
@@ -5,6 +5,7 @@
 
 #include "voxel/polyvox/PagedVolume.h"
 #include "voxel/WorldPersister.h"
+#include "voxel/WorldColumnCache.h"
 
 namespace voxel {
 
@@ -18,6 +19,7 @@ class PagedVolumeWrapper;
 class WorldPager: public PagedVolume::Pager {
 private:
 	WorldPersister _worldPersister;
+	WorldColumnCache _columnCache;
 	long _seed = 0l;
 	int _createFlags = 0;
 	glm::vec2 _noiseSeedOffset;
@@ -63,6 +65,11 @@ public:
 
 	void setNoiseOffset(const glm::vec2& noiseOffset);
 
+	/**
+	 * @brief The 2d data of the world columns that is shared by all chunks of a column
+	 */
+	WorldColumnCache& columnCache();
+
 	void erase(const Region& region);
 	/**
 	 * @return @c true if the chunk was modified (created), @c false if it was just loaded
@@ -71,4 +78,8 @@ public:
 	void pageOut(PagedVolume::Chunk* chunk) override;
 };
 
+inline WorldColumnCache& WorldPager::columnCache() {
+	return _columnCache;
+}
+
 }
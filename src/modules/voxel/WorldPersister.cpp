@@ -10,14 +10,70 @@
 #include "core/Common.h"
 #include "core/String.h"
 #include "core/ByteStream.h"
+#include "core/Trace.h"
 #include <zlib.h>
+#include <cstdio>
+#include <functional>
 
 namespace voxel {
 
 #define WORLD_FILE_VERSION 1
 
-std::string WorldPersister::getWorldName(const Region& region, long seed) const {
-	return core::string::format("world_%li_%i_%i_%i.wld", seed, region.getLowerX(), region.getLowerY(), region.getLowerZ());
+// the amount of region files that are kept open
+static const size_t MAX_OPEN_REGION_FILES = 64;
+
+WorldPersister::~WorldPersister() {
+	shutdown();
+}
+
+glm::ivec3 WorldPersister::chunkPos(const Region& region) const {
+	const int sideLength = region.getWidthInVoxels();
+	return region.getLowerCorner() / sideLength;
+}
+
+WorldPersister::ChunkKey WorldPersister::chunkKey(const Region& region, long seed) const {
+	return ChunkKey{seed, region.getLowerCorner()};
+}
+
+std::string WorldPersister::getRegionFileName(const Region& region, long seed) const {
+	const glm::ivec3& regionPos = WorldRegionFile::regionPos(chunkPos(region));
+	return core::string::format("world_%li_%i_%i_%i_%i.wrg", seed, region.getWidthInVoxels(), regionPos.x, regionPos.y, regionPos.z);
+}
+
+std::string WorldPersister::legacyWorldPath(const Region& region, long seed) const {
+	const core::App* app = core::App::getInstance();
+	const io::FilesystemPtr& filesystem = app->filesystem();
+	return filesystem->homePath() + core::string::format("world_%li_%i_%i_%i.wld", seed, region.getLowerX(), region.getLowerY(), region.getLowerZ());
+}
+
+WorldRegionFilePtr WorldPersister::regionFile(const Region& region, long seed, bool create) {
+	const std::string& filename = getRegionFileName(region, seed);
+	std::lock_guard<std::mutex> lock(_regionFilesMutex);
+	auto i = _regionFiles.find(filename);
+	if (i != _regionFiles.end()) {
+		return i->second;
+	}
+	const core::App* app = core::App::getInstance();
+	const io::FilesystemPtr& filesystem = app->filesystem();
+	const std::string path = filesystem->homePath() + filename;
+	if (!create && !filesystem->exists(path)) {
+		return WorldRegionFilePtr();
+	}
+	const WorldRegionFilePtr& file = std::make_shared<WorldRegionFile>(path);
+	if (!file->open()) {
+		return WorldRegionFilePtr();
+	}
+	if (_regionFiles.size() >= MAX_OPEN_REGION_FILES) {
+		// only close files that are not in use - we must never have two handles for the same file
+		for (auto it = _regionFiles.begin(); it != _regionFiles.end(); ++it) {
+			if (it->second.use_count() == 1) {
+				_regionFiles.erase(it);
+				break;
+			}
+		}
+	}
+	_regionFiles.insert(std::make_pair(filename, file));
+	return file;
 }
 
 void WorldPersister::erase(const Region& region, long seed) {
@@ -25,52 +81,82 @@ void WorldPersister::erase(const Region& region, long seed) {
 		return;
 	}
 	core_trace_scoped(WorldPersisterErase);
-#if 0
-	PagedVolume::ChunkPtr chunk = ctx.getChunk();
-	const core::App* app = core::App::getInstance();
-	const io::FilesystemPtr& filesystem = app->filesystem();
-	const Region& region = ctx.region;
-	const std::string& filename = getWorldName(region, seed);
-	// TODO: filesystem->remove(filename);
-#endif
+	PendingWrite pendingWrite;
+	pendingWrite.seed = seed;
+	pendingWrite.region = region;
+	pendingWrite.erase = true;
+	std::unique_lock<std::mutex> lock(_ioMutex);
+	if (!ensureIoThread()) {
+		lock.unlock();
+		remove(pendingWrite);
+		return;
+	}
+	// replaces a state of the chunk that wasn't written yet
+	_pendingWrites[chunkKey(region, seed)] = std::move(pendingWrite);
+	lock.unlock();
+	_ioCondition.notify_one();
 }
 
-bool WorldPersister::load(PagedVolume::Chunk* chunk, long seed) {
-	if (!_persist) {
+bool WorldPersister::remove(const PendingWrite& pendingWrite) {
+	core_trace_scoped(WorldPersisterRemove);
+	const Region& region = pendingWrite.region;
+	// a chunk that wasn't migrated yet must not come back with the next load
+	std::remove(legacyWorldPath(region, pendingWrite.seed).c_str());
+	const WorldRegionFilePtr& file = regionFile(region, pendingWrite.seed, false);
+	if (!file) {
+		return true;
+	}
+	const int slot = WorldRegionFile::slot(chunkPos(region));
+	if (!file->remove(slot)) {
 		return false;
 	}
-	core_trace_scoped(WorldPersisterLoad);
-	const core::App* app = core::App::getInstance();
-	const io::FilesystemPtr& filesystem = app->filesystem();
+	Log::debug("Removed chunk %i:%i:%i from %s", region.getLowerX(), region.getLowerY(), region.getLowerZ(), file->path().c_str());
+	return true;
+}
+
+bool WorldPersister::decode(PagedVolume::Chunk* chunk, const uint8_t* voxels, size_t size) const {
 	const Region& region = chunk->region();
-	const std::string& filename = getWorldName(region, seed);
-	const io::FilePtr& f = filesystem->open(filename);
-	if (!f->exists()) {
+	const int width = region.getWidthInVoxels();
+	const int height = region.getHeightInVoxels();
+	const int depth = region.getDepthInVoxels();
+	core::ByteView view(voxels, size);
+	const uint8_t* voxelBuf = view.readSpan((size_t)width * height * depth * 2);
+	if (voxelBuf == nullptr) {
+		Log::error("Not enough voxel data for the chunk at %i:%i:%i", region.getLowerX(), region.getLowerY(), region.getLowerZ());
 		return false;
 	}
-	Log::trace("Try to load world %s", f->name().c_str());
-	uint8_t *fileBuf;
-	// TODO: load async, put world into state loading, and do the real loading in onFrame if the file is fully loaded
-	const int fileLen = f->read((void **) &fileBuf);
-	if (!fileBuf || fileLen <= 0) {
-		Log::error("Failed to load the world from %s", f->name().c_str());
-		return false;
+
+	for (int z = 0; z < depth; ++z) {
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				static_assert(sizeof(VoxelType) == sizeof(uint8_t), "Voxel type size changed");
+				const VoxelType material = (VoxelType)*voxelBuf++;
+				const uint8_t colorIndex = *voxelBuf++;
+				const Voxel& voxel = createVoxel(material, colorIndex);
+				chunk->setVoxel(x, y, z, voxel);
+			}
+		}
 	}
-	std::unique_ptr<uint8_t[]> smartBuf(fileBuf);
+	return true;
+}
 
-	core::ByteStream bs(fileLen);
-	bs.append(fileBuf, fileLen);
-	int len;
-	int version;
-	bs.readFormat("ib", &len, &version);
+bool WorldPersister::decompress(PagedVolume::Chunk* chunk, const std::vector<uint8_t>& data, const std::string& name) const {
+	// the header is read in place - the compressed data isn't copied
+	core::ByteView view(data);
+	int32_t len;
+	uint8_t version;
+	if (!view.readInt(len) || !view.readByte(version)) {
+		Log::error("chunk in %s is truncated", name.c_str());
+		return false;
+	}
 
 	if (version != WORLD_FILE_VERSION) {
-		Log::error("file %s has a wrong version number %i (expected %i)", f->name().c_str(), version, WORLD_FILE_VERSION);
+		Log::error("chunk in %s has a wrong version number %i (expected %i)", name.c_str(), version, WORLD_FILE_VERSION);
 		return false;
 	}
 	const int sizeLimit = 1024;
-	if (len > 1000l * 1000l * sizeLimit) {
-		Log::error("extracted memory would be more than %i MB for the file %s", sizeLimit, f->name().c_str());
+	if (len < 0 || len > 1000l * 1000l * sizeLimit) {
+		Log::error("extracted memory would be more than %i MB for the chunk in %s", sizeLimit, name.c_str());
 		return false;
 	}
 
@@ -78,63 +164,149 @@ bool WorldPersister::load(PagedVolume::Chunk* chunk, long seed) {
 	std::unique_ptr<uint8_t[]> smartTargetBuf(targetBuf);
 
 	uLongf targetBufSize = len;
-	const int res = uncompress(targetBuf, &targetBufSize, bs.getBuffer(), bs.getSize());
+	const int res = uncompress(targetBuf, &targetBufSize, view.data(), view.remaining());
 	if (res != Z_OK) {
 		Log::error("Failed to uncompress the world data with len %i", len);
 		return false;
 	}
+	return decode(chunk, targetBuf, targetBufSize);
+}
 
-	core::ByteStream voxelBuf(len);
-	voxelBuf.append(targetBuf, len);
-
-	const int width = region.getWidthInVoxels();
-	const int height = region.getHeightInVoxels();
-	const int depth = region.getDepthInVoxels();
+bool WorldPersister::read(PendingRead& pendingRead) {
+	core_trace_scoped(WorldPersisterRead);
+	const Region& region = pendingRead.region;
+	const WorldRegionFilePtr& file = regionFile(region, pendingRead.seed, false);
+	const int slot = WorldRegionFile::slot(chunkPos(region));
+	if (file && file->has(slot)) {
+		pendingRead.name = file->path();
+		return file->read(slot, pendingRead.data);
+	}
+	return migrate(pendingRead);
+}
 
-	for (int z = 0; z < depth; ++z) {
-		for (int y = 0; y < height; ++y) {
-			for (int x = 0; x < width; ++x) {
-				core_assert_msg(voxelBuf.getSize() >= 1, "Failed to load %s (x: %i, y: %i, z: %i)", f->name().c_str(), x, y, z);
-				static_assert(sizeof(VoxelType) == sizeof(uint8_t), "Voxel type size changed");
-				const VoxelType material = (VoxelType)voxelBuf.readByte();
-				const uint8_t colorIndex = voxelBuf.readByte();
-				const Voxel& voxel = createVoxel(material, colorIndex);
-				chunk->setVoxel(x, y, z, voxel);
-			}
+bool WorldPersister::migrate(PendingRead& pendingRead) {
+	const Region& region = pendingRead.region;
+	const std::string& path = legacyWorldPath(region, pendingRead.seed);
+	{
+		io::File f(path, io::FileMode::Read);
+		if (!f.exists()) {
+			return false;
 		}
+		uint8_t *fileBuf;
+		const int fileLen = f.read((void **) &fileBuf);
+		if (!fileBuf || fileLen <= 0) {
+			Log::error("Failed to load the world from %s", path.c_str());
+			return false;
+		}
+		std::unique_ptr<uint8_t[]> smartBuf(fileBuf);
+		pendingRead.data.assign(fileBuf, fileBuf + fileLen);
+	}
+	pendingRead.name = path;
+	// the old files have the same layout as the slots of the region files - the old file is
+	// only removed after the data is in the region file
+	const WorldRegionFilePtr& file = regionFile(region, pendingRead.seed, true);
+	const int slot = WorldRegionFile::slot(chunkPos(region));
+	if (file && file->write(slot, pendingRead.data.data(), pendingRead.data.size())) {
+		std::remove(path.c_str());
+		Log::debug("Moved %s into %s", path.c_str(), file->path().c_str());
+	} else {
+		Log::warn("Failed to move %s into the region file", path.c_str());
 	}
 	return true;
 }
 
-bool WorldPersister::save(PagedVolume::Chunk* chunk, long seed) {
+bool WorldPersister::load(PagedVolume::Chunk* chunk, long seed) {
 	if (!_persist) {
 		return false;
 	}
 	core_trace_scoped(WorldPersisterLoad);
-	core::ByteStream voxelStream;
 	const Region& region = chunk->region();
+	PendingRead pendingRead;
+	pendingRead.seed = seed;
+	pendingRead.region = region;
+	{
+		std::unique_lock<std::mutex> lock(_ioMutex);
+		// the chunk might still wait for the io thread to get written
+		auto i = _pendingWrites.find(chunkKey(region, seed));
+		if (i != _pendingWrites.end()) {
+			const PendingWrite& pendingWrite = i->second;
+			return !pendingWrite.erase && decode(chunk, pendingWrite.voxels.data(), pendingWrite.voxels.size());
+		}
+		if (_currentWriteActive && _currentWrite.seed == seed && _currentWrite.region == region) {
+			return !_currentWrite.erase && decode(chunk, _currentWrite.voxels.data(), _currentWrite.voxels.size());
+		}
+		if (!ensureIoThread()) {
+			lock.unlock();
+			pendingRead.success = read(pendingRead);
+		} else {
+			_pendingReads.push_back(&pendingRead);
+			_ioCondition.notify_one();
+			_readCondition.wait(lock, [&pendingRead] {
+				return pendingRead.done;
+			});
+		}
+	}
+	if (!pendingRead.success) {
+		return false;
+	}
+	Log::trace("Load chunk %i:%i:%i from %s", region.getLowerX(), region.getLowerY(), region.getLowerZ(), pendingRead.name.c_str());
+	return decompress(chunk, pendingRead.data, pendingRead.name);
+}
+
+bool WorldPersister::save(PagedVolume::Chunk* chunk, long seed) {
+	if (!_persist) {
+		return false;
+	}
+	core_trace_scoped(WorldPersisterSave);
+	PendingWrite pendingWrite;
+	pendingWrite.seed = seed;
+	pendingWrite.region = chunk->region();
+	const Region& region = pendingWrite.region;
 	const int width = region.getWidthInVoxels();
 	const int height = region.getHeightInVoxels();
 	const int depth = region.getDepthInVoxels();
+	pendingWrite.voxels.reserve(width * height * depth * 2);
 
 	for (int z = 0; z < depth; ++z) {
 		for (int y = 0; y < height; ++y) {
 			for (int x = 0; x < width; ++x) {
 				const Voxel& voxel = chunk->voxel(x, y, z);
 				static_assert(sizeof(VoxelType) == sizeof(uint8_t), "Voxel type size changed");
-				voxelStream.addByte(std::enum_value(voxel.getMaterial()));
-				voxelStream.addByte(voxel.getColor());
+				pendingWrite.voxels.push_back(std::enum_value(voxel.getMaterial()));
+				pendingWrite.voxels.push_back(voxel.getColor());
 			}
 		}
 	}
 
-	// save the stuff
-	const std::string& filename = getWorldName(region, seed);
-	const core::App* app = core::App::getInstance();
-	const io::FilesystemPtr& filesystem = app->filesystem();
+	std::unique_lock<std::mutex> lock(_ioMutex);
+	if (!ensureIoThread()) {
+		lock.unlock();
+		return write(pendingWrite);
+	}
+	// replaces an older state of the same chunk that wasn't written yet
+	_pendingWrites[chunkKey(region, seed)] = std::move(pendingWrite);
+	lock.unlock();
+	_ioCondition.notify_one();
+	return true;
+}
 
-	const uint8_t* voxelBuf = voxelStream.getBuffer();
-	const int voxelSize = voxelStream.getSize();
+bool WorldPersister::ensureIoThread() {
+	if (_ioThreadRunning) {
+		// also while shutting down - the io thread only exits after all queues are empty
+		return true;
+	}
+	if (_shutdown) {
+		return false;
+	}
+	_ioThreadRunning = true;
+	_ioThread = std::thread(std::bind(&WorldPersister::ioThread, this));
+	return true;
+}
+
+bool WorldPersister::write(const PendingWrite& pendingWrite) {
+	core_trace_scoped(WorldPersisterWrite);
+	const uint8_t* voxelBuf = pendingWrite.voxels.data();
+	const int voxelSize = pendingWrite.voxels.size();
 	uLongf neededVoxelBufLen = compressBound(voxelSize);
 	uint8_t* compressedVoxelBuf = new uint8_t[neededVoxelBufLen];
 	std::unique_ptr<uint8_t[]> smartBuf(compressedVoxelBuf);
@@ -143,15 +315,95 @@ bool WorldPersister::save(PagedVolume::Chunk* chunk, long seed) {
 		Log::error("Failed to compress the voxel data");
 		return false;
 	}
-	core::ByteStream final;
-	final.addFormat("ib", voxelSize, WORLD_FILE_VERSION);
-	final.append(compressedVoxelBuf, neededVoxelBufLen);
-	if (!filesystem->write(filename, final.getBuffer(), final.getSize())) {
-		Log::error("Failed to write file %s", filename.c_str());
+	core::ByteStream final(5 + neededVoxelBufLen);
+	final.addInt(voxelSize);
+	final.addByte(WORLD_FILE_VERSION);
+	final.writeBytes(compressedVoxelBuf, neededVoxelBufLen);
+
+	const Region& region = pendingWrite.region;
+	const WorldRegionFilePtr& file = regionFile(region, pendingWrite.seed, true);
+	if (!file) {
+		Log::error("Failed to open the region file for chunk %i:%i:%i", region.getLowerX(), region.getLowerY(), region.getLowerZ());
+		return false;
+	}
+	const int slot = WorldRegionFile::slot(chunkPos(region));
+	if (!file->write(slot, final.getBuffer(), final.getSize())) {
 		return false;
 	}
-	Log::debug("Wrote file %s (%i)", filename.c_str(), voxelSize);
+	Log::debug("Wrote chunk %i:%i:%i to %s (%i)", region.getLowerX(), region.getLowerY(), region.getLowerZ(), file->path().c_str(), voxelSize);
 	return true;
 }
 
+void WorldPersister::ioThread() {
+	core_trace_thread("WorldPersister");
+	std::unique_lock<std::mutex> lock(_ioMutex);
+	for (;;) {
+		_ioCondition.wait(lock, [this] {
+			return _shutdown || !_pendingReads.empty() || !_pendingWrites.empty();
+		});
+		if (!_pendingReads.empty()) {
+			PendingRead* pendingRead = _pendingReads.front();
+			_pendingReads.pop_front();
+			lock.unlock();
+
+			const bool success = read(*pendingRead);
+
+			lock.lock();
+			pendingRead->success = success;
+			pendingRead->done = true;
+			_readCondition.notify_all();
+			continue;
+		}
+		if (_pendingWrites.empty()) {
+			// only reached while shutting down - nothing is queued anymore once this is cleared
+			_ioThreadRunning = false;
+			break;
+		}
+		auto i = _pendingWrites.begin();
+		_currentWrite = std::move(i->second);
+		_currentWriteActive = true;
+		_pendingWrites.erase(i);
+		lock.unlock();
+
+		if (_currentWrite.erase) {
+			remove(_currentWrite);
+		} else {
+			write(_currentWrite);
+		}
+
+		lock.lock();
+		_currentWriteActive = false;
+		_currentWrite.voxels.clear();
+		if (_pendingWrites.empty()) {
+			_flushCondition.notify_all();
+		}
+	}
+	_flushCondition.notify_all();
+}
+
+void WorldPersister::flush() {
+	std::unique_lock<std::mutex> lock(_ioMutex);
+	if (!_ioThreadRunning) {
+		return;
+	}
+	_flushCondition.wait(lock, [this] {
+		return _pendingWrites.empty() && !_currentWriteActive;
+	});
+}
+
+void WorldPersister::shutdown() {
+	std::thread ioThread;
+	{
+		std::unique_lock<std::mutex> lock(_ioMutex);
+		_shutdown = true;
+		ioThread = std::move(_ioThread);
+	}
+	_ioCondition.notify_all();
+	if (ioThread.joinable()) {
+		ioThread.join();
+	}
+	std::lock_guard<std::mutex> lock(_regionFilesMutex);
+	_regionFiles.clear();
+}
+
 }
@@ -5,23 +5,136 @@
 #pragma once
 
 #include "voxel/polyvox/PagedVolume.h"
+#include "voxel/WorldRegionFile.h"
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace voxel {
 
 class PagedVolumeWrapper;
 
+/**
+ * @brief Loads and saves the chunks of the world in region files.
+ *
+ * Many chunks are packed into one region file (see @c WorldRegionFile). All file access
+ * is done on a background io thread - loading blocks the caller until the io thread read
+ * the data, the decompression is done on the caller again. If a chunk is saved again before
+ * the io thread wrote the previous state, only the latest state is written.
+ *
+ * Chunks that are still stored in the old one-file-per-chunk format (@c world_*.wld) are
+ * moved into the region files when they are loaded.
+ */
 class WorldPersister {
 protected:
 	bool _persist = true;
 
+	struct ChunkKey {
+		long seed;
+		glm::ivec3 pos;
+
+		inline bool operator==(const ChunkKey& other) const {
+			return seed == other.seed && pos == other.pos;
+		}
+	};
+
+	struct ChunkKeyHash {
+		inline size_t operator()(const ChunkKey& key) const {
+			return std::hash<glm::ivec3>()(key.pos) * 31u + std::hash<long>()(key.seed);
+		}
+	};
+
+	struct PendingWrite {
+		long seed = 0l;
+		Region region;
+		// two bytes per voxel (material and color)
+		std::vector<uint8_t> voxels;
+		// the chunk is removed from the region file instead
+		bool erase = false;
+	};
+
+	struct PendingRead {
+		long seed = 0l;
+		Region region;
+		// the compressed chunk data and the file it was read from
+		std::vector<uint8_t> data;
+		std::string name;
+		bool done = false;
+		bool success = false;
+	};
+
+	std::mutex _regionFilesMutex;
+	std::unordered_map<std::string, WorldRegionFilePtr> _regionFiles;
+
+	// guards the queues and the state of the io thread
+	std::mutex _ioMutex;
+	std::condition_variable _ioCondition;
+	std::condition_variable _readCondition;
+	std::condition_variable _flushCondition;
+	std::unordered_map<ChunkKey, PendingWrite, ChunkKeyHash> _pendingWrites;
+	// served before the writes - the callers are waiting for them
+	std::deque<PendingRead*> _pendingReads;
+	// the write that is currently processed by the io thread
+	PendingWrite _currentWrite;
+	bool _currentWriteActive = false;
+	// no io thread is started anymore - the work is done on the caller after the io thread exited
+	bool _shutdown = false;
+	bool _ioThreadRunning = false;
+	std::thread _ioThread;
+
+	void ioThread();
+	/**
+	 * @note Must be called with the io mutex held
+	 * @return @c false if the persister was shut down and the io thread exited - the caller has
+	 * to do the work itself
+	 */
+	bool ensureIoThread();
+	bool read(PendingRead& pendingRead);
+	bool migrate(PendingRead& pendingRead);
+	bool write(const PendingWrite& pendingWrite);
+	bool remove(const PendingWrite& pendingWrite);
+	bool decode(PagedVolume::Chunk* chunk, const uint8_t* voxels, size_t size) const;
+	bool decompress(PagedVolume::Chunk* chunk, const std::vector<uint8_t>& data, const std::string& name) const;
+	WorldRegionFilePtr regionFile(const Region& region, long seed, bool create);
+	glm::ivec3 chunkPos(const Region& region) const;
+	ChunkKey chunkKey(const Region& region, long seed) const;
+	/**
+	 * @return The path of the file the chunk was stored in before the region files were introduced
+	 */
+	std::string legacyWorldPath(const Region& region, long seed) const;
+
 public:
+	~WorldPersister();
+
 	void setPersist(bool persist);
 
 	bool load(PagedVolume::Chunk* chunk, long seed);
+	/**
+	 * @brief Queues the chunk data for the io thread
+	 * @sa flush()
+	 */
 	bool save(PagedVolume::Chunk* chunk, long seed);
+	/**
+	 * @brief Queues the removal of the chunk - its sectors in the region file are reused
+	 */
 	void erase(const Region& region, long seed);
-	std::string getWorldName(const Region& region, long seed) const;
+	/**
+	 * @brief Blocks until all queued chunks are written
+	 */
+	void flush();
+	/**
+	 * @brief Writes all queued chunks, stops the io thread and closes all region files
+	 * @note The persister stays usable - but all following loads and saves are done on the caller
+	 */
+	void shutdown();
+	/**
+	 * @return The name of the region file that contains the chunk of the given region
+	 */
+	std::string getRegionFileName(const Region& region, long seed) const;
 };
 
 inline void WorldPersister::setPersist(bool persist) {
@@ -0,0 +1,302 @@
+/**
+ * @file
+ */
+
+#include "WorldRegionFile.h"
+#include "core/Common.h"
+#include "core/Assert.h"
+#include "core/Log.h"
+#include "core/Trace.h"
+#include <SDL.h>
+#include <algorithm>
+
+namespace voxel {
+
+static constexpr uint32_t REGION_FILE_MAGIC = FourCC('W', 'R', 'G', 'N');
+static constexpr uint32_t REGION_FILE_VERSION = 1u;
+// magic, version and amount of slots
+static constexpr uint32_t REGION_HEADER_FIELDS = 3u;
+// offset, size and capacity
+static constexpr uint32_t REGION_ENTRY_FIELDS = 3u;
+
+WorldRegionFile::WorldRegionFile(const std::string& path) :
+		_path(path) {
+}
+
+WorldRegionFile::~WorldRegionFile() {
+	close();
+}
+
+uint32_t WorldRegionFile::headerSize() {
+	return (REGION_HEADER_FIELDS + SLOTS * REGION_ENTRY_FIELDS) * sizeof(uint32_t);
+}
+
+int WorldRegionFile::slot(const glm::ivec3& chunkPos) {
+	const int mask = CHUNKS_PER_AXIS - 1;
+	return (chunkPos.x & mask) + (chunkPos.y & mask) * CHUNKS_PER_AXIS + (chunkPos.z & mask) * CHUNKS_PER_AXIS * CHUNKS_PER_AXIS;
+}
+
+glm::ivec3 WorldRegionFile::regionPos(const glm::ivec3& chunkPos) {
+	static_assert(CHUNKS_PER_AXIS == 8, "The shift below expects 8 chunks per axis");
+	return glm::ivec3(chunkPos.x >> 3, chunkPos.y >> 3, chunkPos.z >> 3);
+}
+
+bool WorldRegionFile::open() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_rwops != nullptr) {
+		return true;
+	}
+	_rwops = SDL_RWFromFile(_path.c_str(), "r+b");
+	if (_rwops == nullptr) {
+		_rwops = SDL_RWFromFile(_path.c_str(), "w+b");
+		if (_rwops == nullptr) {
+			Log::error("Failed to create region file %s", _path.c_str());
+			return false;
+		}
+		for (int i = 0; i < SLOTS; ++i) {
+			_entries[i] = Entry();
+		}
+		_gaps.clear();
+		_fileSize = headerSize();
+		if (!writeHeader()) {
+			Log::error("Failed to write the header of region file %s", _path.c_str());
+			SDL_RWclose(_rwops);
+			_rwops = nullptr;
+			return false;
+		}
+		return true;
+	}
+
+	const Sint64 fileSize = SDL_RWsize(_rwops);
+	if (fileSize < (Sint64)headerSize()) {
+		Log::error("Region file %s is too small", _path.c_str());
+		SDL_RWclose(_rwops);
+		_rwops = nullptr;
+		return false;
+	}
+	_fileSize = (uint32_t)fileSize;
+	const uint32_t magic = SDL_ReadLE32(_rwops);
+	const uint32_t version = SDL_ReadLE32(_rwops);
+	const uint32_t slots = SDL_ReadLE32(_rwops);
+	if (magic != REGION_FILE_MAGIC || version != REGION_FILE_VERSION || slots != (uint32_t)SLOTS) {
+		Log::error("Region file %s has an invalid header (version %u, slots %u)", _path.c_str(), version, slots);
+		SDL_RWclose(_rwops);
+		_rwops = nullptr;
+		return false;
+	}
+	for (int i = 0; i < SLOTS; ++i) {
+		Entry& e = _entries[i];
+		e.offset = SDL_ReadLE32(_rwops);
+		e.size = SDL_ReadLE32(_rwops);
+		e.capacity = SDL_ReadLE32(_rwops);
+		if (e.size > e.capacity || (e.capacity > 0u && e.offset + e.capacity > _fileSize)) {
+			Log::warn("Invalid entry %i in region file %s", i, _path.c_str());
+			e = Entry();
+		}
+	}
+	collectGaps();
+	return true;
+}
+
+void WorldRegionFile::collectGaps() {
+	std::vector<const Entry*> used;
+	for (int i = 0; i < SLOTS; ++i) {
+		if (_entries[i].capacity > 0u) {
+			used.push_back(&_entries[i]);
+		}
+	}
+	std::sort(used.begin(), used.end(), [] (const Entry* a, const Entry* b) {
+		return a->offset < b->offset;
+	});
+	_gaps.clear();
+	uint32_t offset = headerSize();
+	for (const Entry* e : used) {
+		if (e->offset > offset) {
+			_gaps.push_back(Gap{offset, e->offset - offset});
+		}
+		offset = std::max(offset, e->offset + e->capacity);
+	}
+	if (_fileSize > offset) {
+		_gaps.push_back(Gap{offset, _fileSize - offset});
+	}
+}
+
+uint32_t WorldRegionFile::allocate(uint32_t capacity) {
+	for (auto i = _gaps.begin(); i != _gaps.end(); ++i) {
+		if (i->size < capacity) {
+			continue;
+		}
+		const uint32_t offset = i->offset;
+		i->offset += capacity;
+		i->size -= capacity;
+		if (i->size == 0u) {
+			_gaps.erase(i);
+		}
+		return offset;
+	}
+	const uint32_t offset = _fileSize;
+	_fileSize += capacity;
+	return offset;
+}
+
+void WorldRegionFile::release(uint32_t offset, uint32_t capacity) {
+	if (capacity == 0u) {
+		return;
+	}
+	auto next = std::lower_bound(_gaps.begin(), _gaps.end(), offset, [] (const Gap& gap, uint32_t offset) {
+		return gap.offset < offset;
+	});
+	if (next != _gaps.begin()) {
+		auto prev = next - 1;
+		if (prev->offset + prev->size == offset) {
+			prev->size += capacity;
+			if (next != _gaps.end() && offset + capacity == next->offset) {
+				prev->size += next->size;
+				_gaps.erase(next);
+			}
+			return;
+		}
+	}
+	if (next != _gaps.end() && offset + capacity == next->offset) {
+		next->offset = offset;
+		next->size += capacity;
+		return;
+	}
+	_gaps.insert(next, Gap{offset, capacity});
+}
+
+void WorldRegionFile::close() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_rwops == nullptr) {
+		return;
+	}
+	SDL_RWclose(_rwops);
+	_rwops = nullptr;
+}
+
+bool WorldRegionFile::writeHeader() {
+	if (SDL_RWseek(_rwops, 0, RW_SEEK_SET) != 0) {
+		return false;
+	}
+	SDL_WriteLE32(_rwops, REGION_FILE_MAGIC);
+	SDL_WriteLE32(_rwops, REGION_FILE_VERSION);
+	SDL_WriteLE32(_rwops, (uint32_t)SLOTS);
+	for (int i = 0; i < SLOTS; ++i) {
+		const Entry& e = _entries[i];
+		SDL_WriteLE32(_rwops, e.offset);
+		SDL_WriteLE32(_rwops, e.size);
+		SDL_WriteLE32(_rwops, e.capacity);
+	}
+	return SDL_RWtell(_rwops) == (Sint64)headerSize();
+}
+
+bool WorldRegionFile::writeEntry(int slot, const Entry& e) {
+	const Sint64 entryOffset = (REGION_HEADER_FIELDS + slot * REGION_ENTRY_FIELDS) * sizeof(uint32_t);
+	if (SDL_RWseek(_rwops, entryOffset, RW_SEEK_SET) != entryOffset) {
+		return false;
+	}
+	if (SDL_WriteLE32(_rwops, e.offset) != 1) {
+		return false;
+	}
+	if (SDL_WriteLE32(_rwops, e.size) != 1) {
+		return false;
+	}
+	return SDL_WriteLE32(_rwops, e.capacity) == 1;
+}
+
+bool WorldRegionFile::has(int slot) const {
+	core_assert(slot >= 0 && slot < SLOTS);
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _entries[slot].size > 0u;
+}
+
+bool WorldRegionFile::read(int slot, std::vector<uint8_t>& data) const {
+	core_assert(slot >= 0 && slot < SLOTS);
+	core_trace_scoped(WorldRegionFileRead);
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_rwops == nullptr) {
+		return false;
+	}
+	const Entry& e = _entries[slot];
+	if (e.size == 0u) {
+		return false;
+	}
+	if (SDL_RWseek(_rwops, e.offset, RW_SEEK_SET) != (Sint64)e.offset) {
+		Log::error("Failed to seek to slot %i in region file %s", slot, _path.c_str());
+		return false;
+	}
+	data.resize(e.size);
+	if (SDL_RWread(_rwops, data.data(), 1, e.size) != e.size) {
+		Log::error("Failed to read slot %i from region file %s", slot, _path.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool WorldRegionFile::write(int slot, const uint8_t* data, uint32_t size) {
+	core_assert(slot >= 0 && slot < SLOTS);
+	core_assert(size > 0u);
+	core_trace_scoped(WorldRegionFileWrite);
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_rwops == nullptr) {
+		return false;
+	}
+	// the data always goes into new sectors - the old data stays intact until the offset table
+	// points to the new location
+	Entry e;
+	e.capacity = (size + SECTOR_SIZE - 1u) / SECTOR_SIZE * SECTOR_SIZE;
+	e.offset = allocate(e.capacity);
+	e.size = size;
+	if (SDL_RWseek(_rwops, e.offset, RW_SEEK_SET) != (Sint64)e.offset) {
+		Log::error("Failed to seek to slot %i in region file %s", slot, _path.c_str());
+		release(e.offset, e.capacity);
+		return false;
+	}
+	if (SDL_RWwrite(_rwops, data, 1, size) != size) {
+		Log::error("Failed to write slot %i to region file %s", slot, _path.c_str());
+		release(e.offset, e.capacity);
+		return false;
+	}
+	// pad the sectors to keep the file size in sync with the capacity of the last entry
+	const uint32_t end = e.offset + e.capacity;
+	if (end == _fileSize) {
+		static const uint8_t zeros[SECTOR_SIZE] = {};
+		const uint32_t padding = e.capacity - size;
+		if (padding > 0u && SDL_RWwrite(_rwops, zeros, 1, padding) != padding) {
+			Log::error("Failed to pad slot %i in region file %s", slot, _path.c_str());
+			release(e.offset, e.capacity);
+			return false;
+		}
+	}
+	if (!writeEntry(slot, e)) {
+		Log::error("Failed to update the offset table of region file %s", _path.c_str());
+		release(e.offset, e.capacity);
+		return false;
+	}
+	Entry& old = _entries[slot];
+	release(old.offset, old.capacity);
+	old = e;
+	return true;
+}
+
+bool WorldRegionFile::remove(int slot) {
+	core_assert(slot >= 0 && slot < SLOTS);
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_rwops == nullptr) {
+		return false;
+	}
+	Entry& e = _entries[slot];
+	if (e.capacity == 0u) {
+		return true;
+	}
+	if (!writeEntry(slot, Entry())) {
+		Log::error("Failed to update the offset table of region file %s", _path.c_str());
+		return false;
+	}
+	// only reused after the offset table doesn't point to them anymore
+	release(e.offset, e.capacity);
+	e = Entry();
+	return true;
+}
+
+}
@@ -0,0 +1,108 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "core/NonCopyable.h"
+#include <glm/vec3.hpp>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+struct SDL_RWops;
+
+namespace voxel {
+
+/**
+ * @brief Container file that stores the compressed data of many chunks in one file.
+ *
+ * The file starts with a header and an offset table with one entry per chunk slot. The chunk
+ * data is stored behind the table in blocks of @c SECTOR_SIZE bytes. Chunk data is never overwritten
+ * in place - it is written into the first free gap that is big enough or appended to the end of the
+ * file, and the offset table is updated afterwards. The sectors of the previous version are reused
+ * once the table no longer points to them, so a failed write keeps the previous version.
+ *
+ * @note All methods are thread safe.
+ */
+class WorldRegionFile : public core::NonCopyable {
+public:
+	/** The amount of chunks per axis that are stored in one region file */
+	static constexpr int CHUNKS_PER_AXIS = 8;
+	static constexpr int SLOTS = CHUNKS_PER_AXIS * CHUNKS_PER_AXIS * CHUNKS_PER_AXIS;
+	static constexpr uint32_t SECTOR_SIZE = 4096u;
+
+	WorldRegionFile(const std::string& path);
+	~WorldRegionFile();
+
+	/**
+	 * @brief Opens an existing region file or creates a new one if it doesn't exist yet.
+	 * @return @c false if the file could not get opened or has an invalid header
+	 */
+	bool open();
+	void close();
+
+	/**
+	 * @brief Computes the slot index for the given chunk position (in chunk space)
+	 */
+	static int slot(const glm::ivec3& chunkPos);
+	/**
+	 * @brief Computes the region position for the given chunk position (in chunk space)
+	 */
+	static glm::ivec3 regionPos(const glm::ivec3& chunkPos);
+
+	/**
+	 * @return @c true if the given slot contains data
+	 */
+	bool has(int slot) const;
+	/**
+	 * @param[out] data The stored data of the given slot
+	 * @return @c false if the slot is empty or the data could not get read
+	 */
+	bool read(int slot, std::vector<uint8_t>& data) const;
+	bool write(int slot, const uint8_t* data, uint32_t size);
+	/**
+	 * @brief Clears the slot - the sectors are reused by the following writes
+	 * @return @c false if the offset table could not get updated
+	 */
+	bool remove(int slot);
+
+	const std::string& path() const;
+
+private:
+	struct Entry {
+		uint32_t offset = 0u;
+		uint32_t size = 0u;
+		uint32_t capacity = 0u;
+	};
+
+	// a gap between the chunk data - sorted by offset and never adjacent to each other
+	struct Gap {
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	bool writeHeader();
+	bool writeEntry(int slot, const Entry& e);
+	void collectGaps();
+	uint32_t allocate(uint32_t capacity);
+	void release(uint32_t offset, uint32_t capacity);
+	static uint32_t headerSize();
+
+	const std::string _path;
+	SDL_RWops* _rwops = nullptr;
+	uint32_t _fileSize = 0u;
+	Entry _entries[SLOTS];
+	std::vector<Gap> _gaps;
+	mutable std::mutex _mutex;
+};
+
+inline const std::string& WorldRegionFile::path() const {
+	return _path;
+}
+
+typedef std::shared_ptr<WorldRegionFile> WorldRegionFilePtr;
+
+}
@@ -0,0 +1,132 @@
+/**
+ * @file
+ *
+ * Replaces the global operator new to count the heap allocations of the whole process - that's
+ * why this benchmark lives in its own executable.
+ */
+
+#include "core/benchmark/AbstractBenchmark.h"
+#include "voxel/polyvox/PagedVolume.h"
+#include "voxel/polyvox/CubicSurfaceExtractor.h"
+#include "voxel/MaterialColor.h"
+#include "voxel/Constants.h"
+#include "voxel/IsQuadNeeded.h"
+#include <SDL.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// counts the heap allocations of the whole process - see extractAllocations
+std::atomic<uint64_t> allocations { 0u };
+
+SDL_malloc_func sdlMalloc = nullptr;
+SDL_calloc_func sdlCalloc = nullptr;
+SDL_realloc_func sdlRealloc = nullptr;
+SDL_free_func sdlFree = nullptr;
+
+void* SDLCALL countingMalloc(size_t size) {
+	++allocations;
+	return sdlMalloc(size);
+}
+
+void* SDLCALL countingCalloc(size_t nmemb, size_t size) {
+	++allocations;
+	return sdlCalloc(nmemb, size);
+}
+
+void* SDLCALL countingRealloc(void* mem, size_t size) {
+	++allocations;
+	return sdlRealloc(mem, size);
+}
+
+}
+
+void* operator new(size_t size) {
+	++allocations;
+	void* ptr = malloc(size);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+class ExtractAllocationsBenchmark: public core::AbstractBenchmark {
+public:
+	bool onInitApp() override {
+		voxel::initDefaultMaterialColors();
+		return true;
+	}
+};
+
+/**
+ * Hills of grass on top of rock - gives the quad merging something to do
+ */
+class HillPager: public voxel::PagedVolume::Pager {
+public:
+	bool pageIn(voxel::PagedVolume::PagerContext& ctx) override {
+		const voxel::Region& region = ctx.region;
+		const voxel::Voxel& rock = voxel::createVoxel(voxel::VoxelType::Rock, 0);
+		const voxel::Voxel& grass = voxel::createVoxel(voxel::VoxelType::Grass, 0);
+		const int sideLength = region.getWidthInVoxels();
+		for (int z = 0; z < sideLength; ++z) {
+			for (int x = 0; x < sideLength; ++x) {
+				const int worldX = region.getLowerX() + x;
+				const int worldZ = region.getLowerZ() + z;
+				const int height = 64 + (int)(20.0f * glm::sin(worldX * 0.2f) * glm::cos(worldZ * 0.15f));
+				for (int y = 0; y < sideLength; ++y) {
+					const int worldY = region.getLowerY() + y;
+					if (worldY < height) {
+						ctx.chunk->setVoxel(x, y, z, rock);
+					} else if (worldY == height) {
+						ctx.chunk->setVoxel(x, y, z, grass);
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	void pageOut(voxel::PagedVolume::Chunk* chunk) override {
+	}
+};
+
+/**
+ * Extracts the same region over and over again. After the first extraction all the temporary
+ * buffers of the extractor and the meshes are big enough - so no heap allocation should happen
+ * anymore.
+ */
+BENCHMARK_DEFINE_F(ExtractAllocationsBenchmark, extractAllocations) (benchmark::State& state) {
+	HillPager pager;
+	voxel::PagedVolume volumeData(&pager, 64 * 1024 * 1024, 32);
+	const voxel::Region region(glm::ivec3(0), glm::ivec3(15, 127, 15));
+	voxel::Mesh mesh(0, 0, true);
+	voxel::Mesh waterMesh(0, 0, true);
+	// warm up - pages in the chunks and grows the buffers
+	voxel::extractAllCubicMesh(&volumeData, region, &mesh, &waterMesh, voxel::IsQuadNeeded(), voxel::IsWaterQuadNeeded(), voxel::MAX_WATER_HEIGHT);
+
+	SDL_GetMemoryFunctions(&sdlMalloc, &sdlCalloc, &sdlRealloc, &sdlFree);
+	SDL_SetMemoryFunctions(countingMalloc, countingCalloc, countingRealloc, sdlFree);
+	uint64_t extractionAllocations = 0u;
+	while (state.KeepRunning()) {
+		const uint64_t before = allocations;
+		voxel::extractAllCubicMesh(&volumeData, region, &mesh, &waterMesh, voxel::IsQuadNeeded(), voxel::IsWaterQuadNeeded(), voxel::MAX_WATER_HEIGHT);
+		extractionAllocations += allocations - before;
+	}
+	SDL_SetMemoryFunctions(sdlMalloc, sdlCalloc, sdlRealloc, sdlFree);
+	state.counters["allocations"] = (double)extractionAllocations / (double)state.iterations();
+	state.counters["indices"] = (double)mesh.getNoOfIndices();
+}
+
+BENCHMARK_REGISTER_F(ExtractAllocationsBenchmark, extractAllocations);
+
+BENCHMARK_MAIN()
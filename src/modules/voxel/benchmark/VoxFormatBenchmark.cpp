@@ -0,0 +1,88 @@
+#include "core/benchmark/AbstractBenchmark.h"
+#include "voxel/model/QBFormat.h"
+#include "voxel/model/VoxFormat.h"
+#include "voxel/polyvox/RawVolume.h"
+#include "voxel/MaterialColor.h"
+#include "io/FileStream.h"
+#include <glm/glm.hpp>
+
+/**
+ * Saves a big volume once in every format - the benchmarks load it again
+ */
+class VoxFormatBenchmark: public core::AbstractBenchmark {
+protected:
+	static constexpr int SideLength = 126;
+
+	io::FilePtr open(const char* name, io::FileMode mode = io::FileMode::Read) {
+		return core::App::getInstance()->filesystem()->open(name, mode);
+	}
+
+	template<class FORMAT>
+	void load(benchmark::State& state, const char* name) {
+		FORMAT format;
+		const int64_t bytes = open(name)->length();
+		while (state.KeepRunning()) {
+			const io::FilePtr& file = open(name);
+			voxel::RawVolume* volume = format.load(file);
+			benchmark::DoNotOptimize(volume);
+			delete volume;
+		}
+		state.SetBytesProcessed(state.iterations() * bytes);
+	}
+public:
+	bool onInitApp() override {
+		voxel::initDefaultMaterialColors();
+		const voxel::Region region(glm::ivec3(0), glm::ivec3(SideLength - 1));
+		voxel::RawVolume volume(region);
+		const voxel::Voxel& rock = voxel::createVoxel(voxel::VoxelType::Rock, 0);
+		const voxel::Voxel& grass = voxel::createVoxel(voxel::VoxelType::Grass, 0);
+		// hills - the runs of the same voxels have different lengths
+		for (int z = 0; z < SideLength; ++z) {
+			for (int x = 0; x < SideLength; ++x) {
+				const int height = SideLength / 2 + (int)(20.0f * glm::sin(x * 0.2f) * glm::cos(z * 0.15f));
+				for (int y = 0; y < height; ++y) {
+					volume.setVoxel(x, y, z, y == height - 1 ? grass : rock);
+				}
+			}
+		}
+		voxel::QBFormat qb;
+		voxel::VoxFormat vox;
+		return qb.save(&volume, open("benchmark.qb", io::FileMode::Write))
+				&& vox.save(&volume, open("benchmark.vox", io::FileMode::Write));
+	}
+};
+
+BENCHMARK_DEFINE_F(VoxFormatBenchmark, loadQB) (benchmark::State& state) {
+	load<voxel::QBFormat>(state, "benchmark.qb");
+}
+
+BENCHMARK_REGISTER_F(VoxFormatBenchmark, loadQB);
+
+BENCHMARK_DEFINE_F(VoxFormatBenchmark, loadVox) (benchmark::State& state) {
+	load<voxel::VoxFormat>(state, "benchmark.vox");
+}
+
+BENCHMARK_REGISTER_F(VoxFormatBenchmark, loadVox);
+
+/**
+ * Reads the whole qb file value by value in the given FileStreamMode
+ */
+BENCHMARK_DEFINE_F(VoxFormatBenchmark, readStream) (benchmark::State& state) {
+	const io::FileStreamMode mode = (io::FileStreamMode)state.range(0);
+	int64_t bytes = 0;
+	while (state.KeepRunning()) {
+		const io::FilePtr& file = open("benchmark.qb");
+		io::FileStream stream(file.get(), mode);
+		uint32_t val;
+		while (stream.readInt(val) == 0) {
+			benchmark::DoNotOptimize(val);
+		}
+		bytes += stream.size();
+	}
+	state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK_REGISTER_F(VoxFormatBenchmark, readStream)
+	->Arg((int)io::FileStreamMode::Direct)
+	->Arg((int)io::FileStreamMode::Buffered)
+	->Arg((int)io::FileStreamMode::Mapped);
@@ -6,6 +6,10 @@
 #include "voxel/BiomeManager.h"
 #include "voxel/Constants.h"
 #include "voxel/IsQuadNeeded.h"
+#include "voxel/World.h"
+#include "core/Var.h"
+#include "core/GameConfig.h"
+#include <thread>
 
 class PagedVolumeBenchmark: public core::AbstractBenchmark {
 protected:
@@ -52,4 +56,130 @@ BENCHMARK_DEFINE_F(PagedVolumeBenchmark, pageIn) (benchmark::State& state) {
 
 BENCHMARK_REGISTER_F(PagedVolumeBenchmark, pageIn)->RangeMultiplier(2)->Range(8, 256);
 
+/**
+ * Fills every chunk below the height of zero - this is cheap enough to let the chunk
+ * management dominate the measurement
+ */
+class GroundPager: public voxel::PagedVolume::Pager {
+public:
+	bool pageIn(voxel::PagedVolume::PagerContext& ctx) override {
+		if (ctx.region.getLowerY() >= 0) {
+			return false;
+		}
+		const voxel::Voxel& voxel = voxel::createVoxel(voxel::VoxelType::Rock, 0);
+		const int sideLength = ctx.region.getWidthInVoxels();
+		for (int z = 0; z < sideLength; ++z) {
+			for (int y = 0; y < sideLength; ++y) {
+				for (int x = 0; x < sideLength; ++x) {
+					ctx.chunk->setVoxel(x, y, z, voxel);
+				}
+			}
+		}
+		return false;
+	}
+
+	void pageOut(voxel::PagedVolume::Chunk* chunk) override {
+	}
+};
+
+BENCHMARK_DEFINE_F(PagedVolumeBenchmark, pageThrough) (benchmark::State& state) {
+	const uint16_t chunkSideLength = state.range(0);
+	// the smallest budget the volume accepts - the walk below touches much more chunks
+	const uint32_t volumeMemoryMegaBytes = 1;
+	GroundPager pager;
+	voxel::PagedVolume volumeData(&pager, volumeMemoryMegaBytes * 1024 * 1024, chunkSideLength);
+	const int chunksPerRow = 64;
+	int z = 0;
+	while (state.KeepRunning()) {
+		for (int x = 0; x < chunksPerRow; ++x) {
+			for (int y = -1; y <= 0; ++y) {
+				benchmark::DoNotOptimize(volumeData.voxel(x * chunkSideLength, y * chunkSideLength, z));
+			}
+		}
+		z += chunkSideLength;
+	}
+	state.SetItemsProcessed(state.iterations() * chunksPerRow * 2);
+}
+
+BENCHMARK_REGISTER_F(PagedVolumeBenchmark, pageThrough)->RangeMultiplier(2)->Range(8, 32);
+
+BENCHMARK_DEFINE_F(PagedVolumeBenchmark, chunkLookup) (benchmark::State& state) {
+	const uint32_t threads = state.range(0);
+	const int chunkSideLength = 16;
+	const int chunks = 8;
+	const int lookupsPerThread = 100000;
+	GroundPager pager;
+	voxel::PagedVolume volumeData(&pager, 64 * 1024 * 1024, chunkSideLength);
+	// page in all chunks before measuring
+	for (int z = 0; z < chunks; ++z) {
+		for (int y = -1; y <= 0; ++y) {
+			for (int x = 0; x < chunks; ++x) {
+				volumeData.voxel(x * chunkSideLength, y * chunkSideLength, z * chunkSideLength);
+			}
+		}
+	}
+	while (state.KeepRunning()) {
+		std::vector<std::thread> workers;
+		for (uint32_t t = 0; t < threads; ++t) {
+			workers.emplace_back([&volumeData, t] () {
+				// every thread jumps between the chunks - so the last accessed chunk cache misses
+				uint32_t n = t;
+				for (int i = 0; i < lookupsPerThread; ++i) {
+					n = n * 1664525u + 1013904223u;
+					const int x = (n >> 8) % (chunks * chunkSideLength);
+					const int z = (n >> 16) % (chunks * chunkSideLength);
+					benchmark::DoNotOptimize(volumeData.voxel(x, -1, z));
+				}
+			});
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * threads * lookupsPerThread);
+}
+
+BENCHMARK_REGISTER_F(PagedVolumeBenchmark, chunkLookup)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+BENCHMARK_DEFINE_F(PagedVolumeBenchmark, extractWorld) (benchmark::State& state) {
+	const uint32_t threads = state.range(0);
+	const int regions = 64;
+	core::Var::get(cfg::VoxelMeshSize, "16", core::CV_READONLY);
+	const io::FilesystemPtr& filesystem = core::App::getInstance()->filesystem();
+	const std::string& luaParameters = filesystem->load("world.lua");
+	const std::string& luaBiomes = filesystem->load("biomes.lua");
+	int offset = 0;
+	while (state.KeepRunning()) {
+		state.PauseTiming();
+		voxel::World world(threads);
+		world.init(luaParameters, luaBiomes);
+		world.setSeed(1l);
+		world.setPersist(false);
+		state.ResumeTiming();
+		const glm::ivec3& meshSize = world.meshSize();
+		for (int i = 0; i < regions; ++i) {
+			world.scheduleMeshExtraction(glm::ivec3((offset + i) * meshSize.x, 0, 0));
+		}
+		offset += regions;
+		std::vector<voxel::ExtractionWorkerStats> workers;
+		for (;;) {
+			int extracted = 0;
+			world.stats(workers);
+			for (const voxel::ExtractionWorkerStats& w : workers) {
+				extracted += w.extracted;
+			}
+			if (extracted >= regions) {
+				break;
+			}
+			std::this_thread::yield();
+		}
+		state.PauseTiming();
+		world.shutdown();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * regions);
+}
+
+BENCHMARK_REGISTER_F(PagedVolumeBenchmark, extractWorld)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
 BENCHMARK_MAIN()
@@ -4,29 +4,34 @@
 namespace voxel {
 namespace world {
 
-WorldGenerator::WorldGenerator(BiomeManager& biomeManager, long seed) :
-		_biomeManager(biomeManager), _seed(seed), _random(seed) {
+WorldGenerator::WorldGenerator(BiomeManager& biomeManager, long seed, WorldColumnCache* columnCache) :
+		_biomeManager(biomeManager), _seed(seed), _random(seed), _columnCache(columnCache) {
 }
 
-float WorldGenerator::getHeight(const glm::vec2& noisePos2d, const WorldContext& worldCtx) const {
-	// TODO: move the noise settings into the biome
-	const float landscapeNoise = ::noise::Noise2D(noisePos2d, worldCtx.landscapeNoiseOctaves,
-			worldCtx.landscapeNoisePersistence, worldCtx.landscapeNoiseFrequency, worldCtx.landscapeNoiseAmplitude);
-	const float noiseNormalized = ::noise::norm(landscapeNoise);
-	const float mountainNoise = ::noise::Noise2D(noisePos2d, worldCtx.mountainNoiseOctaves,
-			worldCtx.mountainNoisePersistence, worldCtx.mountainNoiseFrequency, worldCtx.mountainNoiseAmplitude);
-	const float mountainNoiseNormalized = ::noise::norm(mountainNoise);
-	const float mountainMultiplier = mountainNoiseNormalized * (mountainNoiseNormalized + 0.5f);
-	const float n = glm::clamp(noiseNormalized * mountainMultiplier, 0.0f, 1.0f);
-	return n;
+void WorldGenerator::getColumns(int lowerX, int lowerZ, int width, int depth, int step, const WorldContext& worldCtx, int noiseSeedOffsetX, int noiseSeedOffsetZ, ColumnData* columns) const {
+	if (_columnCache == nullptr) {
+		WorldColumnCache::compute(_biomeManager, worldCtx, glm::ivec2(noiseSeedOffsetX, noiseSeedOffsetZ), lowerX, lowerZ, width, depth, step, columns);
+		return;
+	}
+	WorldColumnCache::TilePtr tile;
+	int i = 0;
+	for (int z = 0; z < depth; ++z) {
+		const int worldZ = lowerZ + z * step;
+		for (int x = 0; x < width; ++x, ++i) {
+			const int worldX = lowerX + x * step;
+			if (!tile || !tile->contains(worldX, worldZ)) {
+				tile = _columnCache->tile(worldX, worldZ);
+			}
+			columns[i] = tile->column(worldX, worldZ);
+		}
+	}
 }
 
-int WorldGenerator::fillVoxels(int x, int lowerY, int z, const WorldContext& worldCtx, Voxel* voxels, int noiseSeedOffsetX, int noiseSeedOffsetZ, int maxHeight) const {
+int WorldGenerator::fillVoxels(int x, int lowerY, int z, const ColumnData& column, const WorldContext& worldCtx, Voxel* voxels, int noiseSeedOffsetX, int noiseSeedOffsetZ, int maxHeight) const {
 	const glm::vec2 noisePos2d(noiseSeedOffsetX + x, noiseSeedOffsetZ + z);
-	const float n = getHeight(noisePos2d, worldCtx);
-	const glm::ivec3 noisePos3d(x, lowerY, z);
-	int centerHeight;
-	const float cityMultiplier = _biomeManager.getCityMultiplier(glm::ivec2(x, z), &centerHeight);
+	const float n = column.height;
+	const int centerHeight = column.cityHeight;
+	const float cityMultiplier = column.cityMultiplier;
 	int ni = n * maxHeight;
 	if (cityMultiplier < 1.0f) {
 		const float revn = (1.0f - cityMultiplier);
@@ -41,18 +46,22 @@ int WorldGenerator::fillVoxels(int x, int lowerY, int z, const WorldContext& wor
 	static constexpr Voxel air;
 
 	voxels[0] = dirt;
-	glm::ivec3 pos(x, 0, z);
-	for (int y = ni - 1; y >= lowerY + 1; --y) {
-		const glm::vec3 noisePos3d(noisePos2d.x, y, noisePos2d.y);
+	// evaluate the cave noise for the whole column at once
+	const int caveLowerY = lowerY + 1;
+	float caveNoise[MAX_TERRAIN_HEIGHT];
+	if (ni > caveLowerY) {
 		// TODO: move the noise settings into the biome
-		const float noiseVal = ::noise::norm(
-				::noise::Noise3D(noisePos3d, worldCtx.caveNoiseOctaves, worldCtx.caveNoisePersistence,
-						worldCtx.caveNoiseFrequency, worldCtx.caveNoiseAmplitude));
+		::noise::Noise3DColumn(noisePos2d.x, noisePos2d.y, caveLowerY, ni, caveNoise, worldCtx.caveNoiseOctaves,
+				worldCtx.caveNoisePersistence, worldCtx.caveNoiseFrequency, worldCtx.caveNoiseAmplitude);
+	}
+	glm::ivec3 pos(x, 0, z);
+	for (int y = ni - 1; y >= caveLowerY; --y) {
+		const float noiseVal = ::noise::norm(caveNoise[y - caveLowerY]);
 		const float finalDensity = n + noiseVal;
 		if (finalDensity > worldCtx.caveDensityThreshold) {
 			const bool cave = y < ni - 1;
 			pos.y = y;
-			const Voxel& voxel = _biomeManager.getVoxel(pos, cave);
+			const Voxel& voxel = _biomeManager.getVoxel(pos, column.humidity, column.temperature, cave);
 			voxels[y] = voxel;
 		} else {
 			if (y < MAX_WATER_HEIGHT) {
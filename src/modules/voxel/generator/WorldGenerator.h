@@ -12,7 +12,9 @@
 #include "voxel/polyvox/Voxel.h"
 #include "voxel/Constants.h"
 #include "voxel/WorldContext.h"
+#include "voxel/WorldColumnCache.h"
 #include "voxel/MaterialColor.h"
+#include <vector>
 
 namespace voxel {
 namespace world {
@@ -28,11 +30,21 @@ private:
 	BiomeManager& _biomeManager;
 	long _seed;
 	core::Random _random;
+	WorldColumnCache* _columnCache;
 
-	int fillVoxels(int x, int y, int z, const WorldContext& worldCtx, Voxel* voxels, int noiseSeedOffsetX, int noiseSeedOffsetZ, int maxHeight) const;
-	float getHeight(const glm::vec2& noisePos2d, const WorldContext& worldCtx) const;
+	int fillVoxels(int x, int y, int z, const ColumnData& column, const WorldContext& worldCtx, Voxel* voxels, int noiseSeedOffsetX, int noiseSeedOffsetZ, int maxHeight) const;
+	/**
+	 * @brief Collects the column data for a grid of columns - from the cache if there is one
+	 * @param[in] step The distance between two columns
+	 * @param[out] columns Buffer of size @c width * @c depth
+	 */
+	void getColumns(int lowerX, int lowerZ, int width, int depth, int step, const WorldContext& worldCtx, int noiseSeedOffsetX, int noiseSeedOffsetZ, ColumnData* columns) const;
 public:
-	WorldGenerator(BiomeManager& biomeManager, long seed = 0);
+	/**
+	 * @param[in] columnCache Optional cache for the 2d data of the world columns. Must be initialized with the
+	 * same context and noise offset that are given to @c createWorld()
+	 */
+	WorldGenerator(BiomeManager& biomeManager, long seed = 0, WorldColumnCache* columnCache = nullptr);
 
 	template<class Volume>
 	bool createBuildings(Volume& volume) {
@@ -75,9 +87,14 @@ public:
 		const int size = 2;
 		core_assert(depth % size == 0);
 		core_assert(width % size == 0);
+		const int columnsX = width / size;
+		const int columnsZ = depth / size;
+		std::vector<ColumnData> columns(columnsX * columnsZ);
+		getColumns(lowerX, lowerZ, columnsX, columnsZ, size, worldCtx, noiseSeedOffsetX, noiseSeedOffsetZ, columns.data());
+		int column = 0;
 		for (int z = lowerZ; z < lowerZ + depth; z += size) {
-			for (int x = lowerX; x < lowerX + width; x += size) {
-				const int ni = fillVoxels(x, lowerY, z, worldCtx, voxels, noiseSeedOffsetX, noiseSeedOffsetZ, MAX_TERRAIN_HEIGHT - 1);
+			for (int x = lowerX; x < lowerX + width; x += size, ++column) {
+				const int ni = fillVoxels(x, lowerY, z, columns[column], worldCtx, voxels, noiseSeedOffsetX, noiseSeedOffsetZ, MAX_TERRAIN_HEIGHT - 1);
 				volume.setVoxels(x, lowerY, z, size, size, voxels, ni);
 			}
 		}
@@ -379,7 +379,7 @@ RawVolume* QBFormat::load(const io::FilePtr& file) {
 		Log::error("Could not load qb file: File doesn't exist");
 		return nullptr;
 	}
-	io::FileStream stream(file.get());
+	io::FileStream stream(file.get(), io::FileStreamMode::Mapped);
 	voxel::RawVolume* volume = loadFromStream(stream);
 	return volume;
 }
@@ -219,7 +219,7 @@ RawVolume* QBTFormat::load(const io::FilePtr& file) {
 		Log::error("Could not load qbt file: File doesn't exist");
 		return nullptr;
 	}
-	io::FileStream stream(file.get());
+	io::FileStream stream(file.get(), io::FileStreamMode::Mapped);
 	if (!loadFromStream(stream)) {
 		return nullptr;
 	}
@@ -115,7 +115,7 @@ RawVolume* VoxFormat::load(const io::FilePtr& file) {
 		Log::error("Could not load vox file: File doesn't exist");
 		return nullptr;
 	}
-	io::FileStream stream(file.get());
+	io::FileStream stream(file.get(), io::FileStreamMode::Mapped);
 
 	// 1. File Structure : RIFF style
 	// -------------------------------------------------------------------------------
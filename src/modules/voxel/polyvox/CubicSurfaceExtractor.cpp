@@ -4,6 +4,8 @@
 
 #include "CubicSurfaceExtractor.h"
 #include <SDL.h>
+#include <algorithm>
+#include <limits>
 
 namespace voxel {
 
@@ -58,26 +60,40 @@ static bool mergeQuads(Quad& q1, Quad& q2, Mesh* meshCurrent) {
 	return false;
 }
 
-static bool performQuadMerging(QuadList& quads, Mesh* meshCurrent) {
-	bool didMerge = false;
-	for (QuadList::iterator outerIter = quads.begin(); outerIter != quads.end(); ++outerIter) {
-		QuadList::iterator innerIter = outerIter;
-		++innerIter;
-		while (innerIter != quads.end()) {
-			Quad& q1 = *outerIter;
-			Quad& q2 = *innerIter;
+/**
+ * @brief Quads that were merged into another quad are flagged with this index
+ */
+static const IndexType MergedQuad = std::numeric_limits<IndexType>::max();
 
-			const bool result = mergeQuads(q1, q2, meshCurrent);
+SDL_FORCE_INLINE bool isMerged(const Quad& quad) {
+	return quad.vertices[0] == MergedQuad;
+}
 
-			if (result) {
+static bool performQuadMerging(QuadList& quads, Mesh* meshCurrent) {
+	bool didMerge = false;
+	const size_t size = quads.size();
+	for (size_t outer = 0; outer < size; ++outer) {
+		Quad& q1 = quads[outer];
+		if (isMerged(q1)) {
+			continue;
+		}
+		for (size_t inner = outer + 1; inner < size; ++inner) {
+			Quad& q2 = quads[inner];
+			if (isMerged(q2)) {
+				continue;
+			}
+			if (mergeQuads(q1, q2, meshCurrent)) {
 				didMerge = true;
-				innerIter = quads.erase(innerIter);
-			} else {
-				++innerIter;
+				q2.vertices[0] = MergedQuad;
 			}
 		}
 	}
 
+	if (didMerge) {
+		// keeps the order of the remaining quads
+		quads.erase(std::remove_if(quads.begin(), quads.end(), isMerged), quads.end());
+	}
+
 	return didMerge;
 }
 
@@ -92,6 +108,53 @@ SDL_FORCE_INLINE uint8_t vertexAmbientOcclusion(bool side1, bool side2, bool cor
 	return 3 - (side1 + side2 + corner);
 }
 
+constexpr size_t ExtractionScratch::MaxRetainedBytes;
+
+ExtractionScratch& ExtractionScratch::get() {
+	static thread_local ExtractionScratch scratch;
+	return scratch;
+}
+
+static size_t capacityInBytes(const QuadListVector& vecListQuads) {
+	size_t bytes = vecListQuads.capacity() * sizeof(QuadList);
+	for (const QuadList& listQuads : vecListQuads) {
+		bytes += listQuads.capacity() * sizeof(Quad);
+	}
+	return bytes;
+}
+
+size_t ExtractionScratch::capacityInBytes() const {
+	size_t bytes = previousSliceVertices.capacityInBytes() + currentSliceVertices.capacityInBytes()
+			+ previousSliceVerticesWater.capacityInBytes() + currentSliceVerticesWater.capacityInBytes();
+	for (const QuadListVector& vecListQuads : vecQuads) {
+		bytes += voxel::capacityInBytes(vecListQuads);
+	}
+	return bytes + voxel::capacityInBytes(vecQuadsWater);
+}
+
+void ExtractionScratch::shrink() {
+	if (capacityInBytes() <= MaxRetainedBytes) {
+		return;
+	}
+	previousSliceVertices.release();
+	currentSliceVertices.release();
+	previousSliceVerticesWater.release();
+	currentSliceVerticesWater.release();
+	for (QuadListVector& vecListQuads : vecQuads) {
+		QuadListVector().swap(vecListQuads);
+	}
+	QuadListVector().swap(vecQuadsWater);
+}
+
+void resetQuads(QuadListVector& vecListQuads, size_t size) {
+	if (vecListQuads.size() < size) {
+		vecListQuads.resize(size);
+	}
+	for (QuadList& listQuads : vecListQuads) {
+		listQuads.clear();
+	}
+}
+
 void meshify(Mesh* result, bool mergeQuads, QuadListVector& vecListQuads) {
 	for (QuadList& listQuads : vecListQuads) {
 		if (mergeQuads) {
@@ -10,7 +10,6 @@
 #include "core/NonCopyable.h"
 #include "Region.h"
 #include <vector>
-#include <list>
 #include "core/Trace.h"
 
 #define BUFFERED_SAMPLER 1
@@ -64,21 +63,40 @@ struct VertexData {
 
 class Array : core::NonCopyable {
 private:
-	uint32_t _width;
-	uint32_t _height;
-	uint32_t _depth;
-	VertexData* _elements;
+	uint32_t _width = 0u;
+	uint32_t _height = 0u;
+	uint32_t _depth = 0u;
+	size_t _capacity = 0u;
+	VertexData* _elements = nullptr;
 public:
-	Array(uint32_t width, uint32_t height, uint32_t depth) :
-			_width(width), _height(height), _depth(depth) {
-		_elements = (VertexData*)SDL_malloc(width * height * depth * sizeof(VertexData));
-		SDL_memset(_elements, 0, width * height * depth * sizeof(VertexData));
+	Array() {
+	}
+
+	Array(uint32_t width, uint32_t height, uint32_t depth) {
+		resize(width, height, depth);
 	}
 
 	~Array() {
 		SDL_free(_elements);
 	}
 
+	/**
+	 * @brief Changes the dimensions and clears all elements. The memory is only reallocated if
+	 * the array has to grow.
+	 */
+	void resize(uint32_t width, uint32_t height, uint32_t depth) {
+		const size_t size = (size_t)width * height * depth;
+		if (size > _capacity) {
+			SDL_free(_elements);
+			_elements = (VertexData*)SDL_malloc(size * sizeof(VertexData));
+			_capacity = size;
+		}
+		_width = width;
+		_height = height;
+		_depth = depth;
+		clear();
+	}
+
 	void clear() {
 		memset(_elements, 0x0, _width * _height * _depth * sizeof(VertexData));
 	}
@@ -90,15 +108,85 @@ public:
 
 	void swap(Array& other) {
 		std::swap(_elements, other._elements);
+		std::swap(_capacity, other._capacity);
+	}
+
+	inline size_t capacityInBytes() const {
+		return _capacity * sizeof(VertexData);
+	}
+
+	/**
+	 * @brief Frees the memory - the next @c resize() call allocates again
+	 */
+	void release() {
+		SDL_free(_elements);
+		_elements = nullptr;
+		_capacity = 0u;
+		_width = _height = _depth = 0u;
 	}
 };
 
 /**
- * @brief Should be a list because random inserts which we need in @c performQuadMerging are O(1)
+ * @brief The quads of one plane. The merged quads are removed in one pass after each merge
+ * iteration in @c performQuadMerging - so the memory can be reused for the next extraction.
  */
-typedef std::list<Quad> QuadList;
+typedef std::vector<Quad> QuadList;
 typedef std::vector<QuadList> QuadListVector;
 
+/**
+ * @brief The temporary buffers of the surface extraction. Each thread has its own instance
+ * and the buffers only grow - extracting regions of the same size doesn't allocate any
+ * memory after the first extraction. The memory is released after an extraction that needed
+ * more than @c MaxRetainedBytes.
+ */
+struct ExtractionScratch {
+	static constexpr size_t MaxRetainedBytes = 16u * 1024u * 1024u;
+
+	Array previousSliceVertices;
+	Array currentSliceVertices;
+	Array previousSliceVerticesWater;
+	Array currentSliceVerticesWater;
+
+	// During extraction we create a number of different lists of quads. All the
+	// quads in a given list are in the same plane and facing in the same direction.
+	QuadListVector vecQuads[NoOfFaces];
+	QuadListVector vecQuadsWater;
+
+	/**
+	 * @return The instance of the calling thread
+	 */
+	static ExtractionScratch& get();
+
+	size_t capacityInBytes() const;
+	/**
+	 * @brief Releases all the memory if more than @c MaxRetainedBytes are kept
+	 */
+	void shrink();
+
+	/**
+	 * @brief The instance of the calling thread - shrunk at the end of the scope
+	 */
+	class Scoped {
+	private:
+		ExtractionScratch& _scratch;
+	public:
+		Scoped() : _scratch(get()) {
+		}
+		~Scoped() {
+			_scratch.shrink();
+		}
+		inline ExtractionScratch& operator*() {
+			return _scratch;
+		}
+	};
+};
+
+/**
+ * @brief Makes sure that there are at least @c size empty quad lists - without releasing the
+ * memory of the lists.
+ */
+extern void resetQuads(QuadListVector& vecListQuads, size_t size);
+
 /**
  * @section Surface extraction
  */
@@ -216,27 +304,30 @@ void extractCubicMesh(VolumeType* volData, const Region& region, Mesh* result, I
 	const glm::ivec3& upper = region.getUpperCorner();
 	result->setOffset(offset);
 
+	ExtractionScratch::Scoped scopedScratch;
+	ExtractionScratch& scratch = *scopedScratch;
+
 	// Used to avoid creating duplicate vertices.
 	const int widthInCells = upper.x - offset.x;
 	const int heightInCells = upper.y - offset.y;
-	Array previousSliceVertices(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
-	Array currentSliceVertices(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
+	Array& previousSliceVertices = scratch.previousSliceVertices;
+	Array& currentSliceVertices = scratch.currentSliceVertices;
+	previousSliceVertices.resize(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
+	currentSliceVertices.resize(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
 
-	// During extraction we create a number of different lists of quads. All the
-	// quads in a given list are in the same plane and facing in the same direction.
-	QuadListVector vecQuads[NoOfFaces];
+	QuadListVector* vecQuads = scratch.vecQuads;
 
 	const int xSize = upper.x - offset.x + 2;
 	const int ySize = upper.y - offset.y + 2;
 	const int zSize = upper.z - offset.z + 2;
-	vecQuads[NegativeX].resize(xSize);
-	vecQuads[PositiveX].resize(xSize);
+	resetQuads(vecQuads[NegativeX], xSize);
+	resetQuads(vecQuads[PositiveX], xSize);
 
-	vecQuads[NegativeY].resize(ySize);
-	vecQuads[PositiveY].resize(ySize);
+	resetQuads(vecQuads[NegativeY], ySize);
+	resetQuads(vecQuads[PositiveY], ySize);
 
-	vecQuads[NegativeZ].resize(zSize);
-	vecQuads[PositiveZ].resize(zSize);
+	resetQuads(vecQuads[NegativeZ], zSize);
+	resetQuads(vecQuads[PositiveZ], zSize);
 
 #if BUFFERED_SAMPLER == 1
 	typename VolumeType::BufferedSampler volumeSampler(volData, region);
@@ -454,8 +545,8 @@ void extractCubicMesh(VolumeType* volData, const Region& region, Mesh* result, I
 
 	{
 		core_trace_scoped(GenerateMesh);
-		for (QuadListVector& vecListQuads : vecQuads) {
-			meshify(result, mergeQuads, vecListQuads);
+		for (int face = 0; face < NoOfFaces; ++face) {
+			meshify(result, mergeQuads, vecQuads[face]);
 		}
 	}
 
@@ -473,33 +564,38 @@ void extractAllCubicMesh(VolumeType* volData, const Region& region, Mesh* result
 	result->setOffset(offset);
 	resultWater->setOffset(offset);
 
+	ExtractionScratch::Scoped scopedScratch;
+	ExtractionScratch& scratch = *scopedScratch;
+
 	// Used to avoid creating duplicate vertices.
 	const int widthInCells = upper.x - offset.x;
 	const int heightInCells = upper.y - offset.y;
-	Array previousSliceVertices(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
-	Array currentSliceVertices(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
+	Array& previousSliceVertices = scratch.previousSliceVertices;
+	Array& currentSliceVertices = scratch.currentSliceVertices;
+	previousSliceVertices.resize(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
+	currentSliceVertices.resize(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
 
-	Array previousSliceVerticesWater(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
-	Array currentSliceVerticesWater(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
+	Array& previousSliceVerticesWater = scratch.previousSliceVerticesWater;
+	Array& currentSliceVerticesWater = scratch.currentSliceVerticesWater;
+	previousSliceVerticesWater.resize(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
+	currentSliceVerticesWater.resize(widthInCells + 2, heightInCells + 2, MaxVerticesPerPosition);
 
-	// During extraction we create a number of different lists of quads. All the
-	// quads in a given list are in the same plane and facing in the same direction.
-	QuadListVector vecQuads[NoOfFaces];
+	QuadListVector* vecQuads = scratch.vecQuads;
 
 	const int xSize = upper.x - offset.x + 2;
 	const int ySize = upper.y - offset.y + 2;
 	const int zSize = upper.z - offset.z + 2;
-	vecQuads[NegativeX].resize(xSize);
-	vecQuads[PositiveX].resize(xSize);
+	resetQuads(vecQuads[NegativeX], xSize);
+	resetQuads(vecQuads[PositiveX], xSize);
 
-	vecQuads[NegativeY].resize(ySize);
-	vecQuads[PositiveY].resize(ySize);
+	resetQuads(vecQuads[NegativeY], ySize);
+	resetQuads(vecQuads[PositiveY], ySize);
 
-	vecQuads[NegativeZ].resize(zSize);
-	vecQuads[PositiveZ].resize(zSize);
+	resetQuads(vecQuads[NegativeZ], zSize);
+	resetQuads(vecQuads[PositiveZ], zSize);
 
-	QuadListVector vecQuadsWater;
-	vecQuadsWater.resize(ySize);
+	QuadListVector& vecQuadsWater = scratch.vecQuadsWater;
+	resetQuads(vecQuadsWater, ySize);
 
 #if BUFFERED_SAMPLER == 1
 	typename VolumeType::BufferedSampler volumeSampler(volData, region);
@@ -743,8 +839,8 @@ void extractAllCubicMesh(VolumeType* volData, const Region& region, Mesh* result
 
 	{
 		core_trace_scoped(GenerateMesh);
-		for (QuadListVector& vecListQuads : vecQuads) {
-			meshify(result, mergeQuads, vecListQuads);
+		for (int face = 0; face < NoOfFaces; ++face) {
+			meshify(result, mergeQuads, vecQuads[face]);
 		}
 		meshify(resultWater, mergeQuads, vecQuadsWater);
 	}
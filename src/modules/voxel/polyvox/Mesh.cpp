@@ -6,6 +6,7 @@
 #include "CubicSurfaceExtractor.h"
 #include "core/Common.h"
 #include "core/Trace.h"
+#include <limits>
 
 namespace voxel {
 
@@ -44,18 +45,18 @@ bool Mesh::addMesh(const Mesh& mesh) {
 }
 
 void Mesh::removeUnusedVertices() {
-	std::vector<bool> isVertexUsed(_vecVertices.size());
-	std::fill(isVertexUsed.begin(), isVertexUsed.end(), false);
+	// the surface extraction calls this for every mesh - reuse the memory of the mapping
+	static thread_local std::vector<IndexType> newPos;
+	const IndexType unusedVertex = std::numeric_limits<IndexType>::max();
+	newPos.assign(_vecVertices.size(), unusedVertex);
 
-	for (uint32_t triCt = 0; triCt < _vecIndices.size(); triCt++) {
-		int v = _vecIndices[triCt];
-		isVertexUsed[v] = true;
+	for (const IndexType index : _vecIndices) {
+		newPos[index] = 0u;
 	}
 
-	int noOfUsedVertices = 0;
-	std::vector<uint32_t> newPos(_vecVertices.size());
+	IndexType noOfUsedVertices = 0u;
 	for (size_t vertCt = 0; vertCt < _vecVertices.size(); vertCt++) {
-		if (isVertexUsed[vertCt]) {
+		if (newPos[vertCt] != unusedVertex) {
 			_vecVertices[noOfUsedVertices] = _vecVertices[vertCt];
 			newPos[vertCt] = noOfUsedVertices;
 			noOfUsedVertices++;
@@ -64,10 +65,14 @@ void Mesh::removeUnusedVertices() {
 
 	_vecVertices.resize(noOfUsedVertices);
 
-	for (size_t triCt = 0; triCt < _vecIndices.size(); triCt++) {
-		_vecIndices[triCt] = newPos[_vecIndices[triCt]];
+	for (IndexType& index : _vecIndices) {
+		index = newPos[index];
 	}
-	_vecIndices.resize(_vecIndices.size());
-}
 
+	// don't keep the memory of a huge mesh around
+	static const size_t maxRetainedPositions = 1024u * 1024u;
+	if (newPos.capacity() > maxRetainedPositions) {
+		std::vector<IndexType>().swap(newPos);
+	}
+}
 }
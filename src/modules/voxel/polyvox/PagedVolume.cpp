@@ -6,6 +6,7 @@
 #include "Morton.h"
 #include "Utility.h"
 #include "core/Log.h"
+#include <algorithm>
 
 namespace voxel {
 
@@ -32,21 +33,22 @@ PagedVolume::PagedVolume(Pager* pPager, uint32_t uTargetMemoryUsageInBytes, uint
 	// Use to perform modulo by bit operations
 	_chunkMask = _chunkSideLength - 1;
 
-	// Calculate the number of chunks based on the memory limit and the size of each chunk.
-	uint32_t uChunkSizeInBytes = PagedVolume::Chunk::calculateSizeInBytes(_chunkSideLength);
-	_chunkCountLimit = uTargetMemoryUsageInBytes / uChunkSizeInBytes;
+	// Calculate the number of chunks based on the memory limit and the size of each chunk. Chunks that are
+	// not in use are compressed before they are evicted - so usually many more chunks fit into the memory limit.
+	const uint32_t uChunkSizeInBytes = PagedVolume::Chunk::calculateSizeInBytes(_chunkSideLength);
+	_targetMemoryUsageInBytes = uTargetMemoryUsageInBytes;
 
 	// Enforce sensible limits on the number of chunks.
 	const uint32_t uMinPracticalNoOfChunks = 32; // Enough to make sure a chunks and it's neighbours can be loaded, with a few to spare.
-	if (_chunkCountLimit < uMinPracticalNoOfChunks) {
-		Log::warn("Requested memory usage limit of %uMb is too low and cannot be adhered to. Chunk limit is at %i, Chunk size: %uKb",
-				uTargetMemoryUsageInBytes / (1024 * 1024), _chunkCountLimit, uChunkSizeInBytes / 1024);
+	if (uTargetMemoryUsageInBytes / uChunkSizeInBytes < uMinPracticalNoOfChunks) {
+		Log::warn("Requested memory usage limit of %uMb is too low and cannot be adhered to. Chunk size: %uKb",
+				uTargetMemoryUsageInBytes / (1024 * 1024), uChunkSizeInBytes / 1024);
 	}
-	_chunkCountLimit = std::max(_chunkCountLimit, uMinPracticalNoOfChunks);
+	_chunkCountLimit = uMinPracticalNoOfChunks;
 
 	// Inform the user about the chosen memory configuration.
-	Log::debug("Memory usage limit for volume now set to %uMb (%u chunks of %uKb each).",
-			(_chunkCountLimit * uChunkSizeInBytes) / (1024 * 1024), _chunkCountLimit, uChunkSizeInBytes / 1024);
+	Log::debug("Memory usage limit for volume now set to %uMb (%u uncompressed chunks of %uKb each).",
+			uTargetMemoryUsageInBytes / (1024 * 1024), uTargetMemoryUsageInBytes / uChunkSizeInBytes, uChunkSizeInBytes / 1024);
 }
 
 /**
@@ -149,77 +151,143 @@ void PagedVolume::setVoxels(int32_t uXPos, int32_t uYPos, int32_t uZPos, int nx,
  */
 void PagedVolume::flushAll() {
 	core::RecursiveScopedWriteLock writeLock(_rwLock);
-	// Clear this pointer as all chunks are about to be removed.
-	_lastAccessedChunk = ChunkPtr();
+	for (Chunk* chunk : _clock) {
+		chunk->_removed = true;
+		chunk->detachMemoryUsage();
+	}
+	_clock.clear();
+	_clockHand = _clock.end();
 
 	// Erase all the most recently used chunks.
-	_chunks.clear();
+	for (ChunkShard& shard : _shards) {
+		ChunkMap chunks;
+		{
+			core::ScopedWriteLock shardLock(shard.lock);
+			chunks.swap(shard.chunks);
+		}
+		// the chunks are paged out outside of the shard lock
+		_chunkCount -= chunks.size();
+	}
+}
+
+PagedVolume::ChunkShard& PagedVolume::shard(const glm::ivec3& pos) const {
+	static_assert((CHUNK_SHARDS & (CHUNK_SHARDS - 1)) == 0, "The amount of shards must be a power of two");
+	const uint32_t hash = ((uint32_t)pos.x * 73856093u) ^ ((uint32_t)pos.y * 19349663u) ^ ((uint32_t)pos.z * 83492791u);
+	return _shards[hash & (CHUNK_SHARDS - 1)];
 }
 
 /**
- * Starting at the position indicated by the hash, and then search through the whole array looking for a chunk with the correct
- * position. In most cases we expect to find it in the first place we look. Note that this algorithm is slow in the case that
- * the chunk is not found because the whole array has to be searched, but in this case we are going to have to page the data in
- * from an external source which is likely to be slow anyway.
+ * Look up the chunk in the hash map and mark it as recently used to give it a second chance when the clock hand passes by.
  */
 PagedVolume::ChunkPtr PagedVolume::existingChunk(int32_t chunkX, int32_t chunkY, int32_t chunkZ) const {
 	const glm::ivec3 pos(chunkX, chunkY, chunkZ);
-	auto i = _chunks.find(pos);
-	if (i == _chunks.end()) {
+	ChunkShard& s = shard(pos);
+	core::ScopedReadLock readLock(s.lock);
+	auto i = s.chunks.find(pos);
+	if (i == s.chunks.end()) {
 		return nullptr;
 	}
 	const PagedVolume::ChunkPtr& chunk = i->second;
-	chunk->_chunkLastAccessed = ++_timestamper;
+	chunk->_recentlyUsed = true;
 	return chunk;
 }
 
+void PagedVolume::removeChunk(const ChunkPtr& chunk) const {
+	{
+		core::RecursiveScopedReadLock readLock(_listenerLock);
+		for (IChunkListener* l : _listener) {
+			l->onRemove(chunk);
+		}
+	}
+	if (_clockHand == chunk->_clockPosition) {
+		++_clockHand;
+	}
+	_clock.erase(chunk->_clockPosition);
+	chunk->_removed = true;
+	chunk->detachMemoryUsage();
+	ChunkShard& s = shard(chunk->_chunkSpacePosition);
+	core::ScopedWriteLock shardLock(s.lock);
+	s.chunks.erase(chunk->_chunkSpacePosition);
+	--_chunkCount;
+}
+
 /**
- * As we have added a chunk we may have exceeded our target chunk limit. Search through the array to
- * determine how many chunks we have, as well as finding the oldest timestamp. Note that this is potentially
- * wasteful and we may instead wish to track how many chunks we have and/or delete a chunk at random (or
- * just check e.g. 10 and delete the oldest of those) but we'll see if this is a bottleneck first. Paging
- * the data in is probably more expensive.
+ * As we have added a chunk we may have exceeded our target memory usage. The clock hand moves over the chunks
+ * and gives every chunk that was accessed since the last visit a second chance. Other chunks are compressed if
+ * they are not referenced outside of the volume - or deleted otherwise. Every step of the hand either clears the
+ * flag of an access, compresses or deletes a chunk. The steps per created chunk are limited - the remaining
+ * sweep is continued by the next creations.
  */
 void PagedVolume::deleteOldestChunkIfNeeded() const {
-	const std::size_t chunkCount = _chunks.size();
-	if (chunkCount < _chunkCountLimit) {
-		return;
-	}
-	glm::ivec3 oldestChunkPos;
-	bool foundOldestChunk = false;
-	uint32_t oldestChunkTimestamp = std::numeric_limits<uint32_t>::max();
-	for (ChunkMap::iterator i = _chunks.begin(); i != _chunks.end(); ++i) {
-		const glm::ivec3& pos = i->first;
-		const ChunkPtr& chunk = i->second;
-		if (chunk->_chunkLastAccessed < oldestChunkTimestamp) {
-			oldestChunkTimestamp = chunk->_chunkLastAccessed;
-			foundOldestChunk = true;
-			oldestChunkPos = pos;
+	// at most three rounds: clear the access flags, compress and delete
+	std::size_t steps = std::min(_clock.size() * 3u, (std::size_t)MAX_CLOCK_STEPS);
+	while (_memoryUsageInBytes > _targetMemoryUsageInBytes && _chunkCount > _chunkCountLimit && steps-- > 0u) {
+		if (_clockHand == _clock.end()) {
+			_clockHand = _clock.begin();
 		}
-	}
-	if (foundOldestChunk) {
-		ChunkMap::iterator i = _chunks.find(oldestChunkPos);
-		core::RecursiveScopedReadLock readLock(_listenerLock);
-		for (IChunkListener* l : _listener) {
-			l->onRemove(i->second);
+		Chunk* chunk = *_clockHand;
+		if (chunk->_recentlyUsed.exchange(false)) {
+			++_clockHand;
+			continue;
+		}
+		// we need a copy here - the map entry is removed
+		const ChunkPtr chunkPtr = chunk->shared_from_this();
+		if (compressIfUnused(chunkPtr)) {
+			++_clockHand;
+			continue;
 		}
-		_chunks.erase(i);
+		removeChunk(chunkPtr);
 	}
 }
 
+/**
+ * The lookups don't take the volume lock - so the chunk is unlinked from its shard and flagged as removed (for the
+ * per thread cache) before the references are counted. After that nobody can get a new reference, and if the given
+ * one is the only one left nobody holds a pointer into the voxel data or waits for the chunk lock.
+ */
+bool PagedVolume::compressIfUnused(const ChunkPtr& chunk) const {
+	const glm::ivec3& pos = chunk->_chunkSpacePosition;
+	ChunkShard& s = shard(pos);
+	chunk->_removed = true;
+	{
+		core::ScopedWriteLock shardLock(s.lock);
+		s.chunks.erase(pos);
+	}
+	bool compressed = false;
+	if (chunk.use_count() == 1 && chunk->_data != nullptr && !chunk->_incompressible) {
+		compressed = chunk->compress();
+	}
+	{
+		core::ScopedWriteLock shardLock(s.lock);
+		s.chunks.insert(std::make_pair(pos, chunk));
+	}
+	chunk->_removed = false;
+	return compressed;
+}
+
 PagedVolume::ChunkPtr PagedVolume::createNewChunk(int32_t chunkX, int32_t chunkY, int32_t chunkZ) const {
 	// The chunk was not found so we will create a new one.
 	glm::ivec3 pos(chunkX, chunkY, chunkZ);
 	Log::debug("create new chunk at %i:%i:%i", chunkX, chunkY, chunkZ);
 	ChunkPtr chunk = std::make_shared<Chunk>(pos, _chunkSideLength, _pager);
-	chunk->_chunkLastAccessed = ++_timestamper; // Important, as we may soon delete the oldest chunk
+	// Other threads can find the chunk as soon as it is inserted - they have to wait for the
+	// chunk lock until the pager is done
+	core::RecursiveScopedWriteLock chunkWriteLock(chunk->_rwLock);
 
 	{
 		core::RecursiveScopedWriteLock volumeWriteLock(_rwLock);
-		auto i = _chunks.insert(std::make_pair(pos, chunk));
-		if (!i.second) {
-			return i.first->second;
+		{
+			ChunkShard& s = shard(pos);
+			core::ScopedWriteLock shardLock(s.lock);
+			auto i = s.chunks.insert(std::make_pair(pos, chunk));
+			if (!i.second) {
+				return i.first->second;
+			}
 		}
+		++_chunkCount;
+		// Insert behind the hand - the new chunk is visited last
+		chunk->_clockPosition = _clock.insert(_clockHand, chunk.get());
+		chunk->attachMemoryUsage(&_memoryUsageInBytes);
 		deleteOldestChunkIfNeeded();
 	}
 
@@ -235,23 +303,42 @@ PagedVolume::ChunkPtr PagedVolume::createNewChunk(int32_t chunkX, int32_t chunkY
 
 	// Page the data in
 	// We'll use this later to decide if data needs to be paged out again.
-	core::RecursiveScopedWriteLock chunkWriteLock(chunk->_rwLock);
 	chunk->_dataModified = _pager->pageIn(pctx);
 	Log::debug("finished creating new chunk at %i:%i:%i", chunkX, chunkY, chunkZ);
 
 	return chunk;
 }
 
+namespace {
+
+/**
+ * Every thread remembers the chunk it accessed last. This doesn't keep the chunk alive - and thus
+ * doesn't prevent the chunk from being compressed or discarded.
+ */
+struct LastAccessedChunk {
+	const PagedVolume* volume = nullptr;
+	glm::ivec3 pos;
+	std::weak_ptr<PagedVolume::Chunk> chunk;
+};
+
+thread_local LastAccessedChunk lastAccessedChunk;
+
+}
+
 PagedVolume::ChunkPtr PagedVolume::chunk(int32_t chunkX, int32_t chunkY, int32_t chunkZ) const {
-	ChunkPtr chunk;
-	{
-		core::RecursiveScopedReadLock readLock(_rwLock);
-		if (chunkX == _lastAccessedChunkX && chunkY == _lastAccessedChunkY && chunkZ == _lastAccessedChunkZ && _lastAccessedChunk) {
-			return _lastAccessedChunk;
+	if (lastAccessedChunk.volume == this && lastAccessedChunk.pos.x == chunkX && lastAccessedChunk.pos.y == chunkY && lastAccessedChunk.pos.z == chunkZ) {
+		ChunkPtr chunk = lastAccessedChunk.chunk.lock();
+		if (chunk && !chunk->_removed) {
+			// avoid the write to the shared flag if it is already set
+			if (!chunk->_recentlyUsed) {
+				chunk->_recentlyUsed = true;
+			}
+			return chunk;
 		}
-		chunk = existingChunk(chunkX, chunkY, chunkZ);
 	}
 
+	ChunkPtr chunk = existingChunk(chunkX, chunkY, chunkZ);
+
 	// If we still haven't found the chunk then it's time to create a new one and page it in from disk.
 	if (!chunk) {
 		chunk = createNewChunk(chunkX, chunkY, chunkZ);
@@ -261,11 +348,9 @@ PagedVolume::ChunkPtr PagedVolume::chunk(int32_t chunkX, int32_t chunkY, int32_t
 		}
 	}
 
-	core::RecursiveScopedWriteLock writeLock(_rwLock);
-	_lastAccessedChunk = chunk;
-	_lastAccessedChunkX = chunkX;
-	_lastAccessedChunkY = chunkY;
-	_lastAccessedChunkZ = chunkZ;
+	lastAccessedChunk.volume = this;
+	lastAccessedChunk.pos = glm::ivec3(chunkX, chunkY, chunkZ);
+	lastAccessedChunk.chunk = chunk;
 
 	return chunk;
 }
@@ -274,11 +359,9 @@ PagedVolume::ChunkPtr PagedVolume::chunk(int32_t chunkX, int32_t chunkY, int32_t
  * Calculate the memory usage of the volume.
  */
 uint32_t PagedVolume::calculateSizeInBytes() {
-	core::RecursiveScopedReadLock readLock(_rwLock);
-	const std::size_t uChunkCount = _chunks.size();
 	// Note: We disregard the size of the other class members as they are likely to be very small compared to the size of the
-	// allocated voxel data. This also keeps the reported size as a power of two, which makes other memory calculations easier.
-	return PagedVolume::Chunk::calculateSizeInBytes(_chunkSideLength) * uChunkCount;
+	// allocated voxel data.
+	return _memoryUsageInBytes;
 }
 
 }
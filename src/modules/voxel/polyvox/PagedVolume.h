@@ -8,9 +8,11 @@
 #include "Region.h"
 #include "core/NonCopyable.h"
 #include "core/RecursiveReadWriteLock.h"
+#include "core/ReadWriteLock.h"
 #include <array>
 #include <memory>
 #include <atomic>
+#include <mutex>
 #include <list>
 #include <vector>
 #define GLM_ENABLE_EXPERIMENTAL
@@ -47,9 +49,32 @@ public:
 		Chunk(const glm::ivec3& v3dPosition, uint16_t uSideLength, Pager* pPager = nullptr);
 		~Chunk();
 
+		/**
+		 * @return The dense voxel data in morton order
+		 * @note A compressed chunk is decompressed by calling this. As long as the data is only read, the
+		 * chunk can be compressed again without rebuilding the palette. The samplers announce their writes
+		 * through the returned pointer with @c dataWritten().
+		 */
 		Voxel* data() const;
+		/**
+		 * @return The amount of memory the voxel data and the bookkeeping of the chunk currently occupy - this is
+		 * much smaller for a compressed chunk.
+		 */
 		uint32_t dataSizeInBytes() const;
 
+		/**
+		 * @brief Replaces the dense voxel data by a palette of the distinct voxels and
+		 * bit packed palette indices.
+		 *
+		 * The voxels can still be read without decompressing the chunk. Writing to the chunk
+		 * updates the packed indices in place as long as the voxel is already in the palette
+		 * or the palette has a free slot for the current index width. Otherwise the chunk gets
+		 * decompressed again.
+		 * @return @c false if the chunk contains too many distinct voxels to be compressed
+		 */
+		bool compress();
+		bool isCompressed() const;
+
 		bool containsPoint(const glm::ivec3& pos) const;
 		bool containsPoint(int32_t x, int32_t y, int32_t z) const;
 		Region region() const;
@@ -63,15 +88,51 @@ public:
 		void setVoxel(const glm::i16vec3& v3dPos, const Voxel& tValue);
 
 	private:
-		// This is updated by the PagedVolume and used to discard the least recently used chunks.
-		uint32_t _chunkLastAccessed = 0u;
+		// This is set by the PagedVolume on every access and cleared by the clock hand that
+		// looks for chunks to compress or discard (second chance).
+		std::atomic_bool _recentlyUsed { true };
+		// The position in the clock of the volume - only valid as long as the chunk is part of the volume
+		std::list<Chunk*>::iterator _clockPosition;
+
+		// Set if the chunk was removed from the volume - while some users might still hold a reference
+		std::atomic_bool _removed { false };
+
+		// The memory usage counter of the volume the chunk belongs to. Every size change of
+		// the chunk is forwarded to it.
+		std::atomic_uint* _volumeMemoryUsage = nullptr;
+		mutable std::mutex _volumeMemoryUsageMutex;
+		void attachMemoryUsage(std::atomic_uint* memoryUsage);
+		void detachMemoryUsage();
 
 		uint32_t calculateSizeInBytes() const;
 		static uint32_t calculateSizeInBytes(uint32_t uSideLength);
 
-		Voxel* _data = nullptr;
+		// expects the write lock to be held
+		void decompress() const;
+		// called after the dense data was modified through the pointer returned by data()
+		void dataWritten();
+		uint32_t paletteIndex(uint32_t index) const;
+		void setPaletteIndex(uint32_t index, uint32_t paletteIndex);
+		const Voxel& voxelByIndex(uint32_t index) const;
+		void updateDataSize() const;
+
+		// only valid if the chunk is not compressed
+		mutable Voxel* _data = nullptr;
 		uint16_t _sideLength = 0u;
 
+		// the distinct voxels of a compressed chunk
+		mutable std::vector<Voxel> _palette;
+		// the palette indices of a compressed chunk - packed into 32 bit words in morton order
+		mutable std::vector<uint32_t> _indices;
+		// 0, 1, 2, 4 or 8 bits - the indices never cross a word boundary
+		mutable uint8_t _bitsPerIndex = 0u;
+		mutable uint8_t _indicesPerWordPower = 0u;
+		// set if the palette and the indices still match the dense data - compressing only has to free the dense data then
+		mutable bool _paletteValid = false;
+		mutable std::atomic_uint _dataSizeInBytes { 0u };
+		// set if the last compression attempt failed and the chunk wasn't modified since then
+		bool _incompressible = false;
+
 		// This is so we can tell whether a uncompressed chunk has to be recompressed and whether
 		// a compressed chunk has to be paged back to disk, or whether they can just be discarded.
 		bool _dataModified = false;
@@ -82,7 +143,7 @@ public:
 		// Note: Do we really need to store this position here as well as in the block maps?
 		glm::ivec3 _chunkSpacePosition;
 
-		core::RecursiveReadWriteLock _rwLock{"chunk"};
+		mutable core::RecursiveReadWriteLock _rwLock{"chunk"};
 	};
 	typedef std::shared_ptr<Chunk> ChunkPtr;
 
@@ -206,6 +267,8 @@ public:
 		BufferedSampler(const PagedVolume* volume, const Region& region);
 		BufferedSampler(const PagedVolume& volume, const Region& region);
 		~BufferedSampler();
+		BufferedSampler(const BufferedSampler&) = delete;
+		BufferedSampler& operator=(const BufferedSampler&) = delete;
 
 		const Voxel& voxel() const;
 
@@ -253,9 +316,11 @@ public:
 		const Voxel& peekVoxel1px1py1pz() const;
 
 	protected:
-		uint16_t index(int x, int y, int z) const;
+		uint32_t index(int x, int y, int z) const;
 
-		std::vector<Voxel> _buffer;
+		// taken from a per-thread pool and given back on destruction - so the memory is reused
+		std::vector<Voxel> _storage;
+		Voxel* _buffer = nullptr;
 
 		//The current position in the volume
 		int32_t _xPosInVolume = 0u;
@@ -272,7 +337,7 @@ public:
 		uint16_t _regionWidth;
 		uint16_t _regionHeight;
 		uint16_t _regionDepth;
-		uint16_t _zOffset;
+		uint32_t _zOffset;
 
 		int32_t _minsX;
 		int32_t _minsY;
@@ -304,7 +369,7 @@ public:
 	/// Removes all voxels from memory
 	void flushAll();
 
-	/// Calculates approximately how many bytes of memory the volume is currently using.
+	/// Calculates approximately how many bytes of memory the volume is currently using (compressed chunks are smaller).
 	uint32_t calculateSizeInBytes();
 	ChunkPtr chunk(const glm::ivec3& pos) const;
 
@@ -326,22 +391,36 @@ private:
 	ChunkPtr existingChunk(int32_t uChunkX, int32_t uChunkY, int32_t uChunkZ) const;
 	ChunkPtr createNewChunk(int32_t uChunkX, int32_t uChunkY, int32_t uChunkZ) const;
 	void deleteOldestChunkIfNeeded() const;
-
-	// Storing these properties individually has proved to be faster than keeping
-	// them in a glm::ivec3 as it avoids constructions and comparison overheads.
-	// They are also at the start of the class in the hope that they will be pulled
-	// into cache - I've got no idea if this actually makes a difference.
-	mutable int32_t _lastAccessedChunkX = 0;
-	mutable int32_t _lastAccessedChunkY = 0;
-	mutable int32_t _lastAccessedChunkZ = 0;
-	mutable ChunkPtr _lastAccessedChunk = nullptr;
-
-	mutable std::atomic_uint _timestamper { 0u };
+	/**
+	 * @return @c true if the chunk was compressed - this is only done if nobody but the caller holds a reference to it
+	 */
+	bool compressIfUnused(const ChunkPtr& chunk) const;
 
 	uint32_t _chunkCountLimit = 0u;
+	uint32_t _targetMemoryUsageInBytes = 0u;
+	// the sum of the data sizes of all chunks in the volume
+	mutable std::atomic_uint _memoryUsageInBytes { 0u };
+
+	// All chunks of the volume in insertion order - the hand moves around this ring and gives
+	// recently used chunks a second chance before they are compressed or discarded.
+	mutable std::list<Chunk*> _clock;
+	mutable std::list<Chunk*>::iterator _clockHand = _clock.end();
+	// The maximum amount of steps the hand moves per created chunk - the memory usage might exceed the target
+	// for a few chunk creations, but the creation of a single chunk doesn't have to sweep the whole clock.
+	static constexpr int MAX_CLOCK_STEPS = 32;
+	void removeChunk(const ChunkPtr& chunk) const;
 
 	typedef std::unordered_map<glm::ivec3, ChunkPtr, std::hash<glm::ivec3> > ChunkMap;
-	mutable ChunkMap _chunks;
+	// The chunk map is split into shards with their own locks. Lookups only lock the shard of the
+	// chunk - so threads that access different chunks don't block each other.
+	static constexpr int CHUNK_SHARDS = 16;
+	struct ChunkShard {
+		core::ReadWriteLock lock {"chunkshard"};
+		ChunkMap chunks;
+	};
+	mutable std::array<ChunkShard, CHUNK_SHARDS> _shards;
+	mutable std::atomic_uint _chunkCount { 0u };
+	ChunkShard& shard(const glm::ivec3& pos) const;
 
 	// The size of the chunks
 	uint16_t _chunkSideLength;
@@ -350,6 +429,7 @@ private:
 
 	Pager* _pager = nullptr;
 
+	// Protects the creation and removal of chunks - but not the lookup of existing chunks
 	mutable core::RecursiveReadWriteLock _rwLock{"pagedvolume"};
 	mutable core::RecursiveReadWriteLock _listenerLock{"listener"};
 };
@@ -610,7 +690,7 @@ inline bool PagedVolume::BufferedSampler::setPosition(const glm::ivec3& v3dNewPo
 	return setPosition(v3dNewPos.x, v3dNewPos.y, v3dNewPos.z);
 }
 
-inline uint16_t PagedVolume::BufferedSampler::index(int x, int y, int z) const {
+inline uint32_t PagedVolume::BufferedSampler::index(int x, int y, int z) const {
 	core_assert_msg(x >= 0 && x < _regionWidth, "x: %i is out of bounds (0, %i)", x, _regionWidth);
 	core_assert_msg(y >= 0 && y < _regionHeight, "y: %i is out of bounds (0, %i)", y, _regionHeight);
 	core_assert_msg(z >= 0 && z < _regionDepth, "z: %i is out of bounds (0, %i)", z, _regionDepth);
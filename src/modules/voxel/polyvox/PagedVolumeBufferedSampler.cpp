@@ -7,9 +7,30 @@
 #include "Utility.h"
 #include "Morton.h"
 #include "core/TimeProvider.h"
+#include <algorithm>
+#include <vector>
 
 namespace voxel {
 
+namespace {
+
+/**
+ * @brief The voxel buffers of the destroyed samplers of this thread - the extraction of a region
+ * doesn't need to allocate memory as long as the buffer is big enough
+ */
+thread_local std::vector<std::vector<Voxel>> bufferPool;
+// the amount of buffers that are kept per thread - and the size of the biggest buffer that is kept
+const size_t maxPooledBuffers = 4u;
+const size_t maxPooledVoxels = 4u * 1024u * 1024u;
+
+/**
+ * @brief Keeps the chunks that are referenced while the region is copied. Only the entries starting
+ * at the size the list had when the sampler was created belong to the sampler.
+ */
+thread_local std::vector<std::pair<glm::ivec3, PagedVolume::ChunkPtr>> referencedChunks;
+
+}
+
 PagedVolume::BufferedSampler::BufferedSampler(const PagedVolume* volume, const Region& region) {
 	const int32_t chunkMask = volume->_chunkMask;
 	const uint8_t chunkSideLengthPower = volume->_chunkSideLengthPower;
@@ -23,14 +44,22 @@ PagedVolume::BufferedSampler::BufferedSampler(const PagedVolume* volume, const R
 	_regionDepth = r.getDepthInVoxels();
 	_zOffset = _regionWidth * _regionHeight;
 
-	_buffer.reserve(_zOffset * _regionDepth);
+	if (!bufferPool.empty()) {
+		_storage = std::move(bufferPool.back());
+		bufferPool.pop_back();
+	}
+	const size_t bufferSize = (size_t)_zOffset * _regionDepth;
+	if (_storage.size() < bufferSize) {
+		_storage.resize(bufferSize);
+	}
+	_buffer = _storage.data();
+
 	const glm::ivec3& offset = r.getLowerCorner();
 	const glm::ivec3& upper = r.getUpperCorner();
 	ChunkPtr chunk;
 
-	std::unordered_map<glm::ivec3, ChunkPtr> chunks;
+	const size_t firstChunk = referencedChunks.size();
 
-	core::RecursiveScopedReadLock readLock(volume->_rwLock);
 	glm::ivec3 chunkPos(std::numeric_limits<int>::min()), newChunkPos;
 	for (int32_t z = offset.z; z <= upper.z; ++z) {
 		const uint32_t regZ = z - offset.z;
@@ -43,25 +72,34 @@ PagedVolume::BufferedSampler::BufferedSampler(const PagedVolume* volume, const R
 			newChunkPos.y = y >> chunkSideLengthPower;
 
 			int vecIndex = index(0, regY, regZ);
-			for (int32_t x = offset.x; x <= upper.x; ++x, ++vecIndex) {
+			for (int32_t x = offset.x; x <= upper.x;) {
 				newChunkPos.x = x >> chunkSideLengthPower;
 				if (chunkPos != newChunkPos) {
 					chunkPos = newChunkPos;
-					auto i = chunks.find(chunkPos);
-					if (i != chunks.end()) {
+					// a region only touches a few chunks - a linear search is fine here
+					auto i = std::find_if(referencedChunks.begin() + firstChunk, referencedChunks.end(),
+						[&] (const std::pair<glm::ivec3, ChunkPtr>& e) { return e.first == chunkPos; });
+					if (i != referencedChunks.end()) {
 						chunk = i->second;
 					} else {
 						chunk = volume->chunk(chunkPos.x, chunkPos.y, chunkPos.z);
-						chunks[chunkPos] = chunk;
+						referencedChunks.emplace_back(chunkPos, chunk);
 					}
 				}
 
-				const uint16_t xOffset = static_cast<uint16_t>(x & chunkMask);
-				const uint32_t index = morton256_x[xOffset] | morton256_y[yOffset] | morton256_z[zOffset];
-				_buffer[vecIndex] = chunk->_data[index];
+				// the voxels of the row that are part of this chunk are copied at once. The chunk
+				// is modified (and paged in) under its write lock.
+				const int32_t chunkUpperX = std::min(upper.x, x | chunkMask);
+				core::RecursiveScopedReadLock chunkLock(chunk->_rwLock);
+				for (; x <= chunkUpperX; ++x, ++vecIndex) {
+					const uint16_t xOffset = static_cast<uint16_t>(x & chunkMask);
+					const uint32_t index = morton256_x[xOffset] | morton256_y[yOffset] | morton256_z[zOffset];
+					_buffer[vecIndex] = chunk->voxelByIndex(index);
+				}
 			}
 		}
 	}
+	referencedChunks.erase(referencedChunks.begin() + firstChunk, referencedChunks.end());
 }
 
 PagedVolume::BufferedSampler::BufferedSampler(const PagedVolume& volume, const Region& region) :
@@ -69,6 +107,9 @@ PagedVolume::BufferedSampler::BufferedSampler(const PagedVolume& volume, const R
 }
 
 PagedVolume::BufferedSampler::~BufferedSampler() {
+	if (!_storage.empty() && _storage.capacity() <= maxPooledVoxels && bufferPool.size() < maxPooledBuffers) {
+		bufferPool.push_back(std::move(_storage));
+	}
 }
 
 bool PagedVolume::BufferedSampler::setPosition(int32_t xPos, int32_t yPos, int32_t zPos) {
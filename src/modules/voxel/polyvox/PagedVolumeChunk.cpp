@@ -5,6 +5,7 @@
 #include "PagedVolume.h"
 #include "Morton.h"
 #include "Utility.h"
+#include <algorithm>
 
 namespace voxel {
 
@@ -21,23 +22,189 @@ PagedVolume::Chunk::Chunk(const glm::ivec3& v3dPosition, uint16_t uSideLength, P
 	const uint32_t uNoOfVoxels = _sideLength * _sideLength * _sideLength;
 	_data = (Voxel*)SDL_malloc(uNoOfVoxels * sizeof(Voxel));
 	memset(_data, 0, uNoOfVoxels * sizeof(Voxel));
+	updateDataSize();
 }
 
 PagedVolume::Chunk::~Chunk() {
 	if (_dataModified && _pager) {
 		_pager->pageOut(this);
 	}
+	detachMemoryUsage();
 
 	SDL_free(_data);
 	_data = nullptr;
 }
 
 Voxel* PagedVolume::Chunk::data() const {
+	{
+		core::RecursiveScopedReadLock readLock(_rwLock);
+		if (_data != nullptr) {
+			return _data;
+		}
+	}
+	core::RecursiveScopedWriteLock writeLock(_rwLock);
+	decompress();
 	return _data;
 }
 
+void PagedVolume::Chunk::dataWritten() {
+	core::RecursiveScopedWriteLock writeLock(_rwLock);
+	_dataModified = true;
+	_incompressible = false;
+	_paletteValid = false;
+}
+
 uint32_t PagedVolume::Chunk::dataSizeInBytes() const {
-	return _sideLength * _sideLength * _sideLength * sizeof(Voxel);
+	return _dataSizeInBytes;
+}
+
+void PagedVolume::Chunk::updateDataSize() const {
+	// the chunk itself, the node in the chunk map of the volume (with the cached hash and the bucket) and the node in the clock
+	constexpr uint32_t overhead = sizeof(Chunk) + sizeof(std::pair<const glm::ivec3, ChunkPtr>) + sizeof(std::size_t) + 2 * sizeof(void*)
+			+ sizeof(Chunk*) + 2 * sizeof(void*);
+	uint32_t size = overhead + _indices.capacity() * sizeof(uint32_t) + _palette.capacity() * sizeof(Voxel);
+	if (_data != nullptr) {
+		size += calculateSizeInBytes();
+	}
+	std::lock_guard<std::mutex> lock(_volumeMemoryUsageMutex);
+	const uint32_t oldSize = _dataSizeInBytes.exchange(size);
+	if (_volumeMemoryUsage != nullptr) {
+		*_volumeMemoryUsage += size;
+		*_volumeMemoryUsage -= oldSize;
+	}
+}
+
+void PagedVolume::Chunk::attachMemoryUsage(std::atomic_uint* memoryUsage) {
+	std::lock_guard<std::mutex> lock(_volumeMemoryUsageMutex);
+	core_assert(_volumeMemoryUsage == nullptr);
+	_volumeMemoryUsage = memoryUsage;
+	*_volumeMemoryUsage += _dataSizeInBytes;
+}
+
+void PagedVolume::Chunk::detachMemoryUsage() {
+	std::lock_guard<std::mutex> lock(_volumeMemoryUsageMutex);
+	if (_volumeMemoryUsage == nullptr) {
+		return;
+	}
+	*_volumeMemoryUsage -= _dataSizeInBytes;
+	_volumeMemoryUsage = nullptr;
+}
+
+bool PagedVolume::Chunk::isCompressed() const {
+	core::RecursiveScopedReadLock readLock(_rwLock);
+	return _data == nullptr;
+}
+
+bool PagedVolume::Chunk::compress() {
+	core::RecursiveScopedWriteLock writeLock(_rwLock);
+	if (_data == nullptr) {
+		return true;
+	}
+	if (_paletteValid) {
+		// the chunk was only read since it was decompressed - the palette and the indices are still up to date
+		SDL_free(_data);
+		_data = nullptr;
+		_paletteValid = false;
+		updateDataSize();
+		return true;
+	}
+	const uint32_t voxelCount = _sideLength * _sideLength * _sideLength;
+	std::vector<uint8_t> paletteIndices(voxelCount);
+	std::vector<Voxel> palette;
+	palette.reserve(256);
+	// neighbouring voxels are likely the same - so check the last match first
+	uint32_t lastPaletteIndex = 0u;
+	for (uint32_t i = 0u; i < voxelCount; ++i) {
+		const Voxel& voxel = _data[i];
+		if (palette.empty() || !palette[lastPaletteIndex].isSame(voxel)) {
+			auto iter = std::find_if(palette.begin(), palette.end(), [&] (const Voxel& v) { return v.isSame(voxel); });
+			if (iter == palette.end()) {
+				if (palette.size() >= 256) {
+					_incompressible = true;
+					return false;
+				}
+				palette.push_back(voxel);
+				iter = palette.end() - 1;
+			}
+			lastPaletteIndex = (uint32_t)std::distance(palette.begin(), iter);
+		}
+		paletteIndices[i] = (uint8_t)lastPaletteIndex;
+	}
+
+	if (palette.size() <= 1) {
+		_bitsPerIndex = 0u;
+	} else if (palette.size() <= 2) {
+		_bitsPerIndex = 1u;
+	} else if (palette.size() <= 4) {
+		_bitsPerIndex = 2u;
+	} else if (palette.size() <= 16) {
+		_bitsPerIndex = 4u;
+	} else {
+		_bitsPerIndex = 8u;
+	}
+	std::vector<uint32_t>().swap(_indices);
+	if (_bitsPerIndex > 0u) {
+		_indicesPerWordPower = logBase2(32u / _bitsPerIndex);
+		const uint32_t indicesPerWord = 1u << _indicesPerWordPower;
+		_indices.assign((voxelCount + indicesPerWord - 1u) / indicesPerWord, 0u);
+		for (uint32_t i = 0u; i < voxelCount; ++i) {
+			setPaletteIndex(i, paletteIndices[i]);
+		}
+	}
+	// reserve all slots that are addressable with the current index width to
+	// not invalidate references to the palette entries on writes
+	std::vector<Voxel>().swap(_palette);
+	_palette.reserve(1u << _bitsPerIndex);
+	_palette.insert(_palette.end(), palette.begin(), palette.end());
+
+	SDL_free(_data);
+	_data = nullptr;
+	updateDataSize();
+	return true;
+}
+
+void PagedVolume::Chunk::decompress() const {
+	if (_data != nullptr) {
+		return;
+	}
+	const uint32_t voxelCount = _sideLength * _sideLength * _sideLength;
+	Voxel* data = (Voxel*)SDL_malloc(voxelCount * sizeof(Voxel));
+	for (uint32_t i = 0u; i < voxelCount; ++i) {
+		data[i] = _palette[paletteIndex(i)];
+	}
+	// the palette and the indices are only released by the next compress() call. The buffered
+	// sampler reads without the chunk lock and references to the palette entries were handed out
+	// by voxel().
+	_data = data;
+	_paletteValid = true;
+	updateDataSize();
+}
+
+uint32_t PagedVolume::Chunk::paletteIndex(uint32_t index) const {
+	if (_bitsPerIndex == 0u) {
+		return 0u;
+	}
+	const uint32_t word = _indices[index >> _indicesPerWordPower];
+	const uint32_t shift = (index & ((1u << _indicesPerWordPower) - 1u)) * _bitsPerIndex;
+	return (word >> shift) & ((1u << _bitsPerIndex) - 1u);
+}
+
+void PagedVolume::Chunk::setPaletteIndex(uint32_t index, uint32_t paletteIndex) {
+	if (_bitsPerIndex == 0u) {
+		core_assert(paletteIndex == 0u);
+		return;
+	}
+	uint32_t& word = _indices[index >> _indicesPerWordPower];
+	const uint32_t shift = (index & ((1u << _indicesPerWordPower) - 1u)) * _bitsPerIndex;
+	const uint32_t mask = ((1u << _bitsPerIndex) - 1u) << shift;
+	word = (word & ~mask) | ((paletteIndex << shift) & mask);
+}
+
+const Voxel& PagedVolume::Chunk::voxelByIndex(uint32_t index) const {
+	if (_data != nullptr) {
+		return _data[index];
+	}
+	return _palette[paletteIndex(index)];
 }
 
 const Voxel& PagedVolume::Chunk::voxel(uint32_t uXPos, uint32_t uYPos, uint32_t uZPos) const {
@@ -46,11 +213,10 @@ const Voxel& PagedVolume::Chunk::voxel(uint32_t uXPos, uint32_t uYPos, uint32_t
 	core_assert_msg(uXPos < _sideLength, "Supplied position is outside of the chunk. asserted %u > %u", uXPos, _sideLength);
 	core_assert_msg(uYPos < _sideLength, "Supplied position is outside of the chunk. asserted %u > %u", uYPos, _sideLength);
 	core_assert_msg(uZPos < _sideLength, "Supplied position is outside of the chunk. asserted %u > %u", uZPos, _sideLength);
-	core_assert_msg(_data, "No uncompressed data - chunk must be decompressed before accessing voxels.");
 
 	const uint32_t index = morton256_x[uXPos] | morton256_y[uYPos] | morton256_z[uZPos];
 	core::RecursiveScopedReadLock readLock(_rwLock);
-	return _data[index];
+	return voxelByIndex(index);
 }
 
 const Voxel& PagedVolume::Chunk::voxel(const glm::i16vec3& v3dPos) const {
@@ -63,12 +229,29 @@ void PagedVolume::Chunk::setVoxel(uint32_t uXPos, uint32_t uYPos, uint32_t uZPos
 	core_assert_msg(uXPos < _sideLength, "Supplied position is outside of the chunk");
 	core_assert_msg(uYPos < _sideLength, "Supplied position is outside of the chunk");
 	core_assert_msg(uZPos < _sideLength, "Supplied position is outside of the chunk");
-	core_assert_msg(_data, "No uncompressed data - chunk must be decompressed before accessing voxels.");
 
 	const uint32_t index = morton256_x[uXPos] | morton256_y[uYPos] | morton256_z[uZPos];
 	core::RecursiveScopedWriteLock writeLock(_rwLock);
-	_data[index] = tValue;
 	_dataModified = true;
+	_incompressible = false;
+	if (_data != nullptr) {
+		_data[index] = tValue;
+		_paletteValid = false;
+		return;
+	}
+	auto iter = std::find_if(_palette.begin(), _palette.end(), [&] (const Voxel& v) { return v.isSame(tValue); });
+	if (iter == _palette.end()) {
+		if (_palette.size() >= (1u << _bitsPerIndex)) {
+			// the current index width can't address another palette entry
+			decompress();
+			_data[index] = tValue;
+			_paletteValid = false;
+			return;
+		}
+		_palette.push_back(tValue);
+		iter = _palette.end() - 1;
+	}
+	setPaletteIndex(index, (uint32_t)std::distance(_palette.begin(), iter));
 }
 
 void PagedVolume::Chunk::setVoxels(uint32_t uXPos, uint32_t uZPos, const Voxel* tValues, int amount) {
@@ -82,9 +265,11 @@ void PagedVolume::Chunk::setVoxels(uint32_t uXPos, uint32_t uYPos, uint32_t uZPo
 	core_assert_msg(uXPos < _sideLength, "Supplied x position is outside of the chunk");
 	core_assert_msg(uYPos < _sideLength, "Supplied y position is outside of the chunk");
 	core_assert_msg(uZPos < _sideLength, "Supplied z position is outside of the chunk");
-	core_assert_msg(_data, "No uncompressed data - chunk must be decompressed before accessing voxels.");
 
 	core::RecursiveScopedWriteLock writeLock(_rwLock);
+	decompress();
+	_incompressible = false;
+	_paletteValid = false;
 	for (int y = uYPos; y < amount; ++y) {
 		const uint32_t index = morton256_x[uXPos] | morton256_y[y] | morton256_z[uZPos];
 		_data[index] = tValues[y];
@@ -51,7 +51,7 @@ void PagedVolume::Sampler::setPosition(int32_t xPos, int32_t yPos, int32_t zPos)
 	const uint32_t voxelIndexInChunk = morton256_x[_xPosInChunk] | morton256_y[_yPosInChunk] | morton256_z[_zPosInChunk];
 
 	_currentChunk = _volume->chunk(xChunk, yChunk, zChunk);
-	_currentVoxel = _currentChunk->_data + voxelIndexInChunk;
+	_currentVoxel = _currentChunk->data() + voxelIndexInChunk;
 }
 
 bool PagedVolume::Sampler::setVoxel(const Voxel& tValue) {
@@ -61,6 +61,7 @@ bool PagedVolume::Sampler::setVoxel(const Voxel& tValue) {
 	//Need to think what effect this has on any existing iterators.
 	//core_assert_msg(false, "This function cannot be used on PagedVolume samplers.");
 	*_currentVoxel = tValue;
+	_currentChunk->dataWritten();
 	return true;
 }
 
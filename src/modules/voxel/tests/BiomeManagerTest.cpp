@@ -95,4 +95,64 @@ TEST_F(BiomeManagerTest, testCityGradient) {
 		<< "Out of the radius of the city - here we should not have any influence on the height anymore";
 }
 
+TEST_F(BiomeManagerTest, testBiomeLookup) {
+	BiomeManager mgr;
+	mgr.init("");
+	std::vector<const Biome*> biomes;
+	const VoxelType types[] = {VoxelType::Grass, VoxelType::Sand, VoxelType::Rock, VoxelType::Dirt};
+	for (int i = 0; i < 40; ++i) {
+		const int lower = _random.random(0, MAX_HEIGHT);
+		const int upper = _random.random(lower, MAX_HEIGHT);
+		const Biome* biome = mgr.addBiome(lower, upper, _random.randomf(0.0f, 1.0f), _random.randomf(0.0f, 1.0f), types[i % 4], i % 3 == 0);
+		ASSERT_NE(nullptr, biome);
+		biomes.push_back(biome);
+	}
+	for (int i = 0; i < 10000; ++i) {
+		const glm::ivec3 pos(0, _random.random(-10, MAX_HEIGHT + 10), 0);
+		const float humidity = _random.randomf(0.0f, 1.0f);
+		const float temperature = _random.randomf(0.0f, 1.0f);
+		const bool underground = i % 2 == 0;
+		// the closest biome that matches the height
+		const Biome* expected = nullptr;
+		float distMin = std::numeric_limits<float>::max();
+		for (const Biome* biome : biomes) {
+			if (pos.y > biome->yMax || pos.y < biome->yMin || biome->underground != underground) {
+				continue;
+			}
+			const float dT = temperature - biome->temperature;
+			const float dH = humidity - biome->humidity;
+			const float dist = dT * dT + dH * dH;
+			if (dist < distMin) {
+				expected = biome;
+				distMin = dist;
+			}
+		}
+		const Biome* biome = mgr.getBiome(pos, humidity, temperature, underground);
+		if (expected == nullptr) {
+			EXPECT_EQ(std::find(biomes.begin(), biomes.end(), biome), biomes.end()) << "Expected the default biome at y " << pos.y;
+		} else {
+			ASSERT_EQ(expected, biome) << "Wrong biome for y " << pos.y << ", humidity " << humidity << " and temperature " << temperature;
+		}
+	}
+}
+
+TEST_F(BiomeManagerTest, testZones) {
+	BiomeManager mgr;
+	mgr.init("");
+	mgr.addZone(glm::ivec3(0), 100.0f, ZoneType::City);
+	mgr.addZone(glm::ivec3(-1000, 0, 2000), 1000.0f, ZoneType::City);
+	mgr.addZone(glm::ivec3(-1050, 0, 2000), 10.0f, ZoneType::City);
+	EXPECT_EQ(glm::ivec3(0), mgr.getZone(glm::ivec2(99, 0), ZoneType::City)->pos());
+	EXPECT_EQ(glm::ivec3(0), mgr.getZone(glm::ivec2(-70, -70), ZoneType::City)->pos());
+	EXPECT_EQ(nullptr, mgr.getZone(glm::ivec2(100, 0), ZoneType::City));
+	EXPECT_EQ(nullptr, mgr.getZone(glm::ivec2(-71, -71), ZoneType::City));
+	EXPECT_EQ(nullptr, mgr.getZone(glm::ivec2(500, 500), ZoneType::City));
+	// the zone that was added first wins
+	EXPECT_EQ(glm::ivec3(-1000, 0, 2000), mgr.getZone(glm::ivec2(-1050, 2000), ZoneType::City)->pos());
+	EXPECT_EQ(glm::ivec3(-1000, 0, 2000), mgr.getZone(glm::ivec2(-1999, 2000), ZoneType::City)->pos());
+	EXPECT_EQ(nullptr, mgr.getZone(glm::ivec2(-2000, 2000), ZoneType::City));
+	EXPECT_TRUE(mgr.hasCity(glm::ivec3(-1000, 0, 2999)));
+	EXPECT_FALSE(mgr.hasCity(glm::ivec3(-1000, 0, 3000)));
+}
+
 }
@@ -4,6 +4,9 @@
 
 #include "AbstractVoxelTest.h"
 #include "voxel/polyvox/PagedVolume.h"
+#include <thread>
+#include <atomic>
+#include <vector>
 
 namespace voxel {
 
@@ -28,4 +31,45 @@ TEST_F(PagedVolumeBufferedSamplerTest, testPeekUpperCorner) {
 	sampler.peekVoxel1px1py1pz();
 }
 
+TEST_F(PagedVolumeBufferedSamplerTest, testConcurrentAccess) {
+	// spans several chunks
+	const Region region(glm::ivec3(-64), glm::ivec3(127));
+	std::vector<glm::ivec3> positions;
+	std::vector<Voxel> expected;
+	PagedVolume::BufferedSampler reference(_volData, region);
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z += 7) {
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y += 7) {
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x += 7) {
+				const glm::ivec3 pos(x, y, z);
+				ASSERT_TRUE(reference.setPosition(pos));
+				positions.push_back(pos);
+				expected.push_back(reference.voxel());
+			}
+		}
+	}
+
+	std::atomic_int mismatches(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&] () {
+			PagedVolume::BufferedSampler sampler(_volData, region);
+			PagedVolume::Sampler volumeSampler(_volData);
+			for (size_t i = 0; i < positions.size(); ++i) {
+				const glm::ivec3& pos = positions[i];
+				volumeSampler.setPosition(pos);
+				if (!sampler.setPosition(pos) || !sampler.voxel().isSame(expected[i])) {
+					++mismatches;
+				}
+				if (!volumeSampler.voxel().isSame(expected[i]) || !_volData.voxel(pos).isSame(expected[i])) {
+					++mismatches;
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	EXPECT_EQ(0, mismatches);
+}
+
 }
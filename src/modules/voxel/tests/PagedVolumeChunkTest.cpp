@@ -0,0 +1,111 @@
+/**
+ * @file
+ */
+
+#include "AbstractVoxelTest.h"
+#include "voxel/polyvox/PagedVolume.h"
+
+namespace voxel {
+
+class PagedVolumeChunkTest: public AbstractVoxelTest {
+};
+
+TEST_F(PagedVolumeChunkTest, testCompressUniform) {
+	PagedVolume::Chunk chunk(glm::ivec3(0), 32, &_pager);
+	const uint32_t uncompressedSize = chunk.dataSizeInBytes();
+	ASSERT_FALSE(chunk.isCompressed());
+	ASSERT_TRUE(chunk.compress());
+	ASSERT_TRUE(chunk.isCompressed());
+	EXPECT_LT(chunk.dataSizeInBytes(), uncompressedSize / 100);
+	EXPECT_EQ(VoxelType::Air, chunk.voxel(31, 31, 31).getMaterial());
+
+	// the palette of a uniform chunk has no free slot - this must decompress the chunk
+	const Voxel voxel = createVoxel(VoxelType::Grass, 1);
+	chunk.setVoxel(1, 2, 3, voxel);
+	EXPECT_FALSE(chunk.isCompressed());
+	EXPECT_TRUE(chunk.voxel(1, 2, 3).isSame(voxel));
+	EXPECT_EQ(VoxelType::Air, chunk.voxel(3, 2, 1).getMaterial());
+}
+
+TEST_F(PagedVolumeChunkTest, testCompressRoundTrip) {
+	const PagedVolume::ChunkPtr& chunk = _volData.chunk(_region.getCentre());
+	const Region& region = chunk->region();
+	std::vector<Voxel> voxels;
+	for (int z = 0; z < region.getDepthInVoxels(); ++z) {
+		for (int y = 0; y < region.getHeightInVoxels(); ++y) {
+			for (int x = 0; x < region.getWidthInVoxels(); ++x) {
+				voxels.push_back(chunk->voxel(x, y, z));
+			}
+		}
+	}
+	const uint32_t uncompressedSize = chunk->dataSizeInBytes();
+	ASSERT_TRUE(chunk->compress());
+	ASSERT_TRUE(chunk->isCompressed());
+	EXPECT_LT(chunk->dataSizeInBytes(), uncompressedSize);
+
+	// modify a voxel that is already part of the palette - this is done in place
+	const Voxel air;
+	chunk->setVoxel(0, 0, 0, air);
+	voxels[0] = air;
+	EXPECT_TRUE(chunk->isCompressed());
+
+	int i = 0;
+	for (int z = 0; z < region.getDepthInVoxels(); ++z) {
+		for (int y = 0; y < region.getHeightInVoxels(); ++y) {
+			for (int x = 0; x < region.getWidthInVoxels(); ++x, ++i) {
+				ASSERT_TRUE(voxels[i].isSame(chunk->voxel(x, y, z))) << "compressed voxel at " << x << ":" << y << ":" << z << " differs";
+			}
+		}
+	}
+
+	ASSERT_NE(nullptr, chunk->data());
+	EXPECT_FALSE(chunk->isCompressed());
+	i = 0;
+	for (int z = 0; z < region.getDepthInVoxels(); ++z) {
+		for (int y = 0; y < region.getHeightInVoxels(); ++y) {
+			for (int x = 0; x < region.getWidthInVoxels(); ++x, ++i) {
+				ASSERT_TRUE(voxels[i].isSame(chunk->voxel(x, y, z))) << "decompressed voxel at " << x << ":" << y << ":" << z << " differs";
+			}
+		}
+	}
+}
+
+TEST_F(PagedVolumeChunkTest, testCompressAfterRead) {
+	PagedVolume::Chunk chunk(glm::ivec3(0), 32, &_pager);
+	const Voxel voxel = createVoxel(VoxelType::Grass, 1);
+	chunk.setVoxel(1, 2, 3, voxel);
+	ASSERT_TRUE(chunk.compress());
+	const uint32_t compressedSize = chunk.dataSizeInBytes();
+	EXPECT_GT(compressedSize, (uint32_t)sizeof(PagedVolume::Chunk));
+
+	// reading the dense data decompresses the chunk - the palette is reused by the next compression
+	ASSERT_NE(nullptr, chunk.data());
+	EXPECT_FALSE(chunk.isCompressed());
+	ASSERT_TRUE(chunk.compress());
+	EXPECT_TRUE(chunk.isCompressed());
+	EXPECT_EQ(compressedSize, chunk.dataSizeInBytes());
+	EXPECT_TRUE(chunk.voxel(1, 2, 3).isSame(voxel));
+	EXPECT_EQ(VoxelType::Air, chunk.voxel(3, 2, 1).getMaterial());
+
+	// a write to the dense data invalidates the palette
+	ASSERT_NE(nullptr, chunk.data());
+	const Voxel rock = createVoxel(VoxelType::Rock, 2);
+	chunk.setVoxel(3, 2, 1, rock);
+	ASSERT_TRUE(chunk.compress());
+	EXPECT_TRUE(chunk.voxel(1, 2, 3).isSame(voxel));
+	EXPECT_TRUE(chunk.voxel(3, 2, 1).isSame(rock));
+}
+
+TEST_F(PagedVolumeChunkTest, testCompressTooManyVoxels) {
+	PagedVolume::Chunk chunk(glm::ivec3(0), 32, &_pager);
+	int n = 0;
+	for (int z = 0; z < 32; ++z) {
+		for (int x = 0; x < 32; ++x, ++n) {
+			chunk.setVoxel(x, 0, z, createVoxel(n % 2 == 0 ? VoxelType::Grass : VoxelType::Rock, n % 256));
+		}
+	}
+	ASSERT_FALSE(chunk.compress());
+	EXPECT_FALSE(chunk.isCompressed());
+}
+
+}
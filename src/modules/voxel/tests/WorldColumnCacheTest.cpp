@@ -0,0 +1,84 @@
+/**
+ * @file
+ */
+
+#include "AbstractVoxelTest.h"
+#include "voxel/WorldColumnCache.h"
+#include "voxel/WorldContext.h"
+#include "voxel/BiomeManager.h"
+
+namespace voxel {
+
+class WorldColumnCacheTest: public AbstractVoxelTest {
+protected:
+	BiomeManager _biomeManager;
+	WorldContext _worldCtx;
+	const glm::ivec2 _noiseOffset { 123, -456 };
+
+	void SetUp() override {
+		AbstractVoxelTest::SetUp();
+		_biomeManager.init("");
+		_biomeManager.addZone(glm::ivec3(0), 50.0f, ZoneType::City);
+	}
+
+	void TearDown() override {
+		_biomeManager.shutdown();
+		AbstractVoxelTest::TearDown();
+	}
+};
+
+TEST_F(WorldColumnCacheTest, testColumn) {
+	WorldColumnCache cache;
+	cache.init(&_biomeManager, &_worldCtx, _noiseOffset);
+	for (const glm::ivec2& pos : {glm::ivec2(0), glm::ivec2(-1, -33), glm::ivec2(31, 32), glm::ivec2(-1000, 1000)}) {
+		ColumnData expected;
+		WorldColumnCache::compute(_biomeManager, _worldCtx, _noiseOffset, pos.x, pos.y, 1, 1, 1, &expected);
+		const ColumnData& column = cache.column(pos.x, pos.y);
+		EXPECT_FLOAT_EQ(expected.height, column.height) << "at " << pos.x << ":" << pos.y;
+		EXPECT_FLOAT_EQ(expected.humidity, column.humidity) << "at " << pos.x << ":" << pos.y;
+		EXPECT_FLOAT_EQ(expected.temperature, column.temperature) << "at " << pos.x << ":" << pos.y;
+		EXPECT_FLOAT_EQ(expected.cityMultiplier, column.cityMultiplier) << "at " << pos.x << ":" << pos.y;
+		EXPECT_EQ(expected.cityHeight, column.cityHeight) << "at " << pos.x << ":" << pos.y;
+	}
+	EXPECT_FLOAT_EQ(0.0f, cache.column(0, 0).cityMultiplier);
+}
+
+TEST_F(WorldColumnCacheTest, testTiles) {
+	WorldColumnCache cache(2);
+	cache.init(&_biomeManager, &_worldCtx, _noiseOffset);
+	const WorldColumnCache::TilePtr tile = cache.tile(-1, -1);
+	EXPECT_EQ(glm::ivec2(-WorldColumnCache::TILE_SIZE), tile->pos);
+	EXPECT_TRUE(tile->contains(-WorldColumnCache::TILE_SIZE, -1));
+	EXPECT_FALSE(tile->contains(0, -1));
+	EXPECT_EQ(tile, cache.tile(-WorldColumnCache::TILE_SIZE, -WorldColumnCache::TILE_SIZE));
+	EXPECT_EQ(1u, cache.size());
+
+	cache.tile(0, 0);
+	// the least recently used tile is dropped
+	cache.tile(-1, -1);
+	cache.tile(WorldColumnCache::TILE_SIZE, 0);
+	EXPECT_EQ(2u, cache.size());
+	EXPECT_EQ(tile, cache.tile(-1, -1));
+
+	cache.clear();
+	EXPECT_EQ(0u, cache.size());
+}
+
+TEST_F(WorldColumnCacheTest, testEviction) {
+	const int maxTiles = 4;
+	WorldColumnCache cache(maxTiles);
+	cache.init(&_biomeManager, &_worldCtx, _noiseOffset);
+	const WorldColumnCache::TilePtr first = cache.tile(0, 0);
+	for (int i = 1; i < 32; ++i) {
+		// keeps the first tile referenced
+		EXPECT_EQ(first, cache.tile(0, 0));
+		cache.tile(i * WorldColumnCache::TILE_SIZE, 0);
+		EXPECT_LE(cache.size(), (size_t)maxTiles);
+	}
+	EXPECT_EQ(first, cache.tile(0, 0)) << "A tile that is used all the time must not be dropped";
+	const WorldColumnCache::TilePtr last = cache.tile(31 * WorldColumnCache::TILE_SIZE, 0);
+	EXPECT_EQ(last, cache.tile(31 * WorldColumnCache::TILE_SIZE, 0));
+	EXPECT_EQ((size_t)maxTiles, cache.size());
+}
+
+}
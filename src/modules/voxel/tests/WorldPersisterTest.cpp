@@ -4,6 +4,9 @@
 
 #include "AbstractVoxelTest.h"
 #include "voxel/WorldPersister.h"
+#include "voxel/WorldRegionFile.h"
+#include "core/String.h"
+#include <cstdio>
 
 namespace voxel {
 
@@ -13,9 +16,10 @@ class WorldPersisterTest: public AbstractVoxelTest {
 TEST_F(WorldPersisterTest, testSaveLoad) {
 	WorldPersister persister;
 	ASSERT_TRUE(persister.save(_ctx.chunk().get(), _seed)) << "Could not save volume chunk";
+	persister.flush();
 
 	const voxel::Region region = _ctx.region();
-	const std::string& filename = persister.getWorldName(region, _seed);
+	const std::string& filename = persister.getRegionFileName(region, _seed);
 	const core::App* app = _testApp;
 	const io::FilesystemPtr& filesystem = app->filesystem();
 	ASSERT_TRUE(filesystem->open(filename)->exists()) << "Nothing was written into " << filename;
@@ -24,4 +28,88 @@ TEST_F(WorldPersisterTest, testSaveLoad) {
 	ASSERT_EQ(VoxelType::Grass, _volData.voxel(32, 32, 32).getMaterial());
 }
 
+TEST_F(WorldPersisterTest, testErase) {
+	WorldPersister persister;
+	ASSERT_TRUE(persister.save(_ctx.chunk().get(), _seed));
+	persister.flush();
+	persister.erase(_ctx.region(), _seed);
+	// not yet removed from the file - but the queued removal hides it
+	ASSERT_FALSE(persister.load(_ctx.chunk().get(), _seed)) << "The erased chunk must not be loaded";
+	persister.flush();
+	ASSERT_FALSE(persister.load(_ctx.chunk().get(), _seed)) << "The erased chunk must not be loaded";
+	persister.shutdown();
+
+	const std::string path = _testApp->filesystem()->homePath() + persister.getRegionFileName(_ctx.region(), _seed);
+	WorldRegionFile file(path);
+	ASSERT_TRUE(file.open());
+	EXPECT_FALSE(file.has(WorldRegionFile::slot(glm::ivec3(0))));
+}
+
+TEST_F(WorldPersisterTest, testSaveDifferentSeeds) {
+	const long seed1 = _seed + 1;
+	const long seed2 = _seed + 2;
+	WorldPersister persister;
+	// both saves are queued for the same chunk position
+	ASSERT_TRUE(persister.save(_ctx.chunk().get(), seed1));
+	ASSERT_TRUE(persister.save(_ctx.chunk().get(), seed2));
+	persister.flush();
+	persister.shutdown();
+	WorldPersister reader;
+	ASSERT_TRUE(reader.load(_ctx.chunk().get(), seed1)) << "The chunk of the first seed was not written";
+	ASSERT_TRUE(reader.load(_ctx.chunk().get(), seed2)) << "The chunk of the second seed was not written";
+}
+
+TEST_F(WorldPersisterTest, testMigrateLegacyFile) {
+	const long seed = _seed + 3;
+	const voxel::Region region = _ctx.region();
+	const std::string& homePath = _testApp->filesystem()->homePath();
+	const std::string regionPath = homePath + WorldPersister().getRegionFileName(region, seed);
+	const std::string legacyPath = homePath + core::string::format("world_%li_%i_%i_%i.wld", seed,
+			region.getLowerX(), region.getLowerY(), region.getLowerZ());
+	std::remove(regionPath.c_str());
+
+	// the slots have the same layout as the old files
+	std::vector<uint8_t> data;
+	{
+		WorldPersister persister;
+		ASSERT_TRUE(persister.save(_ctx.chunk().get(), seed));
+		persister.shutdown();
+		WorldRegionFile file(regionPath);
+		ASSERT_TRUE(file.open());
+		ASSERT_TRUE(file.read(WorldRegionFile::slot(glm::ivec3(0)), data));
+	}
+	std::remove(regionPath.c_str());
+	ASSERT_TRUE(_testApp->filesystem()->syswrite(legacyPath, data.data(), data.size()));
+
+	_volData.flushAll();
+	WorldPersister persister;
+	ASSERT_TRUE(persister.load(_ctx.chunk().get(), seed)) << "Could not load the chunk from " << legacyPath;
+	ASSERT_EQ(VoxelType::Grass, _volData.voxel(32, 32, 32).getMaterial());
+	persister.shutdown();
+	EXPECT_FALSE(io::File(legacyPath, io::FileMode::Read).exists()) << "The old file should have been removed";
+	WorldRegionFile file(regionPath);
+	ASSERT_TRUE(file.open());
+	EXPECT_TRUE(file.has(WorldRegionFile::slot(glm::ivec3(0)))) << "The chunk was not moved into the region file";
+}
+
+TEST_F(WorldPersisterTest, testSaveAfterShutdown) {
+	const long seed = _seed + 4;
+	const std::string path = _testApp->filesystem()->homePath() + WorldPersister().getRegionFileName(_ctx.region(), seed);
+	std::remove(path.c_str());
+	WorldPersister persister;
+	persister.shutdown();
+	// no io thread is started anymore - the chunk is written on the caller
+	ASSERT_TRUE(persister.save(_ctx.chunk().get(), seed));
+	_volData.flushAll();
+	ASSERT_TRUE(persister.load(_ctx.chunk().get(), seed));
+	ASSERT_EQ(VoxelType::Grass, _volData.voxel(32, 32, 32).getMaterial());
+	persister.erase(_ctx.region(), seed);
+	ASSERT_FALSE(persister.load(_ctx.chunk().get(), seed));
+	persister.shutdown();
+
+	WorldRegionFile file(path);
+	ASSERT_TRUE(file.open());
+	EXPECT_FALSE(file.has(WorldRegionFile::slot(glm::ivec3(0))));
+}
+
 }
@@ -0,0 +1,83 @@
+/**
+ * @file
+ */
+
+#include "core/tests/AbstractTest.h"
+#include "voxel/WorldRegionFile.h"
+#include "io/File.h"
+#include <cstdio>
+
+namespace voxel {
+
+class WorldRegionFileTest: public core::AbstractTest {
+};
+
+TEST_F(WorldRegionFileTest, testSlot) {
+	EXPECT_EQ(0, WorldRegionFile::slot(glm::ivec3(0)));
+	EXPECT_EQ(0, WorldRegionFile::slot(glm::ivec3(8, 16, -8)));
+	EXPECT_EQ(WorldRegionFile::SLOTS - 1, WorldRegionFile::slot(glm::ivec3(-1)));
+	EXPECT_EQ(glm::ivec3(-1, 0, 1), WorldRegionFile::regionPos(glm::ivec3(-1, 7, 8)));
+}
+
+TEST_F(WorldRegionFileTest, testWriteRead) {
+	const std::string path = _testApp->filesystem()->homePath() + "testregionfile.wrg";
+	// start without a file
+	std::remove(path.c_str());
+
+	const std::vector<uint8_t> small(100, 1u);
+	const std::vector<uint8_t> large(WorldRegionFile::SECTOR_SIZE * 2, 2u);
+	{
+		WorldRegionFile file(path);
+		ASSERT_TRUE(file.open());
+		ASSERT_FALSE(file.has(3));
+		ASSERT_TRUE(file.write(3, small.data(), small.size()));
+		ASSERT_TRUE(file.write(4, small.data(), small.size()));
+		// doesn't fit into the old sectors anymore
+		ASSERT_TRUE(file.write(3, large.data(), large.size()));
+	}
+	WorldRegionFile file(path);
+	ASSERT_TRUE(file.open());
+	ASSERT_TRUE(file.has(3));
+	ASSERT_TRUE(file.has(4));
+	ASSERT_FALSE(file.has(5));
+	std::vector<uint8_t> data;
+	ASSERT_TRUE(file.read(3, data));
+	ASSERT_EQ(large, data);
+	ASSERT_TRUE(file.read(4, data));
+	ASSERT_EQ(small, data);
+	ASSERT_FALSE(file.read(5, data));
+}
+
+TEST_F(WorldRegionFileTest, testReuseSectors) {
+	const std::string path = _testApp->filesystem()->homePath() + "testregionfilereuse.wrg";
+	std::remove(path.c_str());
+
+	const std::vector<uint8_t> small(100, 1u);
+	const std::vector<uint8_t> large(WorldRegionFile::SECTOR_SIZE * 2, 2u);
+	{
+		WorldRegionFile file(path);
+		ASSERT_TRUE(file.open());
+		ASSERT_TRUE(file.write(1, small.data(), small.size()));
+		ASSERT_TRUE(file.write(2, small.data(), small.size()));
+		ASSERT_TRUE(file.write(3, small.data(), small.size()));
+		// frees two adjacent sectors
+		ASSERT_TRUE(file.remove(1));
+		ASSERT_TRUE(file.remove(2));
+		ASSERT_FALSE(file.has(1));
+	}
+	const long sizeBefore = io::File(path, io::FileMode::Read).length();
+	{
+		// the gap is found again after reopening
+		WorldRegionFile file(path);
+		ASSERT_TRUE(file.open());
+		ASSERT_TRUE(file.write(4, large.data(), large.size()));
+		std::vector<uint8_t> data;
+		ASSERT_TRUE(file.read(4, data));
+		ASSERT_EQ(large, data);
+		ASSERT_TRUE(file.read(3, data));
+		ASSERT_EQ(small, data);
+	}
+	EXPECT_EQ(sizeBefore, io::File(path, io::FileMode::Read).length()) << "The freed sectors were not reused";
+}
+
+}
@@ -6,6 +6,7 @@
 
 #include "core/Var.h"
 #include "core/command/Command.h"
+#include "core/TimerWheel.h"
 #include "cooldown/CooldownProvider.h"
 #include "network/ServerMessageSender.h"
 #include "attrib/ContainerProvider.h"
@@ -17,8 +18,12 @@
 #include "backend/loop/ServerLoop.h"
 #include "backend/spawn/SpawnMgr.h"
 #include "persistence/DBHandler.h"
+#include "persistence/PersistenceMgr.h"
+#include "persistence/AsyncDBHandler.h"
 #include "stock/StockDataProvider.h"
+#include <algorithm>
 #include <cstdlib>
+#include <string>
 
 Server::Server(const network::ServerNetworkPtr& network, const backend::ServerLoopPtr& serverLoop,
 		const core::TimeProviderPtr& timeProvider, const io::FilesystemPtr& filesystem,
@@ -42,6 +47,9 @@ core::AppState Server::onConstruct() {
 	core::Var::get(cfg::ServerHost, "");
 	core::Var::get(cfg::ServerMaxClients, "1024");
 	core::Var::get(cfg::ServerSeed, "1");
+	// the backend callbacks of the ai tick (npcs, aggro, poi and world queries) are not yet safe for parallel ticks
+	core::Var::get(cfg::ServerAIThreads, "1");
+	core::Var::get(cfg::ServerStageThreads, "4");
 	core::Var::get(cfg::VoxelMeshSize, "16", core::CV_READONLY);
 	core::Var::get(cfg::DatabaseMinConnections, "2");
 	core::Var::get(cfg::DatabaseMaxConnections, "10");
@@ -93,6 +101,7 @@ int main(int argc, char *argv[]) {
 	const core::EventBusPtr& eventBus = std::make_shared<core::EventBus>();
 	const voxel::WorldPtr& world = std::make_shared<voxel::World>();
 	const core::TimeProviderPtr& timeProvider = std::make_shared<core::TimeProvider>();
+	const core::TimerWheelPtr& timerWheel = std::make_shared<core::TimerWheel>();
 	const io::FilesystemPtr& filesystem = std::make_shared<io::Filesystem>();
 	const backend::AIRegistryPtr& registry = std::make_shared<backend::AIRegistry>();
 	const attrib::ContainerProviderPtr& containerProvider = std::make_shared<attrib::ContainerProvider>();
@@ -108,15 +117,18 @@ int main(int argc, char *argv[]) {
 	const stock::StockProviderPtr& stockDataProvider = std::make_shared<stock::StockDataProvider>();
 	const poi::PoiProviderPtr& poiProvider = std::make_shared<poi::PoiProvider>(world, timeProvider);
 	const persistence::DBHandlerPtr& dbHandler = std::make_shared<persistence::DBHandler>();
+	const persistence::PersistenceMgrPtr& persistenceMgr = std::make_shared<persistence::PersistenceMgr>(eventBus);
+	const persistence::AsyncDBHandlerPtr& asyncDbHandler = std::make_shared<persistence::AsyncDBHandler>();
 	const backend::EntityStoragePtr& entityStorage = std::make_shared<backend::EntityStorage>(messageSender, world,
-			timeProvider, containerProvider, poiProvider, cooldownProvider, dbHandler, stockDataProvider, eventBus);
+			timeProvider, timerWheel, containerProvider, poiProvider, cooldownProvider, dbHandler, persistenceMgr,
+			asyncDbHandler, stockDataProvider, eventBus);
 	const backend::SpawnMgrPtr& spawnMgr = std::make_shared<backend::SpawnMgr>(world, entityStorage, messageSender,
-			timeProvider, loader, containerProvider, poiProvider, cooldownProvider);
+			timeProvider, timerWheel, loader, containerProvider, poiProvider, cooldownProvider);
 
 	const eventmgr::EventProviderPtr& eventProvider = std::make_shared<eventmgr::EventProvider>(dbHandler);
 	const eventmgr::EventMgrPtr& eventMgr = std::make_shared<eventmgr::EventMgr>(eventProvider, timeProvider);
 
-	const backend::ServerLoopPtr& serverLoop = std::make_shared<backend::ServerLoop>(dbHandler, network, spawnMgr,
+	const backend::ServerLoopPtr& serverLoop = std::make_shared<backend::ServerLoop>(dbHandler, persistenceMgr, asyncDbHandler, network, spawnMgr,
 			world, entityStorage, eventBus, registry, containerProvider, poiProvider, cooldownProvider, eventMgr,
 			stockDataProvider);
 